@@ -135,4 +135,48 @@ hrpsyspy [python arguments]
 \section python_binding Python bindings
 
 A python module hrpsys.so provides python bindings to setup and execute simulations interactively.
+
+\section hrpsys-bench hrpsys-bench
+
+measure controller kernels (filters, preview control, gait generation, force distribution, ...) with fixed inputs
+
+hrpsys-bench [options]
+
+--iterations [N]<br>
+&nbsp;&nbsp;Number of measured calls of each kernel (by default, 100000).<br>
+--warmup [N]<br>
+&nbsp;&nbsp;Number of calls before measurement (by default, 1000).<br>
+--filter [string]<br>
+&nbsp;&nbsp;Run only kernels whose names contain <i>string</i>.<br>
+--output [file]<br>
+&nbsp;&nbsp;Write results to <i>file</i> as well as the standard output.<br>
+--compare [file]<br>
+&nbsp;&nbsp;Compare with results written by --output. The exit status is 2 if a kernel regressed.<br>
+--threshold [ratio]<br>
+&nbsp;&nbsp;Ratio of p50 to the baseline regarded as a regression (by default, 1.2). Increase of allocations is always a regression.<br>
+
+Each line of results consists of the name, iterations, p50, p99, mean and max duration of a call[ns] and heap allocations per call. The allocations are counted only with glibc and -1 otherwise.
+
+\section hrpsys-replay hrpsys-replay
+
+execute an RTC in this process with inputs read from logs saved by DataLogger, as fast as possible
+
+hrpsys-replay --module [path] --log [basename] [options] [RTM options]
+
+--module [path]<br>
+&nbsp;&nbsp;Shared library of the RTC such as <i>Stabilizer.so</i> (Required).<br>
+--factory [name]<br>
+&nbsp;&nbsp;Factory name of the RTC (by default, basename of the module).<br>
+--log [basename]<br>
+&nbsp;&nbsp;Basename of logs, <i>basename.portname</i> files written by DataLogger (Required).<br>
+--connect [inport:logport]<br>
+&nbsp;&nbsp;Feed <i>inport</i> of the RTC with <i>basename.logport</i>. InPorts without this option are fed with <i>basename.inport</i> if it exists.<br>
+--conf [name=value]<br>
+&nbsp;&nbsp;Set a configuration variable of the RTC before it is activated.<br>
+--output [basename]<br>
+&nbsp;&nbsp;Data of OutPorts are written to <i>basename.portname</i> in the same format as DataLogger, and the duration of each onExecute()[us] to <i>basename.timing</i> (by default, replay).<br>
+--max-cycles [N]<br>
+&nbsp;&nbsp;Stop after N cycles.<br>
+
+Each cycle feeds the earliest lines of input logs, calls onExecute() of the RTC directly and records outputs, so results don't depend on timing. RTM options such as -f rtc.conf are passed to the manager, e.g. to specify the model of the robot. Service ports are not connected.
 */
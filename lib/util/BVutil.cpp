@@ -1,4 +1,13 @@
 #include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstddef>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 extern "C" {
 #if (defined __APPLE__)
 #include <pcl/surface/qhull.h>
@@ -153,3 +162,273 @@ void convertToConvexHull(hrp::Link *i_link)
     //
     //std::cerr << i_link->name << " reduce triangles from " << numTriangles << " to " << num << std::endl;
 }
+
+// layout of the cache file, all values are in the native byte order
+//   header : "HRPHULL" '\0', version, number of hulls (uint32)
+//   hull   : hash (uint64), name length, number of vertices, number of
+//            triangles (uint32), name padded to a multiple of 4 bytes,
+//            vertices (float x 3), triangles (int32 x 3)
+static const char HULL_CACHE_MAGIC[8] = {'H','R','P','H','U','L','L','\0'};
+static const unsigned int HULL_CACHE_VERSION = 1;
+
+// FNV-1a
+static unsigned long long hashBytes(const void *i_data, size_t i_size,
+                                    unsigned long long i_hash=14695981039346656037ULL)
+{
+    const unsigned char *p = (const unsigned char *)i_data;
+    for (size_t i=0; i<i_size; i++){
+        i_hash ^= p[i];
+        i_hash *= 1099511628211ULL;
+    }
+    return i_hash;
+}
+
+static unsigned long long geometryHash(hrp::Link *i_link)
+{
+    int n = i_link->coldetModel->getNumVertices();
+    unsigned long long hash = hashBytes(&n, sizeof(n));
+    float v[3];
+    for (int i=0; i<n; i++){
+        i_link->coldetModel->getVertex(i, v[0], v[1], v[2]);
+        hash = hashBytes(v, sizeof(v), hash);
+    }
+    return hash;
+}
+
+static size_t padded(size_t i_size)
+{
+    return (i_size + 3) & ~(size_t)3;
+}
+
+ConvexHullCache::ConvexHullCache(const std::string& i_fname)
+    : m_fname(i_fname), m_data(NULL), m_size(0), m_modified(false)
+{
+    load();
+}
+
+ConvexHullCache::~ConvexHullCache()
+{
+    save();
+    if (m_data) munmap(m_data, m_size);
+}
+
+void ConvexHullCache::load()
+{
+    if (m_fname.empty()) return;
+    int fd = open(m_fname.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0){
+        void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED){
+            m_data = data;
+            m_size = st.st_size;
+        }
+    }
+    close(fd);
+    if (!m_data) return;
+
+    const char *p = (const char *)m_data, *end = p + m_size;
+    unsigned int version, num;
+    if (m_size < sizeof(HULL_CACHE_MAGIC) + 2*sizeof(unsigned int)
+        || memcmp(p, HULL_CACHE_MAGIC, sizeof(HULL_CACHE_MAGIC)) != 0){
+        std::cerr << "invalid convex hull cache(" << m_fname << ")" << std::endl;
+        return;
+    }
+    p += sizeof(HULL_CACHE_MAGIC);
+    memcpy(&version, p, sizeof(version)); p += sizeof(version);
+    memcpy(&num, p, sizeof(num)); p += sizeof(num);
+    if (version != HULL_CACHE_VERSION) return;
+    for (unsigned int i=0; i<num; i++){
+        Hull hull;
+        unsigned int nameLength;
+        const size_t headerSize = sizeof(hull.hash) + 3*sizeof(unsigned int);
+        if (end - p < (ptrdiff_t)headerSize) break;
+        memcpy(&hull.hash, p, sizeof(hull.hash)); p += sizeof(hull.hash);
+        memcpy(&nameLength, p, sizeof(unsigned int)); p += sizeof(unsigned int);
+        memcpy(&hull.numVertices, p, sizeof(unsigned int)); p += sizeof(unsigned int);
+        memcpy(&hull.numTriangles, p, sizeof(unsigned int)); p += sizeof(unsigned int);
+        size_t bodySize = padded(nameLength) + hull.numVertices*3*sizeof(float)
+            + hull.numTriangles*3*sizeof(int);
+        if ((size_t)(end - p) < bodySize){
+            std::cerr << "truncated convex hull cache(" << m_fname << ")" << std::endl;
+            break;
+        }
+        std::string name(p, nameLength);
+        p += padded(nameLength);
+        hull.vertices = (const float *)p;
+        p += hull.numVertices*3*sizeof(float);
+        hull.triangles = (const int *)p;
+        p += hull.numTriangles*3*sizeof(int);
+        bool valid = true;
+        for (unsigned int j=0; j<hull.numTriangles*3; j++){
+            if (hull.triangles[j] < 0 || (unsigned int)hull.triangles[j] >= hull.numVertices){
+                valid = false;
+                break;
+            }
+        }
+        if (!valid){
+            std::cerr << "invalid convex hull of " << name << " in cache(" << m_fname << ")" << std::endl;
+            continue;
+        }
+        m_hulls[name] = hull;
+    }
+}
+
+bool ConvexHullCache::save()
+{
+    if (!m_modified || m_fname.empty()) return true;
+    // write to a unique file and replace the cache since it may be mapped
+    // and other processes loading the same model may write it at the same time
+    std::vector<char> tmpname(m_fname.begin(), m_fname.end());
+    const char suffix[] = ".XXXXXX";
+    tmpname.insert(tmpname.end(), suffix, suffix + sizeof(suffix));
+    int fd = mkstemp(&tmpname[0]);
+    if (fd < 0){
+        std::cerr << "failed to write convex hull cache(" << m_fname << ")" << std::endl;
+        return false;
+    }
+    FILE *fp = fdopen(fd, "wb");
+    if (!fp){
+        close(fd);
+        unlink(&tmpname[0]);
+        return false;
+    }
+    unsigned int version = HULL_CACHE_VERSION, num = m_hulls.size();
+    fwrite(HULL_CACHE_MAGIC, sizeof(HULL_CACHE_MAGIC), 1, fp);
+    fwrite(&version, sizeof(version), 1, fp);
+    fwrite(&num, sizeof(num), 1, fp);
+    const char pad[4] = {0,0,0,0};
+    for (std::map<std::string, Hull>::const_iterator it=m_hulls.begin();
+         it != m_hulls.end(); it++){
+        const Hull& hull = it->second;
+        unsigned int nameLength = it->first.size();
+        fwrite(&hull.hash, sizeof(hull.hash), 1, fp);
+        fwrite(&nameLength, sizeof(nameLength), 1, fp);
+        fwrite(&hull.numVertices, sizeof(hull.numVertices), 1, fp);
+        fwrite(&hull.numTriangles, sizeof(hull.numTriangles), 1, fp);
+        fwrite(it->first.c_str(), 1, nameLength, fp);
+        fwrite(pad, 1, padded(nameLength) - nameLength, fp);
+        fwrite(hull.vertices, sizeof(float), hull.numVertices*3, fp);
+        fwrite(hull.triangles, sizeof(int), hull.numTriangles*3, fp);
+    }
+    bool failed = ferror(fp) != 0;
+    if (fclose(fp) != 0 || failed || rename(&tmpname[0], m_fname.c_str()) != 0){
+        std::cerr << "failed to write convex hull cache(" << m_fname << ")" << std::endl;
+        unlink(&tmpname[0]);
+        return false;
+    }
+    m_modified = false;
+    return true;
+}
+
+void ConvexHullCache::convertToConvexHull(hrp::BodyPtr i_body)
+{
+    for (unsigned int i=0; i<i_body->numLinks(); i++){
+        convertToConvexHull(i_body->link(i));
+    }
+}
+
+void ConvexHullCache::convertToConvexHull(hrp::Link *i_link)
+{
+    if (!i_link->coldetModel || !i_link->coldetModel->getNumVertices()) return;
+
+    int ptype = i_link->coldetModel->getPrimitiveType();
+    if (ptype == ColdetModel::SP_PLANE || ptype == ColdetModel::SP_SPHERE){
+        return;
+    }
+
+    unsigned long long hash = geometryHash(i_link);
+    std::map<std::string, Hull>::iterator it = m_hulls.find(i_link->name);
+    if (it != m_hulls.end() && it->second.hash == hash){
+        const Hull& hull = it->second;
+        ColdetModelPtr coldetModel(new ColdetModel());
+        coldetModel->setName(i_link->name.c_str());
+        coldetModel->setPrimitiveType(ColdetModel::SP_MESH);
+        coldetModel->setNumVertices(hull.numVertices);
+        coldetModel->setNumTriangles(hull.numTriangles);
+        for (unsigned int i=0; i<hull.numVertices; i++){
+            const float *v = hull.vertices + i*3;
+            coldetModel->setVertex(i, v[0], v[1], v[2]);
+        }
+        for (unsigned int i=0; i<hull.numTriangles; i++){
+            const int *t = hull.triangles + i*3;
+            coldetModel->setTriangle(i, t[0], t[1], t[2]);
+        }
+        coldetModel->build();
+        i_link->coldetModel = coldetModel;
+        return;
+    }
+
+    ColdetModelPtr original = i_link->coldetModel;
+    ::convertToConvexHull(i_link);
+    if (i_link->coldetModel == original) return; // qhull failed
+
+    Hull& hull = m_hulls[i_link->name];
+    hull.hash = hash;
+    hull.numVertices = i_link->coldetModel->getNumVertices();
+    hull.numTriangles = i_link->coldetModel->getNumTriangles();
+    hull.vertexBuffer.resize(hull.numVertices*3);
+    hull.triangleBuffer.resize(hull.numTriangles*3);
+    for (unsigned int i=0; i<hull.numVertices; i++){
+        float *v = &hull.vertexBuffer[i*3];
+        i_link->coldetModel->getVertex(i, v[0], v[1], v[2]);
+    }
+    for (unsigned int i=0; i<hull.numTriangles; i++){
+        int *t = &hull.triangleBuffer[i*3];
+        i_link->coldetModel->getTriangle(i, t[0], t[1], t[2]);
+    }
+    hull.vertices = hull.vertexBuffer.empty() ? NULL : &hull.vertexBuffer[0];
+    hull.triangles = hull.triangleBuffer.empty() ? NULL : &hull.triangleBuffer[0];
+    m_modified = true;
+}
+
+static bool makeDirectories(const std::string& i_path)
+{
+    for (size_t pos = i_path.find('/', 1);; pos = i_path.find('/', pos + 1)){
+        std::string dir = i_path.substr(0, pos);
+        if (mkdir(dir.c_str(), 0700) != 0 && errno != EEXIST) return false;
+        if (pos == std::string::npos) break;
+    }
+    struct stat st;
+    return stat(i_path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+std::string defaultConvexHullCacheDir()
+{
+    const char *xdg = getenv("XDG_CACHE_HOME"), *home = getenv("HOME");
+    std::string dir;
+    if (xdg && xdg[0] == '/'){
+        dir = std::string(xdg) + "/hrpsys";
+    }else if (home && home[0] == '/'){
+        dir = std::string(home) + "/.cache/hrpsys";
+    }else{
+        // a private directory since /tmp is shared with other users
+        char tmp[32];
+        sprintf(tmp, "/tmp/hrpsys-%u", (unsigned int)getuid());
+        struct stat st;
+        if (mkdir(tmp, 0700) != 0 && errno != EEXIST) return "";
+        if (lstat(tmp, &st) != 0 || !S_ISDIR(st.st_mode)
+            || st.st_uid != getuid() || (st.st_mode & 077)){
+            std::cerr << "can't use " << tmp << " for convex hull cache" << std::endl;
+            return "";
+        }
+        return tmp;
+    }
+    if (!makeDirectories(dir)){
+        std::cerr << "can't create " << dir << " for convex hull cache" << std::endl;
+        return "";
+    }
+    return dir;
+}
+
+std::string convexHullCacheFile(const std::string& i_url, const std::string& i_dir)
+{
+    std::string dir = i_dir.empty() ? defaultConvexHullCacheDir() : i_dir;
+    if (dir.empty()) return "";
+    std::string base = i_url.substr(i_url.find_last_of('/') + 1);
+    base = base.substr(0, base.find('.'));
+    char hash[17];
+    sprintf(hash, "%016llx", hashBytes(i_url.c_str(), i_url.size()));
+    return dir + "/" + base + "-" + hash + ".hull";
+}
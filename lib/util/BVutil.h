@@ -1,6 +1,9 @@
 #ifndef __BVUTIL_H__
 #define __BVUTIL_H__
 
+#include <map>
+#include <string>
+#include <vector>
 #include <hrpModel/Body.h>
 
 void convertToAABB(hrp::BodyPtr i_body);
@@ -8,4 +11,47 @@ void convertToAABB(hrp::Link *i_link);
 void convertToConvexHull(hrp::BodyPtr i_body);
 void convertToConvexHull(hrp::Link *i_link);
 
+/**
+   convex hulls of links kept in a file. A hull is looked up by the name of
+   the link and a hash of its vertices and computed by qhull only when it is
+   not found. Computed hulls are written back to the file when the cache is
+   destroyed. Hulls are not cached if the file name is empty.
+ */
+class ConvexHullCache
+{
+public:
+    ConvexHullCache(const std::string& i_fname);
+    ~ConvexHullCache();
+    void convertToConvexHull(hrp::BodyPtr i_body);
+    void convertToConvexHull(hrp::Link *i_link);
+    bool save();
+private:
+    struct Hull
+    {
+        unsigned long long hash;
+        unsigned int numVertices, numTriangles;
+        // point to the mapped file or to buffers below
+        const float *vertices;
+        const int *triangles;
+        std::vector<float> vertexBuffer;
+        std::vector<int> triangleBuffer;
+    };
+    void load();
+
+    std::string m_fname;
+    void *m_data;
+    size_t m_size;
+    bool m_modified;
+    std::map<std::string, Hull> m_hulls;
+};
+
+// $XDG_CACHE_HOME/hrpsys, $HOME/.cache/hrpsys or /tmp/hrpsys-<uid>, created
+// if it doesn't exist. Empty if it can't be used.
+std::string defaultConvexHullCacheDir();
+
+// file name of the cache for a model URL in a directory, the default
+// directory is used if it is empty. Empty if no directory can be used.
+std::string convexHullCacheFile(const std::string& i_url,
+                                const std::string& i_dir="");
+
 #endif
@@ -377,6 +377,7 @@ void GLsceneBase::draw()
             for (size_t k=0; k<cameras.size(); k++){
                 hrp::VisionSensor *s = cameras[k]->sensor();
                 if (!s->isEnabled) continue;
+                if (m_nonRenderedSensors.count(s)) continue;
                 if (s->nextUpdateTime < m_log->currentTime()){
                     cameras[k]->render(this);
                     s->nextUpdateTime += 1.0/s->frameRate;
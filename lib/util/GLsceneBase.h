@@ -4,6 +4,7 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <set>
 #include <sys/time.h>
 //Open CV header
 #include <opencv2/core/core_c.h>
@@ -18,6 +19,9 @@
 #include <hrpModel/ConstraintForceSolver.h>
 #include <hrpModel/World.h>
 
+namespace hrp{
+    class VisionSensor;
+};
 class GLbody;
 class GLcamera;
 class LogManagerBase;
@@ -65,6 +69,8 @@ public:
     void setBackGroundColor(float rgb[3]);
     hrp::Vector3 center();
     void capture() { m_isCapturing = true; }
+    // sensors simulated elsewhere, e.g. by RayCaster, are not rendered
+    void disableOffscreenRendering(hrp::VisionSensor *i_sensor) { m_nonRenderedSensors.insert(i_sensor); }
 protected:
     enum {REQ_NONE, REQ_CLEAR, REQ_CAPTURE};
 
@@ -87,6 +93,7 @@ protected:
     int m_targetObject;
     float m_bgColor[3];
     bool m_isCapturing;
+    std::set<hrp::VisionSensor *> m_nonRenderedSensors;
 };
 
 #endif
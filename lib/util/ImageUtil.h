@@ -0,0 +1,61 @@
+#ifndef __IMAGE_UTIL_H__
+#define __IMAGE_UTIL_H__
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include "hrpsys/idl/Img.hh"
+
+/**
+   helpers shared by image processing components.
+
+   Images on data ports are RGB while OpenCV expects BGR. Conversions are
+   done by cv::cvtColor() on headers wrapping the given buffers, so they
+   use SIMD kernels of OpenCV selected at runtime and never allocate.
+   Intermediate images should be cv::Mat members whose create() reuses the
+   buffer as long as the size and the type are unchanged.
+ */
+
+inline int numChannels(Img::ColorFormat i_format)
+{
+    return i_format == Img::CF_RGB ? 3 : 1;
+}
+
+// cv::Mat header on the raw data of an uncompressed image, no copy
+inline cv::Mat wrapImage(Img::ImageData& i_image)
+{
+    return cv::Mat(i_image.height, i_image.width,
+                   CV_8UC(numChannels(i_image.format)),
+                   i_image.raw_data.get_buffer());
+}
+
+// set up an output image, raw_data is reallocated only when it grows
+inline unsigned char *setupImage(Img::ImageData& o_image, int i_width,
+                                 int i_height, Img::ColorFormat i_format)
+{
+    o_image.width  = i_width;
+    o_image.height = i_height;
+    o_image.format = i_format;
+    unsigned int len = i_width*i_height*numChannels(i_format);
+    if (o_image.raw_data.length() != len) o_image.raw_data.length(len);
+    return o_image.raw_data.get_buffer();
+}
+
+// RGB -> BGR and BGR -> RGB, i_src and o_dst must not overlap
+inline void swapRedBlue(const unsigned char *i_src, unsigned char *o_dst,
+                        int i_width, int i_height)
+{
+    cv::Mat src(i_height, i_width, CV_8UC3, const_cast<unsigned char *>(i_src));
+    cv::Mat dst(i_height, i_width, CV_8UC3, o_dst);
+    cv::cvtColor(src, dst, cv::COLOR_RGB2BGR);
+}
+
+// RGB -> gray with the same weights as CV_RGB2GRAY
+inline void rgbToGray(const unsigned char *i_src, unsigned char *o_dst,
+                      int i_width, int i_height)
+{
+    cv::Mat src(i_height, i_width, CV_8UC3, const_cast<unsigned char *>(i_src));
+    cv::Mat dst(i_height, i_width, CV_8UC1, o_dst);
+    cv::cvtColor(src, dst, cv::COLOR_RGB2GRAY);
+}
+
+#endif
@@ -7,7 +7,15 @@
 #include <boost/thread/thread.hpp>
 #include "LogManagerBase.h"
 
-template<class T>
+// time stamp of i-th state in a log container. Containers which don't keep
+// states as T objects (e.g. compact logs) provide their own overload
+template<class C>
+double logTime(C& i_log, size_t i)
+{
+    return i_log[i].time;
+}
+
+template<class T, class Container=std::deque<T> >
 class LogManager : public LogManagerBase
 {
 public:
@@ -55,7 +63,7 @@ public:
     double currentTime() { 
         boost::mutex::scoped_lock lock(m_mutex);
         if (!m_log.empty() && m_index>=0){
-            return m_log[m_index].time - m_offsetT;
+            return logTime(m_log, m_index) - m_offsetT;
         }else{
             return -1;
         }
@@ -63,13 +71,13 @@ public:
     int index() { return m_index; }
     double time(int i) { 
         boost::mutex::scoped_lock lock(m_mutex);
-        return m_log[i].time; 
+        return logTime(m_log, i); 
     }
     void faster(){
         boost::mutex::scoped_lock lock(m_mutex);
         m_playRatio *= 2;
         if (m_isPlaying){
-            m_initT = m_log[m_index].time;
+            m_initT = logTime(m_log, m_index);
             gettimeofday(&m_startT, NULL);
         }
     }
@@ -77,7 +85,7 @@ public:
         boost::mutex::scoped_lock lock(m_mutex);
         m_playRatio /= 2;
         if (m_isPlaying){
-            m_initT = m_log[m_index].time;
+            m_initT = logTime(m_log, m_index);
             gettimeofday(&m_startT, NULL);
         }
     }
@@ -86,7 +94,7 @@ public:
         if (m_log.empty()) return false;
 
         if (m_atLast) setIndex(0);
-        m_initT = m_log[0].time;
+        m_initT = logTime(m_log, 0);
         m_isRecording = true;
         m_fps = i_fps;
         return true;
@@ -99,7 +107,7 @@ public:
         if (!m_isPlaying){
             m_isPlaying = true;
             if (m_atLast) setIndex(0);
-            m_initT = m_log[m_index].time;
+            m_initT = logTime(m_log, m_index);
             gettimeofday(&m_startT, NULL);
         }else{
             m_isPlaying = false;
@@ -113,7 +121,7 @@ public:
             gettimeofday(&tv, NULL);
             double drawT = m_initT + ((tv.tv_sec - m_startT.tv_sec) + (tv.tv_usec - m_startT.tv_usec)*1e-6)*m_playRatio;
             //
-            while(drawT > m_log[m_index].time){
+            while(drawT > logTime(m_log, m_index)){
                 setIndex(m_index+1);
                 if (m_atLast) {
                     m_isPlaying = false;
@@ -126,7 +134,7 @@ public:
             m_isNewStateAdded = false;
         }
         if(m_isRecording){
-            while(m_initT > m_log[m_index].time){
+            while(m_initT > logTime(m_log, m_index)){
                 setIndex(m_index+1);
                 if (m_atLast) {
                     m_isRecording = false;
@@ -155,6 +163,9 @@ public:
         }
     }
     void enableRingBuffer(int len) { m_maxLogLength = len; }
+    Container& storage() { return m_log; }
+    // lock it while storage() is accessed and states may be added by another thread
+    boost::mutex& mutex() { return m_mutex; }
     unsigned int length() { 
         boost::mutex::scoped_lock lock(m_mutex);
         return m_log.size(); 
@@ -164,7 +175,7 @@ public:
         if (m_log.size() < m_index && m_index >= 0){
             return -1;
         }else{
-            return m_log[m_index].time;
+            return logTime(m_log, m_index);
         }
     }
 protected:
@@ -177,7 +188,7 @@ protected:
         m_atLast = m_index == m_log.size()-1; 
     }
 
-    std::deque<T> m_log;
+    Container m_log;
     int m_index;
     bool m_isNewStateAdded, m_atLast;
     double m_initT;
@@ -0,0 +1,60 @@
+#include <map>
+#include <string>
+#include <sys/stat.h>
+#include <coil/Mutex.h>
+#include <coil/Guard.h>
+#include "ModelCache.h"
+
+typedef coil::Guard<coil::Mutex> Guard;
+
+struct CachedModel
+{
+    CachedModel() : mtime(0) {}
+    hrp::BodyPtr body;
+    time_t mtime;
+};
+
+// key is the URL followed by loadGeometryForCollisionDetection
+static std::map<std::string, CachedModel> s_models;
+static coil::Mutex s_mutex;
+
+// modification time of a local file, 0 for other URLs
+static time_t modificationTime(const std::string& url)
+{
+    std::string path = url;
+    if (path.find("file://") == 0){
+        path = path.substr(7);
+    }else if (path.find("://") != std::string::npos){
+        return 0;
+    }
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) return 0;
+    return st.st_mtime;
+}
+
+bool loadBodyFromModelCache(hrp::BodyPtr& body, const char *url,
+                            CosNaming::NamingContext_var cxt,
+                            bool loadGeometryForCollisionDetection)
+{
+    Guard guard(s_mutex);
+    std::string key = std::string(url) + (loadGeometryForCollisionDetection ? "#1" : "#0");
+    time_t mtime = modificationTime(url);
+    CachedModel& model = s_models[key];
+    if (!model.body || model.mtime != mtime){
+        hrp::BodyPtr loaded(new hrp::Body());
+        if (!loadBodyFromModelLoader(loaded, url, cxt,
+                                     loadGeometryForCollisionDetection)){
+            return false;
+        }
+        model.body = loaded;
+        model.mtime = mtime;
+    }
+    body = hrp::BodyPtr(new hrp::Body(*model.body));
+    return true;
+}
+
+void clearModelCache()
+{
+    Guard guard(s_mutex);
+    s_models.clear();
+}
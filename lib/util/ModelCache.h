@@ -0,0 +1,23 @@
+#ifndef __MODEL_CACHE_H__
+#define __MODEL_CACHE_H__
+
+#include <hrpModel/Body.h>
+#include <hrpModel/ModelLoaderUtil.h>
+
+/**
+   models shared by RTCs in a process. A model is loaded from ModelLoader
+   when its URL is requested for the first time, or when the file of the URL
+   is modified, and later requests get copies of the cached Body without
+   asking ModelLoader.
+
+   \param body replaced with a copy of the cached model
+   \return false if the model can't be loaded
+ */
+bool loadBodyFromModelCache(hrp::BodyPtr& body, const char *url,
+                            CosNaming::NamingContext_var cxt,
+                            bool loadGeometryForCollisionDetection=false);
+
+// remove all models from the cache
+void clearModelCache();
+
+#endif
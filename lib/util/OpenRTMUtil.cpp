@@ -124,6 +124,10 @@ void setConfiguration(RTC::RTObject_var rtc,
 RTC::RTObject_var findRTC(const std::string &rtcName)
 {
     RTC::Manager& manager = RTC::Manager::instance();
+    // components in this process can be found without the naming service
+    RTC::RTObject_impl *local = manager.getComponent(rtcName.c_str());
+    if (local) return RTC::RTObject::_duplicate(local->getObjRef());
+
     std::string nameServer = manager.getConfig()["corba.nameservers"];
     int comPos = nameServer.find(",");
     if (comPos < 0){
@@ -181,6 +181,11 @@ bool Project::parse(const std::string& filename)
                       name.erase(name.rfind(".collisionShape"));
                       m.joint[name].collisionShape = (char *)(xmlGetProp(cur_node, (xmlChar *)"value"));
                       boost::trim(m.joint[name].collisionShape);
+                  } else if ( std::string((char *)xmlGetProp(cur_node, (xmlChar *)"name")).rfind(".simulation") != std::string::npos ) {
+                      std::string name = std::string((char *)xmlGetProp(cur_node, (xmlChar *)"name"));
+                      name.erase(name.rfind(".simulation"));
+                      m.sensorSimulation[name] = (char *)(xmlGetProp(cur_node, (xmlChar *)"value"));
+                      boost::trim(m.sensorSimulation[name]);
                   } else if ( std::string((char *)xmlGetProp(cur_node, (xmlChar *)"name")).rfind(".translation") != std::string::npos ) {
                       std::string name = std::string((char *)xmlGetProp(cur_node, (xmlChar *)"name"));
                       name.erase(name.rfind(".translation"));
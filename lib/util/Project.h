@@ -64,6 +64,8 @@ public:
     std::string rtcName;
     std::vector<std::string > inports;
     std::vector<std::string > outports;
+    // sensor name -> "raycast" or "opengl"
+    std::map<std::string, std::string> sensorSimulation;
 };
 
 class RTSItem {
@@ -0,0 +1,380 @@
+#include <cfloat>
+#include <cmath>
+#include <algorithm>
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/barrier.hpp>
+#include <hrpModel/Link.h>
+#include <hrpModel/Sensor.h>
+#include "RayCaster.h"
+
+using namespace hrp;
+
+#define MAX_LEAF_TRIANGLES 4
+#define STACK_SIZE 64
+#define MIN_RAYS_PER_THREAD 256
+
+namespace {
+    struct CenterLess {
+        CenterLess(const std::vector<float>& i_centers, int i_axis) :
+            centers(i_centers), axis(i_axis) {}
+        bool operator()(int a, int b) const {
+            return centers[a*3+axis] < centers[b*3+axis];
+        }
+        const std::vector<float>& centers;
+        int axis;
+    };
+
+    template<class T>
+    inline bool hitBox(const T *min, const T *max,
+                       const double *o, const double *inv,
+                       double tmin, double tmax)
+    {
+        for (int k=0; k<3; k++){
+            double t0 = (min[k] - o[k])*inv[k];
+            double t1 = (max[k] - o[k])*inv[k];
+            if (t0 > t1) std::swap(t0, t1);
+            if (t0 > tmin) tmin = t0;
+            if (t1 < tmax) tmax = t1;
+            if (tmin > tmax) return false;
+        }
+        return true;
+    }
+
+    // Moller-Trumbore, both sides of a triangle are hit
+    inline bool hitTriangle(const float *v, const double *o, const double *d,
+                            double& t)
+    {
+        double e1[3], e2[3], pv[3], tv[3], qv[3];
+        for (int k=0; k<3; k++){
+            e1[k] = v[3+k] - v[k];
+            e2[k] = v[6+k] - v[k];
+            tv[k] = o[k] - v[k];
+        }
+        pv[0] = d[1]*e2[2] - d[2]*e2[1];
+        pv[1] = d[2]*e2[0] - d[0]*e2[2];
+        pv[2] = d[0]*e2[1] - d[1]*e2[0];
+        double det = e1[0]*pv[0] + e1[1]*pv[1] + e1[2]*pv[2];
+        if (fabs(det) < 1e-12) return false;
+        double inv = 1.0/det;
+        double u = (tv[0]*pv[0] + tv[1]*pv[1] + tv[2]*pv[2])*inv;
+        if (u < 0 || u > 1) return false;
+        qv[0] = tv[1]*e1[2] - tv[2]*e1[1];
+        qv[1] = tv[2]*e1[0] - tv[0]*e1[2];
+        qv[2] = tv[0]*e1[1] - tv[1]*e1[0];
+        double w = (d[0]*qv[0] + d[1]*qv[1] + d[2]*qv[2])*inv;
+        if (w < 0 || u + w > 1) return false;
+        t = (e2[0]*qv[0] + e2[1]*qv[1] + e2[2]*qv[2])*inv;
+        return true;
+    }
+}
+
+RayCaster::RayCaster() : m_numThreads(1), m_workers(NULL), m_barrier(NULL),
+                         m_stopWorkers(false), m_activeThreads(1),
+                         m_minScale(0), m_maxScale(0), m_exclude(NULL)
+{
+}
+
+RayCaster::~RayCaster()
+{
+    setNumThreads(1);
+}
+
+void RayCaster::clear()
+{
+    m_meshes.clear();
+}
+
+void RayCaster::setNumThreads(int n)
+{
+    if (n <= 0) n = boost::thread::hardware_concurrency();
+    if (n < 1) n = 1;
+    if (n == m_numThreads) return;
+    if (m_workers){
+        m_stopWorkers = true;
+        m_barrier->wait();
+        m_workers->join_all();
+        delete m_workers;
+        delete m_barrier;
+        m_workers = NULL;
+        m_barrier = NULL;
+        m_stopWorkers = false;
+    }
+    m_numThreads = n;
+    if (n > 1){
+        m_barrier = new boost::barrier(n);
+        m_workers = new boost::thread_group();
+        for (int i=1; i<n; i++){
+            m_workers->create_thread(
+                boost::bind(&RayCaster::workerMain, this, i));
+        }
+    }
+}
+
+void RayCaster::workerMain(int id)
+{
+    while(1){
+        m_barrier->wait();
+        if (m_stopWorkers) break;
+        castRays(id);
+        m_barrier->wait();
+    }
+}
+
+void RayCaster::addBody(BodyPtr i_body)
+{
+    for (unsigned int i=0; i<i_body->numLinks(); i++){
+        addLink(i_body->link(i));
+    }
+    update();
+}
+
+void RayCaster::addLink(Link *i_link)
+{
+    ColdetModelPtr model = i_link->coldetModel;
+    if (!model || !model->getNumTriangles()) return;
+    int ntri = model->getNumTriangles();
+
+    std::vector<float> vertices(ntri*9), centers(ntri*3);
+    std::vector<int> tris(ntri);
+    int vindex[3];
+    for (int i=0; i<ntri; i++){
+        model->getTriangle(i, vindex[0], vindex[1], vindex[2]);
+        float *v = &vertices[i*9];
+        for (int j=0; j<3; j++){
+            model->getVertex(vindex[j], v[j*3], v[j*3+1], v[j*3+2]);
+        }
+        for (int k=0; k<3; k++){
+            centers[i*3+k] = (v[k] + v[3+k] + v[6+k])/3;
+        }
+        tris[i] = i;
+    }
+
+    m_meshes.push_back(Mesh());
+    Mesh& mesh = m_meshes.back();
+    mesh.link = i_link;
+    mesh.nodes.reserve(2*ntri/MAX_LEAF_TRIANGLES+1);
+    build(mesh, vertices, centers, tris, 0, ntri);
+    // triangles are reordered so that a leaf refers to a contiguous range
+    mesh.vertices.resize(ntri*9);
+    for (int i=0; i<ntri; i++){
+        std::copy(&vertices[tris[i]*9], &vertices[tris[i]*9]+9,
+                  &mesh.vertices[i*9]);
+    }
+}
+
+int RayCaster::build(Mesh& mesh, const std::vector<float>& vertices,
+                     const std::vector<float>& centers,
+                     std::vector<int>& tris, int begin, int end)
+{
+    Node node;
+    float cmin[3], cmax[3];
+    for (int k=0; k<3; k++){
+        node.min[k] = cmin[k] = FLT_MAX;
+        node.max[k] = cmax[k] = -FLT_MAX;
+    }
+    for (int i=begin; i<end; i++){
+        const float *v = &vertices[tris[i]*9];
+        const float *c = &centers[tris[i]*3];
+        for (int k=0; k<3; k++){
+            node.min[k] = std::min(node.min[k], std::min(v[k], std::min(v[3+k], v[6+k])));
+            node.max[k] = std::max(node.max[k], std::max(v[k], std::max(v[3+k], v[6+k])));
+            cmin[k] = std::min(cmin[k], c[k]);
+            cmax[k] = std::max(cmax[k], c[k]);
+        }
+    }
+    int index = mesh.nodes.size();
+    mesh.nodes.push_back(node);
+    if (end - begin <= MAX_LEAF_TRIANGLES){
+        node.right = -1;
+        node.begin = begin;
+        node.count = end - begin;
+    }else{
+        // split at the median of centers along the longest axis
+        int axis = 0;
+        for (int k=1; k<3; k++){
+            if (cmax[k] - cmin[k] > cmax[axis] - cmin[axis]) axis = k;
+        }
+        int mid = (begin + end)/2;
+        std::nth_element(tris.begin()+begin, tris.begin()+mid, tris.begin()+end,
+                         CenterLess(centers, axis));
+        build(mesh, vertices, centers, tris, begin, mid);
+        node.right = build(mesh, vertices, centers, tris, mid, end);
+        node.begin = begin;
+        node.count = 0;
+    }
+    mesh.nodes[index] = node;
+    return index;
+}
+
+void RayCaster::update()
+{
+    for (size_t i=0; i<m_meshes.size(); i++){
+        Mesh& mesh = m_meshes[i];
+        Link *l = mesh.link;
+        mesh.R = l->attitude();
+        mesh.p = l->p;
+        const Node& root = mesh.nodes[0];
+        Vector3 c, h;
+        for (int k=0; k<3; k++){
+            c[k] = (root.min[k] + root.max[k])/2;
+            h[k] = (root.max[k] - root.min[k])/2;
+        }
+        c = mesh.p + mesh.R*c;
+        for (int k=0; k<3; k++){
+            double r = fabs(mesh.R(k,0))*h[0] + fabs(mesh.R(k,1))*h[1]
+                + fabs(mesh.R(k,2))*h[2];
+            mesh.min[k] = c[k] - r;
+            mesh.max[k] = c[k] + r;
+        }
+    }
+}
+
+double RayCaster::castRay(const Mesh& mesh, const Vector3& i_origin,
+                          const Vector3& i_dir,
+                          double i_minDist, double i_maxDist) const
+{
+    Vector3 lo(mesh.R.transpose()*(i_origin - mesh.p));
+    Vector3 ld(mesh.R.transpose()*i_dir);
+    double o[3], d[3], inv[3];
+    for (int k=0; k<3; k++){
+        o[k] = lo[k];
+        d[k] = ld[k];
+        inv[k] = 1.0/ld[k];
+    }
+    double best = -1, tmax = i_maxDist, t;
+    int stack[STACK_SIZE], sp=0;
+    stack[sp++] = 0;
+    while (sp){
+        const Node& node = mesh.nodes[stack[--sp]];
+        if (!hitBox(node.min, node.max, o, inv, i_minDist, tmax)) continue;
+        if (node.count){
+            const float *v = &mesh.vertices[node.begin*9];
+            for (int i=0; i<node.count; i++, v+=9){
+                if (hitTriangle(v, o, d, t) && t >= i_minDist && t <= tmax){
+                    best = tmax = t;
+                }
+            }
+        }else if (sp + 2 <= STACK_SIZE){
+            stack[sp++] = node.right;
+            stack[sp++] = &node - &mesh.nodes[0] + 1;
+        }
+    }
+    return best;
+}
+
+double RayCaster::castRay(const Vector3& i_origin, const Vector3& i_dir,
+                          double i_minDist, double i_maxDist,
+                          const Link *i_exclude) const
+{
+    double o[3], inv[3];
+    for (int k=0; k<3; k++){
+        o[k] = i_origin[k];
+        inv[k] = 1.0/i_dir[k];
+    }
+    double best = -1, tmax = i_maxDist;
+    for (size_t i=0; i<m_meshes.size(); i++){
+        const Mesh& mesh = m_meshes[i];
+        if (mesh.link == i_exclude) continue;
+        if (!hitBox(mesh.min, mesh.max, o, inv, i_minDist, tmax)) continue;
+        double t = castRay(mesh, i_origin, i_dir, i_minDist, tmax);
+        if (t >= 0) best = tmax = t;
+    }
+    return best;
+}
+
+// rays of the id-th chunk, threads beyond m_activeThreads have nothing
+void RayCaster::castRays(int id)
+{
+    if (id >= m_activeThreads) return;
+    int n = m_dirs.size();
+    int chunk = (n + m_activeThreads - 1)/m_activeThreads;
+    int end = std::min(n, (id+1)*chunk);
+    for (int i=id*chunk; i<end; i++){
+        Vector3 dir(m_R*m_dirs[i]);
+        double len = dir.norm();
+        double t = castRay(m_origin, dir/len, m_minScale*len, m_maxScale*len,
+                           m_exclude);
+        m_distances[i] = t < 0 ? -1 : t/len;
+    }
+}
+
+void RayCaster::castAllRays()
+{
+    int n = m_dirs.size();
+    m_distances.resize(n);
+    m_activeThreads = std::min(m_numThreads, n/MIN_RAYS_PER_THREAD);
+    if (m_activeThreads <= 1){
+        m_activeThreads = 1;
+        castRays(0);
+        return;
+    }
+    m_barrier->wait();
+    castRays(0);
+    m_barrier->wait();
+}
+
+void RayCaster::updateRangeSensor(RangeSensor *i_sensor)
+{
+    int half = (int)(i_sensor->scanAngle/2/i_sensor->scanStep);
+    m_dirs.resize(half*2+1);
+    for (int i=-half; i<=half; i++){
+        double th = i*i_sensor->scanStep;
+        m_dirs[i+half] = Vector3(-sin(th), 0, -cos(th));
+    }
+    Link *l = i_sensor->link;
+    m_origin = l->p + l->R*i_sensor->localPos;
+    m_R = l->R*i_sensor->localR;
+    m_minScale = 0;
+    m_maxScale = i_sensor->maxDistance;
+    m_exclude = l;
+    castAllRays();
+
+    i_sensor->distances.resize(m_distances.size());
+    for (size_t i=0; i<m_distances.size(); i++){
+        i_sensor->distances[i] = m_distances[i] < 0 ? 0 : m_distances[i];
+    }
+    i_sensor->isUpdated = true;
+}
+
+bool RayCaster::updateVisionSensor(VisionSensor *i_sensor)
+{
+    if (i_sensor->imageType != VisionSensor::DEPTH) return false;
+
+    int w = i_sensor->width;
+    int h = i_sensor->height;
+    double fovx = 2*atan(w*tan(i_sensor->fovy/2)/h);
+    double zs = w/(2*tan(fovx/2));
+    // row 0 is the bottom row as glReadPixels() in GLcamera::render()
+    m_dirs.resize(w*h);
+    for (int i=0; i<h; i++){
+        for (int j=0; j<w; j++){
+            m_dirs[i*w+j] = Vector3((j-w/2)/zs, (i-h/2)/zs, -1);
+        }
+    }
+    Link *l = i_sensor->link;
+    m_origin = l->p + l->R*i_sensor->localPos;
+    m_R = l->R*i_sensor->localR;
+    // distances along m_dirs are depths, so near and far clip as OpenGL
+    m_minScale = i_sensor->near;
+    m_maxScale = i_sensor->far;
+    m_exclude = NULL;
+    castAllRays();
+
+    i_sensor->depth.resize(w*h*16);// will be shrinked later
+    float *ptr = (float *)&i_sensor->depth[0];
+    unsigned int npoints=0;
+    for (int i=0; i<w*h; i++){
+        if (m_distances[i] < 0) continue;
+        const Vector3& d = m_dirs[i];
+        ptr[0] = d[0]*m_distances[i];
+        ptr[1] = d[1]*m_distances[i];
+        ptr[2] = -m_distances[i];
+        ptr[3] = 0;
+        ptr += 4;
+        npoints++;
+    }
+    i_sensor->depth.resize(npoints*16);
+    i_sensor->isUpdated = true;
+    return true;
+}
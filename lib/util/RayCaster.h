@@ -0,0 +1,90 @@
+#ifndef __RAY_CASTER_H__
+#define __RAY_CASTER_H__
+
+#include <vector>
+#include <hrpModel/Body.h>
+
+namespace hrp{
+    class RangeSensor;
+    class VisionSensor;
+};
+namespace boost{
+    class barrier;
+    class thread_group;
+};
+
+/**
+   CPU ray caster over triangles of coldetModel of links. A bounding volume
+   hierarchy is built for each link in its local frame once, so moving
+   links only need their bounding boxes in the world frame to be updated.
+   It is used to simulate range sensors and depth images without OpenGL.
+   Rays of a sensor are split among threads which are created by
+   setNumThreads() and reused for every update.
+ */
+class RayCaster
+{
+public:
+    RayCaster();
+    ~RayCaster();
+    void addBody(hrp::BodyPtr i_body);
+    void clear();
+    // n <= 0 : number of hardware threads
+    void setNumThreads(int n);
+    int numThreads() const { return m_numThreads; }
+    // update bounding boxes with the current link positions
+    void update();
+    // distance to the nearest hit in [i_minDist, i_maxDist], or -1 if
+    // nothing is hit. i_dir must be normalized.
+    double castRay(const hrp::Vector3& i_origin, const hrp::Vector3& i_dir,
+                   double i_minDist, double i_maxDist,
+                   const hrp::Link *i_exclude=NULL) const;
+    // fill distances of a range sensor. The link which the sensor is
+    // attached to is ignored. 0 means no hit.
+    void updateRangeSensor(hrp::RangeSensor *i_sensor);
+    // fill depth of a vision sensor in the same format as GLcamera.
+    // Only VisionSensor::DEPTH is supported since colors are not computed.
+    bool updateVisionSensor(hrp::VisionSensor *i_sensor);
+private:
+    struct Node {
+        float min[3], max[3];
+        int right;        // index of the right child, left one follows
+        int begin, count; // triangles of a leaf (count > 0)
+    };
+    struct Mesh {
+        hrp::Link *link;
+        std::vector<float> vertices; // 9 floats per triangle
+        std::vector<Node> nodes;
+        hrp::Matrix33 R;
+        hrp::Vector3 p;
+        double min[3], max[3]; // in the world frame
+    };
+    RayCaster(const RayCaster&);
+    RayCaster& operator=(const RayCaster&);
+    void addLink(hrp::Link *i_link);
+    int build(Mesh& mesh, const std::vector<float>& vertices,
+              const std::vector<float>& centers,
+              std::vector<int>& tris, int begin, int end);
+    double castRay(const Mesh& mesh, const hrp::Vector3& i_origin,
+                   const hrp::Vector3& i_dir,
+                   double i_minDist, double i_maxDist) const;
+    void castRays(int id);
+    void castAllRays();
+    void workerMain(int id);
+
+    std::vector<Mesh> m_meshes;
+    int m_numThreads;
+    // m_numThreads-1 threads wait on m_barrier with castAllRays()
+    boost::thread_group *m_workers;
+    boost::barrier *m_barrier;
+    bool m_stopWorkers;
+    int m_activeThreads; // threads used by the current castAllRays()
+    // rays cast by castAllRays()
+    hrp::Vector3 m_origin;
+    hrp::Matrix33 m_R;
+    std::vector<hrp::Vector3> m_dirs; // in the sensor frame
+    std::vector<double> m_distances;
+    double m_minScale, m_maxScale; // range of the parameter along m_dirs
+    const hrp::Link *m_exclude;
+};
+
+#endif
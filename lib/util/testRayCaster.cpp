@@ -0,0 +1,156 @@
+#include <iostream>
+#include <cmath>
+#include <hrpModel/Body.h>
+#include <hrpModel/Link.h>
+#include <hrpModel/Sensor.h>
+#include "RayCaster.h"
+
+// a box of [-10,10]x[-10,10]x[-3,-2], whose top face is 2[m] below the
+// origin, i.e. 2[m] in front of a sensor at the origin
+hrp::BodyPtr createBox()
+{
+  hrp::ColdetModelPtr model(new hrp::ColdetModel());
+  model->setNumVertices(8);
+  model->setNumTriangles(12);
+  for (int i=0; i<8; i++){
+    model->setVertex(i, i&1 ? 10 : -10, i&2 ? 10 : -10, i&4 ? -2 : -3);
+  }
+  static const int faces[][4] = {{0,1,3,2}, {4,5,7,6}, {0,1,5,4},
+                                 {2,3,7,6}, {0,2,6,4}, {1,3,7,5}};
+  for (int i=0; i<6; i++){
+    model->setTriangle(i*2,   faces[i][0], faces[i][1], faces[i][2]);
+    model->setTriangle(i*2+1, faces[i][0], faces[i][2], faces[i][3]);
+  }
+  model->build();
+
+  hrp::BodyPtr body(new hrp::Body());
+  hrp::Link *link = new hrp::Link();
+  link->name = "BOX";
+  link->p = hrp::Vector3::Zero();
+  link->R = hrp::Matrix33::Identity();
+  link->Rs = hrp::Matrix33::Identity();
+  link->coldetModel = model;
+  body->setRootLink(link);
+  return body;
+}
+
+hrp::BodyPtr createSensorBody()
+{
+  hrp::BodyPtr body(new hrp::Body());
+  hrp::Link *link = new hrp::Link();
+  link->name = "SENSOR";
+  link->p = hrp::Vector3::Zero();
+  link->R = hrp::Matrix33::Identity();
+  link->Rs = hrp::Matrix33::Identity();
+  body->setRootLink(link);
+  return body;
+}
+
+// distances along the scan line are 2/cos(th) to the top face
+bool testRangeSensor(RayCaster& rc, hrp::Link *link)
+{
+  hrp::RangeSensor rs;
+  rs.link = link;
+  rs.localPos = hrp::Vector3::Zero();
+  rs.localR = hrp::Matrix33::Identity();
+  rs.scanAngle = 1.0;
+  rs.scanStep = 0.01;
+  rs.maxDistance = 10;
+  rc.updateRangeSensor(&rs);
+  int half = (int)(rs.scanAngle/2/rs.scanStep);
+  if ((int)rs.distances.size() != half*2+1){
+    std::cerr << "range: " << rs.distances.size() << " distances (expected "
+              << half*2+1 << ")" << std::endl;
+    return false;
+  }
+  double maxError = 0;
+  for (int i=-half; i<=half; i++){
+    double expected = 2/cos(i*rs.scanStep);
+    maxError = std::max(maxError, fabs(rs.distances[i+half] - expected));
+  }
+  // nothing is hit if the box is out of range
+  rs.maxDistance = 1.5;
+  rc.updateRangeSensor(&rs);
+  bool noHit = true;
+  for (size_t i=0; i<rs.distances.size(); i++){
+    if (rs.distances[i] != 0) noHit = false;
+  }
+  bool ok = maxError < 1e-6 && noHit;
+  std::cerr << "range: max error " << maxError
+            << (noHit ? "" : ", hit beyond maxDistance")
+            << (ok ? "" : " NG") << std::endl;
+  return ok;
+}
+
+// every pixel hits the top face, so point k corresponds to pixel
+// (k/w, k%w) and is compared with the point GLcamera computes from depth
+bool testVisionSensor(RayCaster& rc, hrp::Link *link)
+{
+  hrp::VisionSensor vs;
+  vs.link = link;
+  vs.localPos = hrp::Vector3::Zero();
+  vs.localR = hrp::Matrix33::Identity();
+  vs.imageType = hrp::VisionSensor::DEPTH;
+  vs.width = 64;
+  vs.height = 48;
+  vs.fovy = 1.0;
+  vs.near = 0.1;
+  vs.far = 10;
+  if (!rc.updateVisionSensor(&vs)) return false;
+  int w = vs.width, h = vs.height;
+  if (vs.depth.size() != (size_t)w*h*16){
+    std::cerr << "depth: " << vs.depth.size()/16 << " points (expected "
+              << w*h << ")" << std::endl;
+    return false;
+  }
+  double fovx = 2*atan(w*tan(vs.fovy/2)/h);
+  double zs = w/(2*tan(fovx/2));
+  const float *ptr = (const float *)&vs.depth[0];
+  double maxError = 0;
+  for (int i=0; i<h; i++){
+    for (int j=0; j<w; j++, ptr+=4){
+      // same as GLcamera::render()
+      double z = -2;
+      double x = -(j-w/2)*z/zs;
+      double y = -(i-h/2)*z/zs;
+      maxError = std::max(maxError, fabs(ptr[0] - x));
+      maxError = std::max(maxError, fabs(ptr[1] - y));
+      maxError = std::max(maxError, fabs(ptr[2] - z));
+    }
+  }
+  // points beyond the far clip are removed
+  vs.far = 1.5;
+  rc.updateVisionSensor(&vs);
+  bool clipped = vs.depth.empty();
+  bool ok = maxError < 1e-5 && clipped;
+  std::cerr << "depth: max error " << maxError
+            << (clipped ? "" : ", points beyond far clip")
+            << (ok ? "" : " NG") << std::endl;
+  return ok;
+}
+
+int main(int argc, char* argv[])
+{
+  hrp::BodyPtr box = createBox();
+  hrp::BodyPtr sensor = createSensorBody();
+  int ret = 0;
+  int threads[] = {1, 4, 0};
+  for (int t=0; t<3; t++){
+    RayCaster rc;
+    rc.setNumThreads(threads[t]);
+    rc.addBody(box);
+    rc.addBody(sensor);
+    std::cerr << "threads = " << rc.numThreads() << std::endl;
+    // threads are reused for the following updates
+    for (int i=0; i<2; i++){
+      if (!testRangeSensor(rc, sensor->rootLink())) ret = 1;
+      if (!testVisionSensor(rc, sensor->rootLink())) ret = 1;
+    }
+    double up = rc.castRay(hrp::Vector3::Zero(), hrp::Vector3::UnitZ(), 0, 10);
+    if (up >= 0){
+      std::cerr << "hit " << up << "[m] above the box NG" << std::endl;
+      ret = 1;
+    }
+  }
+  return ret;
+}
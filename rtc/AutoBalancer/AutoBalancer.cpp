@@ -11,6 +11,7 @@
 #include <hrpModel/Link.h>
 #include <hrpModel/Sensor.h>
 #include <hrpModel/ModelLoaderUtil.h>
+#include "hrpsys/util/ModelCache.h"
 #include "AutoBalancer.h"
 #include <hrpModel/JointPath.h>
 #include <hrpUtil/MatrixSolvers.h>
@@ -151,9 +152,9 @@ RTC::ReturnCode_t AutoBalancer::onInitialize()
     }
     nameServer = nameServer.substr(0, comPos);
     RTC::CorbaNaming naming(rtcManager.getORB(), nameServer.c_str());
-    if (!loadBodyFromModelLoader(m_robot, prop["model"].c_str(), 
-                                 CosNaming::NamingContext::_duplicate(naming.getRootContext())
-                                 )){
+    if (!loadBodyFromModelCache(m_robot, prop["model"].c_str(), 
+                                CosNaming::NamingContext::_duplicate(naming.getRootContext())
+                                )){
       std::cerr << "[" << m_profile.instance_name << "] failed to load model[" << prop["model"] << "]" << std::endl;
       return RTC::RTC_ERROR;
     }
@@ -199,6 +200,7 @@ RTC::ReturnCode_t AutoBalancer::onInitialize()
         // FIK param
         SimpleFullbodyInverseKinematicsSolver::IKparam tmp_fikp;
         tmp_fikp.manip = hrp::JointPathExPtr(new hrp::JointPathEx(m_robot, m_robot->link(ee_base), m_robot->link(ee_target), m_dt, false, std::string(m_profile.instance_name)));
+        hrp::setAnalyticIKSolverFromProperties(*tmp_fikp.manip, ee_name, prop["analytic_ik"], prop["analytic_ik_plugins"], std::string(m_profile.instance_name));
         tmp_fikp.target_link = m_robot->link(ee_target);
         tmp_fikp.localPos = tp.localPos;
         tmp_fikp.localR = tp.localR;
@@ -264,6 +266,12 @@ RTC::ReturnCode_t AutoBalancer::onInitialize()
     if (interlocking_joints.size() > 0) {
         fik->initializeInterlockingJoints(interlocking_joints);
     }
+    if (prop["abc_ik_threads"] != "") {
+        int num_ik_threads = 1;
+        coil::stringTo(num_ik_threads, prop["abc_ik_threads"].c_str());
+        fik->setNumIKThreads(num_ik_threads);
+        std::cerr << "[" << m_profile.instance_name << "] abc_ik_threads = " << fik->getNumIKThreads() << std::endl;
+    }
 
     zmp_offset_interpolator = new interpolator(ikp.size()*3, m_dt);
     zmp_offset_interpolator->setName(std::string(m_profile.instance_name)+" zmp_offset_interpolator");
@@ -294,6 +302,19 @@ RTC::ReturnCode_t AutoBalancer::onInitialize()
       gg = ggPtr(new rats::gait_generator(m_dt, leg_pos, leg_names, stride_fwd_x_limit/*[m]*/, stride_outside_y_limit/*[m]*/, stride_outside_th_limit/*[deg]*/,
                                           stride_bwd_x_limit/*[m]*/, stride_inside_y_limit/*[m]*/, stride_inside_th_limit/*[m]*/));
       gg->set_default_zmp_offsets(default_zmp_offsets);
+      if (prop["abc_preview_gain_cache"] != "") {
+        rats::riccati_solution_cache::instance().set_file(prop["abc_preview_gain_cache"]);
+      }
+      coil::vstring preview_cog_heights_str = coil::split(prop["abc_preview_cog_heights"], ",");
+      if (preview_cog_heights_str.size() == 3) {
+        double tmpv[3];
+        for (size_t i = 0; i < 3; i++) {
+          coil::stringTo(tmpv[i], preview_cog_heights_str[i].c_str());
+        }
+        size_t n = gg->precompute_preview_gains(tmpv[0], tmpv[1], tmpv[2]);
+        std::cerr << "[" << m_profile.instance_name << "] abc_preview_cog_heights = [" << tmpv[0] << ", " << tmpv[1] << "], step = " << tmpv[2] << "[m], " << n << " gains" << std::endl;
+      }
+      rats::riccati_solution_cache::instance().save();
     }
     gg_is_walking = gg_solved = false;
     m_walkingStates.data = false;
@@ -392,6 +413,8 @@ RTC::ReturnCode_t AutoBalancer::onFinalize()
   delete transition_interpolator;
   delete adjust_footstep_interpolator;
   delete leg_names_interpolator;
+  // solutions added while walking
+  rats::riccati_solution_cache::instance().save();
   return RTC::RTC_OK;
 }
 
@@ -673,7 +696,7 @@ void AutoBalancer::getTargetParameters()
   // basepos, rot, zmp
   m_robot->rootLink()->p = input_basePos;
   m_robot->rootLink()->R = input_baseRot;
-  m_robot->calcForwardKinematics();
+  fik->getKinematics().calcForwardKinematics();
   gg->proc_zmp_weight_map_interpolation();
   if (control_mode != MODE_IDLE) {
     interpolateLegNamesAndZMPOffsets();
@@ -724,7 +747,7 @@ void AutoBalancer::getTargetParameters()
     calcReferenceJointAnglesForIK();
 
     // Calculate ZMP, COG, and sbp targets
-    hrp::Vector3 tmp_ref_cog(m_robot->calcCM());
+    hrp::Vector3 tmp_ref_cog(fik->getKinematics().calcCM());
     hrp::Vector3 tmp_foot_mid_pos = calcFootMidPosUsingZMPWeightMap ();
     if (gg_is_walking) {
       ref_cog = gg->get_cog();
@@ -1053,7 +1076,7 @@ void AutoBalancer::fixLegToCoords (const hrp::Vector3& fix_pos, const hrp::Matri
   hrp::Matrix33 tmpR (fix_rot * current_foot_mid_rot.transpose());
   m_robot->rootLink()->p = fix_pos + tmpR * (m_robot->rootLink()->p - current_foot_mid_pos);
   rats::rotm3times(m_robot->rootLink()->R, tmpR, m_robot->rootLink()->R);
-  m_robot->calcForwardKinematics();
+  fik->getKinematics().calcForwardKinematics();
 }
 
 void AutoBalancer::fixLegToCoords2 (coordinates& tmp_fix_coords)
@@ -1097,6 +1120,7 @@ void AutoBalancer::solveFullbodyIK ()
   hrp::Vector3 dif_cog = tmp_input_sbp - ref_cog;
   // Solve IK
   fik->solveFullbodyIK (dif_cog, transition_interpolator->isEmpty());
+  if (DEBUGP) fik->printIKTime();
 }
 
 
@@ -2023,7 +2047,7 @@ bool AutoBalancer::getGoPosFootstepsSequence(const double& x, const double& y, c
 void AutoBalancer::static_balance_point_proc_one(hrp::Vector3& tmp_input_sbp, const double ref_com_height)
 {
   hrp::Vector3 target_sbp = hrp::Vector3(0, 0, 0);
-  hrp::Vector3 tmpcog = m_robot->calcCM();
+  hrp::Vector3 tmpcog = fik->getKinematics().calcCM();
   if ( use_force == MODE_NO_FORCE ) {
     tmp_input_sbp = tmpcog + sbp_cog_offset;
   } else {
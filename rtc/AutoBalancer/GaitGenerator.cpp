@@ -625,12 +625,12 @@ namespace rats
     // rg+lcg initialization
     rg.reset(one_step_len);
     rg.push_refzmp_from_footstep_nodes_for_dual(footstep_nodes_list.front(), initial_support_leg_steps, initial_swing_leg_dst_steps);
-    if ( preview_controller_ptr != NULL ) {
-      delete preview_controller_ptr;
-      preview_controller_ptr = NULL;
-    }
     //preview_controller_ptr = new preview_dynamics_filter<preview_control>(dt, cog(2) - refzmp_cur_list[0](2), refzmp_cur_list[0]);
-    preview_controller_ptr = new preview_dynamics_filter<extended_preview_control>(dt, cog(2) - rg.get_refzmp_cur()(2), rg.get_refzmp_cur(), gravitational_acceleration);
+    if ( preview_controller_ptr == NULL ) {
+      preview_controller_ptr = new preview_dynamics_filter<extended_preview_control>(dt, cog(2) - rg.get_refzmp_cur()(2), rg.get_refzmp_cur(), gravitational_acceleration);
+    } else {
+      preview_controller_ptr->init(dt, cog(2) - rg.get_refzmp_cur()(2), rg.get_refzmp_cur(), gravitational_acceleration);
+    }
     lcg.reset(one_step_len, footstep_nodes_list.at(1).front().step_time/dt, initial_swing_leg_dst_steps, initial_swing_leg_dst_steps, initial_support_leg_steps, default_double_support_ratio_swing_before, default_double_support_ratio_swing_after);
     /* make another */
     lcg.set_swing_support_steps_list(footstep_nodes_list);
@@ -647,6 +647,16 @@ namespace rats
     emergency_flg = IDLING;
   };
 
+  size_t gait_generator::precompute_preview_gains (const double min_zc, const double max_zc, const double zc_step)
+  {
+    size_t n = 0;
+    if (zc_step <= 0) return n;
+    for (double zc = min_zc; zc <= max_zc + 0.5 * zc_step; zc += zc_step, n++) {
+      preview_dynamics_filter<extended_preview_control> df(dt, zc, hrp::Vector3::Zero(), gravitational_acceleration);
+    }
+    return n;
+  };
+
   bool gait_generator::proc_one_tick ()
   {
     solved = false;
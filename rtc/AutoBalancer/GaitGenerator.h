@@ -1133,6 +1133,8 @@ namespace rats
                                     const std::vector<step_node>& initial_support_leg_steps,
                                     const std::vector<step_node>& initial_swing_leg_dst_steps,
                                     const double delay = 1.6);
+    /* solve riccati equations of the preview controller for COM heights from min_zc to max_zc [m] in advance */
+    size_t precompute_preview_gains (const double min_zc, const double max_zc, const double zc_step);
     bool proc_one_tick ();
     void limit_stride (step_node& cur_fs, const step_node& prev_fs, const double (&limit)[5]) const;
     void modify_footsteps_for_recovery ();
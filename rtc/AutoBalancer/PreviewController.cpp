@@ -1,9 +1,133 @@
 /* -*- coding:utf-8-unix; mode:c++; -*- */
 #include "PreviewController.h"
+#include <cstdio>
 
 using namespace hrp;
 using namespace rats;
 
+bool riccati_solution_cache::key::operator<(const key& k) const
+{
+  if (dim != k.dim) return dim < k.dim;
+  if (dt != k.dt) return dt < k.dt;
+  if (g != k.g) return g < k.g;
+  if (q != k.q) return q < k.q;
+  return r < k.r;
+}
+
+riccati_solution_cache::riccati_solution_cache ()
+  : resolution(1e-4) // [m]
+{
+  pthread_mutex_init(&mutex, NULL);
+}
+
+riccati_solution_cache::~riccati_solution_cache ()
+{
+  pthread_mutex_destroy(&mutex);
+}
+
+riccati_solution_cache& riccati_solution_cache::instance ()
+{
+  static riccati_solution_cache cache;
+  return cache;
+}
+
+bool riccati_solution_cache::set_file (const std::string& _fname)
+{
+  pthread_mutex_lock(&mutex);
+  fname = _fname;
+  // a line consists of dim, dt, g, q, r, zc and elements of P in column-major order
+  FILE* fp = fopen(fname.c_str(), "r");
+  size_t n = 0;
+  if (fp) {
+    key k;
+    double zc;
+    while (fscanf(fp, "%zu %lf %lf %lf %lf %lf", &k.dim, &k.dt, &k.g, &k.q, &k.r, &zc) == 6 && k.dim > 0 && k.dim <= 16) {
+      std::vector<double> P(k.dim * k.dim);
+      size_t i = 0;
+      while (i < P.size() && fscanf(fp, "%lf", &P[i]) == 1) i++;
+      if (i < P.size()) break; // truncated
+      solutions[k][zc] = P;
+      n++;
+    }
+    fclose(fp);
+  }
+  pthread_mutex_unlock(&mutex);
+  if (n > 0) std::cerr << "[riccati_solution_cache] " << n << " solutions are read from " << fname << std::endl;
+  return fp != NULL;
+}
+
+bool riccati_solution_cache::find (const size_t dim, const double dt, const double g, const double q, const double r, const double zc, std::vector<double>& P)
+{
+  key k = {dim, dt, g, q, r};
+  bool found = false;
+  P.clear();
+  pthread_mutex_lock(&mutex);
+  std::map<key, std::map<double, std::vector<double> > >::iterator it = solutions.find(k);
+  if (it != solutions.end()) {
+    std::map<double, std::vector<double> >& s = it->second;
+    std::map<double, std::vector<double> >::iterator upper = s.lower_bound(zc);
+    if (upper != s.end() && upper->first == zc) {
+      P = upper->second;
+      found = true;
+    } else if (upper == s.end()) {
+      P = s.rbegin()->second;
+    } else if (upper == s.begin()) {
+      P = upper->second;
+    } else {
+      std::map<double, std::vector<double> >::iterator lower = upper;
+      lower--;
+      double ratio = (zc - lower->first) / (upper->first - lower->first);
+      P.resize(dim * dim);
+      for (size_t i = 0; i < P.size(); i++) P[i] = (1 - ratio) * lower->second[i] + ratio * upper->second[i];
+    }
+  }
+  pthread_mutex_unlock(&mutex);
+  return found;
+}
+
+void riccati_solution_cache::add (const size_t dim, const double dt, const double g, const double q, const double r, const double zc, const std::vector<double>& P)
+{
+  key k = {dim, dt, g, q, r};
+  pthread_mutex_lock(&mutex);
+  solutions[k][zc] = P;
+  if (!fname.empty()) unsaved.push_back(std::make_pair(k, zc));
+  pthread_mutex_unlock(&mutex);
+}
+
+bool riccati_solution_cache::save ()
+{
+  std::string _fname;
+  std::vector<std::pair<key, double> > _unsaved;
+  std::vector<std::vector<double> > Ps;
+  pthread_mutex_lock(&mutex);
+  _fname = fname;
+  _unsaved.swap(unsaved);
+  for (size_t i = 0; i < _unsaved.size(); i++) Ps.push_back(solutions[_unsaved[i].first][_unsaved[i].second]);
+  pthread_mutex_unlock(&mutex);
+  if (_unsaved.empty()) return true;
+  FILE* fp = fopen(_fname.c_str(), "a");
+  if (!fp) {
+    std::cerr << "[riccati_solution_cache] failed to write " << _fname << std::endl;
+    return false;
+  }
+  for (size_t i = 0; i < _unsaved.size(); i++) {
+    const key& k = _unsaved[i].first;
+    fprintf(fp, "%zu %.17g %.17g %.17g %.17g %.17g", k.dim, k.dt, k.g, k.q, k.r, _unsaved[i].second);
+    for (size_t j = 0; j < Ps[i].size(); j++) fprintf(fp, " %.17g", Ps[i][j]);
+    fprintf(fp, "\n");
+  }
+  fclose(fp);
+  return true;
+}
+
+void riccati_solution_cache::clear ()
+{
+  pthread_mutex_lock(&mutex);
+  solutions.clear();
+  unsaved.clear();
+  pthread_mutex_unlock(&mutex);
+}
+
 template <std::size_t dim>
 void preview_control_base<dim>::update_x_k(const hrp::Vector3& pr, const std::vector<hrp::Vector3>& _qdata)
 {
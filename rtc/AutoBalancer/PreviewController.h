@@ -4,6 +4,8 @@
 #include <iostream>
 #include <queue>
 #include <deque>
+#include <map>
+#include <pthread.h>
 #include <hrpUtil/Eigen3d.h>
 #include "hrpsys/util/Hrpsys.h"
 
@@ -47,6 +49,40 @@ namespace rats
     }
   };
 
+  /* Solutions P of riccati equations of preview controllers shared in a process and optionally kept in a file.
+     A solution is looked up by the dimension, dt, gravitational acceleration, q, r and COM height rounded by resolution.
+     When it isn't found, solutions for the nearest COM heights are interpolated as the initial value of the iteration. */
+  class riccati_solution_cache
+  {
+    struct key
+    {
+      size_t dim;
+      double dt, g, q, r;
+      bool operator<(const key& k) const;
+    };
+    std::map<key, std::map<double, std::vector<double> > > solutions;
+    /* solutions added but not written to fname yet */
+    std::vector<std::pair<key, double> > unsaved;
+    std::string fname;
+    double resolution;
+    pthread_mutex_t mutex;
+    riccati_solution_cache ();
+    ~riccati_solution_cache ();
+  public:
+    static riccati_solution_cache& instance ();
+    /* read solutions from fname, and append new solutions to it by save() */
+    bool set_file (const std::string& _fname);
+    void set_resolution (const double _resolution) { resolution = _resolution; };
+    double round_com_height (const double zc) const { return resolution > 0 ? round(zc / resolution) * resolution : zc; };
+    /* true if found, otherwise P is interpolated or empty */
+    bool find (const size_t dim, const double dt, const double g, const double q, const double r, const double zc, std::vector<double>& P);
+    /* no file access, it can be called from a real-time loop */
+    void add (const size_t dim, const double dt, const double g, const double q, const double r, const double zc, const std::vector<double>& P);
+    /* append solutions added after the last call to the file, should be called outside of real-time loops */
+    bool save ();
+    void clear ();
+  };
+
   template <std::size_t dim>
   class preview_control_base
   {
@@ -62,6 +98,8 @@ namespace rats
     std::deque<double> pz;
     std::deque< std::vector<hrp::Vector3> > qdata;
     double zmp_z, cog_z;
+    /* parameters of the model, zc is rounded so that cached solutions are reused */
+    double dt, model_zc, gravitational_acceleration;
     size_t delay, ending_count;
     virtual void calc_f() = 0;
     virtual void calc_u() = 0;
@@ -72,28 +110,59 @@ namespace rats
                       const double q = 1.0, const double r = 1.0e-6)
     {
       riccati = riccati_equation<dim>(A, b, c, q, r);
-      riccati.solve();
+      riccati_solution_cache& cache = riccati_solution_cache::instance();
+      std::vector<double> P;
+      bool found = cache.find(dim, dt, gravitational_acceleration, q, r, model_zc, P);
+      if (!P.empty()) riccati.P = Eigen::Map<Eigen::Matrix<double, dim, dim> >(&P[0]);
+      bool solved = riccati.solve();
+      if (!solved && !P.empty()) {
+        // retry from the beginning
+        riccati.P = Eigen::Matrix<double, dim, dim>::Zero();
+        solved = riccati.solve();
+      }
+      if (solved && !found) {
+        P.resize(dim * dim);
+        Eigen::Map<Eigen::Matrix<double, dim, dim> > Pmap(&P[0]);
+        Pmap = riccati.P;
+        cache.add(dim, dt, gravitational_acceleration, q, r, model_zc, P);
+      }
       calc_f();
     };
-    /* inhibit copy constructor and copy insertion not by implementing */
-    preview_control_base (const preview_control_base& _p);
-    preview_control_base &operator=(const preview_control_base &_p);
-  public:
-    /* dt = [s], zc = [mm], d = [s] */
-    preview_control_base(const double dt, const double zc,
-                         const hrp::Vector3& init_xk, const double _gravitational_acceleration, const double d = 1.6)
-      : riccati(), x_k(Eigen::Matrix<double, 3, 2>::Zero()), u_k(Eigen::Matrix<double, 1, 2>::Zero()), p(), pz(), qdata(),
-        zmp_z(0), cog_z(zc), delay(static_cast<size_t>(round(d / dt))), ending_count(1+delay)
+    void init_base(const double _dt, const double zc,
+                   const hrp::Vector3& init_xk, const double _gravitational_acceleration, const double d)
     {
+      dt = _dt;
+      model_zc = riccati_solution_cache::instance().round_com_height(zc);
+      gravitational_acceleration = _gravitational_acceleration;
       tcA << 1, dt, 0.5 * dt * dt,
         0, 1,  dt,
         0, 0,  1;
       tcb << 1 / 6.0 * dt * dt * dt,
         0.5 * dt * dt,
         dt;
-      tcc << 1.0, 0.0, -zc / _gravitational_acceleration;
+      tcc << 1.0, 0.0, -model_zc / gravitational_acceleration;
+      x_k = Eigen::Matrix<double, 3, 2>::Zero();
+      u_k = Eigen::Matrix<double, 1, 2>::Zero();
       x_k(0,0) = init_xk(0);
       x_k(0,1) = init_xk(1);
+      p.clear();
+      pz.clear();
+      qdata.clear();
+      zmp_z = 0;
+      cog_z = zc;
+      delay = static_cast<size_t>(round(d / dt));
+      ending_count = 1 + delay;
+    };
+    /* inhibit copy constructor and copy insertion not by implementing */
+    preview_control_base (const preview_control_base& _p);
+    preview_control_base &operator=(const preview_control_base &_p);
+  public:
+    /* dt = [s], zc = [mm], d = [s] */
+    preview_control_base(const double dt, const double zc,
+                         const hrp::Vector3& init_xk, const double _gravitational_acceleration, const double d = 1.6)
+      : riccati(), p(), pz(), qdata()
+    {
+      init_base(dt, zc, init_xk, _gravitational_acceleration, d);
     };
     virtual ~preview_control_base()
     {
@@ -204,6 +273,14 @@ namespace rats
       init_riccati(tcA, tcb, tcc, q, r);
     };
     virtual ~preview_control() {};
+    /* reinitialize for another COM height without reallocation */
+    void init(const double dt, const double zc,
+              const hrp::Vector3& init_xk, const double _gravitational_acceleration = DEFAULT_GRAVITATIONAL_ACCELERATION, const double q = 1.0,
+              const double r = 1.0e-6, const double d = 1.6)
+    {
+      init_base(dt, zc, init_xk, _gravitational_acceleration, d);
+      init_riccati(tcA, tcb, tcc, q, r);
+    };
   };
 
   class extended_preview_control : public preview_control_base<4>
@@ -218,6 +295,20 @@ namespace rats
                              const hrp::Vector3& init_xk, const double _gravitational_acceleration = DEFAULT_GRAVITATIONAL_ACCELERATION, const double q = 1.0,
                              const double r = 1.0e-6, const double d = 1.6)
       : preview_control_base<4>(dt, zc, init_xk, _gravitational_acceleration, d), x_k_e(Eigen::Matrix<double, 4, 2>::Zero())
+    {
+      init_extended(init_xk, q, r);
+    };
+    virtual ~extended_preview_control() {};
+    /* reinitialize for another COM height without reallocation */
+    void init(const double dt, const double zc,
+              const hrp::Vector3& init_xk, const double _gravitational_acceleration = DEFAULT_GRAVITATIONAL_ACCELERATION, const double q = 1.0,
+              const double r = 1.0e-6, const double d = 1.6)
+    {
+      init_base(dt, zc, init_xk, _gravitational_acceleration, d);
+      init_extended(init_xk, q, r);
+    };
+  private:
+    void init_extended(const hrp::Vector3& init_xk, const double q, const double r)
     {
       Eigen::Matrix<double, 4, 4> A;
       Eigen::Matrix<double, 4, 1> b;
@@ -233,11 +324,11 @@ namespace rats
         tcb(1,0),
         tcb(2,0);
       c << 1,0,0,0;
+      x_k_e = Eigen::Matrix<double, 4, 2>::Zero();
       x_k_e(0,0) = init_xk(0);
       x_k_e(0,1) = init_xk(1);
       init_riccati(A, b, c, q, r);
     };
-    virtual ~extended_preview_control() {};
   };
 
   template <class previw_T>
@@ -250,6 +341,12 @@ namespace rats
     preview_dynamics_filter(const double dt, const double zc, const hrp::Vector3& init_xk, const double _gravitational_acceleration = DEFAULT_GRAVITATIONAL_ACCELERATION, const double q = 1.0, const double r = 1.0e-6, const double d = 1.6)
         : preview_controller(dt, zc, init_xk, _gravitational_acceleration, q, r, d), finishedp(false) {};
     ~preview_dynamics_filter() {};
+    /* same as constructing it again, cached riccati solutions are reused */
+    void init(const double dt, const double zc, const hrp::Vector3& init_xk, const double _gravitational_acceleration = DEFAULT_GRAVITATIONAL_ACCELERATION, const double q = 1.0, const double r = 1.0e-6, const double d = 1.6)
+    {
+      preview_controller.init(dt, zc, init_xk, _gravitational_acceleration, q, r, d);
+      finishedp = false;
+    };
     bool update(hrp::Vector3& p_ret, hrp::Vector3& x_ret, std::vector<hrp::Vector3>& qdata_ret, const hrp::Vector3& pr, const std::vector<hrp::Vector3>& qdata, const bool updatep)
     {
       bool flg;
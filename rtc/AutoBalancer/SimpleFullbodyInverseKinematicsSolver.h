@@ -1,8 +1,15 @@
 #ifndef SimpleFullbodyInverseKinematicsSolver_H
 #define SimpleFullbodyInverseKinematicsSolver_H
 
+#include <time.h>
+#include <pthread.h>
+#include <set>
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/barrier.hpp>
 #include <hrpModel/Body.h>
 #include "../ImpedanceController/JointPathEx.h"
+#include "../ImpedanceController/IncrementalKinematics.h"
 #include "../ImpedanceController/RatsMatrix.h"
 
 // Class for Simple Fullbody Inverse Kinematics
@@ -14,12 +21,22 @@ class SimpleFullbodyInverseKinematicsSolver
 private:
     // Robot model for IK
     hrp::BodyPtr m_robot;
+    // Kinematics of m_robot updated only for changed joints, shared with the owner of this solver
+    hrp::IncrementalKinematics m_kinematics;
     // Org (current) joint angles before IK
     hrp::dvector qorg;
     // IK fail checking
     int ik_error_debug_print_freq;
     std::string print_str;
     bool has_ik_failed;
+    // Threads for solving limb IK concurrently
+    int num_ik_threads;
+    boost::thread_group* ik_threads;
+    boost::barrier* ik_barrier;
+    bool stop_ik_threads;
+    int ik_sched_policy;
+    struct sched_param ik_sched_param;
+    double ik_ratio_for_vel;
 public:
     // IK parameter for each limb
     struct IKparam {
@@ -41,14 +58,18 @@ public:
         std::string parent_name;
         // Limb length
         double max_limb_length, limb_length_margin;
+        // Time for solving IK in the last cycle [s]
+        double ik_time;
         IKparam ()
             : avoid_gain(0.001), reference_gain(0.01),
               pos_ik_error_count(0), rot_ik_error_count(0),
-              limb_length_margin(0.02)
+              limb_length_margin(0.02), ik_time(0.0)
         {
         };
     };
     std::map<std::string, IKparam> ikp;
+    // Limbs solved by threads in this cycle
+    std::vector<IKparam*> parallel_ikp;
     // Used for ref joint angles overwrite before IK
     std::vector<int> overwrite_ref_ja_index_vec;
     // IK targets and current?
@@ -74,14 +95,20 @@ public:
           pos_ik_thre(0.5*1e-3), // [m]
           rot_ik_thre((1e-2)*M_PI/180.0), // [rad]
           print_str(_print_str), m_dt(_dt),
-          use_limb_stretch_avoidance(false), limb_stretch_avoidance_time_const(1.5)
+          use_limb_stretch_avoidance(false), limb_stretch_avoidance_time_const(1.5),
+          num_ik_threads(1), ik_threads(NULL), ik_barrier(NULL), stop_ik_threads(false),
+          ik_sched_policy(-1)
     {
         qorg.resize(m_robot->numJoints());
         qrefv.resize(m_robot->numJoints());
+        m_kinematics.setBody(m_robot.get());
         limb_stretch_avoidance_vlimit[0] = -1000 * 1e-3 * _dt; // lower limit
         limb_stretch_avoidance_vlimit[1] = 50 * 1e-3 * _dt; // upper limit
     };
-    ~SimpleFullbodyInverseKinematicsSolver () {};
+    ~SimpleFullbodyInverseKinematicsSolver ()
+    {
+        setNumIKThreads(1);
+    };
 
     void initializeInterlockingJoints (std::vector<std::pair<hrp::Link*, hrp::Link*> > & interlocking_joints)
     {
@@ -110,8 +137,9 @@ public:
         }
         m_robot->rootLink()->p = current_root_p;
         m_robot->rootLink()->R = current_root_R;
-        m_robot->calcForwardKinematics();
+        m_kinematics.calcForwardKinematics();
     };
+    hrp::IncrementalKinematics& getKinematics () { return m_kinematics; };
     void setReferenceJointAngles ()
     {
         for ( unsigned int i = 0; i < m_robot->numJoints(); i++ ){
@@ -141,19 +169,132 @@ public:
         for (size_t i = 0; i < overwrite_ref_ja_index_vec.size(); i++) {
             m_robot->joint(overwrite_ref_ja_index_vec[i])->q = qrefv[overwrite_ref_ja_index_vec[i]];
         }
-        m_robot->calcForwardKinematics();
-        for ( std::map<std::string, IKparam>::iterator it = ikp.begin(); it != ikp.end(); it++ ) {
-            if (it->second.is_ik_enable) solveLimbIK (it->second, it->first, ratio_for_vel, is_transition);
+        m_kinematics.calcForwardKinematics();
+        if (ik_threads) {
+            solveLimbIKParallel(is_transition);
+        } else {
+            for ( std::map<std::string, IKparam>::iterator it = ikp.begin(); it != ikp.end(); it++ ) {
+                if (it->second.is_ik_enable) solveLimbIK (it->second, it->first, ratio_for_vel, is_transition);
+            }
         }
     };
     // Solve limb IK
     bool solveLimbIK (IKparam& param, const std::string& limb_name, const double ratio_for_vel, const bool is_transition)
     {
-        param.manip->calcInverseKinematics2Loop(param.target_p0, param.target_r0, 1.0, param.avoid_gain, param.reference_gain, &qrefv, ratio_for_vel,
-                                                param.localPos, param.localR);
+        calcLimbIK(param, ratio_for_vel);
         checkIKTracking(param, limb_name, is_transition);
         return true;
     }
+    void calcLimbIK (IKparam& param, const double ratio_for_vel)
+    {
+        struct timespec t0, t1;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        param.manip->calcInverseKinematics2Loop(param.target_p0, param.target_r0, 1.0, param.avoid_gain, param.reference_gain, &qrefv, ratio_for_vel,
+                                                param.localPos, param.localR);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        param.ik_time = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) * 1e-9;
+    }
+    // Solve limb IK concurrently
+    //   Limbs share only the base link, so that results are same as solveLimbIK.
+    //   IK tracking is checked in the caller thread after all limbs are solved.
+    void solveLimbIKParallel (const bool is_transition)
+    {
+        parallel_ikp.clear();
+        for ( std::map<std::string, IKparam>::iterator it = ikp.begin(); it != ikp.end(); it++ ) {
+            if (it->second.is_ik_enable) parallel_ikp.push_back(&(it->second));
+        }
+        ik_ratio_for_vel = ratio_for_vel;
+        if (ik_sched_policy < 0) {
+            // threads run with the same priority as the caller (usually a real-time thread)
+            pthread_getschedparam(pthread_self(), &ik_sched_policy, &ik_sched_param);
+        }
+        ik_barrier->wait();
+        solveLimbIKs(0);
+        ik_barrier->wait();
+        for ( std::map<std::string, IKparam>::iterator it = ikp.begin(); it != ikp.end(); it++ ) {
+            if (it->second.is_ik_enable) checkIKTracking(it->second, it->first, is_transition);
+        }
+    };
+    void solveLimbIKs (const int id)
+    {
+        for (size_t i = id; i < parallel_ikp.size(); i += num_ik_threads) {
+            calcLimbIK(*parallel_ikp[i], ik_ratio_for_vel);
+        }
+    };
+    void ikThreadMain (const int id)
+    {
+        bool is_sched_set = false;
+        while (1) {
+            ik_barrier->wait();
+            if (stop_ik_threads) break;
+            if (!is_sched_set) {
+                pthread_setschedparam(pthread_self(), ik_sched_policy, &ik_sched_param);
+                is_sched_set = true;
+            }
+            solveLimbIKs(id);
+            ik_barrier->wait();
+        }
+    };
+    // Check whether limbs can be solved concurrently, i.e. no limb moves links of other limbs
+    bool areLimbsIndependent ()
+    {
+        for ( std::map<std::string, IKparam>::iterator it = ikp.begin(); it != ikp.end(); it++ ) {
+            std::set<hrp::Link*> moved_links;
+            for ( unsigned int i = 0; i < it->second.manip->numJoints(); i++ ) {
+                moved_links.insert(it->second.manip->joint(i));
+            }
+            for ( std::map<std::string, IKparam>::iterator it2 = ikp.begin(); it2 != ikp.end(); it2++ ) {
+                if (it == it2) continue;
+                hrp::JointPathExPtr manip2 = it2->second.manip;
+                // base link of it2 and its ancestors should not be moved as well as joints
+                std::vector<hrp::Link*> used_links;
+                for ( hrp::Link* l = manip2->baseLink(); l; l = l->parent ) {
+                    used_links.push_back(l);
+                }
+                for ( unsigned int i = 0; i < manip2->numJoints(); i++ ) {
+                    used_links.push_back(manip2->joint(i));
+                }
+                for ( size_t i = 0; i < used_links.size(); i++ ) {
+                    if (moved_links.count(used_links[i])) {
+                        std::cerr << "[" << print_str << "] " << it->first << " moves " << used_links[i]->name << " used by " << it2->first << std::endl;
+                        return false;
+                    }
+                }
+            }
+        }
+        return true;
+    };
+    // Set number of threads for limb IK (1 for solving limbs in the caller thread)
+    bool setNumIKThreads (const int _n)
+    {
+        int n = _n;
+        if (ik_threads) {
+            stop_ik_threads = true;
+            ik_barrier->wait();
+            ik_threads->join_all();
+            delete ik_threads;
+            delete ik_barrier;
+            ik_threads = NULL;
+            ik_barrier = NULL;
+            stop_ik_threads = false;
+        }
+        if (n > 1 && !areLimbsIndependent()) {
+            std::cerr << "[" << print_str << "] limb IK can't be solved concurrently" << std::endl;
+            n = 1;
+        }
+        num_ik_threads = std::max(n, 1);
+        if (num_ik_threads > 1) {
+            parallel_ikp.reserve(ikp.size());
+            ik_sched_policy = -1;
+            ik_barrier = new boost::barrier(num_ik_threads);
+            ik_threads = new boost::thread_group();
+            for (int i = 1; i < num_ik_threads; i++) {
+                ik_threads->create_thread(boost::bind(&SimpleFullbodyInverseKinematicsSolver::ikThreadMain, this, i));
+            }
+        }
+        return num_ik_threads == std::max(_n, 1);
+    };
+    int getNumIKThreads () const { return num_ik_threads; };
     // IK fail check
     void checkIKTracking (IKparam& param, const std::string& limb_name, const bool is_transition)
     {
@@ -253,7 +394,7 @@ public:
     // Avoid limb stretch
     void limbStretchAvoidanceControl (const std::vector<hrp::Vector3>& target_p, const std::vector<std::string>& target_name)
     {
-      m_robot->calcForwardKinematics();
+      m_kinematics.calcForwardKinematics();
       double tmp_d_root_height = 0.0, prev_d_root_height = d_root_height;
       if (use_limb_stretch_avoidance) {
         for (size_t i = 0; i < target_p.size(); i++) {
@@ -326,6 +467,14 @@ public:
       }
       std::cerr << "]" << std::endl;
     };
+    void printIKTime ()
+    {
+      std::cerr << "[" << print_str << "]   ik_time = [";
+      for ( std::map<std::string, IKparam>::iterator it = ikp.begin(); it != ikp.end(); it++ ) {
+          if (it->second.is_ik_enable) std::cerr << it->first << ":" << it->second.ik_time * 1e3 << " ";
+      }
+      std::cerr << "][ms] (threads = " << num_ik_threads << ")" << std::endl;
+    };
     hrp::Vector3 getEndEffectorPos(const std::string& limb_name){
       return ikp[limb_name].target_link->p + ikp[limb_name].target_link->R * ikp[limb_name].localPos;
     }
@@ -7,8 +7,7 @@
  * $Id$
  */
 
-#include <opencv2/core/core_c.h>
-#include <opencv2/highgui/highgui_c.h>
+#include <opencv2/core/core.hpp>
 #ifndef CV_VERSION_EPOCH
   #define CV_VERSION_EPOCH CV_VERSION_MAJOR
 #endif
@@ -17,7 +16,10 @@
 #else
 #include <opencv2/highgui/highgui.hpp>
 #endif
+#include <cstring>
+#include <boost/bind.hpp>
 #include "CameraImageSaver.h"
+#include "hrpsys/util/ImageUtil.h"
 
 // Module specification
 // <rtc-template block="module_spec">
@@ -35,6 +37,11 @@ static const char* spec[] =
     "lang_type",         "compile",
     // Configuration variables
     "conf.defalt.basename", "image",
+    "conf.default.format", "png",
+    "conf.default.jpegQuality", "95",
+    "conf.default.writerThreads", "1",
+    "conf.default.queueLength", "16",
+    "conf.default.dropFrames", "1",
 
     ""
   };
@@ -46,12 +53,17 @@ CameraImageSaver::CameraImageSaver(RTC::Manager* manager)
     m_imageIn("image", m_image),
     // </rtc-template>
     m_count(0),
+    m_writers(NULL),
+    m_stopWriters(false),
+    m_saved(0), m_failed(0), m_dropped(0), m_waited(0),
+    m_maxQueueLength(0), m_waitTime(0), m_writeTime(0),
     dummy(0)
 {
 }
 
 CameraImageSaver::~CameraImageSaver()
 {
+  stopWriters();
 }
 
 
@@ -62,6 +74,11 @@ RTC::ReturnCode_t CameraImageSaver::onInitialize()
   // <rtc-template block="bind_config">
   // Bind variables and configuration variable
   bindParameter("basename", m_basename, "image");
+  bindParameter("format", m_fileFormat, "png");
+  bindParameter("jpegQuality", m_jpegQuality, "95");
+  bindParameter("writerThreads", m_writerThreads, "1");
+  bindParameter("queueLength", m_queueLength, "16");
+  bindParameter("dropFrames", m_dropFrames, "1");
   
   // </rtc-template>
 
@@ -111,65 +128,199 @@ RTC::ReturnCode_t CameraImageSaver::onShutdown(RTC::UniqueId ec_id)
 RTC::ReturnCode_t CameraImageSaver::onActivated(RTC::UniqueId ec_id)
 {
   std::cout << m_profile.instance_name<< ": onActivated(" << ec_id << ")" << std::endl;
+  startWriters();
   return RTC::RTC_OK;
 }
 
 RTC::ReturnCode_t CameraImageSaver::onDeactivated(RTC::UniqueId ec_id)
 {
   std::cout << m_profile.instance_name<< ": onDeactivated(" << ec_id << ")" << std::endl;
+  stopWriters();
+  std::cout << m_profile.instance_name << ": saved " << m_saved
+            << " frames, failed " << m_failed
+            << ", dropped " << m_dropped
+            << ", waited " << m_waited << " times(" << m_waitTime << "[ms])"
+            << ", max queue length " << m_maxQueueLength
+            << ", average write time "
+            << (m_saved ? m_writeTime/m_saved : 0) << "[ms]" << std::endl;
   return RTC::RTC_OK;
 }
 
+void CameraImageSaver::startWriters()
+{
+  m_saved = m_failed = m_dropped = m_waited = 0;
+  m_maxQueueLength = 0;
+  m_waitTime = m_writeTime = 0;
+  if (m_fileFormat == "raw") openRawFile();
+  if (m_writerThreads <= 0) return;
+
+  m_frames.resize(m_queueLength > 0 ? m_queueLength : 1);
+  m_free.clear();
+  m_queue.clear();
+  for (size_t i=0; i<m_frames.size(); i++) m_free.push_back(&m_frames[i]);
+  m_stopWriters = false;
+  m_writers = new boost::thread_group();
+  for (int i=0; i<m_writerThreads; i++){
+    m_writers->create_thread(boost::bind(&CameraImageSaver::writerLoop, this));
+  }
+}
+
+// frames in the queue are saved before writers exit
+void CameraImageSaver::stopWriters()
+{
+  if (m_writers){
+    {
+      boost::mutex::scoped_lock lock(m_queueMutex);
+      m_stopWriters = true;
+      m_queueCond.notify_all();
+    }
+    m_writers->join_all();
+    delete m_writers;
+    m_writers = NULL;
+  }
+  m_rawFile.close();
+  m_rawFileName.clear();
+}
+
+// (re)opens the raw file when format or basename is changed while active.
+// RawImageFile serializes open() against write() of writer threads. A file
+// which failed to open is not retried every frame, its frames are counted
+// as failed.
+void CameraImageSaver::openRawFile()
+{
+  std::string fname = m_basename + ".raw";
+  if (fname == m_rawFileName) return;
+  m_rawFile.open(fname);
+  m_rawFileName = fname;
+}
+
+// returns NULL if the queue is full and frames are dropped, otherwise
+// waits for a writer
+CameraImageSaver::Frame *CameraImageSaver::acquireFrame()
+{
+  boost::mutex::scoped_lock lock(m_queueMutex);
+  if (m_free.empty()){
+    if (m_dropFrames) return NULL;
+    m_waited++;
+    coil::TimeValue t1(coil::gettimeofday());
+    while (m_free.empty()) m_freeCond.wait(lock);
+    coil::TimeValue dt = coil::gettimeofday() - t1;
+    m_waitTime += dt.sec()*1e3+dt.usec()/1e3;
+  }
+  Frame *frame = m_free.front();
+  m_free.pop_front();
+  return frame;
+}
+
+void CameraImageSaver::writerLoop()
+{
+  cv::Mat bgr;
+  while (1){
+    Frame *frame;
+    {
+      boost::mutex::scoped_lock lock(m_queueMutex);
+      while (m_queue.empty() && !m_stopWriters) m_queueCond.wait(lock);
+      if (m_queue.empty()) break;
+      frame = m_queue.front();
+      m_queue.pop_front();
+    }
+    coil::TimeValue t1(coil::gettimeofday());
+    bool ok = save(*frame, bgr);
+    coil::TimeValue dt = coil::gettimeofday() - t1;
+    {
+      boost::mutex::scoped_lock lock(m_queueMutex);
+      if (ok) m_saved++; else m_failed++;
+      m_writeTime += dt.sec()*1e3+dt.usec()/1e3;
+      m_free.push_back(frame);
+      m_freeCond.notify_one();
+    }
+  }
+}
+
+bool CameraImageSaver::save(const Frame& i_frame, cv::Mat& io_bgr)
+{
+  if (i_frame.data.empty()) return false;
+  if (i_frame.fileFormat == "raw"){
+    RawImageHeader header;
+    memcpy(header.magic, "HRIM", 4);
+    header.index  = i_frame.index;
+    header.sec    = i_frame.tm.sec;
+    header.nsec   = i_frame.tm.nsec;
+    header.width  = i_frame.width;
+    header.height = i_frame.height;
+    header.format = i_frame.format;
+    header.size   = i_frame.data.size();
+    return m_rawFile.write(header, &i_frame.data[0]);
+  }
+
+  cv::Mat image;
+  unsigned char *data = const_cast<unsigned char *>(&i_frame.data[0]);
+  if (i_frame.format == Img::CF_RGB){
+    // RGB -> BGR
+    io_bgr.create(i_frame.height, i_frame.width, CV_8UC3);
+    swapRedBlue(data, io_bgr.data, i_frame.width, i_frame.height);
+    image = io_bgr;
+  }else{
+    image = cv::Mat(i_frame.height, i_frame.width, CV_8UC1, data);
+  }
+
+  char fname[256];
+  if (i_frame.fileFormat == "jpg"){
+    sprintf(fname, "%s%04d.jpg", i_frame.basename.c_str(), i_frame.index);
+    std::vector<int> param(2);
+    param[0] = cv::IMWRITE_JPEG_QUALITY;
+    param[1] = i_frame.jpegQuality;
+    return cv::imwrite(fname, image, param);
+  }else{
+    sprintf(fname, "%s%04d.png", i_frame.basename.c_str(), i_frame.index);
+    return cv::imwrite(fname, image);
+  }
+}
+
 RTC::ReturnCode_t CameraImageSaver::onExecute(RTC::UniqueId ec_id)
 {
   //std::cout << m_profile.instance_name<< ": onExecute(" << ec_id << ")" << std::endl;
   if (m_imageIn.isNew()){
     m_imageIn.read();
 
-    IplImage* cvImage;
-    switch (m_image.data.image.format){
-    case Img::CF_RGB:
-      cvImage = cvCreateImage(cvSize(m_image.data.image.width,
-                                     m_image.data.image.height),
-                              IPL_DEPTH_8U, 3);
-      break;
-    case Img::CF_GRAY:
-      cvImage = cvCreateImage(cvSize(m_image.data.image.width,
-                                     m_image.data.image.height),
-                              IPL_DEPTH_8U, 1);
-      break;
-    default:
+    Img::ImageData& idat = m_image.data.image;
+    if (idat.format != Img::CF_RGB && idat.format != Img::CF_GRAY){
       std::cerr << "unsupported color format(" 
-                << m_image.data.image.format << ")" << std::endl;
+                << idat.format << ")" << std::endl;
       return RTC::RTC_ERROR;
     }
-    switch(m_image.data.image.format){
-    case Img::CF_RGB:
-      {
-        // RGB -> BGR
-        char *dst = cvImage->imageData;
-        for (unsigned int i=0; i<m_image.data.image.raw_data.length(); i+=3){
-          dst[i  ] = m_image.data.image.raw_data[i+2]; 
-          dst[i+1] = m_image.data.image.raw_data[i+1]; 
-          dst[i+2] = m_image.data.image.raw_data[i  ]; 
-        }
-        break;
-      }
-    case Img::CF_GRAY:
-      memcpy(cvImage->imageData, 
-             m_image.data.image.raw_data.get_buffer(),
-             m_image.data.image.raw_data.length());
-      break;
-    default:
-      break;
-    }
 
-    char fname[256];
-    sprintf(fname, "%s%04d.png", m_basename.c_str(), m_count++);
-    cv::Mat image = cv::cvarrToMat(cvImage);
-    cv::imwrite(fname, image);
-    
-    cvReleaseImage(&cvImage);
+    if (m_fileFormat == "raw") openRawFile();
+
+    // dropped frames leave gaps in indices
+    int index = m_count++;
+    Frame *frame = m_writers ? acquireFrame() : &m_frame;
+    if (!frame){
+      m_dropped++;
+      return RTC::RTC_OK;
+    }
+    frame->index  = index;
+    frame->tm     = m_image.tm;
+    frame->width  = idat.width;
+    frame->height = idat.height;
+    frame->format = idat.format;
+    frame->fileFormat  = m_fileFormat;
+    frame->basename    = m_basename;
+    frame->jpegQuality = m_jpegQuality;
+    frame->data.assign(idat.raw_data.get_buffer(),
+                       idat.raw_data.get_buffer() + idat.raw_data.length());
+
+    if (m_writers){
+      boost::mutex::scoped_lock lock(m_queueMutex);
+      m_queue.push_back(frame);
+      if (m_queue.size() > m_maxQueueLength) m_maxQueueLength = m_queue.size();
+      m_queueCond.notify_one();
+    }else{
+      coil::TimeValue t1(coil::gettimeofday());
+      if (save(*frame, m_bgr)) m_saved++; else m_failed++;
+      coil::TimeValue dt = coil::gettimeofday() - t1;
+      m_writeTime += dt.sec()*1e3+dt.usec()/1e3;
+    }
   }
   
   return RTC::RTC_OK;
@@ -10,6 +10,10 @@
 #ifndef CAMERA_IMAGE_SAVER_H
 #define CAMERA_IMAGE_SAVER_H
 
+#include <deque>
+#include <vector>
+#include <boost/thread.hpp>
+#include <opencv2/core/core.hpp>
 #include <rtm/idl/BasicDataType.hh>
 #include "hrpsys/idl/Img.hh"
 #include <rtm/Manager.h>
@@ -18,6 +22,7 @@
 #include <rtm/DataInPort.h>
 #include <rtm/DataOutPort.h>
 #include <rtm/idl/BasicDataTypeSkel.h>
+#include "RawImageFile.h"
 
 // Service implementation headers
 // <rtc-template block="service_impl_h">
@@ -132,8 +137,42 @@ class CameraImageSaver
   // </rtc-template>
 
  private:
-  std::string m_basename;
+  struct Frame {
+    int index;
+    RTC::Time tm;
+    int width, height;
+    Img::ColorFormat format;
+    std::vector<unsigned char> data;
+    // configuration at the time the frame was received, writers must not
+    // read bound parameters which are updated by the configuration
+    std::string fileFormat, basename;
+    int jpegQuality;
+  };
+  void startWriters();
+  void stopWriters();
+  Frame *acquireFrame();
+  void writerLoop();
+  void openRawFile();
+  bool save(const Frame& i_frame, cv::Mat& io_bgr);
+
+  std::string m_basename, m_fileFormat;
   int m_count;
+  int m_jpegQuality, m_writerThreads, m_queueLength, m_dropFrames;
+  cv::Mat m_bgr;
+  Frame m_frame; // used when frames are saved in onExecute()
+  // frames move between the free list and the queue
+  std::vector<Frame> m_frames;
+  std::deque<Frame *> m_free, m_queue;
+  boost::thread_group *m_writers;
+  boost::mutex m_queueMutex;
+  boost::condition_variable m_queueCond, m_freeCond;
+  bool m_stopWriters;
+  RawImageFile m_rawFile;
+  std::string m_rawFileName; // last file opened, empty after stopWriters()
+  // statistics
+  unsigned long m_saved, m_failed, m_dropped, m_waited;
+  size_t m_maxQueueLength;
+  double m_waitTime, m_writeTime; // [ms]
   int dummy;
 };
 
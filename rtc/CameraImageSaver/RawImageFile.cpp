@@ -0,0 +1,87 @@
+#include <iostream>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "RawImageFile.h"
+
+#define WINDOW_SIZE (64*1024*1024)
+
+RawImageFile::RawImageFile() :
+    m_fd(-1), m_size(0), m_windowOffset(0), m_windowSize(0), m_window(NULL)
+{
+}
+
+RawImageFile::~RawImageFile()
+{
+    close();
+}
+
+bool RawImageFile::open(const std::string& i_fname)
+{
+    close();
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_fd = ::open(i_fname.c_str(), O_RDWR|O_CREAT, 0644);
+    if (m_fd < 0){
+        std::cerr << "failed to open " << i_fname << std::endl;
+        return false;
+    }
+    struct stat st;
+    fstat(m_fd, &st);
+    m_size = st.st_size;
+    return true;
+}
+
+void RawImageFile::close()
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    if (m_fd < 0) return;
+    if (m_window) munmap(m_window, m_windowSize);
+    m_window = NULL;
+    m_windowSize = 0;
+    if (ftruncate(m_fd, m_size) < 0){
+        std::cerr << "failed to truncate a raw image file" << std::endl;
+    }
+    ::close(m_fd);
+    m_fd = -1;
+}
+
+// map a window which contains [m_size, m_size+i_size)
+bool RawImageFile::remap(size_t i_size)
+{
+    if (m_window) munmap(m_window, m_windowSize);
+    m_window = NULL;
+    long page = sysconf(_SC_PAGESIZE);
+    m_windowOffset = m_size - m_size%page;
+    m_windowSize = WINDOW_SIZE;
+    if (m_windowSize < (size_t)(m_size - m_windowOffset) + i_size){
+        m_windowSize = m_size - m_windowOffset + i_size;
+    }
+    if (ftruncate(m_fd, m_windowOffset + m_windowSize) < 0) return false;
+    void *ptr = mmap(NULL, m_windowSize, PROT_READ|PROT_WRITE, MAP_SHARED,
+                     m_fd, m_windowOffset);
+    if (ptr == MAP_FAILED) return false;
+    m_window = (unsigned char *)ptr;
+    return true;
+}
+
+bool RawImageFile::write(const RawImageHeader& i_header,
+                         const unsigned char *i_data)
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    if (m_fd < 0) return false;
+    size_t len = sizeof(RawImageHeader) + i_header.size;
+    if (!m_window
+        || m_size + (off_t)len > m_windowOffset + (off_t)m_windowSize){
+        if (!remap(len)){
+            std::cerr << "failed to map a raw image file" << std::endl;
+            return false;
+        }
+    }
+    unsigned char *dst = m_window + (m_size - m_windowOffset);
+    memcpy(dst, &i_header, sizeof(RawImageHeader));
+    memcpy(dst + sizeof(RawImageHeader), i_data, i_header.size);
+    m_size += len;
+    return true;
+}
@@ -0,0 +1,46 @@
+#ifndef __RAW_IMAGE_FILE_H__
+#define __RAW_IMAGE_FILE_H__
+
+#include <string>
+#include <sys/types.h>
+#include <stdint.h>
+#include <boost/thread.hpp>
+
+/**
+   container file of uncompressed images. Frames are appended through a
+   memory-mapped window which is moved forward as the file grows, and the
+   file is truncated to the written size when it is closed.
+
+   Each frame consists of RawImageHeader followed by size bytes of pixels
+   as they were received (RGB or gray, rows from the top).
+ */
+struct RawImageHeader {
+    char magic[4]; // "HRIM"
+    uint32_t index;
+    uint32_t sec, nsec;
+    uint32_t width, height, format; // format is Img::ColorFormat
+    uint32_t size;
+};
+
+class RawImageFile
+{
+public:
+    RawImageFile();
+    ~RawImageFile();
+    // frames are appended if the file exists
+    bool open(const std::string& i_fname);
+    void close();
+    bool isOpen() const { return m_fd >= 0; }
+    bool write(const RawImageHeader& i_header, const unsigned char *i_data);
+private:
+    bool remap(size_t i_size);
+
+    boost::mutex m_mutex;
+    int m_fd;
+    off_t m_size;               // written bytes
+    off_t m_windowOffset;       // file offset of m_window
+    size_t m_windowSize;
+    unsigned char *m_window;
+};
+
+#endif
@@ -177,7 +177,9 @@ RTC::ReturnCode_t CollisionDetector::onInitialize()
         convertToAABB(m_robot);
     } else if ( prop["collision_model"] == "convex hull" ||
                 prop["collision_model"] == "" ) { // set convex hull as default
-        convertToConvexHull(m_robot);
+        ConvexHullCache cache(convexHullCacheFile(prop["model"],
+                                                  prop["collision_model_cache"]));
+        cache.convertToConvexHull(m_robot);
     }
     setupVClipModel(m_robot);
 
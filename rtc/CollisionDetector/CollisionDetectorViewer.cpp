@@ -40,7 +40,8 @@ hrp::BodyPtr createBody(const std::string& name, const ModelItem& mitem,
     hrp::loadBodyFromBodyInfo(body, binfo, true, GLlinkFactory);
     loadShapeFromBodyInfo(glbody, binfo);
 
-    convertToConvexHull(body);
+    ConvexHullCache cache(convexHullCacheFile(mitem.url));
+    cache.convertToConvexHull(body);
 
     body->setName(name);
     return body;
@@ -7,13 +7,10 @@
  * $Id$
  */
 
-#include <opencv2/highgui/highgui_c.h>
-#include <opencv2/imgproc/imgproc_c.h>
-#ifndef CV_RGB
-#define CV_RGB( r, g, b )  cvScalar( (b), (g), (r), 0 )
-#endif
+#include <opencv2/imgproc/imgproc.hpp>
 #include "ColorExtractor.h"
 #include "hrpsys/util/VectorConvert.h"
+#include "hrpsys/util/ImageUtil.h"
 
 // Module specification
 // <rtc-template block="module_spec">
@@ -44,15 +41,12 @@ ColorExtractor::ColorExtractor(RTC::Manager* manager)
     m_resultOut("result", m_result),
     m_posOut("pos", m_pos),
     // </rtc-template>
-    m_img(NULL),
     dummy(0)
 {
 }
 
 ColorExtractor::~ColorExtractor()
 {
-  if (m_img) cvReleaseImage(&m_img);
-
 }
 
 
@@ -131,40 +125,18 @@ RTC::ReturnCode_t ColorExtractor::onExecute(RTC::UniqueId ec_id)
 
       Img::ImageData& idat = m_original.data.image;
 
-      if (m_img && (m_img->width != idat.width
-		    || m_img->height != idat.height)){
-	cvReleaseImage(&m_img);
-	m_img = NULL;
-      }
-      if (!m_img){
-	m_img = cvCreateImage(cvSize(idat.width, idat.height), 
-			      IPL_DEPTH_8U, 3);
-	m_result.data.image.width  = idat.width;
-	m_result.data.image.height = idat.height;
-	m_result.data.image.format = idat.format;
-	m_result.data.image.raw_data.length(idat.width*idat.height*3);
-      }
-
       // RGB -> BGR
-      unsigned char *rtm=idat.raw_data.get_buffer();
-      char *cv;
-      for (int i=0; i<idat.height; i++){
-        for (int j=0; j<idat.width; j++){
-          cv = m_img->imageData + m_img->widthStep*i + j*3;
-          cv[0] = rtm[2];
-          cv[1] = rtm[1];
-          cv[2] = rtm[0];
-          rtm += 3;
-        }
-      }
+      m_img.create(idat.height, idat.width, CV_8UC3);
+      swapRedBlue(idat.raw_data.get_buffer(), m_img.data,
+                  idat.width, idat.height);
       
       // processing start
       int npixel=0, cx=0, cy=0;
       unsigned char b,g,r;
       for (int i=0; i<idat.height; i++){
-        for (int j=0; j<idat.width; j++){
-          cv = m_img->imageData + m_img->widthStep*i + j*3;
-          b = cv[0]; g = cv[1]; r = cv[2];
+        const unsigned char *pixel = m_img.ptr<unsigned char>(i);
+        for (int j=0; j<idat.width; j++, pixel+=3){
+          b = pixel[0]; g = pixel[1]; r = pixel[2];
           if (r > m_rgbRegion[0] && g > m_rgbRegion[1] && b > m_rgbRegion[2]
               && r < m_rgbRegion[3] && g < m_rgbRegion[4] && b < m_rgbRegion[5]){
             cx += j;
@@ -178,7 +150,7 @@ RTC::ReturnCode_t ColorExtractor::onExecute(RTC::UniqueId ec_id)
         cx /= npixel;
         cy /= npixel;
         //printf("cx=%d, cy=%d, npixel=%d\n", cx, cy, npixel);
-        cvCircle(m_img, cvPoint(cx, cy), sqrt(npixel), CV_RGB(0,0,255), 6, 8, 0);
+        cv::circle(m_img, cv::Point(cx, cy), sqrt(npixel), cv::Scalar(255,0,0), 6, 8, 0);
         m_pos.tm = m_original.tm;
         m_pos.data.x = cx;
         m_pos.data.y = cy;
@@ -187,16 +159,9 @@ RTC::ReturnCode_t ColorExtractor::onExecute(RTC::UniqueId ec_id)
       // processing end
       
       // BGR -> RGB
-      rtm = m_result.data.image.raw_data.get_buffer();
-      for (int i=0; i<idat.height; i++){
-        for (int j=0; j<idat.width; j++){
-          cv = m_img->imageData + m_img->widthStep*i + j*3;
-          rtm[2] = cv[0]; 
-          rtm[1] = cv[1]; 
-          rtm[0] = cv[2];
-          rtm += 3;
-        }
-      }
+      unsigned char *rtm = setupImage(m_result.data.image,
+                                      idat.width, idat.height, idat.format);
+      swapRedBlue(m_img.data, rtm, idat.width, idat.height);
 
       m_resultOut.write();
   }
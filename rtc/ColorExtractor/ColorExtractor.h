@@ -19,7 +19,7 @@
 #include <rtm/DataInPort.h>
 #include <rtm/DataOutPort.h>
 #include <rtm/idl/BasicDataTypeSkel.h>
-#include <opencv2/core/core_c.h>
+#include <opencv2/core/core.hpp>
 
 // Service implementation headers
 // <rtc-template block="service_impl_h">
@@ -139,7 +139,7 @@ class ColorExtractor
   // </rtc-template>
 
  private:
-  IplImage *m_img;
+  cv::Mat m_img;
   int m_minPixels;
   std::vector<int> m_rgbRegion;
   int dummy;
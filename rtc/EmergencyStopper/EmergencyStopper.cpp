@@ -186,6 +186,8 @@ RTC::ReturnCode_t EmergencyStopper::onInitialize()
     m_interpolator->setName(std::string(m_profile.instance_name)+" interpolator");
     m_wrenches_interpolator = new interpolator(nforce*6, recover_time_dt);
     m_wrenches_interpolator->setName(std::string(m_profile.instance_name)+" interpolator wrenches");
+    m_input_posture_queue.resize(m_robot->numJoints(), default_retrieve_time);
+    m_input_wrenches_queue.resize(nforce*6, default_retrieve_time);
 
     m_q.data.length(m_robot->numJoints());
     for(unsigned int i=0; i<m_robot->numJoints(); i++){
@@ -283,13 +285,10 @@ RTC::ReturnCode_t EmergencyStopper::onExecute(RTC::UniqueId ec_id)
         // joint angle
         m_qRefIn.read();
         assert(m_qRef.data.length() == numJoints);
-        std::vector<double> current_posture;
+        Guard guard(m_mutex);
+        double *current_posture = m_input_posture_queue.push();
         for ( unsigned int i = 0; i < m_qRef.data.length(); i++ ) {
-            current_posture.push_back(m_qRef.data[i]);
-        }
-        m_input_posture_queue.push(current_posture);
-        while ((int)m_input_posture_queue.size() > default_retrieve_time) {
-            m_input_posture_queue.pop();
+            current_posture[i] = m_qRef.data[i];
         }
         if (!is_stop_mode) {
             for ( unsigned int i = 0; i < m_qRef.data.length(); i++ ) {
@@ -306,16 +305,12 @@ RTC::ReturnCode_t EmergencyStopper::onExecute(RTC::UniqueId ec_id)
                 m_wrenchesIn[i]->read();
             }
         }
-        std::vector<double> current_wrench;
+        double *current_wrench = m_input_wrenches_queue.push();
         for ( unsigned int i= 0; i < m_wrenchesRef.size(); i++ ) {
             for (int j = 0; j < 6; j++ ) {
-                current_wrench.push_back(m_wrenchesRef[i].data[j]);
+                current_wrench[i*6+j] = m_wrenchesRef[i].data[j];
             }
         }
-        m_input_wrenches_queue.push(current_wrench);
-        while ((int)m_input_wrenches_queue.size() > default_retrieve_time) {
-            m_input_wrenches_queue.pop();
-        }
         if (!is_stop_mode) {
             for ( unsigned int i= 0; i < m_wrenchesRef.size(); i++ ) {
                 for (int j = 0; j < 6; j++ ) {
@@ -514,8 +509,16 @@ bool EmergencyStopper::getEmergencyStopperParam(OpenHRP::EmergencyStopperService
 bool EmergencyStopper::setEmergencyStopperParam(const OpenHRP::EmergencyStopperService::EmergencyStopperParam& i_param)
 {
     std::cerr << "[" << m_profile.instance_name << "] setEmergencyStopperParam" << std::endl;
+    // a negative time would be a huge capacity of the queues
+    if (!(i_param.default_recover_time >= 0 && i_param.default_retrieve_time >= 0)) {
+        std::cerr << "[" << m_profile.instance_name << "]   default_recover_time and default_retrieve_time must be non-negative" << std::endl;
+        return false;
+    }
     default_recover_time = i_param.default_recover_time/m_dt;
+    Guard guard(m_mutex);
     default_retrieve_time = i_param.default_retrieve_time/m_dt;
+    m_input_posture_queue.resize(m_robot->numJoints(), default_retrieve_time);
+    m_input_wrenches_queue.resize(m_wrenchesRef.size()*6, default_retrieve_time);
     std::cerr << "[" << m_profile.instance_name << "]   default_recover_time = " << default_recover_time*m_dt << "[s], default_retrieve_time = " << default_retrieve_time*m_dt << "[s]" << std::endl;
     return true;
 };
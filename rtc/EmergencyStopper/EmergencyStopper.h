@@ -22,7 +22,8 @@
 #include <rtm/idl/ExtendedDataTypesSkel.h>
 #include <hrpModel/Body.h>
 #include "interpolator.h"
-#include <queue>
+#include <vector>
+#include <algorithm>
 
 // Service implementation headers
 // <rtc-template block="service_impl_h">
@@ -38,6 +39,52 @@
 
 using namespace RTC;
 
+/**
+   fixed capacity history of rows of doubles stored contiguously. Once it
+   is full, push() overwrites the oldest row, so no memory is allocated
+   except in resize().
+*/
+class RowRingBuffer
+{
+public:
+    RowRingBuffer() : m_cols(0), m_capacity(0), m_head(0), m_size(0) {}
+    // the newest rows are kept as long as they fit in i_capacity
+    void resize(size_t i_cols, size_t i_capacity)
+    {
+        if (i_capacity < 1) i_capacity = 1;
+        std::vector<double> buf(i_cols*i_capacity);
+        size_t n = (i_cols == m_cols) ? std::min(m_size, i_capacity) : 0;
+        for (size_t i=0; i<n; i++) {
+            const double *row = at(m_size-n+i);
+            std::copy(row, row+m_cols, buf.begin()+i*i_cols);
+        }
+        m_buf.swap(buf);
+        m_cols = i_cols;
+        m_capacity = i_capacity;
+        m_head = 0;
+        m_size = n;
+    }
+    // storage of a new row which becomes the newest one
+    double *push()
+    {
+        size_t index = (m_head + m_size) % m_capacity;
+        if (m_size < m_capacity) {
+            m_size++;
+        } else {
+            m_head = (m_head + 1) % m_capacity;
+        }
+        return &m_buf[index*m_cols];
+    }
+    // the oldest row
+    const double *front() const { return at(0); }
+    size_t size() const { return m_size; }
+    size_t capacity() const { return m_capacity; }
+private:
+    const double *at(size_t i) const { return &m_buf[((m_head + i) % m_capacity)*m_cols]; }
+    std::vector<double> m_buf;
+    size_t m_cols, m_capacity, m_head, m_size;
+};
+
 /**
    \brief sample RT component which has one data input port and one data output port
 */
@@ -188,8 +235,8 @@ private:
     double *m_tmp_wrenches;
     interpolator* m_interpolator;
     interpolator* m_wrenches_interpolator;
-    std::queue<std::vector<double> > m_input_posture_queue;
-    std::queue<std::vector<double> > m_input_wrenches_queue;
+    RowRingBuffer m_input_posture_queue;
+    RowRingBuffer m_input_wrenches_queue;
     int emergency_stopper_beep_count, emergency_stopper_beep_freq;
     coil::Mutex m_mutex;
     BeepClient bc;
@@ -12,6 +12,7 @@
 
 #include "hrpModel/Link.h"
 #include "hrpModel/ModelLoaderUtil.h"
+#include "hrpsys/util/ModelCache.h"
 
 typedef coil::Guard<coil::Mutex> Guard;
 
@@ -99,14 +100,14 @@ RTC::ReturnCode_t ForwardKinematics::onInitialize()
   nameServer = nameServer.substr(0, comPos);
   RTC::CorbaNaming naming(rtcManager.getORB(), nameServer.c_str());
   m_refBody = hrp::BodyPtr(new hrp::Body());
-  if (!loadBodyFromModelLoader(m_refBody, prop["model"].c_str(), 
-                               CosNaming::NamingContext::_duplicate(naming.getRootContext()))){
+  if (!loadBodyFromModelCache(m_refBody, prop["model"].c_str(), 
+                              CosNaming::NamingContext::_duplicate(naming.getRootContext()))){
     std::cerr << "[" << m_profile.instance_name << "] failed to load model[" << prop["model"] << "]" << std::endl;
     return RTC::RTC_ERROR;
   }
   m_actBody = hrp::BodyPtr(new hrp::Body());
-  if (!loadBodyFromModelLoader(m_actBody, prop["model"].c_str(), 
-                               CosNaming::NamingContext::_duplicate(naming.getRootContext()))){
+  if (!loadBodyFromModelCache(m_actBody, prop["model"].c_str(), 
+                              CosNaming::NamingContext::_duplicate(naming.getRootContext()))){
     std::cerr << "[" << m_profile.instance_name << "] failed to load model[" << prop["model"] << "]" << std::endl;
     return RTC::RTC_ERROR;
   }
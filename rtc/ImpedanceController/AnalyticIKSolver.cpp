@@ -0,0 +1,214 @@
+#include "AnalyticIKSolver.h"
+#include "JointPathEx.h"
+#include <iostream>
+#include <dlfcn.h>
+#include <coil/stringutil.h>
+
+#define AXIS_EPS 1e-6 // [m] tolerance of intersections of axes
+#define SOLUTION_EPS 1e-6 // [m], [rad] tolerance of residuals of solutions
+
+using namespace hrp;
+
+typedef AnalyticIKSolver* (*AnalyticIKSolverCreator)(const char *name, JointPathEx *path);
+
+static Matrix33 rotation(const Vector3& axis, double q)
+{
+    return Eigen::AngleAxis<double>(q, axis).toRotationMatrix();
+}
+
+// Paden-Kahan subproblem 1 : angle q such that rotation(w, q) * u = v
+static double rotationAngle(const Vector3& w, const Vector3& u, const Vector3& v)
+{
+    Vector3 up(u - w * w.dot(u)), vp(v - w * w.dot(v));
+    return std::atan2(w.dot(up.cross(vp)), up.dot(vp));
+}
+
+// Paden-Kahan subproblem 2 : angles (q1, q2) such that rotation(w1, q1) * rotation(w2, q2) * u = v
+static bool rotationAngles(const Vector3& w1, const Vector3& w2, const Vector3& u, const Vector3& v,
+                           double q1[2], double q2[2])
+{
+    double c = w1.dot(w2);
+    Vector3 w12(w1.cross(w2));
+    if (w12.squaredNorm() < AXIS_EPS) return false;
+    double alpha = (c * w2.dot(u) - w1.dot(v)) / (c * c - 1);
+    double beta = (c * w1.dot(v) - w2.dot(u)) / (c * c - 1);
+    double gamma2 = (u.squaredNorm() - alpha * alpha - beta * beta - 2 * alpha * beta * c) / w12.squaredNorm();
+    if (gamma2 < -SOLUTION_EPS) return false;
+    double gamma = std::sqrt(std::max(gamma2, 0.0));
+    for (int i = 0; i < 2; i++) {
+        Vector3 z(alpha * w1 + beta * w2 + (i == 0 ? gamma : -gamma) * w12);
+        q2[i] = rotationAngle(w2, u, z);
+        q1[i] = rotationAngle(w1, z, v);
+    }
+    return true;
+}
+
+// Paden-Kahan subproblem 3 : angles q such that |rotation(w, q) * u - v| = d
+static void rotationAnglesByDistance(const Vector3& w, const Vector3& u, const Vector3& v, double d,
+                                     double q[2])
+{
+    Vector3 up(u - w * w.dot(u)), vp(v - w * w.dot(v));
+    double dz = w.dot(u - v);
+    double dp2 = d * d - dz * dz;
+    double q0 = std::atan2(w.dot(up.cross(vp)), up.dot(vp));
+    double c = (up.squaredNorm() + vp.squaredNorm() - dp2) / (2 * up.norm() * vp.norm());
+    // a stretched limb is solved with the nearest angle and rejected by the residual
+    double dq = std::acos(std::min(std::max(c, -1.0), 1.0));
+    q[0] = q0 + dq;
+    q[1] = q0 - dq;
+}
+
+// closest point on line 1 to line 2, false if they are parallel or don't intersect
+static bool intersection(const Vector3& p1, const Vector3& w1, const Vector3& p2, const Vector3& w2,
+                         Vector3& x)
+{
+    Vector3 n(w1.cross(w2));
+    if (n.squaredNorm() < AXIS_EPS) return false;
+    double t = (p2 - p1).cross(w2).dot(n) / n.squaredNorm();
+    x = p1 + t * w1;
+    Vector3 d(x - p2);
+    return (d - w2 * w2.dot(d)).norm() < AXIS_EPS;
+}
+
+static bool isOnLine(const Vector3& x, const Vector3& p, const Vector3& w)
+{
+    Vector3 d(x - p);
+    return (d - w * w.dot(d)).norm() < AXIS_EPS;
+}
+
+// angle equivalent to q nearest to ref
+static double nearestAngle(double q, double ref)
+{
+    return q + 2 * M_PI * std::floor((ref - q) / (2 * M_PI) + 0.5);
+}
+
+Leg6DofIKSolver* Leg6DofIKSolver::create(JointPathEx& path)
+{
+    if (path.numJoints() != 6) return NULL;
+    // links from the base link to the end link, which must be descendants
+    std::vector<Link*> links;
+    for (Link* l = path.endLink(); l != path.baseLink(); l = l->parent) {
+        if (!l) return NULL;
+        links.insert(links.begin(), l);
+    }
+    // all links have the same orientation as the base link when joint angles are 0
+    Leg6DofIKSolver* solver = new Leg6DofIKSolver();
+    Vector3 pos(Vector3::Zero());
+    int j = 0;
+    for (size_t i = 0; i < links.size(); i++) {
+        pos += links[i]->b;
+        if (j < 6 && links[i] == path.joint(j)) {
+            if (links[i]->jointType != Link::ROTATIONAL_JOINT) break;
+            solver->axis[j] = links[i]->a.normalized();
+            solver->point[j] = pos;
+            solver->llimit.push_back(links[i]->llimit);
+            solver->ulimit.push_back(links[i]->ulimit);
+            j++;
+        }
+    }
+    solver->end_p0 = pos;
+    if (j != 6
+        || !intersection(solver->point[0], solver->axis[0], solver->point[1], solver->axis[1], solver->hip)
+        || !isOnLine(solver->hip, solver->point[2], solver->axis[2])
+        || solver->axis[1].cross(solver->axis[2]).squaredNorm() < AXIS_EPS
+        || !intersection(solver->point[4], solver->axis[4], solver->point[5], solver->axis[5], solver->ankle)) {
+        delete solver;
+        return NULL;
+    }
+    return solver;
+}
+
+bool Leg6DofIKSolver::solve(const Vector3& p, const Matrix33& R, dvector& q)
+{
+    // g1 = (target pose) * (end pose at q = 0)^-1 = e1 e2 e3 e4 e5 e6
+    //   where ei is rotation of joint i about its axis
+    Vector3 g1_ankle(R * (ankle - end_p0) + p);
+    Vector3 g1inv_hip(R.transpose() * (hip - p) + end_p0);
+
+    double best_dist = -1;
+    dvector best_q(6), tmp_q(6);
+    // knee : |e4 * ankle - hip| = |g1 * ankle - hip|
+    double q4[2];
+    rotationAnglesByDistance(axis[3], ankle - point[3], hip - point[3], (g1_ankle - hip).norm(), q4);
+    for (int i4 = 0; i4 < 2; i4++) {
+        // ankle : e6^-1 e5^-1 (e4^-1 * hip) = g1^-1 * hip
+        Vector3 x(point[3] + rotation(axis[3], -q4[i4]) * (hip - point[3]));
+        double q6[2], q5[2];
+        if (!rotationAngles(-axis[5], -axis[4], x - ankle, g1inv_hip - ankle, q6, q5)) continue;
+        for (int i56 = 0; i56 < 2; i56++) {
+            // hip : rotation of e1 e2 e3 = R * (e4 e5 e6)^-1
+            Matrix33 R123(R * (rotation(axis[3], q4[i4]) * rotation(axis[4], q5[i56]) * rotation(axis[5], q6[i56])).transpose());
+            double q1[2], q2[2];
+            if (!rotationAngles(axis[0], axis[1], axis[2], R123 * axis[2], q1, q2)) continue;
+            for (int i12 = 0; i12 < 2; i12++) {
+                Matrix33 R3((rotation(axis[0], q1[i12]) * rotation(axis[1], q2[i12])).transpose() * R123);
+                Vector3 u(axis[2].unitOrthogonal());
+                double q3 = rotationAngle(axis[2], u, R3 * u);
+                tmp_q << q1[i12], q2[i12], q3, q4[i4], q5[i56], q6[i56];
+                // check residuals and joint limits
+                Matrix33 tmp_R(Matrix33::Identity());
+                Vector3 tmp_p(end_p0);
+                bool is_valid = true;
+                for (int j = 5; j >= 0; j--) {
+                    tmp_q[j] = nearestAngle(tmp_q[j], q[j]);
+                    if (tmp_q[j] < llimit[j] || tmp_q[j] > ulimit[j]) is_valid = false;
+                    Matrix33 Rj(rotation(axis[j], tmp_q[j]));
+                    tmp_p = point[j] + Rj * (tmp_p - point[j]);
+                    tmp_R = Rj * tmp_R;
+                }
+                if (!is_valid
+                    || (tmp_p - p).norm() > SOLUTION_EPS
+                    || (tmp_R - R).norm() > SOLUTION_EPS) continue;
+                double dist = (tmp_q - q).squaredNorm();
+                if (best_dist < 0 || dist < best_dist) {
+                    best_dist = dist;
+                    best_q = tmp_q;
+                }
+            }
+        }
+    }
+    if (best_dist < 0) return false;
+    q = best_q;
+    return true;
+}
+
+AnalyticIKSolverPtr hrp::createAnalyticIKSolver(const std::string& name, JointPathEx& path,
+                                                const std::string& plugins)
+{
+    if (name == "leg6dof") return AnalyticIKSolverPtr(Leg6DofIKSolver::create(path));
+    coil::vstring plugins_str = coil::split(plugins, ",");
+    for (size_t i = 0; i < plugins_str.size(); i++) {
+        // plugins are never unloaded since solvers created by them may be alive
+        void *handle = dlopen(plugins_str[i].c_str(), RTLD_LAZY);
+        if (!handle) {
+            std::cerr << "failed to load an analytic IK plugin(" << dlerror() << ")" << std::endl;
+            continue;
+        }
+        AnalyticIKSolverCreator creator = (AnalyticIKSolverCreator)dlsym(handle, "createAnalyticIKSolver");
+        if (!creator) continue;
+        AnalyticIKSolver* solver = creator(name.c_str(), &path);
+        if (solver) return AnalyticIKSolverPtr(solver);
+    }
+    return AnalyticIKSolverPtr();
+};
+
+bool hrp::setAnalyticIKSolverFromProperties (JointPathEx& path,
+                                             const std::string& limb_name,
+                                             const std::string& prop_string,
+                                             const std::string& plugins_string,
+                                             const std::string& instance_name)
+{
+    coil::vstring analytic_ik_str = coil::split(prop_string, ",");
+    for (size_t i = 0; i + 1 < analytic_ik_str.size(); i += 2) {
+        if (analytic_ik_str[i] != limb_name) continue;
+        AnalyticIKSolverPtr solver = createAnalyticIKSolver(analytic_ik_str[i+1], path, plugins_string);
+        if (!solver) {
+            std::cerr << "[" << instance_name << "] Analytic IK [" << analytic_ik_str[i+1] << "] can't be used for " << limb_name << std::endl;
+            return false;
+        }
+        std::cerr << "[" << instance_name << "] Analytic IK [" << analytic_ik_str[i+1] << "] is used for " << limb_name << std::endl;
+        path.setAnalyticIKSolver(solver);
+        return true;
+    }
+    return false;
+};
@@ -0,0 +1,63 @@
+#ifndef __ANALYTIC_IK_SOLVER_H__
+#define __ANALYTIC_IK_SOLVER_H__
+#include <string>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <hrpModel/Body.h>
+#include <hrpModel/Link.h>
+
+namespace hrp {
+    class JointPathEx;
+
+    /**
+       closed-form inverse kinematics of a joint path. JointPathEx uses it
+       instead of the numerical solver if it is set, and falls back to the
+       numerical solver when it fails or its solution exceeds joint limits.
+
+       A plugin is a shared library which exports
+         extern "C" hrp::AnalyticIKSolver* createAnalyticIKSolver(const char *name, hrp::JointPathEx *path);
+       returning NULL if it doesn't provide the solver or the solver can't be
+       applied to the path.
+     */
+    class AnalyticIKSolver {
+  public:
+    virtual ~AnalyticIKSolver() {};
+    // q : joint angles which place the end link at (p, R) in the base link frame.
+    //     Current joint angles are given so that the nearest solution can be chosen.
+    virtual bool solve(const Vector3& p, const Matrix33& R, dvector& q) = 0;
+    };
+
+    typedef boost::shared_ptr<AnalyticIKSolver> AnalyticIKSolverPtr;
+
+    /**
+       6 dof leg whose first 3 joint axes intersect at a point (hip) and
+       last 2 joint axes intersect at another point (ankle), solved by
+       Paden-Kahan subproblems. The order and directions of axes and the
+       offsets between joints are arbitrary.
+     */
+    class Leg6DofIKSolver : public AnalyticIKSolver {
+  public:
+    // NULL if the path doesn't have the structure
+    static Leg6DofIKSolver* create(JointPathEx& path);
+    bool solve(const Vector3& p, const Matrix33& R, dvector& q);
+  protected:
+    Leg6DofIKSolver() {};
+    // joint axes and points on them, end link position when all joint angles are 0
+    Vector3 axis[6], point[6], end_p0;
+    // intersections of hip and ankle axes
+    Vector3 hip, ankle;
+    std::vector<double> llimit, ulimit;
+    };
+
+    // create a solver by its name, built-in "leg6dof" or provided by plugins (comma-separated paths)
+    AnalyticIKSolverPtr createAnalyticIKSolver(const std::string& name, JointPathEx& path,
+                                               const std::string& plugins = "");
+
+    // set the solver of a limb from a property such as "rleg,leg6dof,lleg,leg6dof"
+    bool setAnalyticIKSolverFromProperties (JointPathEx& path,
+                                            const std::string& limb_name,
+                                            const std::string& prop_string,
+                                            const std::string& plugins_string,
+                                            const std::string& instance_name);
+};
+#endif //__ANALYTIC_IK_SOLVER_H__
@@ -11,6 +11,7 @@
 #include <hrpModel/Link.h>
 #include <hrpModel/Sensor.h>
 #include <hrpModel/ModelLoaderUtil.h>
+#include "hrpsys/util/ModelCache.h"
 #include "ImpedanceController.h"
 #include "JointPathEx.h"
 #include <hrpModel/JointPath.h>
@@ -109,12 +110,13 @@ RTC::ReturnCode_t ImpedanceController::onInitialize()
     }
     nameServer = nameServer.substr(0, comPos);
     RTC::CorbaNaming naming(rtcManager.getORB(), nameServer.c_str());
-    if (!loadBodyFromModelLoader(m_robot, prop["model"].c_str(), 
-                                 CosNaming::NamingContext::_duplicate(naming.getRootContext())
-                                 )){
+    if (!loadBodyFromModelCache(m_robot, prop["model"].c_str(), 
+                                CosNaming::NamingContext::_duplicate(naming.getRootContext())
+                                )){
       std::cerr << "[" << m_profile.instance_name << "] failed to load model[" << prop["model"] << "]" << std::endl;
       return RTC::RTC_ERROR;
     }
+    m_kinematics.setBody(m_robot.get());
 
 
     // Setting for wrench data ports (real + virtual)
@@ -243,6 +245,7 @@ RTC::ReturnCode_t ImpedanceController::onInitialize()
             std::cerr << "[" << m_profile.instance_name << "]   Invalid joint path from " << base_name_map[ee_name] << " to " << target_link->name << "!! Impedance param for " << sensor_name << " cannot be added!!" << std::endl;
             continue;
         }
+        hrp::setAnalyticIKSolverFromProperties(*p.manip, ee_name, prop["analytic_ik"], prop["analytic_ik_plugins"], std::string(m_profile.instance_name));
         // 4. Set impedance param
         p.transition_joint_q.resize(m_robot->numJoints());
         p.sensor_name = sensor_name;
@@ -371,7 +374,7 @@ RTC::ReturnCode_t ImpedanceController::onExecute(RTC::UniqueId ec_id)
                 }
             }
 	  }
-	  m_robot->calcForwardKinematics();
+	  m_kinematics.calcForwardKinematics();
 
 	}
 
@@ -460,7 +463,7 @@ void ImpedanceController::getTargetParameters ()
     }
     m_robot->rootLink()->p = hrp::Vector3(m_basePos.data.x, m_basePos.data.y, m_basePos.data.z);
     m_robot->rootLink()->R = hrp::rotFromRpy(m_baseRpy.data.r, m_baseRpy.data.p, m_baseRpy.data.y);
-    m_robot->calcForwardKinematics();
+    m_kinematics.calcForwardKinematics();
     // Fix leg for legged robot
     if ( (ee_map.find("rleg") != ee_map.end() && ee_map.find("lleg") != ee_map.end()) // if legged robot
          && !use_sh_base_pos_rpy ) {
@@ -500,7 +503,7 @@ void ImpedanceController::getTargetParameters ()
         hrp::Matrix33 tmpR (new_foot_mid_rot * current_foot_mid_rot.transpose());
         m_robot->rootLink()->p = new_foot_mid_pos + tmpR * (m_robot->rootLink()->p - current_foot_mid_pos);
         rats::rotm3times(m_robot->rootLink()->R, tmpR, m_robot->rootLink()->R);
-        m_robot->calcForwardKinematics();
+        m_kinematics.calcForwardKinematics();
     }
 
     // Set sequencer position and orientation to target_p0 and target_r0
@@ -21,6 +21,7 @@
 #include <rtm/idl/ExtendedDataTypesSkel.h>
 #include <hrpModel/Body.h>
 #include "JointPathEx.h"
+#include "IncrementalKinematics.h"
 #include "RatsMatrix.h"
 #include "ImpedanceOutputGenerator.h"
 // Service implementation headers
@@ -183,6 +184,7 @@ class ImpedanceController
   std::map<std::string, hrp::Vector3> abs_forces, abs_moments, abs_ref_forces, abs_ref_moments;
   double m_dt;
   hrp::BodyPtr m_robot;
+  hrp::IncrementalKinematics m_kinematics;
   coil::Mutex m_mutex;
   hrp::dvector qrefv;
   unsigned int m_debugLevel;
@@ -0,0 +1,165 @@
+#include "IncrementalKinematics.h"
+#include <hrpUtil/Eigen3d.h>
+#include <map>
+
+using namespace hrp;
+
+void IncrementalKinematics::setBody(Body* _body)
+{
+    body = _body;
+    links.clear();
+    parent_indices.clear();
+    std::map<Link*, int> indices;
+    std::vector<Link*> stack(1, body->rootLink());
+    while (!stack.empty()) {
+        Link* l = stack.back();
+        stack.pop_back();
+        std::map<Link*, int>::iterator it = indices.find(l->parent);
+        parent_indices.push_back(it == indices.end() ? -1 : it->second);
+        indices[l] = links.size();
+        links.push_back(l);
+        for (Link* c = l->child; c; c = c->sibling) stack.push_back(c);
+    }
+    size_t n = links.size();
+    prev_q.resize(n);
+    local_R.assign(n, Matrix33::Identity());
+    local_p.assign(n, Vector3::Zero());
+    world_R.assign(n, Matrix33::Identity());
+    world_p.assign(n, Vector3::Zero());
+    local_submc.assign(n, Vector3::Zero());
+    subm.resize(n);
+    changed.resize(n);
+    pose_dirty.resize(n);
+    cm_dirty.resize(n);
+    invalidate();
+}
+
+void IncrementalKinematics::update()
+{
+    if (!initialized) {
+        // masses are assumed to be constant until the next invalidation
+        for (size_t i = 0; i < links.size(); i++) subm[i] = links[i]->m;
+        for (size_t i = links.size() - 1; i > 0; i--) subm[parent_indices[i]] += subm[i];
+        cm_dirty[0] = true;
+    }
+    Matrix33 rot;
+    num_updated_links = 0;
+    changed[0] = false;
+    for (size_t i = 1; i < links.size(); i++) {
+        Link* l = links[i];
+        int pi = parent_indices[i];
+        changed[i] = !initialized || changed[pi] || l->q != prev_q[i];
+        if (!changed[i]) continue;
+        prev_q[i] = l->q;
+        switch (l->jointType) {
+        case Link::ROTATIONAL_JOINT:
+            calcRodrigues(rot, l->a, l->q);
+            local_R[i].noalias() = local_R[pi] * rot;
+            local_p[i].noalias() = local_R[pi] * l->b + local_p[pi];
+            break;
+        case Link::SLIDE_JOINT:
+            local_R[i] = local_R[pi];
+            local_p[i].noalias() = local_R[pi] * (l->b + l->q * l->d) + local_p[pi];
+            break;
+        case Link::FIXED_JOINT:
+        default:
+            local_R[i] = local_R[pi];
+            local_p[i].noalias() = local_R[pi] * l->b + local_p[pi];
+            break;
+        }
+        pose_dirty[i] = cm_dirty[i] = true;
+        num_updated_links++;
+    }
+    initialized = true;
+}
+
+void IncrementalKinematics::calcForwardKinematics()
+{
+    update();
+    Link* root = links[0];
+    bool root_moved = !root_initialized || root->p != prev_root_p || root->R != prev_root_R;
+    for (size_t i = 1; i < links.size(); i++) {
+        Link* l = links[i];
+        // poses may have been overwritten by others, e.g. JointPath::calcForwardKinematics()
+        if (!root_moved && !pose_dirty[i] && l->p == world_p[i] && l->R == world_R[i]) continue;
+        world_R[i].noalias() = root->R * local_R[i];
+        world_p[i].noalias() = root->R * local_p[i] + root->p;
+        l->R = world_R[i];
+        l->p = world_p[i];
+        pose_dirty[i] = false;
+    }
+    prev_root_p = root->p;
+    prev_root_R = root->R;
+    root_initialized = true;
+}
+
+Vector3 IncrementalKinematics::calcCM()
+{
+    update();
+    // subtrees including changed links, descendants have larger indices
+    for (size_t i = links.size() - 1; i > 0; i--) {
+        if (cm_dirty[i]) cm_dirty[parent_indices[i]] = true;
+    }
+    for (size_t i = 0; i < links.size(); i++) {
+        if (!cm_dirty[i]) continue;
+        Link* l = links[i];
+        local_submc[i].noalias() = l->m * (local_R[i] * l->c + local_p[i]);
+    }
+    for (size_t i = links.size() - 1; i > 0; i--) {
+        int pi = parent_indices[i];
+        if (cm_dirty[pi]) local_submc[pi] += local_submc[i];
+        cm_dirty[i] = false;
+    }
+    cm_dirty[0] = false;
+    Link* root = links[0];
+    return root->R * local_submc[0] / subm[0] + root->p;
+}
+
+void IncrementalKinematics::calcCMJacobian(Link* base, dmatrix& J)
+{
+    calcCM();
+    Link* root = links[0];
+    double total_mass = subm[0];
+    int nj = body->numJoints();
+    J.resize(3, base ? nj : nj + 6);
+    J.setZero();
+    // joints between the root link and base move the rest of the body in the opposite direction
+    std::vector<char> reversed(links.size(), false);
+    if (base) {
+        for (size_t i = 0; i < links.size(); i++) {
+            if (links[i] != base) continue;
+            for (int j = i; j > 0; j = parent_indices[j]) reversed[j] = true;
+            break;
+        }
+    }
+    for (size_t i = 1; i < links.size(); i++) {
+        Link* l = links[i];
+        if (l->jointId < 0 || l->jointId >= nj) continue;
+        double m = subm[i];
+        Vector3 mc(local_submc[i]);
+        double sgn = 1.0;
+        if (reversed[i]) {
+            m = total_mass - m;
+            mc = local_submc[0] - mc;
+            sgn = -1.0;
+        }
+        switch (l->jointType) {
+        case Link::ROTATIONAL_JOINT:
+            J.col(l->jointId) = root->R * (sgn / total_mass * (local_R[i] * l->a).cross(mc - m * local_p[i]));
+            break;
+        case Link::SLIDE_JOINT:
+            J.col(l->jointId) = root->R * (sgn * m / total_mass * (local_R[i] * l->d));
+            break;
+        default:
+            break;
+        }
+    }
+    if (!base) {
+        // translation and rotation of the root link
+        Vector3 dp(root->R * local_submc[0] / total_mass);
+        J.block<3,3>(0, nj) = Matrix33::Identity();
+        J(0, nj+3) =    0.0; J(0, nj+4) =  dp(2); J(0, nj+5) = -dp(1);
+        J(1, nj+3) = -dp(2); J(1, nj+4) =    0.0; J(1, nj+5) =  dp(0);
+        J(2, nj+3) =  dp(1); J(2, nj+4) = -dp(0); J(2, nj+5) =    0.0;
+    }
+}
@@ -0,0 +1,62 @@
+#ifndef __INCREMENTAL_KINEMATICS_H__
+#define __INCREMENTAL_KINEMATICS_H__
+#include <vector>
+#include <hrpModel/Body.h>
+#include <hrpModel/Link.h>
+
+// hrplib/hrpModel/Body.h
+namespace hrp {
+    /**
+       forward kinematics, center of mass and its jacobian of a whole body,
+       updated incrementally. Poses of links relative to the root link and
+       mass moments of subtrees in the root link frame are kept, and only
+       the subtrees whose joint angles have changed since the previous call
+       and their ancestors are recomputed. Moving the root link only
+       transforms the kept poses, and the center of mass doesn't need any
+       update for it.
+
+       Joint angles and the pose of the root link are compared with the
+       values of the previous call, and poses of links with the ones
+       written by the previous call, so that poses overwritten by others,
+       e.g. JointPath::calcForwardKinematics() in inverse kinematics, are
+       recomputed even if joint angles are restored. invalidate() must be
+       called after the body is changed in other ways, e.g. masses or
+       offsets of links.
+       calcCM() doesn't set Link::wc unlike Body::calcCM().
+     */
+    class IncrementalKinematics {
+  public:
+    IncrementalKinematics() : body(NULL), initialized(false), root_initialized(false) {};
+    void setBody(Body* _body);
+    void invalidate() { initialized = root_initialized = false; };
+    // same as Body::calcForwardKinematics()
+    void calcForwardKinematics();
+    // same as Body::calcCM() after Body::calcForwardKinematics()
+    Vector3 calcCM();
+    // same as Body::calcCMJacobian()
+    void calcCMJacobian(Link* base, dmatrix& J);
+    // number of links recomputed by the last update, for debugging
+    size_t numUpdatedLinks() const { return num_updated_links; };
+  protected:
+    void update();
+
+    Body* body;
+    std::vector<Link*> links; // a parent always precedes its children
+    std::vector<int> parent_indices; // index in links, -1 for the root
+    std::vector<double> prev_q;
+    // poses and sums of mass * COM of subtrees in the root link frame
+    std::vector<Matrix33> local_R;
+    std::vector<Vector3> local_p, local_submc;
+    // world poses written by the last calcForwardKinematics()
+    std::vector<Matrix33> world_R;
+    std::vector<Vector3> world_p;
+    std::vector<double> subm;
+    // changed by the last update, not yet reflected in world poses, not yet reflected in subtree sums
+    std::vector<char> changed, pose_dirty, cm_dirty;
+    Vector3 prev_root_p;
+    Matrix33 prev_root_R;
+    size_t num_updated_links;
+    bool initialized, root_initialized;
+    };
+};
+#endif //__INCREMENTAL_KINEMATICS_H__
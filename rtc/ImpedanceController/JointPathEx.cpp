@@ -346,16 +346,7 @@ bool JointPathEx::calcInverseKinematics2Loop(const Vector3& dp, const Vector3& o
     }
 
     // dq limitation using lvlimit/uvlimit
-    double min_speed_ratio = 1.0;
-    for(int j=0; j < n; ++j){
-        double speed_ratio = 1.0;
-        if (dq(j) < joints[j]->lvlimit * dt) {
-            speed_ratio = fabs(joints[j]->lvlimit * dt / dq(j));
-        } else if (dq(j) > joints[j]->uvlimit * dt) {
-            speed_ratio = fabs(joints[j]->uvlimit * dt / dq(j));
-        }
-        min_speed_ratio = std::max(std::min(min_speed_ratio, speed_ratio), 0.0);
-    }
+    double min_speed_ratio = calcSpeedRatio(dq);
     if ( min_speed_ratio < 1.0 ) { 
       if ( DEBUG ) {
         std::cerr << "spdlmt: ";
@@ -467,9 +458,78 @@ bool JointPathEx::calcInverseKinematics2Loop(const Vector3& end_effector_p, cons
     hrp::Vector3 vel_r(endLink()->R * matrix_logEx(endLink()->R.transpose() * target_link_R));
     vel_p *= vel_gain;
     vel_r *= vel_gain;
+    if (analytic_ik_solver) {
+        // Same step as the numerical solver, the null space is not used by a non-redundant path.
+        double gain = std::min(LAMBDA, 1.0);
+        hrp::Matrix33 step_R(endLink()->R);
+        if (vel_r.norm() > 0) step_R = Eigen::AngleAxis<double>(gain * vel_r.norm(), vel_r.normalized()).toRotationMatrix() * step_R;
+        hrp::dvector q(numJoints());
+        if (solveInverseKinematicsAnalytic(endLink()->p + gain * vel_p, step_R, q)) {
+            // dq limitation using lvlimit/uvlimit as the numerical solver
+            hrp::dvector dq(q.size());
+            for (int j = 0; j < dq.size(); j++) {
+                dq(j) = q(j) - joints[j]->q;
+            }
+            double min_speed_ratio = calcSpeedRatio(dq);
+            for (int j = 0; j < dq.size(); j++) {
+                joints[j]->q += min_speed_ratio * dq(j);
+            }
+            calcForwardKinematics();
+            return true;
+        }
+    }
     return calcInverseKinematics2Loop(vel_p, vel_r, LAMBDA, avoid_gain, reference_gain, reference_q);
 }
 
+bool JointPathEx::calcInverseKinematicsAnalytic(const Vector3& end_p, const Matrix33& end_R)
+{
+    const int n = numJoints();
+    hrp::dvector q(n);
+    if (!solveInverseKinematicsAnalytic(end_p, end_R, q)) return false;
+    for (int i = 0; i < n; i++) {
+        joints[i]->q = q[i];
+    }
+    calcForwardKinematics();
+    return true;
+}
+
+bool JointPathEx::solveInverseKinematicsAnalytic(const Vector3& end_p, const Matrix33& end_R, dvector& q)
+{
+    if (!analytic_ik_solver || !interlocking_joint_pair_indices.empty()) return false;
+    const int n = numJoints();
+    q.resize(n);
+    for (int i = 0; i < n; i++) {
+        q[i] = joints[i]->q;
+    }
+    if (!analytic_ik_solver->solve(baseLink()->R.transpose() * (end_p - baseLink()->p),
+                                   baseLink()->R.transpose() * end_R, q)) {
+        return false;
+    }
+    // check nan / inf
+    for (int i = 0; i < n; i++) {
+        if ( std::isnan(q[i]) || std::isinf(q[i]) ) {
+            std::cerr << "[" << debug_print_prefix << "] ERROR nan/inf is found in analytic IK" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+double JointPathEx::calcSpeedRatio(const dvector& dq)
+{
+    double min_speed_ratio = 1.0;
+    for(int j=0; j < dq.size(); ++j){
+        double speed_ratio = 1.0;
+        if (dq(j) < joints[j]->lvlimit * dt) {
+            speed_ratio = fabs(joints[j]->lvlimit * dt / dq(j));
+        } else if (dq(j) > joints[j]->uvlimit * dt) {
+            speed_ratio = fabs(joints[j]->uvlimit * dt / dq(j));
+        }
+        min_speed_ratio = std::max(std::min(min_speed_ratio, speed_ratio), 0.0);
+    }
+    return min_speed_ratio;
+}
+
 bool JointPathEx::calcInverseKinematics2(const Vector3& end_p, const Matrix33& end_R,
                                          const double avoid_gain, const double reference_gain, const hrp::dvector* reference_q)
 {
@@ -492,6 +552,8 @@ bool JointPathEx::calcInverseKinematics2(const Vector3& end_p, const Matrix33& e
         }
     }
     
+    if (calcInverseKinematicsAnalytic(end_p, end_R)) return true;
+
     const int n = numJoints();
     dvector qorg(n);
 
@@ -5,6 +5,7 @@
 #include <hrpModel/JointPath.h>
 #include <cmath>
 #include <coil/stringutil.h>
+#include "AnalyticIKSolver.h"
 
 // hrplib/hrpUtil/MatrixSolvers.h
 namespace hrp {
@@ -46,7 +47,15 @@ namespace hrp {
             _opt_w[i] = optional_weight_vector[i];
         }
     };
+    void setAnalyticIKSolver(const AnalyticIKSolverPtr& _solver) { analytic_ik_solver = _solver; };
+    AnalyticIKSolverPtr getAnalyticIKSolver() { return analytic_ik_solver; };
+    // Solve IK by the analytic IK solver. False if it is not set or fails, and joint angles are not changed.
+    bool calcInverseKinematicsAnalytic(const Vector3& end_p, const Matrix33& end_R);
   protected:
+        // Joint angles solved by the analytic IK solver without changing joints. False if it is not set, fails or gives nan/inf.
+        bool solveInverseKinematicsAnalytic(const Vector3& end_p, const Matrix33& end_R, dvector& q);
+        // Ratio to scale dq so that joint velocities are within lvlimit/uvlimit in a control cycle
+        double calcSpeedRatio(const dvector& dq);
         double maxIKPosErrorSqr, maxIKRotErrorSqr;
         int maxIKIteration;
         std::vector<Link*> joints;
@@ -62,6 +71,7 @@ namespace hrp {
         std::vector<size_t> joint_limit_debug_print_counts;
         size_t debug_print_freq_count;
         bool use_inside_joint_weight_retrieval;
+        AnalyticIKSolverPtr analytic_ik_solver;
     };
 
     typedef boost::shared_ptr<JointPathEx> JointPathExPtr;
@@ -0,0 +1,70 @@
+#include "PartialForwardKinematics.h"
+#include <hrpUtil/Eigen3d.h>
+#include <algorithm>
+
+using namespace hrp;
+
+void PartialForwardKinematics::addTarget(Link* target)
+{
+    std::vector<Link*> chain;
+    for (Link* l = target; l; l = l->parent) {
+        if (std::find(path_links.begin(), path_links.end(), l) != path_links.end()) break;
+        chain.push_back(l);
+    }
+    // chain is ordered from the target, append it from the root side
+    for (std::vector<Link*>::reverse_iterator it = chain.rbegin(); it != chain.rend(); it++) {
+        Link* l = *it;
+        std::vector<Link*>::iterator pit = std::find(path_links.begin(), path_links.end(), l->parent);
+        parent_indices.push_back(pit == path_links.end() ? -1 : pit - path_links.begin());
+        path_links.push_back(l);
+        prev_q.push_back(l->q);
+    }
+    dirty.resize(path_links.size());
+    initialized = false;
+}
+
+void PartialForwardKinematics::clear()
+{
+    path_links.clear();
+    parent_indices.clear();
+    prev_q.clear();
+    dirty.clear();
+    initialized = false;
+}
+
+void PartialForwardKinematics::calcForwardKinematics()
+{
+    Matrix33 rot;
+    for (size_t i = 0; i < path_links.size(); i++) {
+        Link* l = path_links[i];
+        int pi = parent_indices[i];
+        if (pi < 0) {
+            // the root link, its pose is given from outside
+            dirty[i] = !initialized || l->p != prev_root_p || l->R != prev_root_R;
+            prev_root_p = l->p;
+            prev_root_R = l->R;
+            continue;
+        }
+        dirty[i] = !initialized || dirty[pi] || l->q != prev_q[i];
+        if (!dirty[i]) continue;
+        prev_q[i] = l->q;
+        Link* parent = l->parent;
+        switch (l->jointType) {
+        case Link::ROTATIONAL_JOINT:
+            calcRodrigues(rot, l->a, l->q);
+            l->R.noalias() = parent->R * rot;
+            l->p = parent->R * l->b + parent->p;
+            break;
+        case Link::SLIDE_JOINT:
+            l->p = parent->R * (l->b + l->q * l->d) + parent->p;
+            l->R = parent->R;
+            break;
+        case Link::FIXED_JOINT:
+        default:
+            l->p = parent->R * l->b + parent->p;
+            l->R = parent->R;
+            break;
+        }
+    }
+    initialized = true;
+}
@@ -0,0 +1,34 @@
+#ifndef __PARTIAL_FORWARD_KINEMATICS_H__
+#define __PARTIAL_FORWARD_KINEMATICS_H__
+#include <vector>
+#include <hrpModel/Body.h>
+#include <hrpModel/Link.h>
+
+// hrplib/hrpModel/LinkTraverse.h
+namespace hrp {
+    /**
+       forward kinematics restricted to links on the paths from the root
+       link to target links such as links sensors are attached to. The
+       paths are merged in advance so that a parent always precedes its
+       children, and a link is recomputed only when its joint angle or the
+       pose of its parent has changed since the previous call. Positions
+       and rotations of the other links are left untouched.
+     */
+    class PartialForwardKinematics {
+  public:
+    PartialForwardKinematics() : initialized(false) {};
+    void addTarget(Link* target);
+    void clear();
+    void calcForwardKinematics();
+    const std::vector<Link*>& links() const { return path_links; };
+  protected:
+    std::vector<Link*> path_links;
+    std::vector<int> parent_indices; // index in path_links, -1 for the root
+    std::vector<double> prev_q;
+    std::vector<char> dirty;
+    Vector3 prev_root_p;
+    Matrix33 prev_root_R;
+    bool initialized;
+    };
+};
+#endif //__PARTIAL_FORWARD_KINEMATICS_H__
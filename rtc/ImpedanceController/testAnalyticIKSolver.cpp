@@ -0,0 +1,295 @@
+/* -*- coding:utf-8-unix; mode:c++; -*- */
+
+#include "JointPathEx.h"
+#include <hrpModel/ModelLoaderUtil.h>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include <time.h>
+
+#ifndef deg2rad
+#define deg2rad(deg) (deg * M_PI / 180)
+#endif
+
+// compare an analytic IK solver with the numerical solver of JointPathEx
+class testAnalyticIKSolver
+{
+protected:
+    hrp::BodyPtr robot;
+    std::string base_name, end_name, solver_name, plugins;
+    int num_samples;
+    double now ()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec + ts.tv_nsec * 1e-9;
+    };
+    double random (double min, double max)
+    {
+        return min + (max - min) * rand() / (double)RAND_MAX;
+    };
+    // 6 dof leg whose joints are aligned along -z with offsets
+    void createLeg (const hrp::Vector3 axes[6], const hrp::Vector3 offsets[7])
+    {
+        robot = hrp::BodyPtr(new hrp::Body());
+        hrp::Link* root = new hrp::Link();
+        root->name = base_name = "WAIST";
+        root->jointType = hrp::Link::FREE_JOINT;
+        root->jointId = -1;
+        root->b = hrp::Vector3::Zero();
+        root->Rs = hrp::Matrix33::Identity();
+        robot->setRootLink(root);
+        hrp::Link* parent = root;
+        for (int i = 0; i < 7; i++) {
+            hrp::Link* l = new hrp::Link();
+            char name[16];
+            sprintf(name, "JOINT%d", i);
+            l->name = i < 6 ? name : "FOOT";
+            l->jointType = i < 6 ? hrp::Link::ROTATIONAL_JOINT : hrp::Link::FIXED_JOINT;
+            l->jointId = i < 6 ? i : -1;
+            l->a = i < 6 ? axes[i] : hrp::Vector3::UnitZ();
+            l->b = offsets[i];
+            l->Rs = hrp::Matrix33::Identity();
+            l->llimit = i == 3 ? 0.0 : deg2rad(-120);
+            l->ulimit = i == 3 ? deg2rad(150) : deg2rad(120);
+            l->lvlimit = -5.0;
+            l->uvlimit = 5.0;
+            parent->addChild(l);
+            parent = l;
+        }
+        end_name = "FOOT";
+        robot->updateLinkTree();
+        robot->rootLink()->p = hrp::Vector3(0, 0, 1.0);
+        robot->rootLink()->R = hrp::Matrix33::Identity();
+        robot->calcForwardKinematics();
+    };
+    bool check ()
+    {
+        hrp::JointPathEx path(robot, robot->link(base_name), robot->link(end_name), 0.002);
+        hrp::AnalyticIKSolverPtr solver = hrp::createAnalyticIKSolver(solver_name, path, plugins);
+        if (!solver) {
+            std::cerr << "[testAnalyticIKSolver] solver " << solver_name << " can't be used for " << base_name << " - " << end_name << std::endl;
+            return false;
+        }
+        int n = path.numJoints();
+        hrp::dvector q_target(n), q_start(n);
+        int analytic_success = 0, numerical_success = 0;
+        double analytic_time = 0, numerical_time = 0, max_pos_error = 0, max_rot_error = 0, max_q_diff = 0;
+        srand(0);
+        for (int i = 0; i < num_samples; i++) {
+            // target pose from random joint angles, start from angles near them
+            for (int j = 0; j < n; j++) {
+                hrp::Link* l = path.joint(j);
+                double margin = (l->ulimit - l->llimit) * 0.05;
+                q_target[j] = random(l->llimit + margin, l->ulimit - margin);
+                q_start[j] = std::min(std::max(q_target[j] + random(-0.2, 0.2), l->llimit), l->ulimit);
+                l->q = q_target[j];
+            }
+            path.calcForwardKinematics();
+            hrp::Vector3 end_p(path.endLink()->p);
+            hrp::Matrix33 end_R(path.endLink()->R);
+
+            for (int j = 0; j < n; j++) path.joint(j)->q = q_start[j];
+            path.calcForwardKinematics();
+            path.setAnalyticIKSolver(solver);
+            double t0 = now();
+            bool solved = path.calcInverseKinematicsAnalytic(end_p, end_R);
+            analytic_time += now() - t0;
+            if (solved) {
+                analytic_success++;
+                max_pos_error = std::max(max_pos_error, (path.endLink()->p - end_p).norm());
+                max_rot_error = std::max(max_rot_error, (path.endLink()->R - end_R).norm());
+                for (int j = 0; j < n; j++) {
+                    max_q_diff = std::max(max_q_diff, std::fabs(path.joint(j)->q - q_target[j]));
+                }
+            }
+
+            for (int j = 0; j < n; j++) path.joint(j)->q = q_start[j];
+            path.calcForwardKinematics();
+            path.setAnalyticIKSolver(hrp::AnalyticIKSolverPtr());
+            t0 = now();
+            if (path.calcInverseKinematics2(end_p, end_R)) numerical_success++;
+            numerical_time += now() - t0;
+        }
+        std::cerr << "[testAnalyticIKSolver] " << solver_name << ", " << num_samples << " samples" << std::endl;
+        std::cerr << "[testAnalyticIKSolver]   analytic  : success = " << analytic_success << ", time = " << analytic_time / num_samples * 1e6 << "[us]" << std::endl;
+        std::cerr << "[testAnalyticIKSolver]   numerical : success = " << numerical_success << ", time = " << numerical_time / num_samples * 1e6 << "[us]" << std::endl;
+        std::cerr << "[testAnalyticIKSolver]   max errors of analytic solutions : pos = " << max_pos_error << "[m], rot = " << max_rot_error << ", q = " << max_q_diff << "[rad]" << std::endl;
+        return analytic_success == num_samples && max_pos_error < 1e-6 && max_rot_error < 1e-6;
+    };
+    // joint velocities of analytic solutions in a control loop are limited by lvlimit/uvlimit
+    bool check_speed_limit ()
+    {
+        const double dt = 0.002;
+        const int max_cycles = 2000;
+        hrp::JointPathEx path(robot, robot->link(base_name), robot->link(end_name), dt);
+        hrp::AnalyticIKSolverPtr solver = hrp::createAnalyticIKSolver(solver_name, path, plugins);
+        if (!solver) {
+            std::cerr << "[testAnalyticIKSolver] solver " << solver_name << " can't be used for " << base_name << " - " << end_name << std::endl;
+            return false;
+        }
+        path.setAnalyticIKSolver(solver);
+        int n = path.numJoints();
+        hrp::dvector q_target(n), q_prev(n);
+        int reached = 0, speed_over = 0, total_cycles = 0;
+        double max_speed_ratio = 0;
+        srand(0);
+        for (int i = 0; i < num_samples; i++) {
+            // target pose and start angles far from each other
+            for (int j = 0; j < n; j++) {
+                hrp::Link* l = path.joint(j);
+                double margin = (l->ulimit - l->llimit) * 0.05;
+                q_target[j] = random(l->llimit + margin, l->ulimit - margin);
+                l->q = q_target[j];
+            }
+            path.calcForwardKinematics();
+            hrp::Vector3 end_p(path.endLink()->p);
+            hrp::Matrix33 end_R(path.endLink()->R);
+            for (int j = 0; j < n; j++) {
+                hrp::Link* l = path.joint(j);
+                l->q = std::min(std::max(q_target[j] + random(-0.5, 0.5), l->llimit), l->ulimit);
+            }
+            path.calcForwardKinematics();
+            for (int k = 0; k < max_cycles; k++) {
+                for (int j = 0; j < n; j++) q_prev[j] = path.joint(j)->q;
+                path.calcInverseKinematics2Loop(end_p, end_R, 1.0);
+                total_cycles++;
+                for (int j = 0; j < n; j++) {
+                    hrp::Link* l = path.joint(j);
+                    double dq = l->q - q_prev[j];
+                    double ratio = dq > 0 ? dq / (l->uvlimit * dt) : dq / (l->lvlimit * dt);
+                    max_speed_ratio = std::max(max_speed_ratio, ratio);
+                    if (ratio > 1.0 + 1e-9) speed_over++;
+                }
+                if ((path.endLink()->p - end_p).norm() < 1e-6 && (path.endLink()->R - end_R).norm() < 1e-6) {
+                    reached++;
+                    break;
+                }
+            }
+        }
+        std::cerr << "[testAnalyticIKSolver] " << solver_name << ", " << num_samples << " samples in a control loop" << std::endl;
+        std::cerr << "[testAnalyticIKSolver]   reached = " << reached << ", cycles = " << total_cycles / (double)num_samples << ", max |dq|/(vlimit*dt) = " << max_speed_ratio << ", speed limit over = " << speed_over << std::endl;
+        return reached == num_samples && speed_over == 0;
+    };
+public:
+    std::vector<std::string> arg_strs;
+    testAnalyticIKSolver () : solver_name("leg6dof"), num_samples(1000) {};
+    void parse_params ()
+    {
+        for (unsigned int i = 0; i < arg_strs.size(); ++ i) {
+            if ( arg_strs[i]== "--solver" ) {
+                if (++i < arg_strs.size()) solver_name = arg_strs[i];
+            } else if ( arg_strs[i]== "--plugins" ) {
+                if (++i < arg_strs.size()) plugins = arg_strs[i];
+            } else if ( arg_strs[i]== "--samples" ) {
+                if (++i < arg_strs.size()) num_samples = atoi(arg_strs[i].c_str());
+            }
+        }
+    };
+    // hip yaw, roll, pitch without offsets
+    bool test0 ()
+    {
+        std::cerr << "test0 : yaw-roll-pitch hip" << std::endl;
+        parse_params();
+        hrp::Vector3 axes[6] = {hrp::Vector3::UnitZ(), hrp::Vector3::UnitX(), hrp::Vector3::UnitY(),
+                                hrp::Vector3::UnitY(), hrp::Vector3::UnitY(), hrp::Vector3::UnitX()};
+        hrp::Vector3 offsets[7] = {hrp::Vector3(0, -0.09, 0), hrp::Vector3::Zero(), hrp::Vector3::Zero(),
+                                   hrp::Vector3(0, 0, -0.3), hrp::Vector3(0, 0, -0.3), hrp::Vector3::Zero(),
+                                   hrp::Vector3(0, 0, -0.07)};
+        createLeg(axes, offsets);
+        return check();
+    };
+    // hip roll, pitch, yaw with knee and ankle offsets
+    bool test1 ()
+    {
+        std::cerr << "test1 : roll-pitch-yaw hip with offsets" << std::endl;
+        parse_params();
+        hrp::Vector3 axes[6] = {hrp::Vector3::UnitX(), hrp::Vector3::UnitY(), hrp::Vector3::UnitZ(),
+                                hrp::Vector3::UnitY(), hrp::Vector3::UnitY(), hrp::Vector3::UnitX()};
+        hrp::Vector3 offsets[7] = {hrp::Vector3(0, -0.09, -0.05), hrp::Vector3::Zero(), hrp::Vector3::Zero(),
+                                   hrp::Vector3(0.02, -0.01, -0.3), hrp::Vector3(-0.02, 0, -0.3), hrp::Vector3::Zero(),
+                                   hrp::Vector3(0.03, 0, -0.07)};
+        createLeg(axes, offsets);
+        return check();
+    };
+    // joint speed limitation of test0 in calcInverseKinematics2Loop
+    bool test2 ()
+    {
+        std::cerr << "test2 : speed limit of yaw-roll-pitch hip" << std::endl;
+        parse_params();
+        hrp::Vector3 axes[6] = {hrp::Vector3::UnitZ(), hrp::Vector3::UnitX(), hrp::Vector3::UnitY(),
+                                hrp::Vector3::UnitY(), hrp::Vector3::UnitY(), hrp::Vector3::UnitX()};
+        hrp::Vector3 offsets[7] = {hrp::Vector3(0, -0.09, 0), hrp::Vector3::Zero(), hrp::Vector3::Zero(),
+                                   hrp::Vector3(0, 0, -0.3), hrp::Vector3(0, 0, -0.3), hrp::Vector3::Zero(),
+                                   hrp::Vector3(0, 0, -0.07)};
+        createLeg(axes, offsets);
+        return check_speed_limit();
+    };
+    // a limb of a model given by --model, --base and --end
+    bool test_model (int argc, char* argv[])
+    {
+        std::string url;
+        for (unsigned int i = 0; i < arg_strs.size(); ++ i) {
+            if ( arg_strs[i]== "--model" ) {
+                if (++i < arg_strs.size()) url = arg_strs[i];
+            } else if ( arg_strs[i]== "--base" ) {
+                if (++i < arg_strs.size()) base_name = arg_strs[i];
+            } else if ( arg_strs[i]== "--end" ) {
+                if (++i < arg_strs.size()) end_name = arg_strs[i];
+            }
+        }
+        parse_params();
+        robot = hrp::BodyPtr(new hrp::Body());
+        if (!loadBodyFromModelLoader(robot, url.c_str(), argc, argv)) {
+            std::cerr << "failed to load model[" << url << "]" << std::endl;
+            return false;
+        }
+        if (!robot->link(base_name) || !robot->link(end_name)) {
+            std::cerr << "no such link " << base_name << " or " << end_name << std::endl;
+            return false;
+        }
+        return check();
+    };
+};
+
+void print_usage ()
+{
+    std::cerr << "Usage : testAnalyticIKSolver [option]" << std::endl;
+    std::cerr << " [option] should be:" << std::endl;
+    std::cerr << "  --test0 : yaw-roll-pitch hip" << std::endl;
+    std::cerr << "  --test1 : roll-pitch-yaw hip with offsets" << std::endl;
+    std::cerr << "  --test2 : speed limit of yaw-roll-pitch hip" << std::endl;
+    std::cerr << "  --model url --base link --end link : limb of a model" << std::endl;
+    std::cerr << " and options for all tests:" << std::endl;
+    std::cerr << "  --solver name : name of the analytic solver (leg6dof by default)" << std::endl;
+    std::cerr << "  --plugins paths : comma-separated paths of plugins" << std::endl;
+    std::cerr << "  --samples n : number of target poses" << std::endl;
+};
+
+int main(int argc, char* argv[])
+{
+    int ret = 0;
+    if (argc >= 2) {
+        testAnalyticIKSolver taik;
+        for (int i = 1; i < argc; ++ i) {
+            taik.arg_strs.push_back(std::string(argv[i]));
+        }
+        if (std::string(argv[1]) == "--test0") {
+            ret = taik.test0() ? 0 : 1;
+        } else if (std::string(argv[1]) == "--test1") {
+            ret = taik.test1() ? 0 : 1;
+        } else if (std::string(argv[1]) == "--test2") {
+            ret = taik.test2() ? 0 : 1;
+        } else if (std::string(argv[1]) == "--model") {
+            ret = taik.test_model(argc, argv) ? 0 : 1;
+        } else {
+            print_usage();
+            ret = 1;
+        }
+    } else {
+        print_usage();
+        ret = 1;
+    }
+    return ret;
+}
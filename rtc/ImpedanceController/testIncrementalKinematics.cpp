@@ -0,0 +1,218 @@
+/* -*- coding:utf-8-unix; mode:c++; -*- */
+
+#include "IncrementalKinematics.h"
+#include "JointPathEx.h"
+#include <hrpUtil/Eigen3d.h>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include <time.h>
+
+// compare IncrementalKinematics with forward kinematics of hrp::Body
+class testIncrementalKinematics
+{
+protected:
+    hrp::BodyPtr robot;
+    std::vector<hrp::Link*> limb_ends;
+    int num_samples, num_changed_joints;
+    bool move_root, use_ik;
+    double now ()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec + ts.tv_nsec * 1e-9;
+    };
+    double random (double min, double max)
+    {
+        return min + (max - min) * rand() / (double)RAND_MAX;
+    };
+    hrp::Vector3 randomVector3 (double max)
+    {
+        return hrp::Vector3(random(-max, max), random(-max, max), random(-max, max));
+    };
+    // humanoid like body, 6 dof legs, 7 dof arms, 2 dof chest and head, 40 joints
+    void createHumanoid ()
+    {
+        robot = hrp::BodyPtr(new hrp::Body());
+        hrp::Link* root = new hrp::Link();
+        root->name = "WAIST";
+        root->jointType = hrp::Link::FREE_JOINT;
+        root->jointId = -1;
+        root->m = 10.0;
+        root->c = randomVector3(0.05);
+        robot->setRootLink(root);
+        const char* limb_names[] = {"RLEG", "LLEG", "CHEST", "RARM", "LARM", "HEAD", "RHAND", "LHAND"};
+        int limb_dofs[] = {6, 6, 2, 7, 7, 2, 5, 5};
+        int limb_parents[] = {-1, -1, -1, 2, 2, 2, 3, 4}; // index of limb, -1 for the root
+        std::vector<hrp::Link*> ends;
+        int joint_id = 0;
+        for (int i = 0; i < 8; i++) {
+            hrp::Link* parent = limb_parents[i] < 0 ? root : ends[limb_parents[i]];
+            for (int j = 0; j < limb_dofs[i]; j++) {
+                hrp::Link* l = new hrp::Link();
+                char name[32];
+                sprintf(name, "%s_JOINT%d", limb_names[i], j);
+                l->name = name;
+                l->jointType = hrp::Link::ROTATIONAL_JOINT;
+                l->jointId = joint_id++;
+                l->a = hrp::Vector3::Unit(j % 3);
+                l->b = randomVector3(0.15);
+                l->m = random(0.5, 3.0);
+                l->c = randomVector3(0.05);
+                l->Rs = hrp::Matrix33::Identity();
+                l->llimit = -10 * M_PI;
+                l->ulimit = 10 * M_PI;
+                l->lvlimit = -100.0;
+                l->uvlimit = 100.0;
+                parent->addChild(l);
+                parent = l;
+            }
+            ends.push_back(parent);
+        }
+        limb_ends.push_back(ends[0]);
+        limb_ends.push_back(ends[1]);
+        robot->updateLinkTree();
+        robot->rootLink()->p = hrp::Vector3(0, 0, 1.0);
+        robot->rootLink()->R = hrp::Matrix33::Identity();
+        robot->calcForwardKinematics();
+    };
+    bool check ()
+    {
+        hrp::IncrementalKinematics kinematics;
+        kinematics.setBody(robot.get());
+        // reference body, poses of robot are written only by kinematics and inverse kinematics
+        hrp::BodyPtr ref_robot(new hrp::Body(*robot));
+        std::vector<hrp::JointPathEx*> paths;
+        for (size_t i = 0; i < limb_ends.size(); i++) {
+            paths.push_back(new hrp::JointPathEx(robot, robot->rootLink(), limb_ends[i], 0.002));
+        }
+        double max_pose_error = 0, max_cm_error = 0, max_jacobian_error = 0;
+        double body_time = 0, incremental_time = 0;
+        hrp::dmatrix J0, J1;
+        std::vector<double> q(robot->numJoints());
+        srand(0);
+        for (int i = 0; i < num_samples; i++) {
+            for (int j = 0; j < num_changed_joints; j++) {
+                robot->joint(rand() % robot->numJoints())->q += random(-0.1, 0.1);
+            }
+            if (move_root) {
+                robot->rootLink()->p += randomVector3(0.01);
+                robot->rootLink()->R = robot->rootLink()->R * hrp::rotFromRpy(randomVector3(0.01));
+            }
+            double t0 = now();
+            kinematics.calcForwardKinematics();
+            hrp::Vector3 cm1(kinematics.calcCM());
+            incremental_time += now() - t0;
+            for (int j = 0; j < robot->numJoints(); j++) {
+                ref_robot->joint(j)->q = robot->joint(j)->q;
+            }
+            ref_robot->rootLink()->p = robot->rootLink()->p;
+            ref_robot->rootLink()->R = robot->rootLink()->R;
+            t0 = now();
+            ref_robot->calcForwardKinematics();
+            hrp::Vector3 cm0(ref_robot->calcCM());
+            body_time += now() - t0;
+            for (int j = 0; j < robot->numLinks(); j++) {
+                max_pose_error = std::max(max_pose_error, (ref_robot->link(j)->p - robot->link(j)->p).norm() + (ref_robot->link(j)->R - robot->link(j)->R).norm());
+            }
+            max_cm_error = std::max(max_cm_error, (cm0 - cm1).norm());
+            // jacobians with the root link and a foot as the base link
+            int limb = rand() % limb_ends.size();
+            hrp::Link* base = i % 2 ? limb_ends[limb] : NULL;
+            ref_robot->calcCMJacobian(base ? ref_robot->link(base->name) : NULL, J0);
+            kinematics.calcCMJacobian(base, J1);
+            max_jacobian_error = std::max(max_jacobian_error, (J0 - J1).norm());
+            if (use_ik) {
+                // inverse kinematics writes poses of a limb, and joint angles are restored as done by controllers
+                for (int j = 0; j < robot->numJoints(); j++) q[j] = robot->joint(j)->q;
+                hrp::Vector3 target_p(limb_ends[limb]->p + randomVector3(0.01));
+                hrp::Matrix33 target_R(limb_ends[limb]->R * hrp::rotFromRpy(randomVector3(0.05)));
+                for (int j = 0; j < 3; j++) paths[limb]->calcInverseKinematics2Loop(target_p, target_R, 1.0);
+                for (int j = 0; j < robot->numJoints(); j++) robot->joint(j)->q = q[j];
+            }
+        }
+        for (size_t i = 0; i < paths.size(); i++) delete paths[i];
+        std::cerr << "[testIncrementalKinematics] " << num_samples << " samples, " << num_changed_joints << " changed joints, " << (move_root ? "moving root" : "fixed root") << (use_ik ? ", inverse kinematics" : "") << std::endl;
+        std::cerr << "[testIncrementalKinematics]   Body        : time = " << body_time / num_samples * 1e6 << "[us]" << std::endl;
+        std::cerr << "[testIncrementalKinematics]   incremental : time = " << incremental_time / num_samples * 1e6 << "[us]" << std::endl;
+        std::cerr << "[testIncrementalKinematics]   max errors : pose = " << max_pose_error << ", cm = " << max_cm_error << "[m], jacobian = " << max_jacobian_error << std::endl;
+        return max_pose_error < 1e-10 && max_cm_error < 1e-10 && max_jacobian_error < 1e-10;
+    };
+public:
+    std::vector<std::string> arg_strs;
+    testIncrementalKinematics () : num_samples(10000), num_changed_joints(2), move_root(false), use_ik(false) {};
+    void parse_params ()
+    {
+        for (unsigned int i = 0; i < arg_strs.size(); ++ i) {
+            if ( arg_strs[i]== "--samples" ) {
+                if (++i < arg_strs.size()) num_samples = atoi(arg_strs[i].c_str());
+            } else if ( arg_strs[i]== "--changed-joints" ) {
+                if (++i < arg_strs.size()) num_changed_joints = atoi(arg_strs[i].c_str());
+            }
+        }
+    };
+    // a few joints change, the root link is fixed
+    bool test0 ()
+    {
+        std::cerr << "test0 : changing joints" << std::endl;
+        parse_params();
+        createHumanoid();
+        return check();
+    };
+    // a few joints change, the root link moves
+    bool test1 ()
+    {
+        std::cerr << "test1 : changing joints and moving root" << std::endl;
+        move_root = true;
+        parse_params();
+        createHumanoid();
+        return check();
+    };
+    // a few joints change, limbs are moved by inverse kinematics and restored
+    bool test2 ()
+    {
+        std::cerr << "test2 : changing joints and inverse kinematics" << std::endl;
+        use_ik = true;
+        parse_params();
+        createHumanoid();
+        return check();
+    };
+};
+
+void print_usage ()
+{
+    std::cerr << "Usage : testIncrementalKinematics [option]" << std::endl;
+    std::cerr << " [option] should be:" << std::endl;
+    std::cerr << "  --test0 : changing joints" << std::endl;
+    std::cerr << "  --test1 : changing joints and moving root" << std::endl;
+    std::cerr << "  --test2 : changing joints and inverse kinematics" << std::endl;
+    std::cerr << " and options for all tests:" << std::endl;
+    std::cerr << "  --samples n : number of samples" << std::endl;
+    std::cerr << "  --changed-joints n : number of joints changed in a sample" << std::endl;
+};
+
+int main(int argc, char* argv[])
+{
+    int ret = 0;
+    if (argc >= 2) {
+        testIncrementalKinematics tik;
+        for (int i = 1; i < argc; ++ i) {
+            tik.arg_strs.push_back(std::string(argv[i]));
+        }
+        if (std::string(argv[1]) == "--test0") {
+            ret = tik.test0() ? 0 : 1;
+        } else if (std::string(argv[1]) == "--test1") {
+            ret = tik.test1() ? 0 : 1;
+        } else if (std::string(argv[1]) == "--test2") {
+            ret = tik.test2() ? 0 : 1;
+        } else {
+            print_usage();
+            ret = 1;
+        }
+    } else {
+        print_usage();
+        ret = 1;
+    }
+    return ret;
+}
@@ -17,6 +17,7 @@
 #include <opencv2/imgcodecs/legacy/constants_c.h>
 #endif
 #include "JpegEncoder.h"
+#include "hrpsys/util/ImageUtil.h"
 
 // Module specification
 // <rtc-template block="module_spec">
@@ -128,39 +129,33 @@ RTC::ReturnCode_t JpegEncoder::onExecute(RTC::UniqueId ec_id)
       m_decodedIn.read();
 
       Img::ImageData& idat = m_decoded.data.image;
-      std::vector<uchar>buf;
-      std::vector<int> param = std::vector<int>(2);
-      param[0] = CV_IMWRITE_JPEG_QUALITY;
-      param[1] = m_quality;
+      m_param.resize(2);
+      m_param[0] = CV_IMWRITE_JPEG_QUALITY;
+      m_param[1] = m_quality;
 
+      // m_buf keeps its capacity between frames
+      m_buf.clear();
       switch(idat.format){
       case Img::CF_RGB:
 	{
-	  // RGB -> BGR
-	  uchar r,g,b, *raw=idat.raw_data.get_buffer();
-	  for (unsigned int i=0; i<idat.raw_data.length(); i+=3, raw+=3){
-	    r = raw[0]; g = raw[1]; b = raw[2];
-	    raw[0] = b; raw[1] = g; raw[2] = r;
-	  }
-	  
-	  cv::Mat src(idat.height, idat.width, CV_8UC3, 
-		      idat.raw_data.get_buffer());
-      cv::imencode(".jpg", src, buf, param);
+	  // RGB -> BGR, the received image is left untouched
+	  m_bgr.create(idat.height, idat.width, CV_8UC3);
+	  swapRedBlue(idat.raw_data.get_buffer(), m_bgr.data,
+		      idat.width, idat.height);
+      cv::imencode(".jpg", m_bgr, m_buf, m_param);
 	  m_encoded.data.image.format = Img::CF_RGB_JPEG;
 	}
 	break;
       case Img::CF_GRAY:
 	{
-	  cv::Mat src(idat.height, idat.width, CV_8U, 
-		      idat.raw_data.get_buffer());
-      cv::imencode(".jpg", src, buf, param);
+      cv::imencode(".jpg", wrapImage(idat), m_buf, m_param);
 	  m_encoded.data.image.format = Img::CF_GRAY_JPEG;
 	}
 	break;
       }
-      m_encoded.data.image.raw_data.length(buf.size());
+      m_encoded.data.image.raw_data.length(m_buf.size());
       unsigned char *dst = m_encoded.data.image.raw_data.get_buffer();
-      memcpy(dst, &buf[0], buf.size());
+      if (!m_buf.empty()) memcpy(dst, &m_buf[0], m_buf.size());
 
 #if 0
       std::cout << "JpegEncoder:" << idat.raw_data.length() << "->"
@@ -10,6 +10,8 @@
 #ifndef JPEG_ENCODER_H
 #define JPEG_ENCODER_H
 
+#include <vector>
+#include <opencv2/core/core.hpp>
 #include <rtm/idl/BasicDataType.hh>
 #include "hrpsys/idl/Img.hh"
 #include <rtm/Manager.h>
@@ -136,6 +138,9 @@ class JpegEncoder
 
  private:
   int m_quality;
+  cv::Mat m_bgr;
+  std::vector<uchar> m_buf;
+  std::vector<int> m_param;
   int dummy;
 };
 
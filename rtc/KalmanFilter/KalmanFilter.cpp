@@ -11,6 +11,7 @@
 #include "hrpsys/util/VectorConvert.h"
 #include <rtm/CorbaNaming.h>
 #include <hrpModel/ModelLoaderUtil.h>
+#include "hrpsys/util/ModelCache.h"
 #include <math.h>
 #include <hrpModel/Link.h>
 #include <hrpModel/Sensor.h>
@@ -114,9 +115,9 @@ RTC::ReturnCode_t KalmanFilter::onInitialize()
   }
   nameServer = nameServer.substr(0, comPos);
   RTC::CorbaNaming naming(rtcManager.getORB(), nameServer.c_str());
-  if (!loadBodyFromModelLoader(m_robot, prop["model"].c_str(), 
-                               CosNaming::NamingContext::_duplicate(naming.getRootContext())
-                               )){
+  if (!loadBodyFromModelCache(m_robot, prop["model"].c_str(), 
+                              CosNaming::NamingContext::_duplicate(naming.getRootContext())
+                              )){
     std::cerr << "[" << m_profile.instance_name << "]failed to load model[" << prop["model"] << "]" << std::endl;
   }
 
@@ -127,6 +128,7 @@ RTC::ReturnCode_t KalmanFilter::onInitialize()
   if (m_robot->numSensors(hrp::Sensor::ACCELERATION) > 0) {
     hrp::Sensor* sensor = m_robot->sensor(hrp::Sensor::ACCELERATION, 0);
     m_sensorR = sensor->link->R * sensor->localR;
+    m_accFK.addTarget(sensor->link);
   } else {
     m_sensorR = hrp::Matrix33::Identity();
   }
@@ -221,7 +223,7 @@ RTC::ReturnCode_t KalmanFilter::onExecute(RTC::UniqueId ec_id)
     } else if (kf_algorithm == OpenHRP::KalmanFilterService::RPYKalmanFilter) {
         double sl_y;
         hrp::Matrix33 BtoS;
-        m_robot->calcForwardKinematics();
+        m_accFK.calcForwardKinematics();
         if (m_robot->numSensors(hrp::Sensor::ACCELERATION) > 0) {
             hrp::Sensor* sensor = m_robot->sensor(hrp::Sensor::ACCELERATION, 0);
             sl_y = hrp::rpyFromRot(sensor->link->R)[2];
@@ -23,6 +23,7 @@
 
 #include "RPYKalmanFilter.h"
 #include "EKFilter.h"
+#include "../ImpedanceController/PartialForwardKinematics.h"
 
 // Service implementation headers
 // <rtc-template block="service_impl_h">
@@ -161,6 +162,8 @@ private:
   RPYKalmanFilter rpy_kf;
   EKFilter ekf_filter;
   hrp::BodyPtr m_robot;
+  // links between the root link and the acceleration sensor
+  hrp::PartialForwardKinematics m_accFK;
   hrp::Matrix33 m_sensorR, sensorR_offset;
   hrp::Vector3 acc_offset;
   unsigned int m_debugLevel;
@@ -8,6 +8,7 @@
  */
 
 #include "ModifiedServo.h"
+#include "hrpsys/util/ModelCache.h"
 
 // Module specification
 // <rtc-template block="module_spec">
@@ -106,8 +107,8 @@ RTC::ReturnCode_t ModifiedServo::onInitialize()
 
   RTC::CorbaNaming naming(rtcManager.getORB(), nameServer.c_str());
 
-  if (!loadBodyFromModelLoader(m_robot, prop["model"].c_str(),
-                               CosNaming::NamingContext::_duplicate(naming.getRootContext())))
+  if (!loadBodyFromModelCache(m_robot, prop["model"].c_str(),
+                              CosNaming::NamingContext::_duplicate(naming.getRootContext())))
       std::cerr << "[" << m_profile.instance_name << "] failed to load model "
       << "[" << prop["model"] << "]" << std::endl;
   
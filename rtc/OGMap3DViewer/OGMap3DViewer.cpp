@@ -182,6 +182,45 @@ private:
     OpenHRP::OGMap3D* m_map;
 };
 
+// applies updated blocks to the map. The map is reallocated if the grid
+// is changed
+static void applyUpdate(const OpenHRP::OGMap3DUpdate& i_update,
+                        OpenHRP::OGMap3D *&io_map)
+{
+    if (!io_map || io_map->resolution != i_update.resolution
+        || io_map->pos.x != i_update.pos.x || io_map->pos.y != i_update.pos.y
+        || io_map->pos.z != i_update.pos.z || io_map->nx != i_update.nx
+        || io_map->ny != i_update.ny || io_map->nz != i_update.nz){
+        delete io_map;
+        io_map = new OpenHRP::OGMap3D;
+        io_map->resolution = i_update.resolution;
+        io_map->pos = i_update.pos;
+        io_map->nx = i_update.nx;
+        io_map->ny = i_update.ny;
+        io_map->nz = i_update.nz;
+        io_map->cells.length(io_map->nx*io_map->ny*io_map->nz);
+        memset(io_map->cells.get_buffer(), OpenHRP::gridUnknown,
+               io_map->cells.length());
+    }
+    for (unsigned int b=0; b<i_update.blocks.length(); b++){
+        const OpenHRP::OGMap3DBlock& block = i_update.blocks[b];
+        int i=0, j=0, k=0;
+        for (unsigned int r=0; r+1<block.runs.length() && i<block.nx; r+=2){
+            for (int c=0; c<block.runs[r] && i<block.nx; c++){
+                io_map->cells[((block.x+i)*io_map->ny + block.y+j)*io_map->nz
+                              + block.z+k] = block.runs[r+1];
+                if (++k == block.nz){
+                    k = 0;
+                    if (++j == block.ny){
+                        j = 0;
+                        i++;
+                    }
+                }
+            }
+        }
+    }
+}
+
 // Module specification
 // <rtc-template block="module_spec">
 static const char* nullcomponent_spec[] =
@@ -224,6 +263,7 @@ OGMap3DViewer::OGMap3DViewer(RTC::Manager* manager)
     m_body(NULL),
     m_imageCount(0),
     m_ogmap(NULL),
+    m_mapVersion(0),
     m_generateMovie(false),
     m_isGeneratingMovie(false)
 {
@@ -380,16 +420,27 @@ RTC::ReturnCode_t OGMap3DViewer::onExecute(RTC::UniqueId ec_id)
     region.size.w = m_ySize;
     region.size.h = m_zSize;
 
-    if (m_ogmap){
-        delete m_ogmap;
-        m_ogmap = NULL;
+    double r[] = {m_xOrigin, m_yOrigin, m_zOrigin, m_xSize, m_ySize, m_zSize};
+    for (int i=0; i<6; i++){
+        if (r[i] != m_mapRegion[i]) m_mapVersion = 0;
+        m_mapRegion[i] = r[i];
     }
     if (!CORBA::is_nil(m_OGMap3DService.getObject())){
         try{
-            m_ogmap = m_OGMap3DService->getOGMap3D(region);
+            OpenHRP::OGMap3DUpdate_var update
+                = m_OGMap3DService->getOGMap3DUpdate(region, m_mapVersion);
+            applyUpdate(update.in(), m_ogmap);
+            m_mapVersion = update->version;
         }catch(CORBA::SystemException& ex){
             // provider is not activated
+            delete m_ogmap;
+            m_ogmap = NULL;
+            m_mapVersion = 0;
         }
+    }else if (m_ogmap){
+        delete m_ogmap;
+        m_ogmap = NULL;
+        m_mapVersion = 0;
     }
     m_mapNode->setMap(m_ogmap);
     
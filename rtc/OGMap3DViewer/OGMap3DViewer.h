@@ -157,6 +157,9 @@ class OGMap3DViewer
   bool m_generateMovie, m_isGeneratingMovie;
   CMapSceneNode *m_mapNode;
   OpenHRP::OGMap3D *m_ogmap;
+  // m_ogmap is updated incrementally while the region is not changed
+  CORBA::ULong m_mapVersion;
+  double m_mapRegion[6];
   CvVideoWriter *m_videoWriter;
   IplImage *m_cvImage;
 };
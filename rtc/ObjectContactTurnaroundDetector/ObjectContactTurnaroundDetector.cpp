@@ -11,6 +11,7 @@
 #include <hrpModel/Link.h>
 #include <hrpModel/Sensor.h>
 #include <hrpModel/ModelLoaderUtil.h>
+#include "hrpsys/util/ModelCache.h"
 #include "ObjectContactTurnaroundDetector.h"
 #include "../ImpedanceController/RatsMatrix.h"
 #include "hrpsys/util/Hrpsys.h"
@@ -101,9 +102,9 @@ RTC::ReturnCode_t ObjectContactTurnaroundDetector::onInitialize()
     }
     nameServer = nameServer.substr(0, comPos);
     RTC::CorbaNaming naming(rtcManager.getORB(), nameServer.c_str());
-    if (!loadBodyFromModelLoader(m_robot, prop["model"].c_str(), 
-                                 CosNaming::NamingContext::_duplicate(naming.getRootContext())
-                                 )){
+    if (!loadBodyFromModelCache(m_robot, prop["model"].c_str(), 
+                                CosNaming::NamingContext::_duplicate(naming.getRootContext())
+                                )){
       std::cerr << "[" << m_profile.instance_name << "] failed to load model[" << prop["model"] << "]" << std::endl;
       return RTC::RTC_ERROR;
     }
@@ -17,6 +17,11 @@ OpenHRP::OGMap3D* OGMap3DService_impl::getOGMap3D(const OpenHRP::AABB& region)
     return m_comp->getOGMap3D(region);
 }
 
+OpenHRP::OGMap3DUpdate* OGMap3DService_impl::getOGMap3DUpdate(const OpenHRP::AABB& region, CORBA::ULong version)
+{
+    return m_comp->getOGMap3DUpdate(region, version);
+}
+
 void OGMap3DService_impl::save(const char *filename)
 {
     m_comp->save(filename);
@@ -26,3 +31,8 @@ void OGMap3DService_impl::clear()
 {
     m_comp->clear();
 }
+
+CORBA::Boolean OGMap3DService_impl::getIntegrationStatus(OpenHRP::OGMap3DIntegrationStatus& o_status)
+{
+    return m_comp->getIntegrationStatus(o_status);
+}
@@ -22,8 +22,10 @@ public:
   virtual ~OGMap3DService_impl();
 
   OpenHRP::OGMap3D* getOGMap3D(const OpenHRP::AABB& region);
+  OpenHRP::OGMap3DUpdate* getOGMap3DUpdate(const OpenHRP::AABB& region, CORBA::ULong version);
   void save(const char *filename);
   void clear();
+  CORBA::Boolean getIntegrationStatus(OpenHRP::OGMap3DIntegrationStatus& o_status);
 
 private:
   OccupancyGridMap3D *m_comp;
@@ -10,6 +10,8 @@
 #include "OccupancyGridMap3D.h"
 #include "hrpUtil/Eigen3d.h"
 #include <octomap/octomap.h>
+#include <algorithm>
+#include <boost/bind.hpp>
 
 #define KDEBUG 0
 //#define KDEBUG 1 // 121022
@@ -25,6 +27,273 @@ typedef coil::Guard<coil::Mutex> Guard;
 
 using namespace octomap;
 
+// voxels are grouped into blocks of 8x8x8 to record updated parts of the map
+#define BLOCK_SHIFT 3
+
+static unsigned long long blockId(const OcTreeKey& key)
+{
+    return ((unsigned long long)(key[0] >> BLOCK_SHIFT) << 32)
+        | ((unsigned long long)(key[1] >> BLOCK_SHIFT) << 16)
+        | (key[2] >> BLOCK_SHIFT);
+}
+
+static void blockKey(unsigned long long id, OcTreeKey& key)
+{
+    key[0] = ((id >> 32) & 0xffff) << BLOCK_SHIFT;
+    key[1] = ((id >> 16) & 0xffff) << BLOCK_SHIFT;
+    key[2] = (id & 0xffff) << BLOCK_SHIFT;
+}
+
+typedef boost::unordered_map<unsigned long long, unsigned long> BlockVersions;
+
+static void stampBlocks(BlockVersions& versions, const KeySet& keys,
+                        unsigned long version)
+{
+    unsigned long long last = ~0ULL;
+    for (KeySet::const_iterator it=keys.begin(); it!=keys.end(); ++it){
+        unsigned long long id = blockId(*it);
+        if (id != last) versions[id] = version;
+        last = id;
+    }
+}
+
+// a scan which is waiting for integration
+struct OGMapScan
+{
+    Pointcloud cloud; // in the sensor frame
+    point3d sensor;
+    pose6d frame;
+    coil::TimeValue tm; // time when the scan is queued
+};
+
+static void castRays(const OcTree *tree, const Pointcloud *cloud,
+                     size_t begin, size_t end, const point3d *origin,
+                     KeySet *freeCells, KeySet *occupiedCells)
+{
+    KeyRay ray;
+    OcTreeKey key;
+    for (size_t i=begin; i<end; i++){
+        const point3d& p = (*cloud)[i];
+        if (tree->computeRayKeys(*origin, p, ray)){
+            freeCells->insert(ray.begin(), ray.end());
+        }
+        if (tree->coordToKeyChecked(p, key)) occupiedCells->insert(key);
+    }
+}
+
+// same as OccupancyOcTreeBase::computeUpdate() except that the scan is
+// transformed into the world frame here and rays are cast by nthreads
+// threads. If discretize is true, end points in the same voxel are merged
+// into one like computeDiscreteUpdate(). This function doesn't modify tree
+static void computeUpdate(const OcTree *tree, OGMapScan& scan,
+                          int nthreads, bool discretize,
+                          KeySet& freeCells, KeySet& occupiedCells)
+{
+    scan.cloud.transform(scan.frame);
+    point3d origin = scan.frame.transform(scan.sensor);
+
+    const Pointcloud *cloud = &scan.cloud;
+    Pointcloud discrete;
+    if (discretize){
+        KeySet endpoints;
+        OcTreeKey key;
+        for (size_t i=0; i<scan.cloud.size(); i++){
+            if (tree->coordToKeyChecked(scan.cloud[i], key)
+                && endpoints.insert(key).second){
+                discrete.push_back(tree->keyToCoord(key));
+            }
+        }
+        cloud = &discrete;
+    }
+
+    size_t n = cloud->size();
+    if (nthreads > (int)(n/1000)) nthreads = n/1000;
+    if (nthreads <= 1){
+        castRays(tree, cloud, 0, n, &origin, &freeCells, &occupiedCells);
+    }else{
+        std::vector<KeySet> frees(nthreads-1), occupieds(nthreads-1);
+        boost::thread_group threads;
+        for (int i=1; i<nthreads; i++){
+            threads.create_thread(boost::bind(castRays, tree, cloud,
+                                              n*i/nthreads, n*(i+1)/nthreads,
+                                              &origin, &frees[i-1],
+                                              &occupieds[i-1]));
+        }
+        castRays(tree, cloud, 0, n/nthreads, &origin, &freeCells, &occupiedCells);
+        threads.join_all();
+        for (int i=0; i<nthreads-1; i++){
+            freeCells.insert(frees[i].begin(), frees[i].end());
+            occupiedCells.insert(occupieds[i].begin(), occupieds[i].end());
+        }
+    }
+
+    // prefer occupied cells over free ones
+    for (KeySet::iterator it=freeCells.begin(); it!=freeCells.end(); ){
+        if (occupiedCells.find(*it) != occupiedCells.end()){
+            it = freeCells.erase(it);
+        }else{
+            ++it;
+        }
+    }
+}
+
+// updates voxels and stamps updated blocks with version
+static void applyUpdate(OcTree *tree, const KeySet& freeCells,
+                        const KeySet& occupiedCells,
+                        BlockVersions& versions, unsigned long version)
+{
+    for (KeySet::const_iterator it=freeCells.begin(); it!=freeCells.end(); ++it){
+        tree->updateNode(*it, false);
+    }
+    for (KeySet::const_iterator it=occupiedCells.begin(); it!=occupiedCells.end(); ++it){
+        tree->updateNode(*it, true);
+    }
+    stampBlocks(versions, freeCells, version);
+    stampBlocks(versions, occupiedCells, version);
+}
+
+// a leaf of octree copied to rasterize it without locking the map
+struct OGMapLeaf
+{
+    float x, y, z, half;
+    unsigned char value;
+};
+
+// a part of OGMap3D given by ranges of indices [lo, hi). Leaves of the map
+// and the known map are leaves[leafBegin, leafEnd) and
+// leaves[leafEnd, knownEnd) respectively
+struct OGMapBox
+{
+    int lo[3], hi[3];
+    size_t leafBegin, leafEnd, knownEnd;
+};
+
+static void copyLeaves(OcTree *tree, const point3d& min, const point3d& max,
+                       double occupiedThd, bool occupiedOnly,
+                       std::vector<OGMapLeaf>& leaves)
+{
+    for (OcTree::leaf_bbx_iterator it = tree->begin_leafs_bbx(min, max),
+             end = tree->end_leafs_bbx(); it != end; ++it){
+        double prob = it->getOccupancy();
+        OGMapLeaf leaf;
+        if (prob >= occupiedThd){
+            leaf.value = prob*0xfe;
+        }else if (occupiedOnly){
+            continue;
+        }else{
+            leaf.value = OpenHRP::gridEmpty;
+        }
+        point3d c = it.getCoordinate();
+        leaf.x = c.x();
+        leaf.y = c.y();
+        leaf.z = c.z();
+        leaf.half = it.getSize()/2;
+        leaves.push_back(leaf);
+    }
+}
+
+// writes values of leaves[begin, end) to cells in the box whose centers
+// are inside of the leaves
+static void rasterize(const std::vector<OGMapLeaf>& leaves,
+                      size_t begin, size_t end, const OGMapBox& box,
+                      const double *pos, const int *n, double size,
+                      unsigned char *cells)
+{
+    for (size_t l=begin; l<end; l++){
+        const OGMapLeaf& leaf = leaves[l];
+        double c[] = {leaf.x, leaf.y, leaf.z};
+        int s[3], e[3];
+        for (int i=0; i<3; i++){
+            s[i] = std::max(box.lo[i], (int)ceil((c[i] - leaf.half - pos[i])/size));
+            e[i] = std::min(box.hi[i], (int)ceil((c[i] + leaf.half - pos[i])/size));
+        }
+        for (int i=s[0]; i<e[0]; i++){
+            for (int j=s[1]; j<e[1]; j++){
+                unsigned char *cell = cells + (i*n[1] + j)*n[2];
+                for (int k=s[2]; k<e[2]; k++) cell[k] = leaf.value;
+            }
+        }
+    }
+}
+
+// a box which covers whole of the grid
+static void wholeBox(const int *n, std::vector<OGMapBox>& boxes)
+{
+    if (n[0] <= 0 || n[1] <= 0 || n[2] <= 0) return;
+    OGMapBox box;
+    for (int i=0; i<3; i++){
+        box.lo[i] = 0;
+        box.hi[i] = n[i];
+    }
+    boxes.push_back(box);
+}
+
+// boxes of blocks in the grid which are updated after version
+static void updatedBoxes(const OcTree *tree, const BlockVersions& versions,
+                         unsigned long version, const double *pos,
+                         const int *n, std::vector<OGMapBox>& boxes)
+{
+    // cell (i,j,k) corresponds to key k0 + (i,j,k)
+    OcTreeKey k0 = tree->coordToKey(point3d(pos[0], pos[1], pos[2]));
+    OcTreeKey key;
+    OGMapBox box;
+    for (BlockVersions::const_iterator it=versions.begin();
+         it!=versions.end(); ++it){
+        if (it->second <= version) continue;
+        blockKey(it->first, key);
+        bool empty = false;
+        for (int i=0; i<3; i++){
+            box.lo[i] = std::max(0, (int)key[i] - (int)k0[i]);
+            box.hi[i] = std::min(n[i], (int)key[i] + (1<<BLOCK_SHIFT) - (int)k0[i]);
+            if (box.lo[i] >= box.hi[i]) empty = true;
+        }
+        if (!empty) boxes.push_back(box);
+    }
+}
+
+static void copyBoxLeaves(OcTree *map, OcTree *knownMap, double occupiedThd,
+                          const double *pos, double size,
+                          std::vector<OGMapBox>& boxes,
+                          std::vector<OGMapLeaf>& leaves)
+{
+    for (size_t b=0; b<boxes.size(); b++){
+        OGMapBox& box = boxes[b];
+        point3d min(pos[0] + box.lo[0]*size, pos[1] + box.lo[1]*size,
+                    pos[2] + box.lo[2]*size);
+        point3d max(pos[0] + (box.hi[0]-1)*size, pos[1] + (box.hi[1]-1)*size,
+                    pos[2] + (box.hi[2]-1)*size);
+        box.leafBegin = leaves.size();
+        copyLeaves(map, min, max, occupiedThd, false, leaves);
+        box.leafEnd = leaves.size();
+        if (knownMap){
+            copyLeaves(knownMap, min, max, occupiedThd, true, leaves);
+        }
+        box.knownEnd = leaves.size();
+    }
+}
+
+// run-length encoding. A run is a pair of its length(1-255) and the state
+// of voxels in it
+static void encodeRuns(const std::vector<unsigned char>& cells,
+                       RTC::OGMapCells& o_runs)
+{
+    size_t nruns = 0;
+    for (size_t i=0; i<cells.size(); nruns++){
+        size_t j = i+1;
+        while (j < cells.size() && j-i < 255 && cells[j] == cells[i]) j++;
+        i = j;
+    }
+    o_runs.length(nruns*2);
+    unsigned char *run = o_runs.get_buffer();
+    for (size_t i=0; i<cells.size(); run+=2){
+        size_t j = i+1;
+        while (j < cells.size() && j-i < 255 && cells[j] == cells[i]) j++;
+        run[0] = j-i;
+        run[1] = cells[i];
+        i = j;
+    }
+}
+
 // Module specification
 // <rtc-template block="module_spec">
 static const char* occupancygridmap3d_spec[] =
@@ -45,6 +314,10 @@ static const char* occupancygridmap3d_spec[] =
     "conf.default.initialMap", "",
     "conf.default.knownMap", "",
     "conf.default.debugLevel", "0",
+    "conf.default.asyncIntegration", "0",
+    "conf.default.queueLength", "4",
+    "conf.default.integrationThreads", "1",
+    "conf.default.discretize", "0",
     ""
   };
 // </rtc-template>
@@ -63,6 +336,10 @@ OccupancyGridMap3D::OccupancyGridMap3D(RTC::Manager* manager)
     m_service0(this),
     m_map(NULL),
     m_knownMap(NULL),
+    m_cacheValid(false),
+    m_version(0),
+    m_clearVersion(0),
+    m_integrationThread(NULL),
     dummy(0)
 {
 }
@@ -83,6 +360,10 @@ RTC::ReturnCode_t OccupancyGridMap3D::onInitialize()
   bindParameter("initialMap", m_initialMap, "");
   bindParameter("knownMap", m_knownMapPath, "");
   bindParameter("debugLevel", m_debugLevel, "0");
+  bindParameter("asyncIntegration", m_asyncIntegration, "0");
+  bindParameter("queueLength", m_queueLength, "4");
+  bindParameter("integrationThreads", m_integrationThreads, "1");
+  bindParameter("discretize", m_discretize, "0");
   
   // </rtc-template>
 
@@ -171,8 +452,18 @@ RTC::ReturnCode_t OccupancyGridMap3D::onActivated(RTC::UniqueId ec_id)
   }else{
     m_map = new OcTree(m_resolution);
   }
+  m_cacheValid = false;
+  m_clearVersion = ++m_version;
   m_updateOut.write();
 
+  if (m_asyncIntegration){
+      m_stopIntegration = false;
+      m_maxQueueLength = 0;
+      m_integrated = m_dropped = 0;
+      m_integrationTimeSum = m_latencySum = m_maxLatency = 0;
+      m_integrationThread = new boost::thread(boost::bind(&OccupancyGridMap3D::integrationLoop, this));
+  }
+
   if(KDEBUG){
     std::cout << m_profile.instance_name << ": initial tree depth = " << m_map->getTreeDepth() << std::endl;
     std::cout << m_profile.instance_name << ": initial tree size = " << m_map->size() << std::endl;
@@ -198,9 +489,26 @@ RTC::ReturnCode_t OccupancyGridMap3D::onActivated(RTC::UniqueId ec_id)
 RTC::ReturnCode_t OccupancyGridMap3D::onDeactivated(RTC::UniqueId ec_id)
 {
   std::cout << m_profile.instance_name<< ": onDeactivated(" << ec_id << ")" << std::endl;
+  if (m_integrationThread){
+      {
+          boost::mutex::scoped_lock lock(m_queueMutex);
+          m_stopIntegration = true;
+          m_queueCond.notify_all();
+      }
+      m_integrationThread->join();
+      delete m_integrationThread;
+      m_integrationThread = NULL;
+      while (!m_queue.empty()){
+          delete m_queue.front();
+          m_queue.pop_front();
+      }
+  }
   Guard guard(m_mutex);
   delete m_map;
   if (m_knownMap) delete m_knownMap;
+  m_map = m_knownMap = NULL;
+  m_cacheValid = false;
+  m_blockVersions.clear();
   return RTC::RTC_OK;
 }
 
@@ -220,49 +528,51 @@ RTC::ReturnCode_t OccupancyGridMap3D::onExecute(RTC::UniqueId ec_id)
 
     while (m_rangeIn.isNew()){
         m_rangeIn.read();
-        Guard guard(m_mutex);
-        Pointcloud cloud;
+        OGMapScan *scan = new OGMapScan;
+        scan->cloud.reserve(m_range.ranges.length());
         for (unsigned int i=0; i<m_range.ranges.length(); i++){
             double th = m_range.config.minAngle + i*m_range.config.angularRes;
             double d = m_range.ranges[i];
             if (d==0) continue;
-            cloud.push_back(point3d(-d*sin(th), 0, -d*cos(th)));
+            scan->cloud.push_back(point3d(-d*sin(th), 0, -d*cos(th)));
         }
-        point3d sensor(0,0,0);
+        scan->sensor = point3d(0,0,0);
         Pose3D &pose = m_range.geometry.geometry.pose;
-        pose6d frame(pose.position.x,
-                     pose.position.y,
-                     pose.position.z, 
-                     pose.orientation.r,
-                     pose.orientation.p,
-                     pose.orientation.y);
-        m_map->insertPointCloud(cloud, sensor, frame);
+        scan->frame = pose6d(pose.position.x,
+                             pose.position.y,
+                             pose.position.z, 
+                             pose.orientation.r,
+                             pose.orientation.p,
+                             pose.orientation.y);
+        integrate(scan);
     }
 
     if (m_cloudIn.isNew()){
         while (m_cloudIn.isNew()) m_cloudIn.read();
         while (m_poseIn.isNew())  m_poseIn.read();
         while (m_sensorPosIn.isNew())  m_sensorPosIn.read();
-        Guard guard(m_mutex);
         float *ptr = (float *)m_cloud.data.get_buffer();
         if (strcmp(m_cloud.type, "xyz")==0 
             || strcmp(m_cloud.type, "xyzrgb")==0){
-            Pointcloud cloud;
+            OGMapScan *scan = new OGMapScan;
+            scan->cloud.reserve(m_cloud.data.length()/16);
             for (unsigned int i=0; i<m_cloud.data.length()/16; i++, ptr+=4){
                 if (isnan(ptr[0])) continue;
-                cloud.push_back(point3d(ptr[0],ptr[1],ptr[2]));
+                scan->cloud.push_back(point3d(ptr[0],ptr[1],ptr[2]));
             }
-            point3d sensor(m_sensorPos.data.x,
-                           m_sensorPos.data.y,
-                           m_sensorPos.data.z);
-            pose6d frame(m_pose.data.position.x,
-                         m_pose.data.position.y,
-                         m_pose.data.position.z, 
-                         m_pose.data.orientation.r,
-                         m_pose.data.orientation.p,
-                         m_pose.data.orientation.y);
-            m_map->insertPointCloud(cloud, sensor, frame);
+            scan->sensor = point3d(m_sensorPos.data.x,
+                                   m_sensorPos.data.y,
+                                   m_sensorPos.data.z);
+            scan->frame = pose6d(m_pose.data.position.x,
+                                 m_pose.data.position.y,
+                                 m_pose.data.position.z, 
+                                 m_pose.data.orientation.r,
+                                 m_pose.data.orientation.p,
+                                 m_pose.data.orientation.y);
+            integrate(scan);
         }else if (strcmp(m_cloud.type, "xyzv")==0){
+            Guard guard(m_mutex);
+            m_version++;
             hrp::Matrix33 R;
             hrp::Vector3 p;
             p[0] = m_pose.data.position.x; 
@@ -390,6 +700,10 @@ RTC::ReturnCode_t OccupancyGridMap3D::onExecute(RTC::UniqueId ec_id)
 #endif
 		//                m_map->updateNode(pog, ptr[3]>0.0?true:false, false);
 		OcTreeNode *updated_node = m_map->updateNode(pog, ptr[3]>0.0?true:false, false); // 121023
+                OcTreeKey key;
+                if (m_map->coordToKeyChecked(pog, key)){
+                    m_blockVersions[blockId(key)] = m_version;
+                }
 #if KDEBUG
 #if 0
 		std::cout << m_profile.instance_name << ": tree depth = " << m_map->getTreeDepth() << std::endl;
@@ -434,7 +748,11 @@ RTC::ReturnCode_t OccupancyGridMap3D::onExecute(RTC::UniqueId ec_id)
                       << ") is not supported" << std::endl;
             return RTC::RTC_ERROR;
         }
-        m_updateOut.write();
+        // updateSignal is written by the integration thread for queued scans
+        if (!m_integrationThread || strcmp(m_cloud.type, "xyzv")==0){
+            Guard guard(m_mutex);
+            m_updateOut.write();
+        }
     }
 
     coil::TimeValue t2(coil::gettimeofday());
@@ -484,136 +802,325 @@ RTC::ReturnCode_t OccupancyGridMap3D::onRateChanged(RTC::UniqueId ec_id)
 
 OpenHRP::OGMap3D* OccupancyGridMap3D::getOGMap3D(const OpenHRP::AABB& region)
 {
-    Guard guard(m_mutex);
+    // queries are serialized by m_cacheMutex. m_mutex is locked only while
+    // leaves in the region are copied so that rasterization doesn't block
+    // updates of the map
+    Guard cacheGuard(m_cacheMutex);
     coil::TimeValue t1(coil::gettimeofday());
 
     OpenHRP::OGMap3D *map = new OpenHRP::OGMap3D;
-    double size = m_map->getResolution();
-    map->resolution = size;
-
-    double min[3];
-    m_map->getMetricMin(min[0],min[1],min[2]);
-    double max[3];
-    m_map->getMetricMax(max[0],max[1],max[2]);
-    for (int i=0; i<3; i++){
-        min[i] -= size; 
-        max[i] += size; 
-    }
+    double size, pos[3];
+    int n[3];
+    bool full;
+    std::vector<OGMapLeaf> leaves;
+    std::vector<OGMapBox> boxes;
+    {
+        Guard guard(m_mutex);
+        size = m_map->getResolution();
+        map->resolution = size;
 
-    if (m_knownMap){
-        double kmin[3];
-        m_knownMap->getMetricMin(kmin[0],kmin[1],kmin[2]);
-        double kmax[3];
-        m_knownMap->getMetricMax(kmax[0],kmax[1],kmax[2]);
+        double min[3];
+        m_map->getMetricMin(min[0],min[1],min[2]);
+        double max[3];
+        m_map->getMetricMax(max[0],max[1],max[2]);
         for (int i=0; i<3; i++){
-            kmin[i] -= size; 
-            kmax[i] += size; 
-            if (kmin[i] < min[i]) min[i] = kmin[i]; 
-            if (kmax[i] > max[i]) max[i] = kmax[i]; 
+            min[i] -= size; 
+            max[i] += size; 
         }
+
+        if (m_knownMap){
+            double kmin[3];
+            m_knownMap->getMetricMin(kmin[0],kmin[1],kmin[2]);
+            double kmax[3];
+            m_knownMap->getMetricMax(kmax[0],kmax[1],kmax[2]);
+            for (int i=0; i<3; i++){
+                kmin[i] -= size; 
+                kmax[i] += size; 
+                if (kmin[i] < min[i]) min[i] = kmin[i]; 
+                if (kmax[i] > max[i]) max[i] = kmax[i]; 
+            }
         
-    }
+        }
 
-    double s[3];
-    s[0] = region.pos.x;
-    s[1] = region.pos.y;
-    s[2] = region.pos.z;
-    double e[3];
-    e[0] = region.pos.x + region.size.l;
-    e[1] = region.pos.y + region.size.w;
-    e[2] = region.pos.z + region.size.h;
-    double l[3];
+        double s[3];
+        s[0] = region.pos.x;
+        s[1] = region.pos.y;
+        s[2] = region.pos.z;
+        double e[3];
+        e[0] = region.pos.x + region.size.l;
+        e[1] = region.pos.y + region.size.w;
+        e[2] = region.pos.z + region.size.h;
+        double l[3];
     
-    for (int i=0; i<3; i++){
-        if (e[i] < min[i] || s[i] > max[i]){ // no overlap
-            s[i] = e[i] = 0;
-        }else{
-            if (s[i] < min[i]) s[i] = min[i];
-            if (e[i] > max[i]) e[i] = max[i];
-        } 
-        l[i] = e[i] - s[i];
-    }
+        for (int i=0; i<3; i++){
+            if (e[i] < min[i] || s[i] > max[i]){ // no overlap
+                s[i] = e[i] = 0;
+            }else{
+                if (s[i] < min[i]) s[i] = min[i];
+                if (e[i] > max[i]) e[i] = max[i];
+            } 
+            l[i] = e[i] - s[i];
+        }
 
 #ifdef USE_ONLY_GRIDS
-    map->pos.x = ((int)(s[0]/size))*size;
-    map->pos.y = ((int)(s[1]/size))*size;
-    map->pos.z = ((int)(s[2]/size))*size;
+        map->pos.x = ((int)(s[0]/size))*size;
+        map->pos.y = ((int)(s[1]/size))*size;
+        map->pos.z = ((int)(s[2]/size))*size;
 #else
 #if 0
-    map->pos.x = s[0];
-    map->pos.y = s[1];
-    map->pos.z = s[2];
-    if(KDEBUG){
-      std::cout << m_profile.instance_name << ": pos = " << map->pos.x << " " << map->pos.y << " " << map->pos.z << " " << std::endl;
-      map->pos.x += size/2.0;
-      map->pos.y += size/2.0;
-      map->pos.z += size/2.0;
-    }
+        map->pos.x = s[0];
+        map->pos.y = s[1];
+        map->pos.z = s[2];
+        if(KDEBUG){
+          std::cout << m_profile.instance_name << ": pos = " << map->pos.x << " " << map->pos.y << " " << map->pos.z << " " << std::endl;
+          map->pos.x += size/2.0;
+          map->pos.y += size/2.0;
+          map->pos.z += size/2.0;
+        }
 #endif      
-    map->pos.x = ((int)(s[0]/size)+0.5)*size; // 121024
-    map->pos.y = ((int)(s[1]/size)+0.5)*size; // 121024
-    map->pos.z = ((int)(s[2]/size)+0.5)*size; // 121024
+        map->pos.x = ((int)(s[0]/size)+0.5)*size; // 121024
+        map->pos.y = ((int)(s[1]/size)+0.5)*size; // 121024
+        map->pos.z = ((int)(s[2]/size)+0.5)*size; // 121024
 #endif
-    map->nx = l[0]/size;
-    map->ny = l[1]/size;
-    map->nz = l[2]/size;
-    int rank=0;
-    point3d p;
-    map->cells.length(map->nx*map->ny*map->nz);
-    {
-        int no=0, ne=0, nu=0;
-        //Guard guard(m_mutex);
-        for (int i=0; i<map->nx; i++){
-            p.x() = map->pos.x + i*size;
-            for (int j=0; j<map->ny; j++){
-                p.y() = map->pos.y + j*size;
-                for (int k=0; k<map->nz; k++){
-                    p.z() = map->pos.z + k*size;
-                    OcTreeNode *result = m_map->search(p);
-		    //                    if (result){
-                    if (result && !(result->hasChildren())){ // 121023
-                        double prob = result->getOccupancy();
-                        if (prob >= m_occupiedThd){
-                            map->cells[rank] = prob*0xfe;
-                            no++;
-			    //			    if(KDEBUG) std::cout << m_profile.instance_name << ": output " << p << " " << prob << std::endl;
-                        }else{
-                            map->cells[rank] = OpenHRP::gridEmpty;
-                            ne++;
-                        }
-                        //printf("%6.3f %6.3f %6.3f:%d\n", p.x(), p.y(), p.z(),map->cells[rank-1]);
-                    }else{
-                        map->cells[rank] = OpenHRP::gridUnknown;
-                        nu++;
-                    }
-                    if (m_knownMap){
-                        OcTreeNode *result = m_knownMap->search(p);
-                        if (result){
-                            double prob = result->getOccupancy();
-                            if (prob >= m_occupiedThd){
-                                map->cells[rank] = prob*0xfe;
-                            }
-                        }
+        map->nx = l[0]/size;
+        map->ny = l[1]/size;
+        map->nz = l[2]/size;
+        pos[0] = map->pos.x; pos[1] = map->pos.y; pos[2] = map->pos.z;
+        n[0] = map->nx; n[1] = map->ny; n[2] = map->nz;
+
+        full = !m_cacheValid || size != m_cacheResolution
+            || m_occupiedThd != m_cacheOccupiedThd;
+        for (int i=0; i<3; i++){
+            if (pos[i] != m_cachePos[i] || n[i] != m_cacheSize[i]) full = true;
+        }
+        if (!full){
+            updatedBoxes(m_map, m_blockVersions, m_cacheVersion, pos, n, boxes);
+            size_t ncells = n[0]*n[1]*n[2];
+            if ((boxes.size() << (3*BLOCK_SHIFT)) > ncells/2){
+                full = true;
+                boxes.clear();
+            }
+        }
+        if (full) wholeBox(n, boxes);
+        copyBoxLeaves(m_map, m_knownMap, m_occupiedThd, pos, size, boxes, leaves);
+
+        m_cacheValid = true;
+        m_cacheVersion = m_version;
+        m_cacheResolution = size;
+        m_cacheOccupiedThd = m_occupiedThd;
+        for (int i=0; i<3; i++){
+            m_cachePos[i] = pos[i];
+            m_cacheSize[i] = n[i];
+        }
+    }
+
+    size_t ncells = n[0]*n[1]*n[2];
+    if (full) m_cacheCells.assign(ncells, OpenHRP::gridUnknown);
+    for (size_t b=0; b<boxes.size(); b++){
+        const OGMapBox& box = boxes[b];
+        if (!full){
+            for (int i=box.lo[0]; i<box.hi[0]; i++){
+                for (int j=box.lo[1]; j<box.hi[1]; j++){
+                    unsigned char *cell = &m_cacheCells[(i*n[1] + j)*n[2]];
+                    for (int k=box.lo[2]; k<box.hi[2]; k++){
+                        cell[k] = OpenHRP::gridUnknown;
                     }
-                    rank++;
                 }
             }
         }
-#if 0
-        std::cout << "occupied/empty/unknown = " << no << "/" << ne << "/" 
-                  << nu << std::endl;
-#endif
+        // the known map overwrites occupied cells
+        rasterize(leaves, box.leafBegin, box.leafEnd, box, pos, n, size,
+                  &m_cacheCells[0]);
+        rasterize(leaves, box.leafEnd, box.knownEnd, box, pos, n, size,
+                  &m_cacheCells[0]);
     }
+    map->cells.length(ncells);
+    if (ncells) memcpy(map->cells.get_buffer(), &m_cacheCells[0], ncells);
+
     coil::TimeValue t2(coil::gettimeofday());
     if (m_debugLevel > 0){
         coil::TimeValue dt = t2-t1;
         std::cout << "OccupancyGridMap3D::getOGMap3D() : " 
-                  << dt.sec()*1e3+dt.usec()/1e3 << "[ms]" << std::endl;
+                  << dt.sec()*1e3+dt.usec()/1e3 << "[ms]";
+        if (!full) std::cout << ", " << boxes.size() << " updated blocks";
+        std::cout << std::endl;
     }
 
     return map;
 }
 
+OpenHRP::OGMap3DUpdate* OccupancyGridMap3D::getOGMap3DUpdate(const OpenHRP::AABB& region, unsigned long version)
+{
+    coil::TimeValue t1(coil::gettimeofday());
+
+    OpenHRP::OGMap3DUpdate *update = new OpenHRP::OGMap3DUpdate;
+    double size, pos[3];
+    int n[3];
+    std::vector<OGMapLeaf> leaves;
+    std::vector<OGMapBox> boxes;
+    {
+        Guard guard(m_mutex);
+        size = m_map->getResolution();
+        // unlike getOGMap3D(), the region is not clipped by the extent of
+        // the map so that the grid doesn't move as the map grows
+        double s[] = {region.pos.x, region.pos.y, region.pos.z};
+        double e[] = {region.pos.x + region.size.l,
+                      region.pos.y + region.size.w,
+                      region.pos.z + region.size.h};
+        for (int i=0; i<3; i++){
+            int first = (int)floor(s[i]/size);
+            pos[i] = (first + 0.5)*size;
+            n[i] = std::max(0, (int)ceil(e[i]/size) - first);
+        }
+        if (version < m_clearVersion){
+            wholeBox(n, boxes);
+        }else{
+            updatedBoxes(m_map, m_blockVersions, version, pos, n, boxes);
+            size_t ncells = n[0]*n[1]*n[2];
+            if ((boxes.size() << (3*BLOCK_SHIFT)) > ncells/2){
+                boxes.clear();
+                wholeBox(n, boxes);
+            }
+        }
+        copyBoxLeaves(m_map, m_knownMap, m_occupiedThd, pos, size, boxes, leaves);
+        update->version = m_version;
+    }
+
+    update->resolution = size;
+    update->pos.x = pos[0];
+    update->pos.y = pos[1];
+    update->pos.z = pos[2];
+    update->nx = n[0];
+    update->ny = n[1];
+    update->nz = n[2];
+    update->blocks.length(boxes.size());
+    std::vector<unsigned char> cells;
+    size_t nbytes = 0;
+    for (size_t b=0; b<boxes.size(); b++){
+        const OGMapBox& box = boxes[b];
+        // rasterize leaves into a grid which covers only the box
+        OGMapBox local = box;
+        int m[3];
+        double lpos[3];
+        for (int i=0; i<3; i++){
+            m[i] = box.hi[i] - box.lo[i];
+            local.lo[i] = 0;
+            local.hi[i] = m[i];
+            lpos[i] = pos[i] + box.lo[i]*size;
+        }
+        cells.assign(m[0]*m[1]*m[2], OpenHRP::gridUnknown);
+        rasterize(leaves, box.leafBegin, box.leafEnd, local, lpos, m, size,
+                  &cells[0]);
+        rasterize(leaves, box.leafEnd, box.knownEnd, local, lpos, m, size,
+                  &cells[0]);
+
+        OpenHRP::OGMap3DBlock& block = update->blocks[b];
+        block.x = box.lo[0];
+        block.y = box.lo[1];
+        block.z = box.lo[2];
+        block.nx = m[0];
+        block.ny = m[1];
+        block.nz = m[2];
+        encodeRuns(cells, block.runs);
+        nbytes += block.runs.length();
+    }
+
+    coil::TimeValue t2(coil::gettimeofday());
+    if (m_debugLevel > 0){
+        coil::TimeValue dt = t2-t1;
+        std::cout << "OccupancyGridMap3D::getOGMap3DUpdate() : " 
+                  << dt.sec()*1e3+dt.usec()/1e3 << "[ms], "
+                  << boxes.size() << " blocks, " << nbytes << "[bytes]"
+                  << std::endl;
+    }
+
+    return update;
+}
+
+void OccupancyGridMap3D::integrate(OGMapScan *scan)
+{
+    if (m_integrationThread){
+        boost::mutex::scoped_lock lock(m_queueMutex);
+        // the oldest scan is dropped to keep the latency bounded
+        if ((int)m_queue.size() >= std::max(1, m_queueLength)){
+            delete m_queue.front();
+            m_queue.pop_front();
+            m_dropped++;
+        }
+        scan->tm = coil::gettimeofday();
+        m_queue.push_back(scan);
+        if (m_queue.size() > m_maxQueueLength) m_maxQueueLength = m_queue.size();
+        m_queueCond.notify_one();
+        return;
+    }
+
+    KeySet freeCells, occupiedCells;
+    Guard guard(m_mutex);
+    computeUpdate(m_map, *scan, m_integrationThreads, m_discretize,
+                  freeCells, occupiedCells);
+    applyUpdate(m_map, freeCells, occupiedCells, m_blockVersions, ++m_version);
+    delete scan;
+}
+
+void OccupancyGridMap3D::integrationLoop()
+{
+    while (1){
+        OGMapScan *scan;
+        {
+            boost::mutex::scoped_lock lock(m_queueMutex);
+            while (m_queue.empty() && !m_stopIntegration) m_queueCond.wait(lock);
+            if (m_stopIntegration) break;
+            scan = m_queue.front();
+            m_queue.pop_front();
+        }
+
+        // rays are cast without locking the map since computeUpdate()
+        // doesn't modify it
+        coil::TimeValue t1(coil::gettimeofday());
+        KeySet freeCells, occupiedCells;
+        computeUpdate(m_map, *scan, m_integrationThreads, m_discretize,
+                      freeCells, occupiedCells);
+        {
+            Guard guard(m_mutex);
+            applyUpdate(m_map, freeCells, occupiedCells, m_blockVersions,
+                        ++m_version);
+            m_updateOut.write();
+        }
+        coil::TimeValue t2(coil::gettimeofday());
+
+        coil::TimeValue dt = t2 - t1, latency = t2 - scan->tm;
+        double tm = dt.sec() + dt.usec()*1e-6;
+        double lt = latency.sec() + latency.usec()*1e-6;
+        delete scan;
+        {
+            boost::mutex::scoped_lock lock(m_queueMutex);
+            m_integrated++;
+            m_integrationTimeSum += tm;
+            m_latencySum += lt;
+            if (lt > m_maxLatency) m_maxLatency = lt;
+        }
+        if (m_debugLevel > 0){
+            std::cout << "OccupancyGridMap3D::integrationLoop() : "
+                      << tm*1e3 << "[ms], latency = " << lt*1e3 << "[ms]"
+                      << std::endl;
+        }
+    }
+}
+
+bool OccupancyGridMap3D::getIntegrationStatus(OpenHRP::OGMap3DIntegrationStatus& o_status)
+{
+    boost::mutex::scoped_lock lock(m_queueMutex);
+    if (!m_integrationThread) return false;
+    o_status.queueLength = m_queue.size();
+    o_status.maxQueueLength = m_maxQueueLength;
+    o_status.integrated = m_integrated;
+    o_status.dropped = m_dropped;
+    o_status.integrationTime = m_integrated ? m_integrationTimeSum/m_integrated : 0;
+    o_status.latency = m_integrated ? m_latencySum/m_integrated : 0;
+    o_status.maxLatency = m_maxLatency;
+    return true;
+}
+
 void OccupancyGridMap3D::save(const char *filename)
 {
     Guard guard(m_mutex);
@@ -624,6 +1131,9 @@ void OccupancyGridMap3D::clear()
 {
     Guard guard(m_mutex);
     m_map->clear();
+    m_cacheValid = false;
+    m_blockVersions.clear();
+    m_clearVersion = ++m_version;
     m_updateOut.write();
 }
 
@@ -10,6 +10,10 @@
 #ifndef NULL_COMPONENT_H
 #define NULL_COMPONENT_H
 
+#include <deque>
+#include <vector>
+#include <boost/thread.hpp>
+#include <boost/unordered_map.hpp>
 #include <rtm/idl/BasicDataType.hh>
 #include <rtm/idl/InterfaceDataTypes.hh>
 #include "hrpsys/idl/pointcloud.hh"
@@ -23,6 +27,7 @@
 namespace octomap{
     class OcTree;
 };
+struct OGMapScan;
 
 
 // Service implementation headers
@@ -105,8 +110,10 @@ class OccupancyGridMap3D
   // virtual RTC::ReturnCode_t onRateChanged(RTC::UniqueId ec_id);
 
   OpenHRP::OGMap3D* getOGMap3D(const OpenHRP::AABB& region);
+  OpenHRP::OGMap3DUpdate* getOGMap3DUpdate(const OpenHRP::AABB& region, unsigned long version);
   void save(const char *filename);
   void clear();
+  bool getIntegrationStatus(OpenHRP::OGMap3DIntegrationStatus& o_status);
 
  protected:
   // Configuration variable declaration
@@ -163,6 +170,36 @@ class OccupancyGridMap3D
   std::string m_cwd;
   coil::Mutex m_mutex;
   int m_debugLevel;
+
+  // the last region extracted by getOGMap3D(). Cells are updated only in
+  // blocks of voxels modified after the extraction. m_cacheMutex guards
+  // m_cacheCells, the others are guarded by m_mutex
+  coil::Mutex m_cacheMutex;
+  bool m_cacheValid;
+  unsigned long m_cacheVersion;
+  double m_cachePos[3], m_cacheResolution, m_cacheOccupiedThd;
+  int m_cacheSize[3];
+  std::vector<unsigned char> m_cacheCells;
+
+  // m_version is incremented whenever the map is modified. Blocks of
+  // 8x8x8 voxels are stamped with the version when they are modified last
+  unsigned long m_version, m_clearVersion;
+  boost::unordered_map<unsigned long long, unsigned long> m_blockVersions;
+
+  // scans are queued and integrated by m_integrationThread if
+  // asyncIntegration is set at activation. Members below m_queueMutex are
+  // guarded by it
+  void integrate(OGMapScan *scan);
+  void integrationLoop();
+  int m_asyncIntegration, m_queueLength, m_integrationThreads, m_discretize;
+  boost::thread *m_integrationThread;
+  boost::mutex m_queueMutex;
+  boost::condition_variable m_queueCond;
+  std::deque<OGMapScan *> m_queue;
+  bool m_stopIntegration;
+  size_t m_maxQueueLength;
+  unsigned long m_integrated, m_dropped;
+  double m_integrationTimeSum, m_latencySum, m_maxLatency;
   int dummy;
 };
 
@@ -8,6 +8,7 @@
  */
 
 #include "PDcontroller.h"
+#include "hrpsys/util/ModelCache.h"
 #include <iostream>
 #include <coil/stringutil.h>
 
@@ -72,9 +73,9 @@ RTC::ReturnCode_t PDcontroller::onInitialize()
   }
   nameServer = nameServer.substr(0, comPos);
   RTC::CorbaNaming naming(rtcManager.getORB(), nameServer.c_str());
-  if (!loadBodyFromModelLoader(m_robot, prop["model"].c_str(), 
-                               CosNaming::NamingContext::_duplicate(naming.getRootContext())
-                               )){
+  if (!loadBodyFromModelCache(m_robot, prop["model"].c_str(), 
+                              CosNaming::NamingContext::_duplicate(naming.getRootContext())
+                              )){
       std::cerr << "[" << m_profile.instance_name << "] failed to load model[" << prop["model"] << "]" 
                 << std::endl;
   }
@@ -0,0 +1,408 @@
+// -*- C++ -*-
+/*!
+ * @file  PointCloudFilter.cpp
+ * @brief Point cloud filter pipeline
+ * $Date$
+ *
+ * $Id$
+ */
+
+#include <coil/stringutil.h>
+#include "PointCloudFilter.h"
+#include "hrpsys/idl/pointcloud.hh"
+
+// Module specification
+// <rtc-template block="module_spec">
+static const char* spec[] =
+  {
+    "implementation_id", "PointCloudFilter",
+    "type_name",         "PointCloudFilter",
+    "description",       "Point Cloud Filter Pipeline",
+    "version",           HRPSYS_PACKAGE_VERSION,
+    "vendor",            "AIST",
+    "category",          "example",
+    "activity_type",     "DataFlowComponent",
+    "max_instance",      "10",
+    "language",          "C++",
+    "lang_type",         "compile",
+    // Configuration variables
+    "conf.default.stages", "voxel,sor",
+    "conf.default.size", "0.01",
+    "conf.default.meanK", "50",
+    "conf.default.stddevMulThresh", "1.0",
+    "conf.default.radius", "0.03",
+    "conf.default.distanceThd", "0.02",
+    "conf.default.pointNumThd", "500",
+    "conf.default.debugLevel", "0",
+
+    ""
+  };
+// </rtc-template>
+
+PointCloudFilter::PointCloudFilter(RTC::Manager* manager)
+  : RTC::DataFlowComponentBase(manager),
+    // <rtc-template block="initializer">
+    m_originalIn("original", m_original),
+    m_filteredOut("filtered", m_filtered),
+    // </rtc-template>
+    dummy(0)
+{
+}
+
+PointCloudFilter::~PointCloudFilter()
+{
+  for (unsigned int i=0; i<m_intermediateOut.size(); i++){
+    delete m_intermediateOut[i];
+  }
+}
+
+
+
+RTC::ReturnCode_t PointCloudFilter::onInitialize()
+{
+  //std::cout << m_profile.instance_name << ": onInitialize()" << std::endl;
+  // <rtc-template block="bind_config">
+  // Bind variables and configuration variable
+  bindParameter("stages", m_stageList, "voxel,sor");
+  bindParameter("size", m_size, "0.01");
+  bindParameter("meanK", m_meanK, "50");
+  bindParameter("stddevMulThresh", m_stddevMulThresh, "1.0");
+  bindParameter("radius", m_radius, "0.03");
+  bindParameter("distanceThd", m_distThd, "0.02");
+  bindParameter("pointNumThd", m_pointNumThd, "500");
+  bindParameter("debugLevel", m_debugLevel, "0");
+  
+  // </rtc-template>
+
+  // Registration: InPort/OutPort/Service
+  // <rtc-template block="registration">
+  // Set InPort buffers
+  addInPort("originalIn", m_originalIn);
+
+  // Set OutPort buffer
+  addOutPort("filteredOut", m_filteredOut);
+  
+  // Set service provider to Ports
+  
+  // Set service consumers to Ports
+  
+  // Set CORBA Service Ports
+  
+  // </rtc-template>
+
+  RTC::Properties& prop = getProperties();
+
+  setXyzHeader(m_filtered);
+  m_passedThrough = false;
+
+  // results of stages listed in intermediate_outputs are also output
+  // from ports named after the stages
+  m_intermediateIndex.assign(NUM_STAGE_TYPES, -1);
+  std::vector<stage_t> intermediate;
+  if (prop["intermediate_outputs"] != ""
+      && !parseStages(prop["intermediate_outputs"], intermediate)){
+    return RTC::RTC_ERROR;
+  }
+  for (unsigned int i=0; i<intermediate.size(); i++){
+    if (m_intermediateIndex[intermediate[i]] < 0){
+      m_intermediateIndex[intermediate[i]] = m_intermediate.size();
+      m_intermediate.push_back(m_filtered);
+    }
+  }
+  m_intermediateOut.resize(m_intermediate.size());
+  for (int i=0; i<NUM_STAGE_TYPES; i++){
+    int index = m_intermediateIndex[i];
+    if (index < 0) continue;
+    m_intermediateOut[index] = new OutPort<PointCloudTypes::PointCloud>(stageName((stage_t)i), m_intermediate[index]);
+    addOutPort(stageName((stage_t)i), *m_intermediateOut[index]);
+  }
+
+  // clouds and filters are reused in every frame
+  m_cloud.reset(new pcl::PointCloud<pcl::PointXYZ>);
+  m_work.reset(new pcl::PointCloud<pcl::PointXYZ>);
+  m_tree.reset(new pcl::search::KdTree<pcl::PointXYZ>);
+  m_coefficients.reset(new pcl::ModelCoefficients);
+  m_inliers.reset(new pcl::PointIndices);
+  m_mls.setPolynomialFit(true);
+  m_mls.setSearchMethod(m_tree);
+  m_seg.setOptimizeCoefficients(true);
+  m_seg.setModelType(pcl::SACMODEL_PLANE);
+  m_seg.setMethodType(pcl::SAC_RANSAC);
+  m_extract.setNegative(true);
+
+  return RTC::RTC_OK;
+}
+
+
+
+RTC::ReturnCode_t PointCloudFilter::onFinalize()
+{
+  for (unsigned int i=0; i<m_intermediateOut.size(); i++){
+    removeOutPort(*m_intermediateOut[i]);
+    delete m_intermediateOut[i];
+  }
+  m_intermediateOut.clear();
+  return RTC::RTC_OK;
+}
+
+/*
+RTC::ReturnCode_t PointCloudFilter::onStartup(RTC::UniqueId ec_id)
+{
+  return RTC::RTC_OK;
+}
+*/
+
+/*
+RTC::ReturnCode_t PointCloudFilter::onShutdown(RTC::UniqueId ec_id)
+{
+  return RTC::RTC_OK;
+}
+*/
+
+RTC::ReturnCode_t PointCloudFilter::onActivated(RTC::UniqueId ec_id)
+{
+  std::cout << m_profile.instance_name<< ": onActivated(" << ec_id << ")" << std::endl;
+  return RTC::RTC_OK;
+}
+
+RTC::ReturnCode_t PointCloudFilter::onDeactivated(RTC::UniqueId ec_id)
+{
+  std::cout << m_profile.instance_name<< ": onDeactivated(" << ec_id << ")" << std::endl;
+  return RTC::RTC_OK;
+}
+
+RTC::ReturnCode_t PointCloudFilter::onExecute(RTC::UniqueId ec_id)
+{
+  if (m_debugLevel > 0){
+    std::cout << m_profile.instance_name<< ": onExecute(" << ec_id << ")" << std::endl;
+  }
+
+  if (m_originalIn.isNew()){
+    m_originalIn.read();
+
+    if (m_stageList != m_parsedStageList){
+      std::vector<stage_t> stages;
+      if (parseStages(m_stageList, stages)){
+        m_stages = stages;
+      }
+      m_parsedStageList = m_stageList;
+    }
+
+    if (m_stages.empty()){
+        m_filtered = m_original;
+        m_passedThrough = true;
+        m_filteredOut.write();
+        return RTC::RTC_OK;
+    }
+
+    // RTM -> PCL
+    unsigned int step = m_original.point_step ? m_original.point_step/sizeof(float) : 4;
+    m_cloud->is_dense = m_original.is_dense;
+    m_cloud->points.resize(m_original.width*m_original.height);
+    m_cloud->width = m_cloud->points.size();
+    m_cloud->height = 1;
+    float *src = (float *)m_original.data.get_buffer();
+    for (unsigned int i=0; i<m_cloud->points.size(); i++){
+      m_cloud->points[i].x = src[0];
+      m_cloud->points[i].y = src[1];
+      m_cloud->points[i].z = src[2];
+      src += step;
+    }
+
+    // PCL Processing
+    for (unsigned int i=0; i<m_stages.size(); i++){
+      size_t n = m_cloud->points.size();
+      applyStage(m_stages[i]);
+      if (m_debugLevel > 0){
+        std::cout << stageName(m_stages[i]) << ": " << n << " -> "
+                  << m_cloud->points.size() << " points" << std::endl;
+      }
+      int index = m_intermediateIndex[m_stages[i]];
+      if (index >= 0){
+        pclToRtm(*m_cloud, m_intermediate[index]);
+        m_intermediate[index].tm = m_original.tm;
+        m_intermediateOut[index]->write();
+      }
+    }
+
+    // PCL -> RTM
+    if (m_passedThrough){
+      // the header of the original cloud was copied
+      setXyzHeader(m_filtered);
+      m_passedThrough = false;
+    }
+    pclToRtm(*m_cloud, m_filtered);
+    m_filtered.tm = m_original.tm;
+    m_filteredOut.write();
+  }
+
+  return RTC::RTC_OK;
+}
+
+void PointCloudFilter::setXyzHeader(PointCloudTypes::PointCloud& o_cloud)
+{
+  o_cloud.height = 1;
+  o_cloud.type = "xyz";
+  o_cloud.fields.length(3);
+  o_cloud.fields[0].name = "x";
+  o_cloud.fields[0].offset = 0;
+  o_cloud.fields[0].data_type = PointCloudTypes::FLOAT32;
+  o_cloud.fields[0].count = 4;
+  o_cloud.fields[1].name = "y";
+  o_cloud.fields[1].offset = 4;
+  o_cloud.fields[1].data_type = PointCloudTypes::FLOAT32;
+  o_cloud.fields[1].count = 4;
+  o_cloud.fields[2].name = "z";
+  o_cloud.fields[2].offset = 8;
+  o_cloud.fields[2].data_type = PointCloudTypes::FLOAT32;
+  o_cloud.fields[2].count = 4;
+  o_cloud.is_bigendian = false;
+  o_cloud.point_step = 16;
+  o_cloud.is_dense = true;
+}
+
+const char *PointCloudFilter::stageName(stage_t i_stage)
+{
+  switch(i_stage){
+  case VOXEL_GRID: return "voxel";
+  case APPROXIMATE_VOXEL_GRID: return "approximateVoxel";
+  case SOR: return "sor";
+  case MLS: return "mls";
+  case PLANE_REMOVER: return "plane";
+  default: return "";
+  }
+}
+
+bool PointCloudFilter::parseStages(const std::string& i_stages,
+                                   std::vector<stage_t>& o_stages)
+{
+  coil::vstring names = coil::split(i_stages, ",");
+  o_stages.clear();
+  for (unsigned int i=0; i<names.size(); i++){
+    int j;
+    for (j=0; j<NUM_STAGE_TYPES; j++){
+      if (names[i] == stageName((stage_t)j)) break;
+    }
+    if (j == NUM_STAGE_TYPES){
+      std::cerr << "[" << m_profile.instance_name << "] unknown stage("
+                << names[i] << "), stages should be some of voxel, approximateVoxel, sor, mls and plane"
+                << std::endl;
+      return false;
+    }
+    o_stages.push_back((stage_t)j);
+  }
+  return true;
+}
+
+void PointCloudFilter::applyStage(stage_t i_stage)
+{
+  switch(i_stage){
+  case VOXEL_GRID:
+    if (!m_size) return;
+    m_voxelGrid.setInputCloud(m_cloud);
+    m_voxelGrid.setLeafSize(m_size, m_size, m_size);
+    m_voxelGrid.filter(*m_work);
+    break;
+  case APPROXIMATE_VOXEL_GRID:
+    if (!m_size) return;
+    m_approximateVoxelGrid.setInputCloud(m_cloud);
+    m_approximateVoxelGrid.setLeafSize(m_size, m_size, m_size);
+    m_approximateVoxelGrid.filter(*m_work);
+    break;
+  case SOR:
+    if (m_cloud->points.empty()) return;
+    m_sor.setInputCloud(m_cloud);
+    m_sor.setMeanK(m_meanK);
+    m_sor.setStddevMulThresh(m_stddevMulThresh);
+    m_sor.filter(*m_work);
+    break;
+  case MLS:
+    if (m_cloud->points.empty()) return;
+    m_mls.setInputCloud(m_cloud);
+    m_mls.setSearchRadius(m_radius);
+    m_mls.process(*m_work);
+    break;
+  case PLANE_REMOVER:
+    m_seg.setDistanceThreshold(m_distThd);
+    while (!m_cloud->points.empty()){
+      m_seg.setInputCloud(m_cloud);
+      m_seg.segment(*m_inliers, *m_coefficients);
+      if (m_inliers->indices.size() < m_pointNumThd) break;
+      m_extract.setInputCloud(m_cloud);
+      m_extract.setIndices(m_inliers);
+      m_extract.filter(*m_work);
+      m_cloud.swap(m_work);
+    }
+    return;
+  default:
+    return;
+  }
+  m_cloud.swap(m_work);
+}
+
+void PointCloudFilter::pclToRtm(const pcl::PointCloud<pcl::PointXYZ>& i_cloud,
+                                PointCloudTypes::PointCloud& o_cloud)
+{
+  o_cloud.width = i_cloud.points.size();
+  o_cloud.row_step = o_cloud.point_step*o_cloud.width;
+  o_cloud.data.length(o_cloud.height*o_cloud.row_step);
+  float *dst = (float *)o_cloud.data.get_buffer();
+  for (unsigned int i=0; i<i_cloud.points.size(); i++){
+    dst[0] = i_cloud.points[i].x;
+    dst[1] = i_cloud.points[i].y;
+    dst[2] = i_cloud.points[i].z;
+    dst += 4;
+  }
+}
+
+/*
+RTC::ReturnCode_t PointCloudFilter::onAborting(RTC::UniqueId ec_id)
+{
+  return RTC::RTC_OK;
+}
+*/
+
+/*
+RTC::ReturnCode_t PointCloudFilter::onError(RTC::UniqueId ec_id)
+{
+  return RTC::RTC_OK;
+}
+*/
+
+/*
+RTC::ReturnCode_t PointCloudFilter::onReset(RTC::UniqueId ec_id)
+{
+  return RTC::RTC_OK;
+}
+*/
+
+/*
+RTC::ReturnCode_t PointCloudFilter::onStateUpdate(RTC::UniqueId ec_id)
+{
+  return RTC::RTC_OK;
+}
+*/
+
+/*
+RTC::ReturnCode_t PointCloudFilter::onRateChanged(RTC::UniqueId ec_id)
+{
+  return RTC::RTC_OK;
+}
+*/
+
+
+
+extern "C"
+{
+
+  void PointCloudFilterInit(RTC::Manager* manager)
+  {
+    RTC::Properties profile(spec);
+    manager->registerFactory(profile,
+                             RTC::Create<PointCloudFilter>,
+                             RTC::Delete<PointCloudFilter>);
+  }
+
+};
+
+
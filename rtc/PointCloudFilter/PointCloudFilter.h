@@ -0,0 +1,203 @@
+// -*- C++ -*-
+/*!
+ * @file  PointCloudFilter.h
+ * @brief Point cloud filter pipeline
+ * @date  $Date$
+ *
+ * $Id$
+ */
+
+#ifndef POINT_CLOUD_FILTER_H
+#define POINT_CLOUD_FILTER_H
+
+#include <vector>
+#include <string>
+#include <pcl/point_types.h>
+#include <pcl/search/kdtree.h>
+#include <pcl/filters/voxel_grid.h>
+#include <pcl/filters/approximate_voxel_grid.h>
+#include <pcl/filters/statistical_outlier_removal.h>
+#include <pcl/filters/extract_indices.h>
+#include <pcl/segmentation/sac_segmentation.h>
+#include <pcl/surface/mls.h>
+#include <rtm/idl/BasicDataType.hh>
+#include "hrpsys/idl/pointcloud.hh"
+#include <rtm/Manager.h>
+#include <rtm/DataFlowComponentBase.h>
+#include <rtm/CorbaPort.h>
+#include <rtm/DataInPort.h>
+#include <rtm/DataOutPort.h>
+#include <rtm/idl/BasicDataTypeSkel.h>
+
+// Service implementation headers
+// <rtc-template block="service_impl_h">
+
+// </rtc-template>
+
+// Service Consumer stub headers
+// <rtc-template block="consumer_stub_h">
+
+// </rtc-template>
+
+using namespace RTC;
+
+/**
+   \brief applies several point cloud filters in one component.
+   The input is converted to PCL once and PCL clouds and filters are
+   reused across frames.
+ */
+class PointCloudFilter
+  : public RTC::DataFlowComponentBase
+{
+ public:
+  /**
+     \brief Constructor
+     \param manager pointer to the Manager
+  */
+  PointCloudFilter(RTC::Manager* manager);
+  /**
+     \brief Destructor
+  */
+  virtual ~PointCloudFilter();
+
+  // The initialize action (on CREATED->ALIVE transition)
+  // formaer rtc_init_entry()
+  virtual RTC::ReturnCode_t onInitialize();
+
+  // The finalize action (on ALIVE->END transition)
+  // formaer rtc_exiting_entry()
+  virtual RTC::ReturnCode_t onFinalize();
+
+  // The startup action when ExecutionContext startup
+  // former rtc_starting_entry()
+  // virtual RTC::ReturnCode_t onStartup(RTC::UniqueId ec_id);
+
+  // The shutdown action when ExecutionContext stop
+  // former rtc_stopping_entry()
+  // virtual RTC::ReturnCode_t onShutdown(RTC::UniqueId ec_id);
+
+  // The activated action (Active state entry action)
+  // former rtc_active_entry()
+  virtual RTC::ReturnCode_t onActivated(RTC::UniqueId ec_id);
+
+  // The deactivated action (Active state exit action)
+  // former rtc_active_exit()
+  virtual RTC::ReturnCode_t onDeactivated(RTC::UniqueId ec_id);
+
+  // The execution action that is invoked periodically
+  // former rtc_active_do()
+  virtual RTC::ReturnCode_t onExecute(RTC::UniqueId ec_id);
+
+  // The aborting action when main logic error occurred.
+  // former rtc_aborting_entry()
+  // virtual RTC::ReturnCode_t onAborting(RTC::UniqueId ec_id);
+
+  // The error action in ERROR state
+  // former rtc_error_do()
+  // virtual RTC::ReturnCode_t onError(RTC::UniqueId ec_id);
+
+  // The reset action that is invoked resetting
+  // This is same but different the former rtc_init_entry()
+  // virtual RTC::ReturnCode_t onReset(RTC::UniqueId ec_id);
+
+  // The state update action that is invoked after onExecute() action
+  // no corresponding operation exists in OpenRTm-aist-0.2.0
+  // virtual RTC::ReturnCode_t onStateUpdate(RTC::UniqueId ec_id);
+
+  // The action that is invoked when execution context's rate is changed
+  // no corresponding operation exists in OpenRTm-aist-0.2.0
+  // virtual RTC::ReturnCode_t onRateChanged(RTC::UniqueId ec_id);
+
+
+ protected:
+  // Configuration variable declaration
+  // <rtc-template block="config_declare">
+  
+  // </rtc-template>
+
+  PointCloudTypes::PointCloud m_original;
+  PointCloudTypes::PointCloud m_filtered;
+
+  // DataInPort declaration
+  // <rtc-template block="inport_declare">
+  InPort<PointCloudTypes::PointCloud> m_originalIn;
+  
+  // </rtc-template>
+
+  // DataOutPort declaration
+  // <rtc-template block="outport_declare">
+  OutPort<PointCloudTypes::PointCloud> m_filteredOut;
+  std::vector<PointCloudTypes::PointCloud> m_intermediate;
+  std::vector<OutPort<PointCloudTypes::PointCloud> *> m_intermediateOut;
+  
+  // </rtc-template>
+
+  // CORBA Port declaration
+  // <rtc-template block="corbaport_declare">
+  
+  // </rtc-template>
+
+  // Service declaration
+  // <rtc-template block="service_declare">
+  
+  // </rtc-template>
+
+  // Consumer declaration
+  // <rtc-template block="consumer_declare">
+  
+  // </rtc-template>
+
+ private:
+  enum stage_t {
+    VOXEL_GRID,
+    APPROXIMATE_VOXEL_GRID,
+    SOR,
+    MLS,
+    PLANE_REMOVER,
+    NUM_STAGE_TYPES
+  };
+  // header of xyz clouds output by pclToRtm()
+  static void setXyzHeader(PointCloudTypes::PointCloud& o_cloud);
+  static const char *stageName(stage_t i_stage);
+  bool parseStages(const std::string& i_stages, std::vector<stage_t>& o_stages);
+  // apply a stage to m_cloud and store the result in m_cloud
+  void applyStage(stage_t i_stage);
+  void pclToRtm(const pcl::PointCloud<pcl::PointXYZ>& i_cloud,
+                PointCloudTypes::PointCloud& o_cloud);
+
+  // configuration
+  std::string m_stageList;
+  double m_size;
+  int m_meanK;
+  double m_stddevMulThresh;
+  double m_radius;
+  double m_distThd;
+  double m_pointNumThd;
+  int m_debugLevel;
+  int dummy;
+
+  std::string m_parsedStageList;
+  std::vector<stage_t> m_stages;
+  bool m_passedThrough; // m_filtered has the header of m_original
+  std::vector<int> m_intermediateIndex; // index of m_intermediate for each stage type, -1 if not output
+
+  // double buffer, m_cloud is the latest result
+  pcl::PointCloud<pcl::PointXYZ>::Ptr m_cloud, m_work;
+  pcl::search::KdTree<pcl::PointXYZ>::Ptr m_tree;
+  pcl::VoxelGrid<pcl::PointXYZ> m_voxelGrid;
+  pcl::ApproximateVoxelGrid<pcl::PointXYZ> m_approximateVoxelGrid;
+  pcl::StatisticalOutlierRemoval<pcl::PointXYZ> m_sor;
+  pcl::MovingLeastSquares<pcl::PointXYZ, pcl::PointXYZ> m_mls;
+  pcl::SACSegmentation<pcl::PointXYZ> m_seg;
+  pcl::ExtractIndices<pcl::PointXYZ> m_extract;
+  pcl::ModelCoefficients::Ptr m_coefficients;
+  pcl::PointIndices::Ptr m_inliers;
+};
+
+
+extern "C"
+{
+  void PointCloudFilterInit(RTC::Manager* manager);
+};
+
+#endif // POINT_CLOUD_FILTER_H
@@ -12,6 +12,7 @@
 #include <opencv2/core/core.hpp>
 #include <opencv2/imgproc/types_c.h>
 #include "RGB2Gray.h"
+#include "hrpsys/util/ImageUtil.h"
 
 // Module specification
 // <rtc-template block="module_spec">
@@ -121,17 +122,10 @@ RTC::ReturnCode_t RGB2Gray::onExecute(RTC::UniqueId ec_id)
 
       Img::ImageData& idat = m_rgb.data.image;
 
-      cv::Mat src(idat.height, idat.width, CV_8UC3, 
-		  idat.raw_data.get_buffer());
-      cv::Mat dst;
-      cv::cvtColor(src, dst, CV_RGB2GRAY);
-
-      m_gray.data.image.width  = idat.width;
-      m_gray.data.image.height = idat.height;
-      m_gray.data.image.format = Img::CF_GRAY;
-      m_gray.data.image.raw_data.length(idat.width*idat.height);
-      memcpy(m_gray.data.image.raw_data.get_buffer(),
-	     dst.data, idat.width*idat.height);
+      // converted directly into the output buffer
+      unsigned char *dst = setupImage(m_gray.data.image,
+                                      idat.width, idat.height, Img::CF_GRAY);
+      rgbToGray(idat.raw_data.get_buffer(), dst, idat.width, idat.height);
 
       m_grayOut.write();
   }
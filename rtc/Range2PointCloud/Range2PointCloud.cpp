@@ -8,6 +8,7 @@
  */
 
 #include <math.h>
+#include <algorithm>
 #include <hrpUtil/Eigen3d.h>
 #include "Range2PointCloud.h"
 
@@ -26,6 +27,7 @@ static const char* range2pointcloud_spec[] =
     "language",          "C++",
     "lang_type",         "compile",
     // Configuration variables
+    "conf.default.accumulateScans", "1",
 
     ""
   };
@@ -37,8 +39,12 @@ Range2PointCloud::Range2PointCloud(RTC::Manager* manager)
     m_rangeIn("range", m_range),
     m_cloudOut("cloud", m_cloud),
     // </rtc-template>
+    m_beamMinAngle(0), m_beamAngularRes(0),
+    m_ringSlotSize(0), m_ringHead(0),
     dummy(0)
 {
+  m_lastOrientation.r = m_lastOrientation.p = m_lastOrientation.y = 0;
+  m_sensorR = hrp::Matrix33::Identity();
 }
 
 Range2PointCloud::~Range2PointCloud()
@@ -52,6 +58,7 @@ RTC::ReturnCode_t Range2PointCloud::onInitialize()
   std::cout << m_profile.instance_name << ": onInitialize()" << std::endl;
   // <rtc-template block="bind_config">
   // Bind variables and configuration variable
+  bindParameter("accumulateScans", m_accumulateScans, "1");
   
   // </rtc-template>
 
@@ -130,41 +137,115 @@ RTC::ReturnCode_t Range2PointCloud::onDeactivated(RTC::UniqueId ec_id)
   return RTC::RTC_OK;
 }
 
+void Range2PointCloud::setupBeams(const RangerConfig& i_config,
+                                  unsigned int i_n)
+{
+  if (m_beamX.size() == i_n && m_beamMinAngle == i_config.minAngle
+      && m_beamAngularRes == i_config.angularRes) return;
+
+  m_beamX.resize(i_n);
+  m_beamZ.resize(i_n);
+  for (unsigned int i=0; i<i_n; i++){
+    double th = i_config.minAngle + i*i_config.angularRes;
+    m_beamX[i] = -sin(th);
+    m_beamZ[i] = -cos(th);
+  }
+  m_beamMinAngle = i_config.minAngle;
+  m_beamAngularRes = i_config.angularRes;
+}
+
+// converts m_range into points and returns the number of them. o_ptr must
+// have room for all beams since points are written without branches and
+// beams without return are overwritten by the next one
+unsigned int Range2PointCloud::convert(float *o_ptr)
+{
+  unsigned int n = m_range.ranges.length();
+  setupBeams(m_range.config, n);
+
+  Pose3D &pose = m_range.geometry.geometry.pose;
+  if (pose.orientation.r != m_lastOrientation.r
+      || pose.orientation.p != m_lastOrientation.p
+      || pose.orientation.y != m_lastOrientation.y){
+    m_sensorR = hrp::rotFromRpy(pose.orientation.r,
+                                pose.orientation.p,
+                                pose.orientation.y);
+    m_lastOrientation = pose.orientation;
+  }
+  // absP = sensorP + sensorR*(d*beam), beam = (x, 0, z)
+  const double px = pose.position.x, py = pose.position.y, pz = pose.position.z;
+  const double r00 = m_sensorR(0,0), r02 = m_sensorR(0,2);
+  const double r10 = m_sensorR(1,0), r12 = m_sensorR(1,2);
+  const double r20 = m_sensorR(2,0), r22 = m_sensorR(2,2);
+  const double *ranges = m_range.ranges.get_buffer();
+  const double *bx = &m_beamX[0], *bz = &m_beamZ[0];
+  unsigned int npoint=0;
+  for (unsigned int i=0; i<n; i++){
+    double d = ranges[i];
+    double a = d*bx[i], b = d*bz[i];
+    float *ptr = o_ptr + npoint*4;
+    ptr[0] = px + r00*a + r02*b;
+    ptr[1] = py + r10*a + r12*b;
+    ptr[2] = pz + r20*a + r22*b;
+    npoint += (d != 0);
+  }
+  return npoint;
+}
+
+// grows the output buffer geometrically so that it is rarely reallocated
+void Range2PointCloud::reserve(unsigned int i_npoints)
+{
+  unsigned int len = i_npoints*m_cloud.point_step;
+  if (m_cloud.data.length() < len){
+    m_cloud.data.length(std::max(len, (unsigned int)m_cloud.data.length()*2));
+  }
+}
+
 RTC::ReturnCode_t Range2PointCloud::onExecute(RTC::UniqueId ec_id)
 {
     //std::cout << m_profile.instance_name<< ": onExecute(" << ec_id << ")" << std::endl;
   if (!m_rangeIn.isNew()) return RTC::RTC_OK;
 
-  m_cloud.width = 0;
-  int npoint=0;
+  unsigned int nscans = m_accumulateScans > 1 ? m_accumulateScans : 1;
+  if (m_ringPoints.size() != nscans){
+    m_ringPoints.assign(nscans, 0);
+    m_ringHead = 0;
+  }
+
+  unsigned int npoint=0;
   int nlines=0;
   while (m_rangeIn.isNew()){
     nlines++;
     m_rangeIn.read();
-    m_cloud.width += m_range.ranges.length();
-    m_cloud.row_step = m_cloud.point_step*m_cloud.width;
-    m_cloud.data.length(m_cloud.row_step);// shrinked later
-    // range -> point cloud
-    float *ptr = (float *)m_cloud.data.get_buffer() + npoint*4;
-    Pose3D &pose = m_range.geometry.geometry.pose;
-    hrp::Vector3 relP, absP, sensorP(pose.position.x,
-				     pose.position.y,
-				     pose.position.z);
-    hrp::Matrix33 sensorR = hrp::rotFromRpy(pose.orientation.r,
-					    pose.orientation.p,
-					    pose.orientation.y);
-    for (unsigned int i=0; i<m_range.ranges.length(); i++){
-      double th = m_range.config.minAngle + i*m_range.config.angularRes;
-      double d = m_range.ranges[i];
-      if (d==0) continue;
-      relP << -d*sin(th), 0, -d*cos(th);
-      absP = sensorP + sensorR*relP;
-      ptr[0] = absP[0];
-      ptr[1] = absP[1];
-      ptr[2] = absP[2];
-      //std::cout << "(" << i << "," << ptr[2] << "," << d << ")" << std::endl;
-      ptr+=4;
-      npoint++;
+    unsigned int n = m_range.ranges.length();
+    if (!n) continue;
+    if (nscans == 1){
+      reserve(npoint + n);
+      npoint += convert((float *)m_cloud.data.get_buffer() + npoint*4);
+    }else{
+      if (n*4 > m_ringSlotSize){
+        // scans accumulated so far are discarded
+        m_ringSlotSize = n*4;
+        m_ring.resize(nscans*m_ringSlotSize);
+        m_ringPoints.assign(nscans, 0);
+        m_ringHead = 0;
+      }
+      m_ringPoints[m_ringHead]
+        = convert(&m_ring[m_ringHead*m_ringSlotSize]);
+      m_ringHead = (m_ringHead+1)%nscans;
+    }
+  }
+  if (nscans > 1){
+    for (unsigned int i=0; i<nscans; i++) npoint += m_ringPoints[i];
+    reserve(npoint);
+    float *ptr = (float *)m_cloud.data.get_buffer();
+    // from the oldest scan
+    for (unsigned int i=0; i<nscans; i++){
+      unsigned int slot = (m_ringHead+i)%nscans;
+      unsigned int len = m_ringPoints[slot]*4;
+      if (!len) continue;
+      std::copy(&m_ring[slot*m_ringSlotSize],
+                &m_ring[slot*m_ringSlotSize] + len, ptr);
+      ptr += len;
     }
   }
 #if 0
@@ -172,6 +253,7 @@ RTC::ReturnCode_t Range2PointCloud::onExecute(RTC::UniqueId ec_id)
 	    << npoint << " points" << std::endl;
 #endif
   m_cloud.width = npoint;
+  m_cloud.row_step = m_cloud.point_step*m_cloud.width;
   m_cloud.data.length(npoint*m_cloud.point_step);
   m_cloudOut.write();
 
@@ -10,6 +10,8 @@
 #ifndef RANGE2POINTCLOUD_H
 #define RANGE2POINTCLOUD_H
 
+#include <vector>
+#include <hrpUtil/Eigen3d.h>
 #include <rtm/idl/BasicDataType.hh>
 #include <rtm/idl/InterfaceDataTypes.hh>
 #include "hrpsys/idl/pointcloud.hh"
@@ -102,6 +104,7 @@ class Range2PointCloud
  protected:
   // Configuration variable declaration
   // <rtc-template block="config_declare">
+  int m_accumulateScans;
   
   // </rtc-template>
 
@@ -136,6 +139,19 @@ class Range2PointCloud
   // </rtc-template>
 
  private:
+  void setupBeams(const RangerConfig& i_config, unsigned int i_n);
+  unsigned int convert(float *o_ptr);
+  void reserve(unsigned int i_npoints);
+
+  // directions of beams in the sensor frame, y components are zero
+  std::vector<double> m_beamX, m_beamZ;
+  double m_beamMinAngle, m_beamAngularRes;
+  Orientation3D m_lastOrientation;
+  hrp::Matrix33 m_sensorR;
+  // points of the last m_accumulateScans scans
+  std::vector<float> m_ring;
+  std::vector<unsigned int> m_ringPoints;
+  unsigned int m_ringSlotSize, m_ringHead;
   int dummy;
 };
 
@@ -11,6 +11,7 @@
 #include <hrpModel/Link.h>
 #include <hrpModel/Sensor.h>
 #include <hrpModel/ModelLoaderUtil.h>
+#include "hrpsys/util/ModelCache.h"
 #include <hrpModel/JointPath.h>
 #include <hrpUtil/MatrixSolvers.h>
 #include "hrpsys/util/Hrpsys.h"
@@ -120,9 +121,9 @@ RTC::ReturnCode_t ReferenceForceUpdater::onInitialize()
   }
   nameServer = nameServer.substr(0, comPos);
   RTC::CorbaNaming naming(rtcManager.getORB(), nameServer.c_str());
-  if (!loadBodyFromModelLoader(m_robot, prop["model"].c_str(), // load robot model for m_robot
-                               CosNaming::NamingContext::_duplicate(naming.getRootContext())
-                               )){
+  if (!loadBodyFromModelCache(m_robot, prop["model"].c_str(), // load robot model for m_robot
+                              CosNaming::NamingContext::_duplicate(naming.getRootContext())
+                              )){
     std::cerr << "[" << m_profile.instance_name << "] failed to load model[" << prop["model"] << "]" << std::endl;
     return RTC::RTC_ERROR;
   }
@@ -10,6 +10,7 @@
 #include "RemoveForceSensorLinkOffset.h"
 #include <rtm/CorbaNaming.h>
 #include <hrpModel/ModelLoaderUtil.h>
+#include "hrpsys/util/ModelCache.h"
 #include <hrpUtil/MatrixSolvers.h>
 #include <hrpModel/Sensor.h>
 
@@ -94,7 +95,7 @@ RTC::ReturnCode_t RemoveForceSensorLinkOffset::onInitialize()
   }
   nameServer = nameServer.substr(0, comPos);
   RTC::CorbaNaming naming(rtcManager.getORB(), nameServer.c_str());
-  if (!loadBodyFromModelLoader(m_robot, prop["model"].c_str(),
+  if (!loadBodyFromModelCache(m_robot, prop["model"].c_str(),
 			       CosNaming::NamingContext::_duplicate(naming.getRootContext())
 	  )){
       std::cerr << "[" << m_profile.instance_name << "] failed to load model[" << prop["model"] << "]" << std::endl;
@@ -113,6 +114,10 @@ RTC::ReturnCode_t RemoveForceSensorLinkOffset::onInitialize()
     registerInPort(s->name.c_str(), *m_forceIn[i]);
     registerOutPort(std::string("off_"+s->name).c_str(), *m_forceOut[i]);
     m_forcemoment_offset_param.insert(std::pair<std::string, ForceMomentOffsetParam>(s->name, ForceMomentOffsetParam()));
+    m_sensorFK.addTarget(s->link);
+  }
+  if (m_robot->numSensors(hrp::Sensor::ACCELERATION) > 0) {
+    m_sensorFK.addTarget(m_robot->sensor(hrp::Sensor::ACCELERATION, 0)->link);
   }
   max_sensor_offset_calib_counter = static_cast<int>(8.0/m_dt); // 8.0[s] by default
   return RTC::RTC_OK;
@@ -176,7 +181,7 @@ RTC::ReturnCode_t RemoveForceSensorLinkOffset::onExecute(RTC::UniqueId ec_id)
     }
     //
     updateRootLinkPosRot(rpy);
-    m_robot->calcForwardKinematics();
+    m_sensorFK.calcForwardKinematics();
     Guard guard(m_mutex);
     for (unsigned int i=0; i<m_forceIn.size(); i++){
       if ( m_force[i].data.length()==6 ) {
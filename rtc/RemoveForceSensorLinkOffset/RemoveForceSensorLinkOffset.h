@@ -26,6 +26,7 @@
 
 #include "RemoveForceSensorLinkOffsetService_impl.h"
 #include "../ImpedanceController/RatsMatrix.h"
+#include "../ImpedanceController/PartialForwardKinematics.h"
 #include <semaphore.h>
 
 // Service implementation headers
@@ -187,6 +188,8 @@ class RemoveForceSensorLinkOffset
   static const double grav = 9.80665; /* [m/s^2] */
   double m_dt;
   hrp::BodyPtr m_robot;
+  // links between the root link and force/acceleration sensors
+  hrp::PartialForwardKinematics m_sensorFK;
   unsigned int m_debugLevel;
   int max_sensor_offset_calib_counter;
   coil::Mutex m_mutex;
@@ -10,6 +10,7 @@
 #include <rtm/CorbaNaming.h>
 #include <hrpModel/Link.h>
 #include <hrpModel/ModelLoaderUtil.h>
+#include "hrpsys/util/ModelCache.h"
 #include "SequencePlayer.h"
 #include "hrpsys/util/VectorConvert.h"
 #include <hrpModel/JointPath.h>
@@ -61,6 +62,8 @@ SequencePlayer::SequencePlayer(RTC::Manager* manager)
       m_error_pos(0.0001),
       m_error_rot(0.001),
       m_iteration(50),
+      m_targetPoseCancel(false),
+      m_targetPoseDuration(0),
       dummy(0)
 {
     sem_init(&m_waitSem, 0, 0);
@@ -123,9 +126,9 @@ RTC::ReturnCode_t SequencePlayer::onInitialize()
     }
     nameServer = nameServer.substr(0, comPos);
     RTC::CorbaNaming naming(rtcManager.getORB(), nameServer.c_str());
-    if (!loadBodyFromModelLoader(m_robot, prop["model"].c_str(), 
-                                 CosNaming::NamingContext::_duplicate(naming.getRootContext())
-                                 )){
+    if (!loadBodyFromModelCache(m_robot, prop["model"].c_str(), 
+                                CosNaming::NamingContext::_duplicate(naming.getRootContext())
+                                )){
         std::cerr << "failed to load model[" << prop["model"] << "]" 
                   << std::endl;
     }
@@ -163,6 +166,7 @@ RTC::ReturnCode_t SequencePlayer::onInitialize()
     }
 
     m_seq = new seqplay(dof, dt, nforce, optional_data_dim);
+    m_ikRobot = hrp::BodyPtr(new hrp::Body(*m_robot));
 
     m_qInit.data.length(dof);
     for (unsigned int i=0; i<dof; i++) m_qInit.data[i] = 0.0;
@@ -187,6 +191,7 @@ RTC::ReturnCode_t SequencePlayer::onFinalize()
     if ( m_debugLevel > 0 ) {
         std::cerr << __PRETTY_FUNCTION__ << std::endl;
     }
+    cancelTargetPose();
     return RTC::RTC_OK;
 }
 
@@ -591,18 +596,50 @@ bool SequencePlayer::setTargetPose(const char* gname, const double *xyz, const d
     if ( m_debugLevel > 0 ) {
         std::cerr << __PRETTY_FUNCTION__ << std::endl;
     }
+    Guard ikGuard(m_ikMutex);
+    cancelTargetPose();
+    if (!setupTargetPose(gname, xyz, rpy, tm, frame_name)) return false;
+
+    // IK is solved on m_ikRobot, so the control loop is not blocked
+    if (!solveTargetPose(false)) return false;
+
+    if ( m_debugLevel > 0 ) {
+        // for debug
+        size_t n = m_targetPoseIndices.size();
+        for (size_t i = 0; i < m_targetPoseTm.size(); i++ ) {
+            std::cerr << m_targetPoseTm[i] << ":";
+            for (size_t j = 0; j < n; j++ ) {
+                std::cerr << m_targetPoseQ[i*n+j] << " ";
+            }
+            std::cerr << std::endl;
+        }
+    }
+
+    return playTargetPose(0, m_targetPoseTm.size(), false);
+}
+
+bool SequencePlayer::setTargetPoseAsync(const char* gname, const double *xyz, const double *rpy, double tm, const char* frame_name)
+{
+    if ( m_debugLevel > 0 ) {
+        std::cerr << __PRETTY_FUNCTION__ << std::endl;
+    }
+    Guard ikGuard(m_ikMutex);
+    cancelTargetPose();
+    if (!setupTargetPose(gname, xyz, rpy, tm, frame_name)) return false;
+    m_targetPoseThread = boost::thread(&SequencePlayer::solveTargetPose, this, true);
+    return true;
+}
+
+bool SequencePlayer::setupTargetPose(const char* gname, const double *xyz, const double *rpy, double tm, const char* frame_name)
+{
     Guard guard(m_mutex);
     if (!setInitialState()) return false;
     // setup
-    std::vector<int> indices;
-    hrp::dvector start_av, end_av;
-    std::vector<hrp::dvector> avs;
+    std::vector<int>& indices = m_targetPoseIndices;
     if (! m_seq->getJointGroup(gname, indices) ) {
         std::cerr << "[setTargetPose] Could not find joint group " << gname << std::endl;
         return false;
     }
-    start_av.resize(indices.size());
-    end_av.resize(indices.size());
 
     //std::cerr << std::endl;
     if ( ! m_robot->joint(indices[0])->parent ) {
@@ -612,33 +649,32 @@ bool SequencePlayer::setTargetPose(const char* gname, const double *xyz, const d
     string base_parent_name = m_robot->joint(indices[0])->parent->name;
     string target_name = m_robot->joint(indices[indices.size()-1])->name;
     // prepare joint path
-    hrp::JointPathExPtr manip = hrp::JointPathExPtr(new hrp::JointPathEx(m_robot, m_robot->link(base_parent_name), m_robot->link(target_name), dt, true, std::string(m_profile.instance_name)));
+    hrp::JointPathExPtr manip = hrp::JointPathExPtr(new hrp::JointPathEx(m_ikRobot, m_ikRobot->link(base_parent_name), m_ikRobot->link(target_name), dt, true, std::string(m_profile.instance_name)));
 
     // calc fk
-    for (unsigned int i=0; i<m_robot->numJoints(); i++){
-        hrp::Link *j = m_robot->joint(i);
+    for (unsigned int i=0; i<m_ikRobot->numJoints(); i++){
+        hrp::Link *j = m_ikRobot->joint(i);
         if (j) j->q = m_qRef.data.get_buffer()[i];
     }
-    m_robot->calcForwardKinematics();
-    for ( unsigned int i = 0; i < manip->numJoints(); i++ ){
-        start_av[i] = manip->joint(i)->q;
-    }
+    m_ikRobot->rootLink()->p = m_robot->rootLink()->p;
+    m_ikRobot->rootLink()->R = m_robot->rootLink()->R;
+    m_ikRobot->calcForwardKinematics();
 
     // xyz and rpy are relateive to root link, where as pos and rotatoin of manip->calcInverseKinematics are relative to base link
 
     // ik params
-    hrp::Vector3 start_p(m_robot->link(target_name)->p);
-    hrp::Matrix33 start_R(m_robot->link(target_name)->R);
+    hrp::Vector3 start_p(m_ikRobot->link(target_name)->p);
+    hrp::Matrix33 start_R(m_ikRobot->link(target_name)->R);
     hrp::Vector3 end_p(xyz[0], xyz[1], xyz[2]);
-    hrp::Matrix33 end_R = m_robot->link(target_name)->calcRfromAttitude(hrp::rotFromRpy(rpy[0], rpy[1], rpy[2]));
+    hrp::Matrix33 end_R = m_ikRobot->link(target_name)->calcRfromAttitude(hrp::rotFromRpy(rpy[0], rpy[1], rpy[2]));
 
     // change start and end must be relative to the frame_name
-    if ( (frame_name != NULL) && (! m_robot->link(frame_name) ) ) {
+    if ( (frame_name != NULL) && (! m_ikRobot->link(frame_name) ) ) {
         std::cerr << "[setTargetPose] Could not find frame_name " << frame_name << std::endl;
         return false;
     } else if ( frame_name != NULL ) {
-        hrp::Vector3 frame_p(m_robot->link(frame_name)->p);
-        hrp::Matrix33 frame_R(m_robot->link(frame_name)->attitude());
+        hrp::Vector3 frame_p(m_ikRobot->link(frame_name)->p);
+        hrp::Matrix33 frame_R(m_ikRobot->link(frame_name)->attitude());
         // fix start/end references from root to frame;
         end_p = frame_R * end_p + frame_p;
         end_R = frame_R * end_R;
@@ -649,61 +685,121 @@ bool SequencePlayer::setTargetPose(const char* gname, const double *xyz, const d
     std::cerr << "                Start\n" << start_p << "\n" << start_R<< std::endl;
     std::cerr << "                End\n" << end_p << "\n" << end_R<< std::endl;
 
-    // interpolate & calc ik
+    // initial step along the path, it is refined by m_targetPoseSampler
     int len = max(((start_p - end_p).norm() / 0.02 ), // 2cm
                   ((hrp::omegaFromRot(start_R.transpose() * end_R).norm()) / 0.025)); // 2 deg
     len = max(len, 1);
+    m_targetPoseSampler.setStep(1.0/len, 0.125/len, min(8.0/len, 1.0));
+    m_targetPoseSampler.init(manip, end_p, end_R);
+
+    m_targetPoseGroup = gname;
+    m_targetPoseDuration = tm;
+    m_targetPoseQ.clear();
+    m_targetPoseQ.reserve(2*len*indices.size());
+    m_targetPoseTm.clear();
+    m_targetPoseTm.reserve(2*len);
+    m_targetPoseCancel = false;
+    return true;
+}
 
-    std::vector<const double *> v_pos;
-    std::vector<double> v_tm;
-    v_pos.resize(len);
-    v_tm.resize(len);
-
-    // do loop
-    for (int i = 0; i < len; i++ ) {
-        double a = (1+i)/(double)len;
-        hrp::Vector3 p = (1-a)*start_p + a*end_p;
-        hrp::Vector3 omega = hrp::omegaFromRot(start_R.transpose() * end_R);
-        hrp::Matrix33 R = start_R * rodrigues(omega.isZero()?omega:omega.normalized(), a*omega.norm());
-        bool ret = manip->calcInverseKinematics2(p, R);
-
+bool SequencePlayer::solveTargetPose(bool i_async)
+{
+    size_t n = m_targetPoseIndices.size();
+    size_t played = 0; // number of waypoints passed to m_seq
+    double param = 0;
+    bool ret = true;
+    while (!m_targetPoseSampler.finished()) {
+        if ( !m_targetPoseSampler.next() ) {
+            std::cerr << "[setTargetPose] IK failed" << std::endl;
+            ret = false;
+            break;
+        }
+        const hrp::dvector& q = m_targetPoseSampler.q();
+        m_targetPoseQ.insert(m_targetPoseQ.end(), q.data(), q.data()+n);
+        m_targetPoseTm.push_back(m_targetPoseDuration*(m_targetPoseSampler.param() - param));
+        param = m_targetPoseSampler.param();
         if ( m_debugLevel > 0 ) {
-            // for debug
-            std::cerr << "target pos/rot : " << i << "/" << a << " : "
-                      << p[0] << " " << p[1] << " " << p[2] << ","
-                      << omega[0] << " " << omega[1] << " " << omega[2] << std::endl;
+            std::cerr << "target param : " << m_targetPoseTm.size()-1 << "/" << param << std::endl;
         }
-        if ( ! ret ) {
-            std::cerr << "[setTargetPose] IK failed" << std::endl;
-            return false;
+
+        if (!i_async) continue;
+        {
+            Guard guard(m_mutex);
+            if (m_targetPoseCancel) return false;
         }
-        v_pos[i] = (const double *)malloc(sizeof(double)*manip->numJoints());
-        for ( unsigned int j = 0; j < manip->numJoints(); j++ ){
-            ((double *)v_pos[i])[j] = manip->joint(j)->q;
+        // play the first waypoint as soon as it is solved, and then each
+        // waypoint as soon as the next one, which is needed to compute the
+        // velocity at it, is solved, so that the interpolator is fed while
+        // IK is running
+        size_t solved = m_targetPoseTm.size();
+        if (played == 0 && !m_targetPoseSampler.finished()) {
+            if (!playTargetPose(0, 1, true)) return false;
+            played = 1;
+        } else if (played > 0 && solved - 1 > played) {
+            if (!playTargetPose(played, solved-1, true)) return false;
+            played = solved - 1;
         }
-        v_tm[i] = tm/len;
     }
-
-    if ( m_debugLevel > 0 ) {
-        // for debug
-        for(int i = 0; i < len; i++ ) {
-            std::cerr << v_tm[i] << ":";
-            for(int j = 0; j < start_av.size(); j++ ) {
-                std::cerr << v_pos[i][j] << " ";
-            }
-            std::cerr << std::endl;
+    if (i_async) {
+        // the motion stops at the last waypoint solved even if IK fails
+        if (played < m_targetPoseTm.size()) {
+            playTargetPose(played, m_targetPoseTm.size(), false);
+        } else if (played > 0) {
+            // IK failed just after the first waypoint, stop there
+            Guard guard(m_mutex);
+            if (m_targetPoseCancel) return false;
+            m_targetPosePos.assign(1, &m_targetPoseQ[(played-1)*n]);
+            m_targetPoseTmSegment.assign(1, m_targetPoseTm[played-1]);
+            m_seq->playPatternOfGroup(m_targetPoseGroup.c_str(), m_targetPosePos, m_targetPoseTmSegment, m_qInit.data.get_buffer(), n, NULL);
         }
     }
+    return ret;
+}
 
-    if (!m_seq->resetJointGroup(gname, m_qInit.data.get_buffer())) return false; // reset sequencer
-    bool ret = m_seq->playPatternOfGroup(gname, v_pos, v_tm, m_qInit.data.get_buffer(), v_pos.size()>0?indices.size():0);
-
-    // clean up memory, need to improve
-    for (int i = 0; i < len; i++ ) {
-        free((double *)v_pos[i]);
+bool SequencePlayer::playTargetPose(size_t i_begin, size_t i_end, bool i_continued)
+{
+    Guard guard(m_mutex);
+    if (m_targetPoseCancel) return false;
+    size_t n = m_targetPoseIndices.size();
+    m_targetPosePos.resize(i_end - i_begin);
+    for (size_t i = i_begin; i < i_end; i++ ) {
+        m_targetPosePos[i - i_begin] = &m_targetPoseQ[i*n];
+    }
+    m_targetPoseTmSegment.assign(m_targetPoseTm.begin() + i_begin, m_targetPoseTm.begin() + i_end);
+    const double *qInit = m_qInit.data.get_buffer();
+    if (i_begin == 0) {
+        if (!m_seq->resetJointGroup(m_targetPoseGroup.c_str(), qInit)) return false; // reset sequencer
+    } else {
+        // the last waypoint already played in the full joint vector
+        m_targetPoseQInit.assign(qInit, qInit + m_qInit.data.length());
+        for (size_t j = 0; j < n; j++ ) {
+            m_targetPoseQInit[m_targetPoseIndices[j]] = m_targetPoseQ[(i_begin-1)*n+j];
+        }
+        qInit = &m_targetPoseQInit[0];
+    }
+    const double *qNext = NULL;
+    if (i_continued && i_end < m_targetPoseTm.size()) {
+        qNext = &m_targetPoseQ[i_end*n];
+    } else if (i_continued) {
+        // the next waypoint is not solved yet, extrapolate it so that
+        // the velocity at the last waypoint is the one toward it
+        m_targetPoseQNext.resize(n);
+        for (size_t j = 0; j < n; j++ ) {
+            double q_prev = i_end - 1 > i_begin ? m_targetPoseQ[(i_end-2)*n+j] : qInit[m_targetPoseIndices[j]];
+            m_targetPoseQNext[j] = 2*m_targetPoseQ[(i_end-1)*n+j] - q_prev;
+        }
+        qNext = &m_targetPoseQNext[0];
     }
+    return m_seq->playPatternOfGroup(m_targetPoseGroup.c_str(), m_targetPosePos, m_targetPoseTmSegment, qInit, m_targetPosePos.size()>0?n:0, qNext);
+}
 
-    return ret;
+void SequencePlayer::cancelTargetPose()
+{
+    {
+        Guard guard(m_mutex);
+        m_targetPoseCancel = true;
+    }
+    if (m_targetPoseThread.joinable()) m_targetPoseThread.join();
 }
 
 void SequencePlayer::loadPattern(const char *basename, double tm)
@@ -22,7 +22,9 @@
 #include <rtm/idl/ExtendedDataTypesSkel.h>
 #include <hrpModel/Body.h>
 #include <hrpModel/Sensor.h>
+#include <boost/thread.hpp>
 #include "seqplay.h"
+#include "TargetPoseSampler.h"
 
 // Service implementation headers
 // <rtc-template block="service_impl_h">
@@ -108,6 +110,7 @@ class SequencePlayer
   bool setBaseRpy(const double *rpy, double tm);
   bool setZmp(const double *zmp, double tm);
   bool setTargetPose(const char* gname, const double *xyz, const double *rpy, double tm, const char* frame_name);
+  bool setTargetPoseAsync(const char* gname, const double *xyz, const double *rpy, double tm, const char* frame_name);
   bool setWrenches(const double *wrenches, double tm);
   void loadPattern(const char *basename, double time); 
   void playPattern(const OpenHRP::dSequenceSequence& pos, const OpenHRP::dSequenceSequence& rpy, const OpenHRP::dSequenceSequence& zmp, const OpenHRP::dSequence& tm);
@@ -181,6 +184,11 @@ class SequencePlayer
   // </rtc-template>
 
  private:
+  bool setupTargetPose(const char* gname, const double *xyz, const double *rpy, double tm, const char* frame_name);
+  bool solveTargetPose(bool i_async);
+  bool playTargetPose(size_t i_begin, size_t i_end, bool i_continued);
+  void cancelTargetPose();
+
   seqplay *m_seq;
   bool m_clearFlag, m_waitFlag;
   sem_t m_waitSem;
@@ -195,6 +203,19 @@ class SequencePlayer
   hrp::Vector3 m_offsetP, m_fixedP;
   hrp::Matrix33 m_offsetR, m_fixedR;
   double m_timeToStartPlaying;
+  // setTargetPose, IK is solved on m_ikRobot which is a copy of m_robot
+  coil::Mutex m_ikMutex;
+  hrp::BodyPtr m_ikRobot;
+  TargetPoseSampler m_targetPoseSampler;
+  boost::thread m_targetPoseThread;
+  bool m_targetPoseCancel;
+  std::string m_targetPoseGroup;
+  std::vector<int> m_targetPoseIndices;
+  double m_targetPoseDuration;
+  std::vector<double> m_targetPoseQ; // waypoints, joint angles of the group
+  std::vector<double> m_targetPoseTm;
+  std::vector<const double *> m_targetPosePos;
+  std::vector<double> m_targetPoseTmSegment, m_targetPoseQInit, m_targetPoseQNext;
   int dummy;
 };
 
@@ -30,6 +30,7 @@ public:
   CORBA::Boolean setZmp(const dSequence& zmp, CORBA::Double tm);
   CORBA::Boolean setWrenches(const dSequence& wrenches, CORBA::Double tm);
   CORBA::Boolean setTargetPose(const char* gname, const dSequence& xyz, const dSequence& rpy, CORBA::Double tm);
+  CORBA::Boolean setTargetPoseAsync(const char* gname, const dSequence& xyz, const dSequence& rpy, CORBA::Double tm);
   CORBA::Boolean isEmpty();
   void loadPattern(const char* basename, CORBA::Double tm);
   void playPattern(const dSequenceSequence& pos, const dSequenceSequence& rpy, const dSequenceSequence& zmp, const dSequence& tm);
@@ -0,0 +1,115 @@
+#include <algorithm>
+#include <hrpUtil/Eigen3d.h>
+#include "TargetPoseSampler.h"
+
+TargetPoseSampler::TargetPoseSampler() :
+    m_angle(0), m_step(1), m_minStep(1), m_maxStep(1),
+    m_tolPos(0.002), m_tolRot(0.01), m_param(1), m_prevStep(0)
+{
+}
+
+void TargetPoseSampler::setStep(double i_step, double i_minStep, double i_maxStep)
+{
+    m_step = i_step;
+    m_minStep = i_minStep;
+    m_maxStep = i_maxStep;
+}
+
+void TargetPoseSampler::setTolerance(double i_pos, double i_rot)
+{
+    m_tolPos = i_pos;
+    m_tolRot = i_rot;
+}
+
+void TargetPoseSampler::init(hrp::JointPathExPtr i_manip,
+                             const hrp::Vector3& i_end_p,
+                             const hrp::Matrix33& i_end_R)
+{
+    m_manip = i_manip;
+    m_manip->calcForwardKinematics();
+    m_start_p = m_manip->endLink()->p;
+    m_start_R = m_manip->endLink()->R;
+    m_end_p = i_end_p;
+    hrp::Vector3 omega = hrp::omegaFromRot(m_start_R.transpose() * i_end_R);
+    m_angle = omega.norm();
+    m_axis = m_angle > 0 ? hrp::Vector3(omega/m_angle) : hrp::Vector3(hrp::Vector3::UnitZ());
+
+    int n = m_manip->numJoints();
+    m_q.resize(n);
+    m_qPrev.resize(n);
+    m_qNew.resize(n);
+    m_qMid.resize(n);
+    for (int i=0; i<n; i++) m_q[i] = m_manip->joint(i)->q;
+    m_qPrev = m_q;
+    m_param = 0;
+    m_prevStep = 0;
+}
+
+void TargetPoseSampler::target(double i_param, hrp::Vector3& o_p,
+                               hrp::Matrix33& o_R) const
+{
+    o_p = (1-i_param)*m_start_p + i_param*m_end_p;
+    o_R = m_start_R * hrp::rodrigues(m_axis, i_param*m_angle);
+}
+
+void TargetPoseSampler::setJointAngles(const hrp::dvector& i_q)
+{
+    for (unsigned int i=0; i<m_manip->numJoints(); i++){
+        m_manip->joint(i)->q = i_q[i];
+    }
+}
+
+bool TargetPoseSampler::next()
+{
+    if (finished()) return false;
+    hrp::Vector3 p;
+    hrp::Matrix33 R;
+    double step = std::min(m_step, 1.0 - m_param);
+    while (1){
+        double a = std::min(m_param + step, 1.0);
+        target(a, p, R);
+        // warm start from the previous solution extrapolated along the path
+        bool solved = false;
+        if (m_prevStep > 0){
+            m_qNew = m_q + (m_q - m_qPrev)*(step/m_prevStep);
+            setJointAngles(m_qNew);
+            solved = m_manip->calcInverseKinematics2(p, R);
+        }
+        if (!solved){
+            setJointAngles(m_q);
+            if (!m_manip->calcInverseKinematics2(p, R)) return false;
+        }
+        for (unsigned int i=0; i<m_manip->numJoints(); i++){
+            m_qNew[i] = m_manip->joint(i)->q;
+        }
+
+        // deviation from the path at the middle of the segment
+        m_qMid = (m_q + m_qNew)*0.5;
+        setJointAngles(m_qMid);
+        m_manip->calcForwardKinematics();
+        hrp::Vector3 mid_p;
+        hrp::Matrix33 mid_R;
+        target(m_param + (a - m_param)*0.5, mid_p, mid_R);
+        hrp::Link *end = m_manip->endLink();
+        double errPos = (end->p - mid_p).norm();
+        double errRot = hrp::omegaFromRot(mid_R.transpose()*end->R).norm();
+        bool tooFar = errPos > m_tolPos || errRot > m_tolRot;
+        if (tooFar && step > m_minStep){
+            step = std::max(step*0.5, m_minStep);
+            continue;
+        }
+
+        setJointAngles(m_qNew);
+        m_manip->calcForwardKinematics();
+        m_qPrev = m_q;
+        m_q = m_qNew;
+        m_prevStep = a - m_param;
+        m_param = a;
+        if (errPos < m_tolPos*0.25 && errRot < m_tolRot*0.25){
+            m_step = std::min(step*2, m_maxStep);
+        }else{
+            m_step = step;
+        }
+        return true;
+    }
+}
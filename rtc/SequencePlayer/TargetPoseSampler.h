@@ -0,0 +1,50 @@
+#ifndef __TARGET_POSE_SAMPLER_H__
+#define __TARGET_POSE_SAMPLER_H__
+
+#include <hrpUtil/EigenTypes.h>
+#include "../ImpedanceController/JointPathEx.h"
+
+/**
+   samples a straight path of the end link in Cartesian space and solves
+   IK at each waypoint, used by setTargetPose().
+
+   The step along the path is adapted so that the end link, while joint
+   angles are interpolated linearly between two waypoints, deviates from
+   the path by less than the given tolerances. The deviation is checked at
+   the middle of each segment; the step is halved while it is too large
+   and doubled again on parts where it is small. IK of a waypoint starts
+   from the previous solution extrapolated along the path.
+ */
+class TargetPoseSampler
+{
+public:
+    TargetPoseSampler();
+    // i_step is the initial step of the path parameter in (0, 1]
+    void setStep(double i_step, double i_minStep, double i_maxStep);
+    void setTolerance(double i_pos, double i_rot);
+    // joints of i_manip must be at the start posture
+    void init(hrp::JointPathExPtr i_manip,
+              const hrp::Vector3& i_end_p, const hrp::Matrix33& i_end_R);
+    // solve the next waypoint, false if IK fails
+    bool next();
+    bool finished() const { return m_param >= 1.0; }
+    // path parameter of the last waypoint in (0, 1]
+    double param() const { return m_param; }
+    // joint angles of the last waypoint
+    const hrp::dvector& q() const { return m_q; }
+private:
+    void target(double i_param, hrp::Vector3& o_p, hrp::Matrix33& o_R) const;
+    void setJointAngles(const hrp::dvector& i_q);
+
+    hrp::JointPathExPtr m_manip;
+    hrp::Vector3 m_start_p, m_end_p;
+    hrp::Matrix33 m_start_R;
+    hrp::Vector3 m_axis;
+    double m_angle;
+    double m_step, m_minStep, m_maxStep;
+    double m_tolPos, m_tolRot;
+    double m_param, m_prevStep;
+    hrp::dvector m_q, m_qPrev, m_qNew, m_qMid;
+};
+
+#endif
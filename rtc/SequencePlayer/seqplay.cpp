@@ -527,7 +527,7 @@ void seqplay::clearOfGroup(const char *gname, double i_timeLimit)
 	}
 }
 
-bool seqplay::playPatternOfGroup(const char *gname, std::vector<const double *> pos, std::vector<double> tm, const double *qInit, unsigned int len)
+bool seqplay::playPatternOfGroup(const char *gname, const std::vector<const double *>& pos, const std::vector<double>& tm, const double *qInit, unsigned int len, const double *qNext)
 {
 	char *s = (char *)gname; while(*s) {*s=toupper(*s);s++;}
 	groupInterpolator *i = groupInterpolators[gname];
@@ -557,14 +557,14 @@ bool seqplay::playPatternOfGroup(const char *gname, std::vector<const double *>
 		}
 		for (unsigned int l=0; l<pos.size(); l++){
 			q = pos[l];
-			if (l < pos.size() - 1 ) {
+			const double *q_next = l < pos.size() - 1 ? pos[l+1] : qNext;
+			if (q_next) {
 				double t0, t1;
 				if (tm.size() == pos.size()) {
-					t0 = tm[l]; t1 = tm[l+1];
+					t0 = tm[l]; t1 = l < pos.size() - 1 ? tm[l+1] : tm[l];
 				} else {
 					t0 = t1 = tm[0];
 				}
-				const double *q_next = pos[l+1];
 				const double *q_prev = l==0 ? qi : pos[l-1];
 				for (unsigned int j = 0; j < len; j++) {
 					double d0, d1, v0, v1;
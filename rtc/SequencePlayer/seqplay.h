@@ -33,7 +33,9 @@ public:
     bool removeJointGroup(const char *gname, double time=2.5);
     bool setJointAnglesOfGroup(const char *gname, const double* i_qRef, const size_t i_qsize, double i_tm=0.0);
     void clearOfGroup(const char *gname, double i_timeLimit);
-    bool playPatternOfGroup(const char *gname, std::vector<const double*> pos, std::vector<double> tm, const double *qInit, unsigned int len);
+    // qNext is the posture which will follow pos by another call. If it is
+    // given, the velocity at the last posture is not zero.
+    bool playPatternOfGroup(const char *gname, const std::vector<const double*>& pos, const std::vector<double>& tm, const double *qInit, unsigned int len, const double *qNext=NULL);
 
     bool resetJointGroup(const char *gname, const double *full);
     //
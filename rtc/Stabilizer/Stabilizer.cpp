@@ -11,6 +11,7 @@
 #include <hrpModel/Link.h>
 #include <hrpModel/Sensor.h>
 #include <hrpModel/ModelLoaderUtil.h>
+#include "hrpsys/util/ModelCache.h"
 #include "Stabilizer.h"
 #include "hrpsys/util/VectorConvert.h"
 #include <math.h>
@@ -187,12 +188,13 @@ RTC::ReturnCode_t Stabilizer::onInitialize()
 
   // parameters for internal robot model
   m_robot = hrp::BodyPtr(new hrp::Body());
-  if (!loadBodyFromModelLoader(m_robot, prop["model"].c_str(), 
-                               CosNaming::NamingContext::_duplicate(naming.getRootContext())
-                               )){
+  if (!loadBodyFromModelCache(m_robot, prop["model"].c_str(), 
+                              CosNaming::NamingContext::_duplicate(naming.getRootContext())
+                              )){
     std::cerr << "[" << m_profile.instance_name << "]failed to load model[" << prop["model"] << "]" << std::endl;
     return RTC::RTC_ERROR;
   }
+  m_kinematics.setBody(m_robot.get());
 
   // Setting for wrench data ports (real + virtual)
   std::vector<std::string> force_sensor_names;
@@ -294,6 +296,7 @@ RTC::ReturnCode_t Stabilizer::onInitialize()
       //
       stikp.push_back(ikp);
       jpe_v.push_back(hrp::JointPathExPtr(new hrp::JointPathEx(m_robot, m_robot->link(ee_base), m_robot->link(ee_target), dt, false, std::string(m_profile.instance_name))));
+      hrp::setAnalyticIKSolverFromProperties(*jpe_v.back(), ee_name, prop["analytic_ik"], prop["analytic_ik_plugins"], std::string(m_profile.instance_name));
       // Fix for toe joint
       if (ee_name.find("leg") != std::string::npos && jpe_v.back()->numJoints() == 7) { // leg and has 7dof joint (6dof leg +1dof toe)
           std::vector<double> optw;
@@ -808,13 +811,13 @@ void Stabilizer::getActualParameters ()
     }
     // tempolary
     m_robot->rootLink()->p = hrp::Vector3::Zero();
-    m_robot->calcForwardKinematics();
+    m_kinematics.calcForwardKinematics();
     hrp::Sensor* sen = m_robot->sensor<hrp::RateGyroSensor>("gyrometer");
     hrp::Matrix33 senR = sen->link->R * sen->localR;
     hrp::Matrix33 act_Rs(hrp::rotFromRpy(m_rpy.data.r, m_rpy.data.p, m_rpy.data.y));
     //hrp::Matrix33 act_Rs(hrp::rotFromRpy(m_rpy.data.r*0.5, m_rpy.data.p*0.5, m_rpy.data.y*0.5));
     m_robot->rootLink()->R = act_Rs * (senR.transpose() * m_robot->rootLink()->R);
-    m_robot->calcForwardKinematics();
+    m_kinematics.calcForwardKinematics();
     act_base_rpy = hrp::rpyFromRot(m_robot->rootLink()->R);
     calcFootOriginCoords (foot_origin_pos, foot_origin_rot);
   } else {
@@ -823,10 +826,10 @@ void Stabilizer::getActualParameters ()
     }
     m_robot->rootLink()->p = current_root_p;
     m_robot->rootLink()->R = current_root_R;
-    m_robot->calcForwardKinematics();
+    m_kinematics.calcForwardKinematics();
   }
   // cog
-  act_cog = m_robot->calcCM();
+  act_cog = m_kinematics.calcCM();
   // zmp
   on_ground = false;
   if (st_algorithm != OpenHRP::StabilizerService::TPCC) {
@@ -1148,7 +1151,7 @@ void Stabilizer::getActualParameters ()
     m_robot->rootLink()->p(0) = current_root_p(0);
     m_robot->rootLink()->p(1) = current_root_p(1);
     m_robot->rootLink()->R = current_root_R;
-    m_robot->calcForwardKinematics();
+    m_kinematics.calcForwardKinematics();
   }
   copy (ref_contact_states.begin(), ref_contact_states.end(), prev_ref_contact_states.begin());
   if (control_mode != MODE_ST) d_pos_z_root = 0.0;
@@ -1190,7 +1193,7 @@ void Stabilizer::getTargetParameters ()
   target_root_p = m_robot->rootLink()->p;
   target_root_R = hrp::rotFromRpy(m_baseRpy.data.r, m_baseRpy.data.p, m_baseRpy.data.y);
   m_robot->rootLink()->R = target_root_R;
-  m_robot->calcForwardKinematics();
+  m_kinematics.calcForwardKinematics();
   ref_zmp = m_robot->rootLink()->R * hrp::Vector3(m_zmpRef.data.x, m_zmpRef.data.y, m_zmpRef.data.z) + m_robot->rootLink()->p; // base frame -> world frame
   hrp::Vector3 foot_origin_pos;
   hrp::Matrix33 foot_origin_rot;
@@ -1201,7 +1204,7 @@ void Stabilizer::getTargetParameters ()
     prev_ref_zmp = ref_zmp;
     ref_zmp = tmp_ref_zmp;
   }
-  ref_cog = m_robot->calcCM();
+  ref_cog = m_kinematics.calcCM();
   ref_total_force = hrp::Vector3::Zero();
   ref_total_moment = hrp::Vector3::Zero(); // Total moment around reference ZMP tmp
   ref_total_foot_origin_moment = hrp::Vector3::Zero();
@@ -1452,7 +1455,7 @@ void Stabilizer::moveBasePosRotForBodyRPYControl ()
     rats::rotm3times(current_root_R, target_root_R, hrp::rotFromRpy(d_rpy[0], d_rpy[1], 0));
     m_robot->rootLink()->R = current_root_R;
     m_robot->rootLink()->p = target_root_p + target_root_R * rel_cog - current_root_R * rel_cog;
-    m_robot->calcForwardKinematics();
+    m_kinematics.calcForwardKinematics();
     current_base_rpy = hrp::rpyFromRot(m_robot->rootLink()->R);
     current_base_pos = m_robot->rootLink()->p;
     if ( DEBUGP || (is_root_rot_limit && loop%200==0) ) {
@@ -1504,7 +1507,7 @@ void Stabilizer::calcSwingSupportLimbGain ()
 void Stabilizer::calcTPCC() {
     // stabilizer loop
       // Choi's feedback law
-      hrp::Vector3 cog = m_robot->calcCM();
+      hrp::Vector3 cog = m_kinematics.calcCM();
       hrp::Vector3 newcog = hrp::Vector3::Zero();
       hrp::Vector3 dcog(ref_cog - act_cog);
       hrp::Vector3 dzmp(ref_zmp - act_zmp);
@@ -1531,11 +1534,11 @@ void Stabilizer::calcTPCC() {
           if (max_ik_loop_count < stikp[i].ik_loop_count) max_ik_loop_count = stikp[i].ik_loop_count;
       }
       for (size_t jj = 0; jj < max_ik_loop_count; jj++) {
-        hrp::Vector3 tmpcm = m_robot->calcCM();
+        hrp::Vector3 tmpcm = m_kinematics.calcCM();
         for (size_t i = 0; i < 2; i++) {
           m_robot->rootLink()->p(i) = m_robot->rootLink()->p(i) + 0.9 * (newcog(i) - tmpcm(i));
         }
-        m_robot->calcForwardKinematics();
+        m_kinematics.calcForwardKinematics();
         for (size_t i = 0; i < stikp.size(); i++) {
           if (is_ik_enable[i]) {
               jpe_v[i]->calcInverseKinematics2Loop(target_link_p[i], target_link_R[i], 1.0, stikp[i].avoid_gain, stikp[i].reference_gain, &qrefv, transition_smooth_gain);
@@ -1580,12 +1583,12 @@ void Stabilizer::calcEEForceMomentControl() {
           // Calc status
           m_robot->rootLink()->R = target_root_R;
           m_robot->rootLink()->p = target_root_p;
-          m_robot->calcForwardKinematics();
+          m_kinematics.calcForwardKinematics();
           hrp::Sensor* sen = m_robot->sensor<hrp::RateGyroSensor>("gyrometer");
           hrp::Matrix33 senR = sen->link->R * sen->localR;
           hrp::Matrix33 act_Rs(hrp::rotFromRpy(m_rpy.data.r, m_rpy.data.p, m_rpy.data.y));
           m_robot->rootLink()->R = act_Rs * (senR.transpose() * m_robot->rootLink()->R);
-          m_robot->calcForwardKinematics();
+          m_kinematics.calcForwardKinematics();
           hrp::Vector3 foot_origin_pos;
           hrp::Matrix33 foot_origin_rot;
           calcFootOriginCoords (foot_origin_pos, foot_origin_rot);
@@ -2569,7 +2572,7 @@ void Stabilizer::calcRUNST() {
     //set root
     m_robot->rootLink()->p = hrp::Vector3(0,0,0);
     //m_robot->rootLink()->R = hrp::rotFromRpy(m_rpyRef.data.r,m_rpyRef.data.p,m_rpyRef.data.y);
-    m_robot->calcForwardKinematics();
+    m_kinematics.calcForwardKinematics();
     hrp::Vector3 target_root_p = m_robot->rootLink()->p;
     hrp::Matrix33 target_root_R = m_robot->rootLink()->R;
     hrp::Vector3 target_foot_p[2];
@@ -2622,7 +2625,7 @@ void Stabilizer::calcRUNST() {
       if (DEBUGP2) {
         std::cerr << " rp " << root_p_s[0] << " " << root_p_s[1] << " " << root_p_s[2] << std::endl;
       }
-      m_robot->calcForwardKinematics();
+      m_kinematics.calcForwardKinematics();
       //
       hrp::Vector3 current_fm = (m_robot->link(target_name[0])->p + m_robot->link(target_name[1])->p)/2;
 
@@ -2743,7 +2746,7 @@ void Stabilizer::calcContactMatrix (hrp::dmatrix& tm, const std::vector<hrp::Vec
 
 void Stabilizer::calcTorque ()
 {
-  m_robot->calcForwardKinematics();
+  m_kinematics.calcForwardKinematics();
   // buffers for the unit vector method
   hrp::Vector3 root_w_x_v;
   hrp::Vector3 g(0, 0, 9.80665);
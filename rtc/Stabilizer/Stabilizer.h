@@ -27,6 +27,7 @@
 #include "TwoDofController.h"
 #include "ZMPDistributor.h"
 #include "../ImpedanceController/JointPathEx.h"
+#include "../ImpedanceController/IncrementalKinematics.h"
 #include "../ImpedanceController/RatsMatrix.h"
 #include "../TorqueFilter/IIRFilter.h"
 
@@ -283,6 +284,7 @@ class Stabilizer
   std::map<std::string, hrp::VirtualForceSensorParam> m_vfs;
   std::vector<hrp::JointPathExPtr> jpe_v;
   hrp::BodyPtr m_robot;
+  hrp::IncrementalKinematics m_kinematics;
   coil::Mutex m_mutex;
   unsigned int m_debugLevel;
   hrp::dvector transition_joint_q, qorg, qrefv;
@@ -16,6 +16,7 @@
 #include "hrpsys/idl/RobotHardwareService.hh"
 #include <rtm/CorbaNaming.h>
 #include <hrpModel/ModelLoaderUtil.h>
+#include "hrpsys/util/ModelCache.h"
 #include <hrpUtil/MatrixSolvers.h>
 
 // Module specification
@@ -100,8 +101,8 @@ RTC::ReturnCode_t ThermoEstimator::onInitialize()
   }
   nameServer = nameServer.substr(0, comPos);
   RTC::CorbaNaming naming(rtcManager.getORB(), nameServer.c_str());
-  if (!loadBodyFromModelLoader(m_robot, prop["model"].c_str(),
-                               CosNaming::NamingContext::_duplicate(naming.getRootContext())
+  if (!loadBodyFromModelCache(m_robot, prop["model"].c_str(),
+                              CosNaming::NamingContext::_duplicate(naming.getRootContext())
         )){
     std::cerr << "[" << m_profile.instance_name << "] failed to load model[" << prop["model"] << "]"
               << std::endl;
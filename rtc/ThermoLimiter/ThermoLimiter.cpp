@@ -10,6 +10,7 @@
 #include "ThermoLimiter.h"
 #include <rtm/CorbaNaming.h>
 #include <hrpModel/ModelLoaderUtil.h>
+#include "hrpsys/util/ModelCache.h"
 #include <hrpUtil/MatrixSolvers.h>
 #include <cmath>
 
@@ -94,8 +95,8 @@ RTC::ReturnCode_t ThermoLimiter::onInitialize()
   }
   nameServer = nameServer.substr(0, comPos);
   RTC::CorbaNaming naming(rtcManager.getORB(), nameServer.c_str());
-  if (!loadBodyFromModelLoader(m_robot, prop["model"].c_str(),
-                               CosNaming::NamingContext::_duplicate(naming.getRootContext())
+  if (!loadBodyFromModelCache(m_robot, prop["model"].c_str(),
+                              CosNaming::NamingContext::_duplicate(naming.getRootContext())
         )){
     std::cerr << "[" << m_profile.instance_name << "] failed to load model[" << prop["model"] << "]"
               << std::endl;
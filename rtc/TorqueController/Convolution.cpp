@@ -9,10 +9,9 @@
  */
 
 #include "Convolution.h"
-#include <vector>
+#include <cmath>
 
 Convolution::Convolution(double _dt, unsigned int _range) {
-  integrator = Integrator();
   setup(_dt, _range);
 }
 
@@ -22,7 +21,7 @@ Convolution::~Convolution(void) {
 void Convolution::reset(void) {
   f_buffer.clear();
   g_buffer.clear();
-  integrator.reset();
+  buffer_start = 0;
   buffer_size = 0;
   return;
 }
@@ -30,33 +29,108 @@ void Convolution::reset(void) {
 void Convolution::setup(double _dt, unsigned int _range) {
   dt = _dt;
   range = _range;
-  integrator.setup(_dt, 0); // integrator range is inf (if range of integrator > 0, integrator remove f(0)*g(t) first)
   reset();
+  // buffers never reallocate when range is defined
+  f_buffer.reserve(range);
+  g_buffer.reserve(range);
   return;
 }
 
 void Convolution::update (double _f, double _g) {
-  f_buffer.push_back(_f);
-  g_buffer.push_back(_g);
-  buffer_size++;
-  if (range > 0 && buffer_size > range) { // restrict buffer size
-    f_buffer.pop_front();
-    g_buffer.pop_front();
-    buffer_size--;
+  if (range > 0 && buffer_size == range) { // restrict buffer size, overwrite the oldest values
+    f_buffer[buffer_start] = _f;
+    g_buffer[buffer_start] = _g;
+    buffer_start = (buffer_start + 1) % range;
+  } else {
+    f_buffer.push_back(_f);
+    g_buffer.push_back(_g);
+    buffer_size++;
   }
   return;
 }
 
+double Convolution::f(unsigned int i) const {
+  return range > 0 ? f_buffer[(buffer_start + i) % range] : f_buffer[i];
+}
+
+double Convolution::g(unsigned int i) const {
+  return range > 0 ? g_buffer[(buffer_start + i) % range] : g_buffer[i];
+}
+
 double Convolution::calculate(void) {
-  // calc f(x) * g(t-x) buffer
-  std::vector<double> fg_buffer;
-  for (int i = 0; i < buffer_size; i++) {
-    fg_buffer.push_back(f_buffer[i] * g_buffer[(buffer_size -1) - i]);
+  // integrate f(x) * g(t-x) by trapezoidal rule in the same way as Integrator:
+  // (1/2 * fg(0) + sum(fg(i), 1, N-2) + 1/2 * fg(N-1)) * dt,
+  // only the first value is counted when N = 1
+  if (buffer_size == 0) {
+    return 0;
+  }
+  double first = f(0) * g(buffer_size - 1);
+  if (buffer_size == 1) {
+    return 0.5 * first * dt;
+  }
+  double sum = 0;
+  for (int i = 1; i < buffer_size - 1; i++) {
+    sum += f(i) * g((buffer_size - 1) - i);
+  }
+  double last = f(buffer_size - 1) * g(0);
+  return (0.5 * first + sum + 0.5 * last) * dt;
+}
+
+ExponentialConvolution::ExponentialConvolution(double _dt) {
+  setup(_dt);
+}
+
+ExponentialConvolution::~ExponentialConvolution(void) {
+}
+
+void ExponentialConvolution::reset(void) {
+  sums.assign(coeffs.size(), 0.0);
+  powers.assign(coeffs.size(), 1.0);
+  g_first = g_last = 0;
+  count = 0;
+}
+
+void ExponentialConvolution::setup(double _dt) {
+  dt = _dt;
+  coeffs.clear();
+  ratios.clear();
+  reset();
+}
+
+void ExponentialConvolution::addTerm(double _c, double _a) {
+  coeffs.push_back(_c);
+  ratios.push_back(std::exp(_a * dt));
+  reset();
+}
+
+void ExponentialConvolution::update(double _g) {
+  // S(n) = sum(r^k * g(n-1-k), k = 0, n-1) = r * S(n-1) + g(n-1)
+  for (size_t i = 0; i < coeffs.size(); i++) {
+    sums[i] = ratios[i] * sums[i] + _g;
+    if (count > 0) {
+      powers[i] *= ratios[i];
+    }
+  }
+  if (count == 0) {
+    g_first = _g;
+  }
+  g_last = _g;
+  count++;
+}
+
+double ExponentialConvolution::calculate(void) {
+  // trapezoidal rule, see Convolution::calculate
+  if (count == 0) {
+    return 0;
+  }
+  double f_first = 0, f_last = 0, sum = 0;
+  for (size_t i = 0; i < coeffs.size(); i++) {
+    f_first += coeffs[i];
+    f_last += coeffs[i] * powers[i];
+    sum += coeffs[i] * sums[i];
   }
-  // calc integration
-  integrator.reset();
-  for (int i = 0; i < buffer_size; i++) {
-    integrator.update(fg_buffer[i]);
+  if (count == 1) {
+    return 0.5 * f_first * g_last * dt;
   }
-  return integrator.calculate();
+  return (sum - 0.5 * f_first * g_last - 0.5 * f_last * g_first) * dt;
 }
@@ -13,6 +13,7 @@
 // </rtc-template>
 
 #include "../Stabilizer/Integrator.h"
+#include <vector>
 
 class Convolution {
 public:
@@ -24,12 +25,37 @@ public:
   void update(double _f, double _g);
   double calculate(void);
 private:
+  double f(unsigned int i) const; // i-th value from the oldest
+  double g(unsigned int i) const;
   double dt; // control cycle
   unsigned int range; // integration range (from t_now - range * dt to t_now [sec])
-  std::deque<double> f_buffer; // integration data buffer for f
-  std::deque<double> g_buffer; // integration data buffer for g
+  std::vector<double> f_buffer; // integration data buffer for f, ring buffer if range > 0
+  std::vector<double> g_buffer; // integration data buffer for g, ring buffer if range > 0
+  unsigned int buffer_start; // index of the oldest values if range > 0
   long long buffer_size; // buffer size of convolution values (f, g)
-  Integrator integrator; // convolution(f, g) = integrate(f(x)*g(t-x), x=0, x=t);
+};
+
+// Convolution whose f is a sum of exponential functions,
+//   f(t) = sum(c_i * exp(a_i * t))
+// convolution(f, g) is updated recursively and calculated in constant time.
+// The result is the same as Convolution with range = 0 updated by f(0), f(dt), f(2dt), ...
+class ExponentialConvolution {
+public:
+  ExponentialConvolution(double _dt = 0.005);
+  ~ExponentialConvolution(void);
+  void reset(void);
+  void setup(double _dt);
+  void addTerm(double _c, double _a); // add c * exp(a * t) to f
+  void update(double _g);
+  double calculate(void);
+private:
+  double dt; // control cycle
+  std::vector<double> coeffs; // c_i
+  std::vector<double> ratios; // exp(a_i * dt)
+  std::vector<double> sums; // sum(exp(a_i * k * dt) * g(t - k * dt), k = 0, n-1)
+  std::vector<double> powers; // exp(a_i * (n-1) * dt)
+  double g_first, g_last;
+  long long count; // number of updates
 };
 
 #endif // CONVOLUTION_H
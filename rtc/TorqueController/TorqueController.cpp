@@ -12,6 +12,7 @@
 
 #include <rtm/CorbaNaming.h>
 #include <hrpModel/ModelLoaderUtil.h>
+#include "hrpsys/util/ModelCache.h"
 #include <hrpUtil/MatrixSolvers.h>
 
 #include <map>
@@ -104,8 +105,8 @@ RTC::ReturnCode_t TorqueController::onInitialize()
   // set robot model
   m_robot = hrp::BodyPtr(new hrp::Body());
   std::cerr << prop["model"].c_str() << std::endl;
-  if (!loadBodyFromModelLoader(m_robot, prop["model"].c_str(),
-                               CosNaming::NamingContext::_duplicate(naming.getRootContext())
+  if (!loadBodyFromModelCache(m_robot, prop["model"].c_str(),
+                              CosNaming::NamingContext::_duplicate(naming.getRootContext())
         )){
     std::cerr << "[" << m_profile.instance_name << "] failed to load model[" << prop["model"] << "]"
               << std::endl;
@@ -222,6 +223,14 @@ RTC::ReturnCode_t TorqueController::onInitialize()
 
   // allocate memory for outPorts
   m_qRefOut.data.length(m_robot->numJoints());
+
+  // allocate memory used in every cycle
+  m_dq = hrp::dvector::Zero(m_robot->numJoints());
+  m_tauMax.resize(m_robot->numJoints());
+  m_tauMaxFromModel.resize(m_robot->numJoints());
+  for (unsigned int i = 0; i < m_robot->numJoints(); i++) {
+    m_tauMaxFromModel[i] = m_robot->joint(i)->climit * m_robot->joint(i)->gearRatio * m_robot->joint(i)->torqueConst;
+  }
   return RTC::RTC_OK;
 }
 
@@ -264,7 +273,7 @@ RTC::ReturnCode_t TorqueController::onExecute(RTC::UniqueId ec_id)
 { 
   m_loop++;
 
-  hrp::dvector dq(m_robot->numJoints());
+  hrp::dvector& dq = m_dq;
   
   // update port
   if (m_tauCurrentInIn.isNew()) {
@@ -367,17 +376,16 @@ RTC::ReturnCode_t TorqueController::onRateChanged(RTC::UniqueId ec_id)
 void TorqueController::executeTorqueControl(hrp::dvector &dq)
 {
   unsigned int numJoints = m_robot->numJoints();
-  hrp::dvector tauMax(numJoints);
+  hrp::dvector& tauMax = m_tauMax;
   dq.resize(numJoints);
 
   // determine tauMax
-  for(unsigned int i = 0; i < numJoints; i++) {
-    double tauMaxFromModel = m_robot->joint(i)->climit * m_robot->joint(i)->gearRatio * m_robot->joint(i)->torqueConst;
-    if ( m_tauMaxIn.data.length() ==  m_robot->numJoints() ) {
-      tauMax[i] = std::min(tauMaxFromModel, m_tauMaxIn.data[i]);
-    } else {
-      tauMax[i] = tauMaxFromModel;
+  if ( m_tauMaxIn.data.length() ==  m_robot->numJoints() ) {
+    for(unsigned int i = 0; i < numJoints; i++) {
+      tauMax[i] = std::min(m_tauMaxFromModel[i], m_tauMaxIn.data[i]);
     }
+  } else {
+    tauMax = m_tauMaxFromModel;
   }
 
   // execute torque control
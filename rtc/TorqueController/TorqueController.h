@@ -165,6 +165,7 @@ private:
   long long m_loop;
   hrp::BodyPtr m_robot;
   std::vector<MotorTorqueController> m_motorTorqueControllers;
+  hrp::dvector m_dq, m_tauMax, m_tauMaxFromModel; // preallocated not to allocate in every cycle
   coil::Mutex m_mutex;
   void executeTorqueControl(hrp::dvector &dq);
   void updateParam(double &val, double &val_new);
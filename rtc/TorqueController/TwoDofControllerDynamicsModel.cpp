@@ -17,11 +17,7 @@
 TwoDofControllerDynamicsModel::TwoDofControllerDynamicsModel() {
   param = TwoDofControllerDynamicsModel::TwoDofControllerDynamicsModelParam(); // use default constructor
   current_time = 0;
-  convolutions.clear();
-  exp_sinh.clear();
-  for (int i = 0; i < NUM_CONVOLUTION_TERM; i++) {
-    convolutions.push_back(Convolution(0.0, 0.0));
-  }
+  setupConvolutions(0);
   integrate_exp_sinh_current.setup(0.0, 0.0);
   error_prefix = ""; // inheritted from TwoDofControllerInterface
 }
@@ -29,11 +25,7 @@ TwoDofControllerDynamicsModel::TwoDofControllerDynamicsModel() {
 TwoDofControllerDynamicsModel::TwoDofControllerDynamicsModel(TwoDofControllerDynamicsModel::TwoDofControllerDynamicsModelParam &_param, unsigned int _range) {
   param.alpha = _param.alpha; param.beta = _param.beta; param.ki = _param.ki; param.tc = _param.tc; param.dt = _param.dt;
   current_time = 0;
-  convolutions.clear();
-  exp_sinh.clear();
-  for (int i = 0; i < NUM_CONVOLUTION_TERM; i++) {
-    convolutions.push_back(Convolution(_param.dt, _range));
-  }
+  setupConvolutions(_range);
   integrate_exp_sinh_current.setup(_param.dt, _range);
   error_prefix = ""; // inheritted from TwoDofControllerInterface  
 }
@@ -44,27 +36,53 @@ TwoDofControllerDynamicsModel::~TwoDofControllerDynamicsModel() {
 void TwoDofControllerDynamicsModel::setup() {
   param.alpha = 0; param.beta = 0; param.ki = 0; param.tc = 0; param.dt = 0;
   convolutions.clear();
-  exp_sinh.clear();
+  exp_convolutions.clear();
   integrate_exp_sinh_current.reset();
   reset();
 }
 
 void TwoDofControllerDynamicsModel::setup(TwoDofControllerDynamicsModel::TwoDofControllerDynamicsModelParam &_param, unsigned int _range) {
   param.alpha = _param.alpha; param.beta = _param.beta; param.ki = _param.ki; param.tc = _param.tc; param.dt = _param.dt;
-  convolutions.clear();
-  for (int i = 0; i < NUM_CONVOLUTION_TERM; i++) {
-    convolutions.push_back(Convolution(_param.dt, _range));
-  }
+  setupConvolutions(_range);
   integrate_exp_sinh_current.setup(_param.dt, _range);
   reset();
 }
 
+void TwoDofControllerDynamicsModel::setupConvolutions(unsigned int _range) {
+  convolutions.clear();
+  exp_convolutions.clear();
+  // exp(-alpha*t)*sinh(beta*t) = (exp(a1*t) - exp(a2*t)) / 2, a1 = beta - alpha, a2 = -(alpha + beta)
+  // and its integration by trapezoidal rule is also a sum of exponential functions unless exp(a*dt) = 1
+  double a[2] = {param.beta - param.alpha, -(param.alpha + param.beta)};
+  double c[2] = {0.5, -0.5};
+  double r[2] = {std::exp(a[0] * param.dt), std::exp(a[1] * param.dt)};
+  use_exp_convolution = (_range == 0 && param.dt && r[0] != 1.0 && r[1] != 1.0);
+  if (use_exp_convolution) {
+    exp_convolutions.resize(NUM_CONVOLUTION_TERM, ExponentialConvolution(param.dt));
+    double constant = 0;
+    for (int i = 0; i < 2; i++) {
+      exp_convolutions[0].addTerm(c[i], a[i]);
+      exp_convolutions[1].addTerm(c[i], a[i]);
+      // (0.5 * f(0) + sum(f(k), 1, n-1) + 0.5 * f(n)) * dt with f(k) = c * r^k and f(0) = 0
+      exp_convolutions[2].addTerm(param.dt * c[i] * (r[i] / (r[i] - 1) - 0.5), a[i]);
+      constant -= param.dt * c[i] / (r[i] - 1);
+    }
+    exp_convolutions[2].addTerm(constant, 0);
+  } else {
+    for (int i = 0; i < NUM_CONVOLUTION_TERM; i++) {
+      convolutions.push_back(Convolution(param.dt, _range));
+    }
+  }
+}
+
 void TwoDofControllerDynamicsModel::reset() {
   current_time = 0;
-  exp_sinh.clear();
   for (std::vector<Convolution>::iterator itr = convolutions.begin(); itr != convolutions.end(); ++itr) {
     (*itr).reset();
   }
+  for (std::vector<ExponentialConvolution>::iterator itr = exp_convolutions.begin(); itr != exp_convolutions.end(); ++itr) {
+    (*itr).reset();
+  }
   integrate_exp_sinh_current.reset();
 }
 
@@ -94,19 +112,31 @@ double TwoDofControllerDynamicsModel::update (double _x, double _xd) {
     return 0;
   }
   
-  // update exp(-a*t)*sinh(b*t) buffer
-  double exp_sinh_current = std::exp(-param.alpha * current_time) * std::sinh(param.beta * current_time);
-  exp_sinh.push_back(exp_sinh_current);
-  integrate_exp_sinh_current.update(exp_sinh_current);
-
   // update convolution
-  convolutions[0].update(exp_sinh_current, _x);
-  convolutions[1].update(exp_sinh_current, _xd - _x);
-  convolutions[2].update(integrate_exp_sinh_current.calculate(), _xd - _x);
+  double conv[NUM_CONVOLUTION_TERM];
+  if (use_exp_convolution) {
+    exp_convolutions[0].update(_x);
+    exp_convolutions[1].update(_xd - _x);
+    exp_convolutions[2].update(_xd - _x);
+    for (int i = 0; i < NUM_CONVOLUTION_TERM; i++) {
+      conv[i] = exp_convolutions[i].calculate();
+    }
+  } else {
+    // update exp(-a*t)*sinh(b*t)
+    double exp_sinh_current = std::exp(-param.alpha * current_time) * std::sinh(param.beta * current_time);
+    integrate_exp_sinh_current.update(exp_sinh_current);
+
+    convolutions[0].update(exp_sinh_current, _x);
+    convolutions[1].update(exp_sinh_current, _xd - _x);
+    convolutions[2].update(integrate_exp_sinh_current.calculate(), _xd - _x);
+    for (int i = 0; i < NUM_CONVOLUTION_TERM; i++) {
+      conv[i] = convolutions[i].calculate();
+    }
+  }
 
   // 2 dof controller
-  velocity = (1 / (param.tc * param.ki * param.beta)) * (-convolutions[0].calculate() + convolutions[1].calculate())
-    + (1 / (param.tc * param.tc * param.ki * param.beta)) * convolutions[2].calculate();
+  velocity = (1 / (param.tc * param.ki * param.beta)) * (-conv[0] + conv[1])
+    + (1 / (param.tc * param.tc * param.ki * param.beta)) * conv[2];
 
   current_time += param.dt;
   
@@ -48,8 +48,10 @@ private:
   TwoDofControllerDynamicsModelParam param;
   double current_time;
   Integrator integrate_exp_sinh_current;
-  std::vector<double> exp_sinh;
   std::vector<Convolution> convolutions;
+  std::vector<ExponentialConvolution> exp_convolutions; // used instead of convolutions if range = 0
+  bool use_exp_convolution;
+  void setupConvolutions(unsigned int _range);
 };
 
 #endif // TWO_DOF_CONTROLLER_DYNAMICS_MODEL_H
@@ -17,20 +17,14 @@
 TwoDofControllerPDModel::TwoDofControllerPDModel() {
   param = TwoDofControllerPDModel::TwoDofControllerPDModelParam(); // use default constructor
   current_time = 0;
-  convolutions.clear();
-  for (int i = 0; i < NUM_CONVOLUTION_TERM; i++) {
-    convolutions.push_back(Convolution(0.0, 0.0));
-  }
+  setupConvolutions(0);
   error_prefix = ""; // inheritted from TwoDofControllerInterface  
 }
 
 TwoDofControllerPDModel::TwoDofControllerPDModel(TwoDofControllerPDModel::TwoDofControllerPDModelParam &_param, unsigned int _range) {
   param.ke = _param.ke; param.kd = _param.kd; param.tc = _param.tc; param.dt = _param.dt;
   current_time = 0;
-  convolutions.clear();
-  for (int i = 0; i < NUM_CONVOLUTION_TERM; i++) {
-    convolutions.push_back(Convolution(_param.dt, _range));
-  }
+  setupConvolutions(_range);
   error_prefix = ""; // inheritted from TwoDofControllerInterface  
 }
 
@@ -40,16 +34,33 @@ TwoDofControllerPDModel::~TwoDofControllerPDModel() {
 void TwoDofControllerPDModel::setup() {
   param.ke = 0; param.kd = 0; param.tc = 0; param.dt = 0;
   convolutions.clear();
+  exp_convolutions.clear();
   reset();
 }
 
 void TwoDofControllerPDModel::setup(TwoDofControllerPDModel::TwoDofControllerPDModelParam &_param, unsigned int _range) {
   param.ke = _param.ke; param.kd = _param.kd; param.tc = _param.tc; param.dt = _param.dt;
+  setupConvolutions(_range);
+  reset();
+}
+
+void TwoDofControllerPDModel::setupConvolutions(unsigned int _range) {
   convolutions.clear();
-  for (int i = 0; i < NUM_CONVOLUTION_TERM; i++) {
-    convolutions.push_back(Convolution(_param.dt, _range));
+  exp_convolutions.clear();
+  // f(t) of all convolutions are exponential functions, they can be calculated recursively without range
+  use_exp_convolution = (_range == 0 && param.kd);
+  if (use_exp_convolution) {
+    double a = param.ke / param.kd;
+    exp_convolutions.resize(NUM_CONVOLUTION_TERM, ExponentialConvolution(param.dt));
+    exp_convolutions[0].addTerm(1, a); // exp(a * t)
+    exp_convolutions[1].addTerm(1, a); // exp(a * t)
+    exp_convolutions[2].addTerm(1, 0); // 1 - exp(a * t)
+    exp_convolutions[2].addTerm(-1, a);
+  } else {
+    for (int i = 0; i < NUM_CONVOLUTION_TERM; i++) {
+      convolutions.push_back(Convolution(param.dt, _range));
+    }
   }
-  reset();
 }
 
 bool TwoDofControllerPDModel::getParameter() {
@@ -69,6 +80,9 @@ void TwoDofControllerPDModel::reset() {
   for (std::vector<Convolution>::iterator itr = convolutions.begin(); itr != convolutions.end(); ++itr) {
     (*itr).reset();
   }
+  for (std::vector<ExponentialConvolution>::iterator itr = exp_convolutions.begin(); itr != exp_convolutions.end(); ++itr) {
+    (*itr).reset();
+  }
 }
 
 double TwoDofControllerPDModel::update (double _x, double _xd) {
@@ -84,13 +98,26 @@ double TwoDofControllerPDModel::update (double _x, double _xd) {
   }
 
   // update convolution
-  convolutions[0].update(std::exp((param.ke / param.kd) * current_time), _x);
-  convolutions[1].update(std::exp((param.ke / param.kd) * current_time), _xd - _x);
-  convolutions[2].update(1 - std::exp((param.ke / param.kd) * current_time), _xd - _x);
+  double conv[NUM_CONVOLUTION_TERM];
+  if (use_exp_convolution) {
+    exp_convolutions[0].update(_x);
+    exp_convolutions[1].update(_xd - _x);
+    exp_convolutions[2].update(_xd - _x);
+    for (int i = 0; i < NUM_CONVOLUTION_TERM; i++) {
+      conv[i] = exp_convolutions[i].calculate();
+    }
+  } else {
+    convolutions[0].update(std::exp((param.ke / param.kd) * current_time), _x);
+    convolutions[1].update(std::exp((param.ke / param.kd) * current_time), _xd - _x);
+    convolutions[2].update(1 - std::exp((param.ke / param.kd) * current_time), _xd - _x);
+    for (int i = 0; i < NUM_CONVOLUTION_TERM; i++) {
+      conv[i] = convolutions[i].calculate();
+    }
+  }
 
   // 2 dof controller
-  velocity = (1 / (param.tc * param.kd)) * (-convolutions[0].calculate() + convolutions[1].calculate())
-    - (1 / (param.tc * param.tc * param.ke)) * convolutions[2].calculate();
+  velocity = (1 / (param.tc * param.kd)) * (-conv[0] + conv[1])
+    - (1 / (param.tc * param.tc * param.ke)) * conv[2];
 
   current_time += param.dt;
   
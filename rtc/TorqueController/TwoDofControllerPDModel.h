@@ -46,6 +46,9 @@ private:
   TwoDofControllerPDModelParam param;
   double current_time;
   std::vector<Convolution> convolutions;
+  std::vector<ExponentialConvolution> exp_convolutions; // used instead of convolutions if range = 0
+  bool use_exp_convolution;
+  void setupConvolutions(unsigned int _range);
 };
 
 #endif // TWO_DOF_CONTROLLER_PDMODEL_H
@@ -1,11 +1,53 @@
 #include <iostream>
 #include <string>
 #include <stdlib.h>
+#include <sys/time.h>
+#include <vector>
+#include <cmath>
+#include <algorithm>
 #include "MotorTorqueController.h"
 
 #define ABS(x) (((x) < 0) ? (-(x)) : (x))
 
+// compare recursive convolution (range = 0) with windowed convolution whose window is never filled
+template <class T, class P>
+int compareConvolution (const std::string& name, P& param, int cycles, bool print_time) {
+  T recursive(param), windowed(param, cycles + 1);
+  double max_error = 0, recursive_tm = 0, windowed_tm = 0;
+  struct timeval t0, t1, t2;
+  for (int n = 0; n < cycles; n++) {
+    double x = std::sin(0.01 * n), xd = 1.0 + 0.1 * std::cos(0.03 * n);
+    gettimeofday(&t0, NULL);
+    double u = recursive.update(x, xd);
+    gettimeofday(&t1, NULL);
+    double u_windowed = windowed.update(x, xd);
+    gettimeofday(&t2, NULL);
+    recursive_tm += (t1.tv_sec - t0.tv_sec) * 1e6 + (t1.tv_usec - t0.tv_usec);
+    windowed_tm += (t2.tv_sec - t1.tv_sec) * 1e6 + (t2.tv_usec - t1.tv_usec);
+    max_error = std::max(max_error, ABS(u - u_windowed) / std::max(1e-3, ABS(u_windowed)));
+  }
+  std::cerr << "#" << name << ", cycles = " << cycles << std::endl;
+  if (print_time) {
+    std::cerr << "#  recursive : " << recursive_tm / cycles << "[us/cycle]" << std::endl;
+    std::cerr << "#  windowed  : " << windowed_tm / cycles << "[us/cycle]" << std::endl;
+  }
+  std::cerr << "#  max error : " << max_error << std::endl;
+  return (max_error < 1e-9) ? 0 : 1;
+}
+
 int main (int argc, char* argv[]) {
+  // --convolution checks recursive convolutions, --bench also prints their timings
+  if (argc >= 2 && (std::string(argv[1]) == "--convolution" || std::string(argv[1]) == "--bench")) {
+    bool print_time = std::string(argv[1]) == "--bench";
+    int cycles = (argc >= 3) ? atoi(argv[2]) : 10000;
+    TwoDofControllerPDModel::TwoDofControllerPDModelParam pd_param;
+    pd_param.ke = -2.0; pd_param.kd = 20.0; pd_param.tc = 0.05; pd_param.dt = 0.005;
+    int ret = compareConvolution<TwoDofControllerPDModel>("TwoDofControllerPDModel", pd_param, cycles, print_time);
+    TwoDofControllerDynamicsModel::TwoDofControllerDynamicsModelParam dynamics_param;
+    dynamics_param.alpha = 3.0; dynamics_param.beta = 2.0; dynamics_param.ki = 0.5; dynamics_param.tc = 0.05; dynamics_param.dt = 0.005;
+    ret |= compareConvolution<TwoDofControllerDynamicsModel>("TwoDofControllerDynamicsModel", dynamics_param, cycles, print_time);
+    return ret;
+  }
   double ke = 2.0, kd = 20.0, tc = 0.05, dt = 0.005;
   const int test_num = 2;
   MotorTorqueController *controller[test_num];
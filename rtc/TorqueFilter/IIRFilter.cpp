@@ -1,5 +1,6 @@
 #include "IIRFilter.h"
 #include <numeric>
+#include <algorithm>
 
 IIRFilter::IIRFilter(unsigned int dim, std::vector<double>& fb_coeffs, std::vector<double>& ff_coeffs, const std::string& error_prefix)
 {
@@ -130,3 +131,102 @@ double IIRFilter::passFilter(double input)
 
     return filtered;
 }
+
+MultiIIRFilter::MultiIIRFilter(const std::string& error_prefix) :
+    m_dimension(0), m_channels(0), m_head(0), m_initialized(false) {
+    m_error_prefix = error_prefix;
+}
+
+bool MultiIIRFilter::setParameter(int dim, std::vector<double>& A, std::vector<double>& B, unsigned int channels) {
+    // use IIRFilter to check and convert parameters
+    IIRFilter filter(m_error_prefix);
+    if (!filter.setParameter(dim, A, B)) {
+        return false;
+    }
+    std::vector<double> fb_coeffs, ff_coeffs;
+    filter.getParameter(dim, fb_coeffs, ff_coeffs);
+    for (size_t i = 1; i < fb_coeffs.size(); i++) {
+        fb_coeffs[i] = - fb_coeffs[i];
+    }
+    return setCoefficients(dim, fb_coeffs, ff_coeffs, channels);
+}
+
+bool MultiIIRFilter::setCoefficients(int dim, std::vector<double>& fb_coeffs, std::vector<double>& ff_coeffs, unsigned int channels) {
+    if (dim < 0 || fb_coeffs.size() != dim + 1 || ff_coeffs.size() != dim + 1) {
+        std::cout << "[" <<  m_error_prefix << "]" << "IIRFilter coefficients size error" << std::endl;
+        return false;
+    }
+    m_dimension = dim;
+    m_channels = channels;
+    m_fb_coefficients = fb_coeffs;
+    m_ff_coefficients = ff_coeffs;
+    m_previous_values.assign(dim * channels, 0.0);
+    m_feedback.resize(channels);
+    m_head = 0;
+    m_initialized = true;
+    return true;
+}
+
+void MultiIIRFilter::getParameter(int &dim, std::vector<double>& A, std::vector<double>& B)
+{
+    dim = m_dimension;
+    B = m_ff_coefficients;
+    A = m_fb_coefficients;
+    for (size_t i = 1; i < A.size(); i++) {
+        A[i] = - A[i];
+    }
+}
+
+void MultiIIRFilter::reset(double initial_input)
+{
+    double sum_ff_coeffs = std::accumulate(m_ff_coefficients.begin(), m_ff_coefficients.end(), 0.0);
+    std::fill(m_previous_values.begin(), m_previous_values.end(), initial_input / sum_ff_coeffs);
+}
+
+void MultiIIRFilter::reset(unsigned int channel, double initial_input)
+{
+    if (channel >= m_channels) return;
+    double sum_ff_coeffs = std::accumulate(m_ff_coefficients.begin(), m_ff_coefficients.end(), 0.0);
+    for (int i = 0; i < m_dimension; i++) {
+        m_previous_values[i * m_channels + channel] = initial_input / sum_ff_coeffs;
+    }
+}
+
+void MultiIIRFilter::passFilter(const double *input, double *output)
+{
+    // same as IIRFilter::passFilter, but each tap is applied to all channels
+    // at once and the oldest values are overwritten instead of shifting
+    if (! m_initialized) {
+        std::fill(output, output + m_channels, 0.0);
+        return;
+    }
+    const unsigned int n = m_channels;
+    double *feedback = m_channels ? &m_feedback[0] : NULL;
+    const double fb0 = m_fb_coefficients[0];
+    for (unsigned int j = 0; j < n; j++) {
+        feedback[j] = fb0 * input[j];
+    }
+    for (int i = 0; i < m_dimension; i++) {
+        const double c = m_fb_coefficients[i + 1];
+        const double *w = delayed(i);
+        for (unsigned int j = 0; j < n; j++) {
+            feedback[j] += c * w[j];
+        }
+    }
+    const double ff0 = m_ff_coefficients[0];
+    for (unsigned int j = 0; j < n; j++) {
+        output[j] = ff0 * feedback[j];
+    }
+    for (int i = 0; i < m_dimension; i++) {
+        const double c = m_ff_coefficients[i + 1];
+        const double *w = delayed(i);
+        for (unsigned int j = 0; j < n; j++) {
+            output[j] += c * w[j];
+        }
+    }
+    // update previous values, the oldest slot becomes the newest
+    if (m_dimension > 0) {
+        m_head = (m_head + m_dimension - 1) % m_dimension;
+        std::copy(feedback, feedback + n, delayed(0));
+    }
+}
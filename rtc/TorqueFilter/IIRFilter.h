@@ -91,6 +91,60 @@ private:
     std::string m_error_prefix;
 };
 
+/**
+   IIRFilter for several channels with the same coefficients.
+   Internal values of all channels are stored in one contiguous array
+   (delay-major, channel-contiguous) so that each tap is a single loop over
+   channels which compilers can vectorize. The result is the same as that of
+   one IIRFilter per channel.
+ */
+class MultiIIRFilter
+{
+public:
+    MultiIIRFilter(const std::string& error_prefix = "");
+    ~MultiIIRFilter() {};
+
+    /**
+       \brief Set parameters, see IIRFilter::setParameter
+       \param channels number of channels
+    */
+    bool setParameter(int dim, std::vector<double>& A, std::vector<double>& B, unsigned int channels);
+    /**
+       \brief Set coefficients directly as the obsolated constructor of IIRFilter
+    */
+    bool setCoefficients(int dim, std::vector<double>& fb_coeffs, std::vector<double>& ff_coeffs, unsigned int channels);
+    void getParameter(int &dim, std::vector<double>&A, std::vector<double>& B);
+    unsigned int channels() const { return m_channels; };
+
+    /**
+       \brief reset all channels
+    */
+    void reset(double initial_input = 0.0);
+    /**
+       \brief reset one channel
+    */
+    void reset(unsigned int channel, double initial_input);
+
+    /**
+       \brief passFilter
+       \param input array of channels() values
+       \param output array of channels() values, can be the same as input
+    */
+    void passFilter(const double *input, double *output);
+private:
+    double *delayed(int i) { return &m_previous_values[((m_head + i) % m_dimension) * m_channels]; };
+
+    int m_dimension;
+    unsigned int m_channels;
+    std::vector<double> m_fb_coefficients;
+    std::vector<double> m_ff_coefficients;
+    std::vector<double> m_previous_values; // w[n-1-i] of channel j is at (m_head + i) % dim * channels + j
+    std::vector<double> m_feedback;
+    int m_head;
+    bool m_initialized;
+    std::string m_error_prefix;
+};
+
 /**
    First order low pass filter
  */
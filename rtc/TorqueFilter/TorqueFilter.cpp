@@ -10,6 +10,7 @@
 #include "TorqueFilter.h"
 #include <rtm/CorbaNaming.h>
 #include <hrpModel/ModelLoaderUtil.h>
+#include "hrpsys/util/ModelCache.h"
 #include <hrpUtil/MatrixSolvers.h>
 
 #define DEBUGP ((m_debugLevel==1 && loop%200==0) || m_debugLevel > 1 )
@@ -103,8 +104,8 @@ RTC::ReturnCode_t TorqueFilter::onInitialize()
   }
   nameServer = nameServer.substr(0, comPos);
   RTC::CorbaNaming naming(rtcManager.getORB(), nameServer.c_str());
-  if (!loadBodyFromModelLoader(m_robot, prop["model"].c_str(),
-                               CosNaming::NamingContext::_duplicate(naming.getRootContext())
+  if (!loadBodyFromModelCache(m_robot, prop["model"].c_str(),
+                              CosNaming::NamingContext::_duplicate(naming.getRootContext())
         )){
     std::cerr << "[" << m_profile.instance_name << "] failed to load model[" << prop["model"] << "] in "
               << m_profile.instance_name << std::endl;
@@ -197,10 +198,11 @@ RTC::ReturnCode_t TorqueFilter::onInitialize()
     }
   }
   
-  // make filter instance
-  for(unsigned int i = 0; i < m_robot->numJoints(); i++){
-    m_filters.push_back(IIRFilter(filter_dim, fb_coeffs, ff_coeffs, std::string(m_profile.instance_name)));
-  }
+  // make filter instance, all joints are filtered at once
+  m_filter = MultiIIRFilter(std::string(m_profile.instance_name));
+  m_filter.setCoefficients(filter_dim, fb_coeffs, ff_coeffs, m_robot->numJoints());
+  m_g_joint_torque = hrp::dvector::Zero(m_robot->numJoints());
+  m_torque = hrp::dvector::Zero(m_robot->numJoints());
   
   return RTC::RTC_OK;
 }
@@ -260,8 +262,8 @@ RTC::ReturnCode_t TorqueFilter::onExecute(RTC::UniqueId ec_id)
 
   if (m_tauIn.data.length() ==  m_robot->numJoints()) {
     int num_joints = m_robot->numJoints();
-    hrp::dvector g_joint_torque(num_joints);
-    hrp::dvector torque(num_joints);
+    hrp::dvector& g_joint_torque = m_g_joint_torque;
+    hrp::dvector& torque = m_torque;
 
     if (m_qCurrent.data.length() ==  m_robot->numJoints()) {
       // reference robot model
@@ -303,11 +305,13 @@ RTC::ReturnCode_t TorqueFilter::onExecute(RTC::UniqueId ec_id)
       std::cerr << std::endl;
     }
 
+    // filter all joints at once
+    m_filter.passFilter(m_tauIn.data.get_buffer(), torque.data());
     for (int i = 0; i < num_joints; i++) {
       // torque calculation from electric current
       // torque[j] = m_tauIn.data[path->joint(j)->jointId] - joint_torque(j);
       // torque[j] = m_filters[path->joint(j)->jointId].executeFilter(m_tauIn.data[path->joint(j)->jointId]) - joint_torque(j); // use filtered tau
-      torque[i] = m_filters[i].executeFilter(m_tauIn.data[i]) - m_torque_offset[i];
+      torque[i] -= m_torque_offset[i];
 
       // torque calclation from error of joint angle
       // if ( m_error_to_torque_gain[path->joint(j)->jointId] == 0.0
@@ -148,7 +148,8 @@ class TorqueFilter
   hrp::BodyPtr m_robot;
   unsigned int m_debugLevel;
   std::vector<double> m_torque_offset;
-  std::vector<IIRFilter> m_filters;
+  MultiIIRFilter m_filter;
+  hrp::dvector m_g_joint_torque, m_torque;
   bool m_is_gravity_compensation;
 };
 
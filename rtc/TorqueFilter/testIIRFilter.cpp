@@ -4,6 +4,8 @@
 /* samples */
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/time.h>
+#include <algorithm>
 #include <iostream>
 #include <vector>
 #include <boost/shared_ptr.hpp>
@@ -169,19 +171,74 @@ template<> void testIIRFilter<double, IIRFilter >::fprintf_plot (FILE* gp_pos)
     fprintf(gp_pos, "plot '/tmp/plot-iirfilter.dat' using 1:2 with lines title 'input' lw 4, '/tmp/plot-iirfilter.dat' using 1:3 with lines title 'filtered' lw 3\n");
 };
 
+// compare MultiIIRFilter with IIRFilters of each channel
+int testMultiIIRFilter (const std::vector<std::string>& arg_strs)
+{
+    int channels = 40, cycles = 10000;
+    for (size_t i = 0; i < arg_strs.size(); ++ i) {
+        if ( arg_strs[i]== "--channels" ) {
+            if (++i < arg_strs.size()) channels = atoi(arg_strs[i].c_str());
+        } else if ( arg_strs[i]== "--cycles" ) {
+            if (++i < arg_strs.size()) cycles = atoi(arg_strs[i].c_str());
+        }
+    }
+    std::cerr << "[testIIRFilter] multi : channels = " << channels << ", cycles = " << cycles << std::endl;
+    int dim = 2;
+    std::vector<double> A(dim+1), B(dim+1);
+    A[0] = 1.000000000000000; A[1] = -1.717211834908084; A[2] = 0.752516181581809;
+    B[0] = 0.00882608666843131; B[1] = 0.01765217333686262; B[2] = 0.00882608666843131;
+    std::vector<IIRFilter> filters(channels);
+    MultiIIRFilter multi_filter;
+    multi_filter.setParameter(dim, A, B, channels);
+    for (int j = 0; j < channels; j++) {
+        filters[j].setParameter(dim, A, B);
+        filters[j].reset(0.1 * j);
+        multi_filter.reset(j, 0.1 * j);
+    }
+    std::vector<double> input(channels * cycles), output(channels * cycles), multi_output(channels * cycles);
+    for (size_t i = 0; i < input.size(); i++) {
+        input[i] = std::sin(0.01 * i) + (rand() / (double)RAND_MAX - 0.5);
+    }
+    struct timeval t0, t1, t2;
+    gettimeofday(&t0, NULL);
+    for (int n = 0; n < cycles; n++) {
+        for (int j = 0; j < channels; j++) {
+            output[n * channels + j] = filters[j].passFilter(input[n * channels + j]);
+        }
+    }
+    gettimeofday(&t1, NULL);
+    for (int n = 0; n < cycles; n++) {
+        multi_filter.passFilter(&input[n * channels], &multi_output[n * channels]);
+    }
+    gettimeofday(&t2, NULL);
+    double max_error = 0;
+    for (size_t i = 0; i < output.size(); i++) {
+        max_error = std::max(max_error, std::fabs(output[i] - multi_output[i]));
+    }
+    double single_tm = (t1.tv_sec - t0.tv_sec) * 1e6 + (t1.tv_usec - t0.tv_usec);
+    double multi_tm = (t2.tv_sec - t1.tv_sec) * 1e6 + (t2.tv_usec - t1.tv_usec);
+    std::cerr << "[testIIRFilter]   IIRFilter      : " << single_tm / cycles << "[us/cycle]" << std::endl;
+    std::cerr << "[testIIRFilter]   MultiIIRFilter : " << multi_tm / cycles << "[us/cycle]" << std::endl;
+    std::cerr << "[testIIRFilter]   max error : " << max_error << std::endl;
+    return (max_error < 1e-12) ? 0 : 1;
+};
+
 void print_usage ()
 {
     std::cerr << "Usage : testIIRFilter [mode] [test-name] [option]" << std::endl;
-    std::cerr << " [mode] should be: --double, --vector3" << std::endl;
+    std::cerr << " [mode] should be: --double, --vector3, --iir, --multi" << std::endl;
     std::cerr << " [test-name] should be:" << std::endl;
     std::cerr << "  --test0 : test" << std::endl;
     std::cerr << " [option] should be:" << std::endl;
+    std::cerr << "  --multi [--channels n] [--cycles n] : compare and benchmark MultiIIRFilter with IIRFilter" << std::endl;
 };
 
 int main(int argc, char* argv[])
 {
     int ret = 0;
-    if (argc >= 3) {
+    if (argc >= 2 && std::string(argv[1]) == "--multi") {
+        ret = testMultiIIRFilter(std::vector<std::string>(argv + 2, argv + argc));
+    } else if (argc >= 3) {
         if (std::string(argv[1]) == "--double") {
             testIIRFilter<double, FirstOrderLowPassFilter<double> > tiir;
             for (int i = 2; i < argc; ++ i) {
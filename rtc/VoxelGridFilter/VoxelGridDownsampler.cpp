@@ -0,0 +1,239 @@
+// -*- C++ -*-
+/*!
+ * @file  VoxelGridDownsampler.cpp
+ * @brief voxel grid filter for PointCloudTypes::PointCloud
+ * $Date$
+ *
+ * $Id$
+ */
+
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <boost/thread.hpp>
+#include <boost/thread/barrier.hpp>
+#include <boost/bind.hpp>
+#include "VoxelGridDownsampler.h"
+
+#define KEY_BITS 21
+#define KEY_BIAS (1 << (KEY_BITS - 1))
+#define KEY_MASK ((1 << KEY_BITS) - 1)
+
+VoxelGridDownsampler::VoxelGridDownsampler() :
+    m_numThreads(0), m_threads(1), m_numWorkers(1), m_workers(NULL),
+    m_barrier(NULL), m_stopWorkers(false), m_func(NULL)
+{
+}
+
+VoxelGridDownsampler::~VoxelGridDownsampler()
+{
+    setupWorkers(1);
+}
+
+void VoxelGridDownsampler::setNumThreads(unsigned int i_num)
+{
+    m_numThreads = i_num;
+}
+
+bool VoxelGridDownsampler::findFields(const PointCloudTypes::PointCloud& i_cloud)
+{
+    static const char *names[] = {"x", "y", "z", "r", "g", "b"};
+    for (int i=0; i<NUM_FIELDS; i++){
+        m_offsets[i] = -1;
+        for (unsigned int j=0; j<i_cloud.fields.length(); j++){
+            if (strcmp(i_cloud.fields[j].name, names[i]) == 0){
+                PointCloudTypes::DataType type = i < R ? PointCloudTypes::FLOAT32 : PointCloudTypes::UINT8;
+                if (i_cloud.fields[j].data_type == type){
+                    m_offsets[i] = i_cloud.fields[j].offset;
+                }
+                break;
+            }
+        }
+    }
+    if (m_offsets[X] < 0 || m_offsets[Y] < 0 || m_offsets[Z] < 0){
+        return false;
+    }
+    // colors are used only if all of them exist
+    if (m_offsets[R] < 0 || m_offsets[G] < 0 || m_offsets[B] < 0){
+        m_offsets[R] = m_offsets[G] = m_offsets[B] = -1;
+    }
+    return true;
+}
+
+bool VoxelGridDownsampler::filter(const PointCloudTypes::PointCloud& i_cloud,
+                                  double i_size,
+                                  PointCloudTypes::PointCloud& o_cloud)
+{
+    if (i_size <= 0 || i_cloud.is_bigendian || !findFields(i_cloud)){
+        std::cerr << "VoxelGridDownsampler: unsupported point cloud(type="
+                  << i_cloud.type << ") or leaf size(" << i_size << ")"
+                  << std::endl;
+        return false;
+    }
+    m_input = &i_cloud;
+    m_output = &o_cloud;
+    m_npoints = i_cloud.width*i_cloud.height;
+    m_size = i_size;
+
+    m_threads = m_numThreads ? m_numThreads : boost::thread::hardware_concurrency();
+    if (m_threads == 0) m_threads = 1;
+    setupWorkers(m_threads);
+    // small clouds are not worth threads
+    if (m_threads > m_npoints/1000 + 1) m_threads = m_npoints/1000 + 1;
+    if (m_maps.size() != m_threads){
+        m_maps.assign(m_threads, std::vector<VoxelMap>(m_threads));
+    }
+
+    run(&VoxelGridDownsampler::bin);
+    run(&VoxelGridDownsampler::merge);
+
+    m_outputIndices.resize(m_threads);
+    unsigned int nvoxels = 0;
+    for (unsigned int i=0; i<m_threads; i++){
+        m_outputIndices[i] = nvoxels;
+        nvoxels += m_maps[0][i].size();
+    }
+
+    o_cloud.tm = i_cloud.tm;
+    o_cloud.type = i_cloud.type;
+    o_cloud.fields = i_cloud.fields;
+    o_cloud.is_bigendian = false;
+    o_cloud.point_step = i_cloud.point_step;
+    o_cloud.height = 1;
+    o_cloud.width = nvoxels;
+    o_cloud.row_step = o_cloud.point_step*o_cloud.width;
+    o_cloud.data.length(o_cloud.height*o_cloud.row_step);
+    o_cloud.is_dense = true;
+
+    run(&VoxelGridDownsampler::write);
+
+    return true;
+}
+
+// workers are recreated only when the number of threads is changed
+void VoxelGridDownsampler::setupWorkers(unsigned int i_num)
+{
+    if (i_num == m_numWorkers) return;
+    if (m_workers){
+        m_stopWorkers = true;
+        m_barrier->wait();
+        m_workers->join_all();
+        delete m_workers;
+        delete m_barrier;
+        m_workers = NULL;
+        m_barrier = NULL;
+        m_stopWorkers = false;
+    }
+    m_numWorkers = i_num;
+    if (i_num > 1){
+        m_barrier = new boost::barrier(i_num);
+        m_workers = new boost::thread_group();
+        for (unsigned int i=1; i<i_num; i++){
+            m_workers->create_thread(
+                boost::bind(&VoxelGridDownsampler::workerMain, this, i));
+        }
+    }
+}
+
+void VoxelGridDownsampler::workerMain(unsigned int i_thread)
+{
+    while(1){
+        m_barrier->wait();
+        if (m_stopWorkers) break;
+        // small clouds use fewer threads than workers
+        if (i_thread < m_threads) (this->*m_func)(i_thread);
+        m_barrier->wait();
+    }
+}
+
+void VoxelGridDownsampler::run(void (VoxelGridDownsampler::*i_func)(unsigned int))
+{
+    if (m_threads <= 1){
+        (this->*i_func)(0);
+        return;
+    }
+    m_func = i_func;
+    m_barrier->wait();
+    (this->*i_func)(0);
+    m_barrier->wait();
+}
+
+void VoxelGridDownsampler::bin(unsigned int i_thread)
+{
+    std::vector<VoxelMap>& maps = m_maps[i_thread];
+    for (unsigned int i=0; i<maps.size(); i++) maps[i].clear();
+
+    const unsigned char *data = m_input->data.get_buffer();
+    unsigned int step = m_input->point_step;
+    unsigned int start = (unsigned long long)m_npoints*i_thread/m_threads;
+    unsigned int end = (unsigned long long)m_npoints*(i_thread+1)/m_threads;
+    for (unsigned int i=start; i<end; i++){
+        const unsigned char *point = data + i*step;
+        float x = *(const float *)(point + m_offsets[X]);
+        float y = *(const float *)(point + m_offsets[Y]);
+        float z = *(const float *)(point + m_offsets[Z]);
+        double ix = floor(x/m_size), iy = floor(y/m_size), iz = floor(z/m_size);
+        // this is also false for NaN
+        if (!(fabs(ix) < KEY_BIAS && fabs(iy) < KEY_BIAS && fabs(iz) < KEY_BIAS)){
+            continue;
+        }
+        boost::uint64_t key
+            = ((boost::uint64_t)(((long long)ix + KEY_BIAS) & KEY_MASK) << (2*KEY_BITS))
+            | ((boost::uint64_t)(((long long)iy + KEY_BIAS) & KEY_MASK) << KEY_BITS)
+            | ((boost::uint64_t)(((long long)iz + KEY_BIAS) & KEY_MASK));
+        unsigned int partition = ((key*0x9E3779B97F4A7C15ULL) >> 32) % m_threads;
+        Voxel& v = maps[partition][key];
+        if (v.n == 0){
+            v.x = v.y = v.z = 0;
+            v.r = v.g = v.b = 0;
+            v.first = i;
+        }
+        v.x += x; v.y += y; v.z += z;
+        if (m_offsets[R] >= 0){
+            v.r += point[m_offsets[R]];
+            v.g += point[m_offsets[G]];
+            v.b += point[m_offsets[B]];
+        }
+        v.n++;
+    }
+}
+
+void VoxelGridDownsampler::merge(unsigned int i_thread)
+{
+    // merge maps of this partition into the map of the first thread
+    VoxelMap& merged = m_maps[0][i_thread];
+    for (unsigned int i=1; i<m_threads; i++){
+        const VoxelMap& map = m_maps[i][i_thread];
+        for (VoxelMap::const_iterator it=map.begin(); it!=map.end(); it++){
+            std::pair<VoxelMap::iterator, bool> ret = merged.insert(*it);
+            if (ret.second) continue;
+            // the first point is in the earlier chunk
+            Voxel& v = ret.first->second;
+            v.x += it->second.x; v.y += it->second.y; v.z += it->second.z;
+            v.r += it->second.r; v.g += it->second.g; v.b += it->second.b;
+            v.n += it->second.n;
+        }
+    }
+}
+
+void VoxelGridDownsampler::write(unsigned int i_thread)
+{
+    const unsigned char *src = m_input->data.get_buffer();
+    unsigned char *dst = m_output->data.get_buffer()
+        + m_outputIndices[i_thread]*m_output->point_step;
+    unsigned int step = m_output->point_step;
+    const VoxelMap& map = m_maps[0][i_thread];
+    for (VoxelMap::const_iterator it=map.begin(); it!=map.end(); it++){
+        const Voxel& v = it->second;
+        memcpy(dst, src + (size_t)v.first*step, step);
+        *(float *)(dst + m_offsets[X]) = v.x/v.n;
+        *(float *)(dst + m_offsets[Y]) = v.y/v.n;
+        *(float *)(dst + m_offsets[Z]) = v.z/v.n;
+        if (m_offsets[R] >= 0){
+            dst[m_offsets[R]] = (v.r + v.n/2)/v.n;
+            dst[m_offsets[G]] = (v.g + v.n/2)/v.n;
+            dst[m_offsets[B]] = (v.b + v.n/2)/v.n;
+        }
+        dst += step;
+    }
+}
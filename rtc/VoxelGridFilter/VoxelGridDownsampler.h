@@ -0,0 +1,91 @@
+// -*- C++ -*-
+/*!
+ * @file  VoxelGridDownsampler.h
+ * @brief voxel grid filter for PointCloudTypes::PointCloud
+ * @date  $Date$
+ *
+ * $Id$
+ */
+
+#ifndef VOXEL_GRID_DOWNSAMPLER_H
+#define VOXEL_GRID_DOWNSAMPLER_H
+
+#include <vector>
+#include <boost/cstdint.hpp>
+#include <boost/unordered_map.hpp>
+#include "hrpsys/idl/pointcloud.hh"
+
+namespace boost{
+    class barrier;
+    class thread_group;
+}
+
+/**
+   \brief voxel grid filter which works directly on the data of
+   PointCloudTypes::PointCloud without converting it to PCL.
+
+   Points are split into chunks and binned into voxels with hash maps by
+   several threads, which are created once and reused for every cloud. Each thread keeps one map per partition of the voxel
+   keys so that partial maps of a partition can be merged by one thread
+   without locks. Every occupied voxel is replaced with the centroid of the
+   points in it, and colors are averaged if the cloud has r, g and b fields.
+   Other fields are copied from the first point in the voxel. Points whose
+   coordinates are not finite or more than 2^20 voxels away from the origin
+   are removed.
+ */
+class VoxelGridDownsampler
+{
+public:
+    VoxelGridDownsampler();
+    ~VoxelGridDownsampler();
+    /**
+       \brief set the number of threads
+       \param i_num number of threads, 0 means the number of hardware threads
+    */
+    void setNumThreads(unsigned int i_num);
+    /**
+       \brief downsample a point cloud
+       \param i_cloud input point cloud which has FLOAT32 x, y and z fields
+       \param i_size leaf size [m]
+       \param o_cloud output point cloud which has the same fields as i_cloud
+       \return false if fields of i_cloud are not supported
+    */
+    bool filter(const PointCloudTypes::PointCloud& i_cloud, double i_size,
+                PointCloudTypes::PointCloud& o_cloud);
+private:
+    struct Voxel {
+        double x, y, z;
+        unsigned int r, g, b;
+        unsigned int n;     // number of points
+        unsigned int first; // index of the first point
+    };
+    typedef boost::unordered_map<boost::uint64_t, Voxel> VoxelMap;
+    enum {X, Y, Z, R, G, B, NUM_FIELDS};
+
+    VoxelGridDownsampler(const VoxelGridDownsampler&);
+    VoxelGridDownsampler& operator=(const VoxelGridDownsampler&);
+    bool findFields(const PointCloudTypes::PointCloud& i_cloud);
+    void setupWorkers(unsigned int i_num);
+    void workerMain(unsigned int i_thread);
+    void run(void (VoxelGridDownsampler::*i_func)(unsigned int));
+    void bin(unsigned int i_thread);
+    void merge(unsigned int i_thread);
+    void write(unsigned int i_thread);
+
+    unsigned int m_numThreads, m_threads;
+    // m_numWorkers-1 threads wait on m_barrier with the caller of run()
+    unsigned int m_numWorkers;
+    boost::thread_group *m_workers;
+    boost::barrier *m_barrier;
+    bool m_stopWorkers;
+    void (VoxelGridDownsampler::*m_func)(unsigned int);
+    const PointCloudTypes::PointCloud *m_input;
+    PointCloudTypes::PointCloud *m_output;
+    unsigned int m_npoints;
+    double m_size;
+    int m_offsets[NUM_FIELDS]; // offsets of fields in a point, -1 if not exist
+    std::vector<std::vector<VoxelMap> > m_maps; // [thread][partition]
+    std::vector<unsigned int> m_outputIndices; // index of the first voxel of each partition in output
+};
+
+#endif // VOXEL_GRID_DOWNSAMPLER_H
@@ -30,6 +30,8 @@ static const char* spec[] =
     // Configuration variables
     "conf.default.size", "0.01",
     "conf.default.debugLevel", "0",
+    "conf.default.native", "0",
+    "conf.default.numThreads", "0",
 
     ""
   };
@@ -58,6 +60,8 @@ RTC::ReturnCode_t VoxelGridFilter::onInitialize()
   // Bind variables and configuration variable
   bindParameter("size", m_size, "0.01");
   bindParameter("debugLevel", m_debugLevel, "0");
+  bindParameter("native", m_native, "0");
+  bindParameter("numThreads", m_numThreads, "0");
   
   // </rtc-template>
 
@@ -151,6 +155,19 @@ RTC::ReturnCode_t VoxelGridFilter::onExecute(RTC::UniqueId ec_id)
         return RTC::RTC_OK;
     }
 
+    if (m_native){
+      // filter without PCL, fields of the original cloud are kept
+      m_downsampler.setNumThreads(m_numThreads);
+      if (m_downsampler.filter(m_original, m_size, m_filtered)){
+        if (m_debugLevel > 0){
+          std::cout << m_original.width*m_original.height << " points are reduced to "
+                    << m_filtered.width << " points" << std::endl;
+        }
+        m_filteredOut.write();
+      }
+      return RTC::RTC_OK;
+    }
+
     pcl::PointCloud<pcl::PointXYZ>::Ptr cloud (new pcl::PointCloud<pcl::PointXYZ>);
     pcl::PointCloud<pcl::PointXYZ>::Ptr cloud_filtered (new pcl::PointCloud<pcl::PointXYZ>);
 
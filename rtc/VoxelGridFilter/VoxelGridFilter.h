@@ -12,6 +12,7 @@
 
 #include <rtm/idl/BasicDataType.hh>
 #include "hrpsys/idl/pointcloud.hh"
+#include "VoxelGridDownsampler.h"
 #include <rtm/Manager.h>
 #include <rtm/DataFlowComponentBase.h>
 #include <rtm/CorbaPort.h>
@@ -137,6 +138,9 @@ class VoxelGridFilter
   int m_debugLevel;
   int dummy;
   double m_size;
+  int m_native;
+  unsigned int m_numThreads;
+  VoxelGridDownsampler m_downsampler;
 };
 
 
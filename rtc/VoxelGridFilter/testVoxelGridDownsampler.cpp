@@ -0,0 +1,97 @@
+#include <iostream>
+#include <map>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <sys/time.h>
+#include "VoxelGridDownsampler.h"
+
+// make a xyzrgb cloud of a noisy sphere with some NaN points
+void makeCloud(PointCloudTypes::PointCloud& cloud, unsigned int w, unsigned int h)
+{
+  cloud.width = w;
+  cloud.height = h;
+  cloud.type = "xyzrgb";
+  cloud.fields.length(6);
+  const char *names[] = {"x", "y", "z", "r", "g", "b"};
+  for (int i=0; i<6; i++){
+    cloud.fields[i].name = names[i];
+    cloud.fields[i].offset = i < 3 ? i*4 : 12 + (i-3);
+    cloud.fields[i].data_type = i < 3 ? PointCloudTypes::FLOAT32 : PointCloudTypes::UINT8;
+    cloud.fields[i].count = i < 3 ? 4 : 1;
+  }
+  cloud.is_bigendian = false;
+  cloud.point_step = 16;
+  cloud.row_step = cloud.point_step*w;
+  cloud.data.length(cloud.row_step*h);
+  cloud.is_dense = false;
+  unsigned char *data = cloud.data.get_buffer();
+  for (unsigned int i=0; i<w*h; i++){
+    float *p = (float *)(data + i*16);
+    double th = M_PI*(i/w)/h, ph = 2*M_PI*(i%w)/w;
+    double r = 1.0 + 0.01*(rand()/(double)RAND_MAX);
+    p[0] = r*sin(th)*cos(ph);
+    p[1] = r*sin(th)*sin(ph);
+    p[2] = r*cos(th) + 1.0;
+    if (i%97 == 0) p[0] = NAN;
+    data[i*16+12] = i%256;
+    data[i*16+13] = (i/7)%256;
+    data[i*16+14] = 100;
+  }
+}
+
+int main (int argc, char* argv[])
+{
+  unsigned int w = 640, h = 480;
+  double size = 0.02;
+  if (argc >= 3) { w = atoi(argv[1]); h = atoi(argv[2]); }
+  PointCloudTypes::PointCloud cloud, filtered;
+  makeCloud(cloud, w, h);
+
+  // reference: count points in each voxel
+  std::map<long long, int> counts;
+  const unsigned char *data = cloud.data.get_buffer();
+  for (unsigned int i=0; i<w*h; i++){
+    const float *p = (const float *)(data + i*16);
+    if (std::isnan(p[0])) continue;
+    long long key = ((long long)floor(p[0]/size) << 42) + ((long long)floor(p[1]/size) << 21) + (long long)floor(p[2]/size);
+    counts[key]++;
+  }
+
+  int ret = 0;
+  unsigned int threads[] = {1, 2, 4, 0};
+  for (int t=0; t<4; t++){
+    VoxelGridDownsampler vg;
+    vg.setNumThreads(threads[t]);
+    // threads are reused for the following frames
+    for (int frame=0; frame<3; frame++){
+      struct timeval t0, t1;
+      gettimeofday(&t0, NULL);
+      if (!vg.filter(cloud, size, filtered)) return 1;
+      gettimeofday(&t1, NULL);
+      // each voxel has one point and it is in the voxel
+      std::map<long long, int> found;
+      const unsigned char *fdata = filtered.data.get_buffer();
+      for (unsigned int i=0; i<filtered.width; i++){
+        const float *p = (const float *)(fdata + i*16);
+        long long key = ((long long)floor(p[0]/size) << 42) + ((long long)floor(p[1]/size) << 21) + (long long)floor(p[2]/size);
+        found[key]++;
+      }
+      bool ok = (filtered.width == counts.size() && found.size() == counts.size());
+      std::cerr << "threads = " << threads[t] << ", frame " << frame << ", "
+                << w*h << " -> " << filtered.width
+                << " points (expected " << counts.size() << "), "
+                << (t1.tv_sec - t0.tv_sec)*1e3 + (t1.tv_usec - t0.tv_usec)*1e-3 << "[ms]"
+                << (ok ? "" : " NG") << std::endl;
+      if (!ok) ret = 1;
+    }
+    // a small cloud uses only some of the threads
+    PointCloudTypes::PointCloud small;
+    makeCloud(small, 10, 10);
+    if (!vg.filter(small, size, filtered) || filtered.width == 0 || filtered.width > 100){
+      std::cerr << "threads = " << threads[t] << ", small cloud NG" << std::endl;
+      ret = 1;
+    }
+  }
+  return ret;
+}
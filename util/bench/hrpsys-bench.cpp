@@ -0,0 +1,473 @@
+/* -*- coding:utf-8-unix; mode:c++; -*- */
+/*
+  hrpsys-bench : micro benchmarks of controller kernels
+
+  Each kernel is called with the same fixed inputs in every run. The first
+  calls are discarded as warm-up, then the duration and the number of heap
+  allocations of each call are recorded. Results are printed as a table,
+  one kernel per line, and a saved table can be given to --compare of a
+  later run to detect regressions.
+*/
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cerrno>
+#include <time.h>
+#include "../../rtc/TorqueFilter/IIRFilter.h"
+#include "../../rtc/Stabilizer/TwoDofController.h"
+#include "../../rtc/Stabilizer/ZMPDistributor.h"
+#include "../../rtc/TorqueController/MotorTorqueController.h"
+#include "../../rtc/KalmanFilter/RPYKalmanFilter.h"
+#include "../../rtc/ImpedanceController/ImpedanceOutputGenerator.h"
+#include "../../rtc/AutoBalancer/GaitGenerator.h"
+
+// Heap allocations are counted by interposing malloc of glibc. operator
+// new and Eigen allocate through it, so both are counted. Aligned
+// allocations, which Eigen uses when it doesn't align by itself, are
+// interposed too.
+static unsigned long s_allocations = 0;
+#ifdef __GLIBC__
+extern "C" {
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t n, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void *__libc_memalign(size_t alignment, size_t size);
+extern void *__libc_valloc(size_t size);
+void *malloc(size_t size) { s_allocations++; return __libc_malloc(size); }
+void *calloc(size_t n, size_t size) { s_allocations++; return __libc_calloc(n, size); }
+void *realloc(void *ptr, size_t size) { s_allocations++; return __libc_realloc(ptr, size); }
+void *memalign(size_t alignment, size_t size) { s_allocations++; return __libc_memalign(alignment, size); }
+void *aligned_alloc(size_t alignment, size_t size) { s_allocations++; return __libc_memalign(alignment, size); }
+void *valloc(size_t size) { s_allocations++; return __libc_valloc(size); }
+int posix_memalign(void **ptr, size_t alignment, size_t size)
+{
+    if (alignment == 0 || alignment % sizeof(void *) || (alignment & (alignment - 1))) return EINVAL;
+    s_allocations++;
+    void *p = __libc_memalign(alignment, size);
+    if (!p) return ENOMEM;
+    *ptr = p;
+    return 0;
+}
+}
+#define COUNT_ALLOCATIONS
+#endif
+
+static inline long long now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec*1000000000LL + ts.tv_nsec;
+}
+
+class Kernel
+{
+public:
+    Kernel(const std::string& i_name) : m_name(i_name) {}
+    virtual ~Kernel() {}
+    const std::string& name() const { return m_name; }
+    // set up inputs of the i-th call, not measured
+    virtual void prepare(unsigned int i) {}
+    // one call of the kernel, outputs must be kept in members
+    virtual void run() = 0;
+private:
+    std::string m_name;
+};
+
+struct Result
+{
+    std::string name;
+    unsigned int iterations;
+    long long p50, p99, max; // [ns]
+    double mean;             // [ns]
+    double allocs;           // per call
+};
+
+static Result measure(Kernel& i_kernel, unsigned int i_warmup,
+                      unsigned int i_iterations,
+                      std::vector<long long>& o_samples)
+{
+    for (unsigned int i=0; i<i_warmup; i++){
+        i_kernel.prepare(i);
+        i_kernel.run();
+    }
+    o_samples.resize(i_iterations);
+    unsigned long allocs = 0;
+    for (unsigned int i=0; i<i_iterations; i++){
+        i_kernel.prepare(i_warmup + i);
+        unsigned long a = s_allocations;
+        long long t0 = now();
+        i_kernel.run();
+        long long t1 = now();
+        allocs += s_allocations - a;
+        o_samples[i] = t1 - t0;
+    }
+    Result r;
+    r.name = i_kernel.name();
+    r.iterations = i_iterations;
+    double sum = 0;
+    for (unsigned int i=0; i<i_iterations; i++) sum += o_samples[i];
+    std::sort(o_samples.begin(), o_samples.end());
+    r.p50 = o_samples[(i_iterations-1)*50/100];
+    r.p99 = o_samples[(i_iterations-1)*99/100];
+    r.max = o_samples[i_iterations-1];
+    r.mean = sum/i_iterations;
+#ifdef COUNT_ALLOCATIONS
+    r.allocs = (double)allocs/i_iterations;
+#else
+    r.allocs = -1;
+#endif
+    return r;
+}
+
+static void printResult(std::ostream& os, const Result& r)
+{
+    os << r.name << " " << r.iterations << " " << r.p50 << " " << r.p99
+       << " " << r.mean << " " << r.max << " " << r.allocs << std::endl;
+}
+
+static bool readResults(const std::string& i_fname,
+                        std::map<std::string, Result>& o_results)
+{
+    std::ifstream ifs(i_fname.c_str());
+    if (!ifs.is_open()){
+        std::cerr << "failed to open " << i_fname << std::endl;
+        return false;
+    }
+    std::string line;
+    while (std::getline(ifs, line)){
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream iss(line);
+        Result r;
+        if (iss >> r.name >> r.iterations >> r.p50 >> r.p99 >> r.mean >> r.max >> r.allocs){
+            o_results[r.name] = r;
+        }
+    }
+    return true;
+}
+
+//
+// kernels
+//
+
+// excitation of inputs, deterministic so that runs are comparable
+static inline double wave(unsigned int i, double i_freq, double i_amp)
+{
+    return i_amp*sin(2*M_PI*i_freq*i*0.004);
+}
+
+class NullKernel : public Kernel
+{
+public:
+    NullKernel() : Kernel("timer-overhead") {}
+    void run() {}
+};
+
+class IIRFilterKernel : public Kernel
+{
+public:
+    IIRFilterKernel() : Kernel("IIRFilter::passFilter"), m_x(0), m_y(0) {
+        m_filter.setParameterAsBiquad(25, 1/sqrt(2), 250);
+    }
+    void prepare(unsigned int i) { m_x = wave(i, 3, 1) + wave(i, 70, 0.1); }
+    void run() { m_y = m_filter.passFilter(m_x); }
+private:
+    IIRFilter m_filter;
+    double m_x, m_y;
+};
+
+class MultiIIRFilterKernel : public Kernel
+{
+public:
+    MultiIIRFilterKernel(unsigned int i_channels)
+        : Kernel("MultiIIRFilter::passFilter/" + toString(i_channels)),
+          m_x(i_channels), m_y(i_channels) {
+        IIRFilter filter;
+        filter.setParameterAsBiquad(25, 1/sqrt(2), 250);
+        int dim;
+        std::vector<double> A, B;
+        filter.getParameter(dim, A, B);
+        m_filter.setParameter(dim, A, B, i_channels);
+    }
+    void prepare(unsigned int i) {
+        for (size_t j=0; j<m_x.size(); j++) m_x[j] = wave(i, 1+j*0.1, 1);
+    }
+    void run() { m_filter.passFilter(&m_x[0], &m_y[0]); }
+    static std::string toString(unsigned int n) {
+        std::ostringstream oss;
+        oss << n;
+        return oss.str();
+    }
+private:
+    MultiIIRFilter m_filter;
+    std::vector<double> m_x, m_y;
+};
+
+class MotorTorqueControllerKernel : public Kernel
+{
+public:
+    MotorTorqueControllerKernel() : Kernel("MotorTorqueController::execute"),
+                                    m_tau(0), m_dq(0) {
+        TwoDofController::TwoDofControllerParam param;
+        param.ke = 2.0; param.tc = 0.05; param.dt = 0.005;
+        m_controller = new MotorTorqueController("bench", param);
+        m_controller->setReferenceTorque(10.0);
+        m_controller->activate();
+    }
+    ~MotorTorqueControllerKernel() { delete m_controller; }
+    void prepare(unsigned int i) { m_tau = 10.0 + wave(i, 2, 5); }
+    void run() { m_dq = m_controller->execute(m_tau, 90.0); }
+private:
+    MotorTorqueController *m_controller;
+    double m_tau, m_dq;
+};
+
+class RPYKalmanFilterKernel : public Kernel
+{
+public:
+    RPYKalmanFilterKernel() : Kernel("RPYKalmanFilter::main_one"),
+                              m_BtoS(hrp::Matrix33::Identity()) {
+        m_filter.setParam(0.004, 0.001, 0.003, 1.0, "bench");
+    }
+    void prepare(unsigned int i) {
+        m_acc = hrp::Vector3(wave(i, 0.5, 0.5), wave(i, 0.3, 0.5), 9.8);
+        m_gyro = hrp::Vector3(wave(i, 0.5, 0.1), wave(i, 0.3, 0.1), 0.01);
+    }
+    void run() {
+        m_filter.main_one(m_rpy, m_rpyRaw, m_baseRpy, m_acc, m_gyro, 0, m_BtoS);
+    }
+private:
+    RPYKalmanFilter m_filter;
+    hrp::Vector3 m_rpy, m_rpyRaw, m_baseRpy, m_acc, m_gyro;
+    hrp::Matrix33 m_BtoS;
+};
+
+class ImpedanceOutputGeneratorKernel : public Kernel
+{
+public:
+    ImpedanceOutputGeneratorKernel()
+        : Kernel("ImpedanceOutputGenerator::calcTargetVelocity"),
+          m_eeR(hrp::Matrix33::Identity()) {
+        m_gen.target_p0 = hrp::Vector3(0.3, -0.2, 0.8);
+        m_gen.resetPreviousTargetParam();
+        m_gen.current_p1 = m_gen.target_p0;
+        m_gen.resetPreviousCurrentParam();
+    }
+    void prepare(unsigned int i) {
+        // the end effector follows the output exactly
+        m_gen.current_p1 = m_gen.output_p1;
+        m_gen.current_r1 = m_gen.output_r1;
+        m_force = hrp::Vector3(wave(i, 0.5, 10), wave(i, 0.7, 10), wave(i, 0.2, 5));
+        m_moment = hrp::Vector3(wave(i, 0.3, 1), wave(i, 0.6, 1), 0);
+    }
+    void run() {
+        m_gen.calcTargetVelocity(m_velP, m_velR, m_eeR, m_force, m_moment, 0.004);
+    }
+private:
+    ImpedanceOutputGenerator m_gen;
+    hrp::Matrix33 m_eeR;
+    hrp::Vector3 m_force, m_moment, m_velP, m_velR;
+};
+
+class PreviewControllerKernel : public Kernel
+{
+public:
+    PreviewControllerKernel()
+        : Kernel("preview_dynamics_filter::update"),
+          m_df(0.004, 0.8, hrp::Vector3::Zero()) {}
+    void prepare(unsigned int i) {
+        // alternate support legs every 0.8[s]
+        m_refzmp = hrp::Vector3(0.001*(i/200), (i/200)%2 ? 0.1 : -0.1, 0);
+    }
+    void run() { m_df.update(m_p, m_x, m_qdata, m_refzmp, m_qdata, true); }
+private:
+    rats::preview_dynamics_filter<rats::extended_preview_control> m_df;
+    hrp::Vector3 m_p, m_x, m_refzmp;
+    std::vector<hrp::Vector3> m_qdata;
+};
+
+class GaitGeneratorKernel : public Kernel
+{
+public:
+    GaitGeneratorKernel() : Kernel("gait_generator::proc_one_tick"),
+                            m_walking(false) {
+        m_cog = 1e-3*hrp::Vector3(6.785, 1.54359, 806.831);
+        m_legPos.push_back(hrp::Vector3(0, -0.105, 0)); // rleg
+        m_legPos.push_back(hrp::Vector3(0,  0.105, 0)); // lleg
+        std::vector<std::string> limbs;
+        limbs.push_back("rleg");
+        limbs.push_back("lleg");
+        m_gg = new rats::gait_generator(0.004, m_legPos, limbs, 0.15, 0.05, 10, 0.05, 0.025, 5);
+    }
+    ~GaitGeneratorKernel() {
+        // interpolators can't be cleared while they are moving
+        while (m_walking) m_walking = m_gg->proc_one_tick();
+        delete m_gg;
+    }
+    void prepare(unsigned int i) {
+        if (m_walking) return;
+        // walk the same way again when the previous walk finished
+        rats::coordinates rleg(m_legPos[0]), lleg(m_legPos[1]), start;
+        rats::mid_coords(start, 0.5, rleg, lleg);
+        m_gg->clear_footstep_nodes_list();
+        m_gg->go_pos_param_2_footstep_nodes_list(0.2, 0.1, 20, std::vector<rats::coordinates>(1, rleg), start, std::vector<rats::leg_type>(1, rats::RLEG));
+        rats::step_node rstep(rats::RLEG, rleg, 0, 0, 0, 0);
+        rats::step_node lstep(rats::LLEG, lleg, 0, 0, 0, 0);
+        bool rfront = m_gg->get_footstep_front_leg_names() == std::vector<std::string>(1, "rleg");
+        m_gg->initialize_gait_parameter(m_cog,
+                                        std::vector<rats::step_node>(1, rfront ? lstep : rstep),
+                                        std::vector<rats::step_node>(1, rfront ? rstep : lstep));
+        while (!m_gg->proc_one_tick());
+        m_walking = true;
+    }
+    void run() { m_walking = m_gg->proc_one_tick(); }
+private:
+    rats::gait_generator *m_gg;
+    std::vector<hrp::Vector3> m_legPos;
+    hrp::Vector3 m_cog;
+    bool m_walking;
+};
+
+class ZMPDistributorKernel : public Kernel
+{
+public:
+    ZMPDistributorKernel(bool i_pinv)
+        : Kernel(i_pinv ? "SimpleZMPDistributor::distributeZMPToForceMomentsPseudoInverse" : "SimpleZMPDistributor::distributeZMPToForceMoments"),
+          m_pinv(i_pinv), m_szd(0.004),
+          m_force(2, hrp::Vector3::Zero()), m_moment(2, hrp::Vector3::Zero()),
+          m_eeRot(2, hrp::Matrix33::Identity()),
+          m_limbGains(2, 1.0), m_toeheelRatio(2, 1.0) {
+        m_szd.set_leg_inside_margin(0.07);
+        m_szd.set_leg_outside_margin(0.07);
+        m_szd.set_leg_front_margin(0.13);
+        m_szd.set_leg_rear_margin(0.1);
+        m_szd.set_vertices_from_margin_params();
+        m_eePos.push_back(hrp::Vector3(0, -0.1, 0));
+        m_eePos.push_back(hrp::Vector3(0,  0.1, 0));
+        m_copPos = m_eePos;
+        m_eeName.push_back("rleg");
+        m_eeName.push_back("lleg");
+    }
+    void prepare(unsigned int i) {
+        m_refzmp = hrp::Vector3(wave(i, 0.3, 0.02), wave(i, 0.6, 0.08), 0);
+    }
+    void run() {
+        if (m_pinv){
+            m_szd.distributeZMPToForceMomentsPseudoInverse(m_force, m_moment, m_eePos, m_copPos, m_eeRot, m_eeName, m_limbGains, m_toeheelRatio, m_refzmp, m_refzmp, 600, 0.004, false);
+        }else{
+            m_szd.distributeZMPToForceMoments(m_force, m_moment, m_eePos, m_copPos, m_eeRot, m_eeName, m_limbGains, m_toeheelRatio, m_refzmp, m_refzmp, 600, 0.004, false);
+        }
+    }
+private:
+    bool m_pinv;
+    SimpleZMPDistributor m_szd;
+    std::vector<hrp::Vector3> m_force, m_moment, m_eePos, m_copPos;
+    std::vector<hrp::Matrix33> m_eeRot;
+    std::vector<std::string> m_eeName;
+    std::vector<double> m_limbGains, m_toeheelRatio;
+    hrp::Vector3 m_refzmp;
+};
+
+void print_usage ()
+{
+    std::cerr << "Usage : hrpsys-bench [option]" << std::endl;
+    std::cerr << " [option] should be:" << std::endl;
+    std::cerr << "  --iterations N : number of measured calls of each kernel (default 100000)" << std::endl;
+    std::cerr << "  --warmup N : number of calls before measurement (default 1000)" << std::endl;
+    std::cerr << "  --filter str : run kernels whose names contain str" << std::endl;
+    std::cerr << "  --output file : write results to file as well" << std::endl;
+    std::cerr << "  --compare file : compare with results written by --output" << std::endl;
+    std::cerr << "  --threshold r : p50 ratio regarded as a regression (default 1.2)" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    unsigned int iterations = 100000, warmup = 1000;
+    double threshold = 1.2;
+    std::string filter, output, baseline;
+    for (int i = 1; i < argc; i++) {
+        std::string arg(argv[i]);
+        if (arg == "--iterations" && ++i < argc) {
+            iterations = atoi(argv[i]);
+        } else if (arg == "--warmup" && ++i < argc) {
+            warmup = atoi(argv[i]);
+        } else if (arg == "--filter" && ++i < argc) {
+            filter = argv[i];
+        } else if (arg == "--output" && ++i < argc) {
+            output = argv[i];
+        } else if (arg == "--compare" && ++i < argc) {
+            baseline = argv[i];
+        } else if (arg == "--threshold" && ++i < argc) {
+            threshold = atof(argv[i]);
+        } else {
+            print_usage();
+            return 1;
+        }
+    }
+    if (iterations == 0) {
+        print_usage();
+        return 1;
+    }
+
+    std::vector<Kernel *> kernels;
+    kernels.push_back(new NullKernel());
+    kernels.push_back(new IIRFilterKernel());
+    kernels.push_back(new MultiIIRFilterKernel(40));
+    kernels.push_back(new MotorTorqueControllerKernel());
+    kernels.push_back(new RPYKalmanFilterKernel());
+    kernels.push_back(new ImpedanceOutputGeneratorKernel());
+    kernels.push_back(new PreviewControllerKernel());
+    kernels.push_back(new GaitGeneratorKernel());
+    kernels.push_back(new ZMPDistributorKernel(false));
+    kernels.push_back(new ZMPDistributorKernel(true));
+
+    std::ostringstream oss;
+    oss << "# hrpsys-bench iterations " << iterations << " warmup " << warmup << std::endl;
+    oss << "# name iterations p50[ns] p99[ns] mean[ns] max[ns] allocs/call" << std::endl;
+    std::cout << oss.str() << std::flush;
+    std::vector<Result> results;
+    std::vector<long long> samples;
+    for (size_t i = 0; i < kernels.size(); i++) {
+        if (!filter.empty() && kernels[i]->name().find(filter) == std::string::npos) continue;
+        results.push_back(measure(*kernels[i], warmup, iterations, samples));
+        printResult(std::cout, results.back());
+        printResult(oss, results.back());
+    }
+    for (size_t i = 0; i < kernels.size(); i++) delete kernels[i];
+
+    if (!output.empty()) {
+        std::ofstream ofs(output.c_str());
+        if (!ofs.is_open()) {
+            std::cerr << "failed to open " << output << std::endl;
+            return 1;
+        }
+        ofs << oss.str();
+    }
+
+    int ret = 0;
+    if (!baseline.empty()) {
+        std::map<std::string, Result> base;
+        if (!readResults(baseline, base)) return 1;
+        std::cout << "# compared with " << baseline << ", threshold " << threshold << std::endl;
+        std::cout << "# name p50_ratio p99_ratio allocs/call(baseline) allocs/call" << std::endl;
+        for (size_t i = 0; i < results.size(); i++) {
+            const Result& r = results[i];
+            std::map<std::string, Result>::iterator it = base.find(r.name);
+            if (it == base.end() || r.name == "timer-overhead") continue;
+            const Result& b = it->second;
+            double p50_ratio = (double)r.p50/std::max(b.p50, 1LL);
+            double p99_ratio = (double)r.p99/std::max(b.p99, 1LL);
+            bool regressed = p50_ratio > threshold || r.allocs > b.allocs;
+            std::cout << r.name << " " << p50_ratio << " " << p99_ratio << " "
+                      << b.allocs << " " << r.allocs
+                      << (regressed ? " REGRESSION" : "") << std::endl;
+            if (regressed) ret = 2;
+        }
+    }
+    return ret;
+}
@@ -0,0 +1,311 @@
+#include <cstdlib>
+#include <sstream>
+#include <iomanip>
+#include "LogReplayer.h"
+
+using namespace RTC;
+
+static const char* logreplayer_spec[] =
+{
+    "implementation_id", "LogReplayer",
+    "type_name",         "LogReplayer",
+    "description",       "log replayer component",
+    "version",           HRPSYS_PACKAGE_VERSION,
+    "vendor",            "AIST",
+    "category",          "example",
+    "activity_type",     "DataFlowComponent",
+    "max_instance",      "1",
+    "language",          "C++",
+    "lang_type",         "compile",
+    ""
+};
+
+// values can be nan or inf
+static bool readValue(std::istream& is, double& v)
+{
+    std::string str;
+    if (!(is >> str)) return false;
+    v = strtod(str.c_str(), NULL);
+    return true;
+}
+
+// data of a line in the format of printData() in DataLogger.cpp
+
+template <class T>
+bool readData(std::istream& is, T& data)
+{
+    std::vector<double> values;
+    double v;
+    while (readValue(is, v)) values.push_back(v);
+    data.length(values.size());
+    for (unsigned int j=0; j<values.size(); j++){
+        data[j] = values[j];
+    }
+    return true;
+}
+
+bool readData(std::istream& is, RTC::Acceleration3D& data)
+{
+    return readValue(is, data.ax) && readValue(is, data.ay) && readValue(is, data.az);
+}
+
+bool readData(std::istream& is, RTC::AngularVelocity3D& data)
+{
+    return readValue(is, data.avx) && readValue(is, data.avy) && readValue(is, data.avz);
+}
+
+bool readData(std::istream& is, RTC::Point3D& data)
+{
+    return readValue(is, data.x) && readValue(is, data.y) && readValue(is, data.z);
+}
+
+bool readData(std::istream& is, RTC::Vector3D& data)
+{
+    return readValue(is, data.x) && readValue(is, data.y) && readValue(is, data.z);
+}
+
+bool readData(std::istream& is, RTC::Orientation3D& data)
+{
+    return readValue(is, data.r) && readValue(is, data.p) && readValue(is, data.y);
+}
+
+bool readData(std::istream& is, RTC::Pose3D& data)
+{
+    return readData(is, data.position) && readData(is, data.orientation);
+}
+
+template <class T>
+void printData(std::ostream& os, const T& data)
+{
+    for (unsigned int j=0; j<data.length(); j++){
+        os << data[j] << " ";
+    }
+}
+
+void printData(std::ostream& os, const RTC::Acceleration3D& data)
+{
+    os << data.ax << " " << data.ay << " " << data.az << " ";
+}
+
+void printData(std::ostream& os, const RTC::AngularVelocity3D& data)
+{
+    os << data.avx << " " << data.avy << " " << data.avz << " ";
+}
+
+void printData(std::ostream& os, const RTC::Point3D& data)
+{
+    os << data.x << " " << data.y << " " << data.z << " ";
+}
+
+void printData(std::ostream& os, const RTC::Vector3D& data)
+{
+    os << data.x << " " << data.y << " " << data.z << " ";
+}
+
+void printData(std::ostream& os, const RTC::Orientation3D& data)
+{
+    os << data.r << " " << data.p << " " << data.y << " ";
+}
+
+void printData(std::ostream& os, const RTC::Pose3D& data)
+{
+    printData(os, data.position);
+    printData(os, data.orientation);
+}
+
+bool LogReaderBase::open(const std::string& i_fname)
+{
+    m_ifs.open(i_fname.c_str());
+    if (!m_ifs.is_open()) return false;
+    readLine();
+    return true;
+}
+
+void LogReaderBase::write()
+{
+    if (m_nextTime < 0) return;
+    writeData(m_nextTime);
+    readLine();
+}
+
+void LogReaderBase::readLine()
+{
+    m_nextTime = -1;
+    while (std::getline(m_ifs, m_line)){
+        std::istringstream iss(m_line);
+        double tm;
+        if (!readValue(iss, tm)) continue;
+        if (!parse(iss)){
+            std::cerr << "invalid line in the log of " << name() << ":" << m_line << std::endl;
+            continue;
+        }
+        m_nextTime = tm;
+        return;
+    }
+}
+
+bool LogWriterBase::open(const std::string& i_fname)
+{
+    m_ofs.open(i_fname.c_str());
+    if (!m_ofs.is_open()) return false;
+    m_ofs.setf(std::ios::fixed, std::ios::floatfield);
+    return true;
+}
+
+template <class T>
+class LogReader : public LogReaderBase
+{
+public:
+    LogReader(const char *name) : m_port(name, m_data) {}
+    const char *name(){
+        return m_port.name();
+    }
+    PortService_ptr port(){
+        return m_port.getPortRef();
+    }
+    OutPort<T>& outPort(){
+        return m_port;
+    }
+protected:
+    bool parse(std::istream& is){
+        return readData(is, m_data.data);
+    }
+    void writeData(double i_time){
+        m_data.tm.sec = (CORBA::ULong)i_time;
+        m_data.tm.nsec = (CORBA::ULong)((i_time - m_data.tm.sec)*1e9);
+        m_port.write();
+    }
+private:
+    OutPort<T> m_port;
+    T m_data;
+};
+
+template <class T>
+class LogWriter : public LogWriterBase
+{
+public:
+    LogWriter(const char *name) : m_port(name, m_data) {}
+    const char *name(){
+        return m_port.name();
+    }
+    PortService_ptr port(){
+        return m_port.getPortRef();
+    }
+    InPort<T>& inPort(){
+        return m_port;
+    }
+    void log(){
+        while (m_port.isNew()){
+            m_port.read();
+            m_ofs << std::setprecision(6) << (m_data.tm.sec + m_data.tm.nsec/1e9) << " ";
+            printData(m_ofs, m_data.data);
+            m_ofs << "\n";
+        }
+    }
+private:
+    InPort<T> m_port;
+    T m_data;
+};
+
+template <class T>
+static LogReaderBase *createReader(LogReplayer *rtc, const std::string& i_name)
+{
+    LogReader<T> *reader = new LogReader<T>(i_name.c_str());
+    if (!rtc->addOutPort(i_name.c_str(), reader->outPort())){
+        delete reader;
+        return NULL;
+    }
+    return reader;
+}
+
+template <class T>
+static LogWriterBase *createWriter(LogReplayer *rtc, const std::string& i_name)
+{
+    LogWriter<T> *writer = new LogWriter<T>(i_name.c_str());
+    if (!rtc->addInPort(i_name.c_str(), writer->inPort())){
+        delete writer;
+        return NULL;
+    }
+    return writer;
+}
+
+LogReplayer::LogReplayer(RTC::Manager* manager)
+    : RTC::DataFlowComponentBase(manager)
+{
+}
+
+LogReplayer::~LogReplayer()
+{
+    for (unsigned int i=0; i<m_readers.size(); i++) delete m_readers[i];
+    for (unsigned int i=0; i<m_writers.size(); i++) delete m_writers[i];
+}
+
+LogReaderBase *LogReplayer::addReader(const std::string& i_type,
+                                      const std::string& i_name)
+{
+    LogReaderBase *reader = NULL;
+    if (i_type == "TimedDoubleSeq"){
+        reader = createReader<TimedDoubleSeq>(this, i_name);
+    }else if (i_type == "TimedLongSeq"){
+        reader = createReader<TimedLongSeq>(this, i_name);
+    }else if (i_type == "TimedBooleanSeq"){
+        reader = createReader<TimedBooleanSeq>(this, i_name);
+    }else if (i_type == "TimedPoint3D"){
+        reader = createReader<TimedPoint3D>(this, i_name);
+    }else if (i_type == "TimedVector3D"){
+        reader = createReader<TimedVector3D>(this, i_name);
+    }else if (i_type == "TimedOrientation3D"){
+        reader = createReader<TimedOrientation3D>(this, i_name);
+    }else if (i_type == "TimedAcceleration3D"){
+        reader = createReader<TimedAcceleration3D>(this, i_name);
+    }else if (i_type == "TimedAngularVelocity3D"){
+        reader = createReader<TimedAngularVelocity3D>(this, i_name);
+    }else if (i_type == "TimedPose3D"){
+        reader = createReader<TimedPose3D>(this, i_name);
+    }else{
+        std::cerr << "LogReplayer: unsupported data type(" << i_type << ")"
+                  << std::endl;
+        return NULL;
+    }
+    if (reader) m_readers.push_back(reader);
+    return reader;
+}
+
+LogWriterBase *LogReplayer::addWriter(const std::string& i_type,
+                                      const std::string& i_name)
+{
+    LogWriterBase *writer = NULL;
+    if (i_type == "TimedDoubleSeq"){
+        writer = createWriter<TimedDoubleSeq>(this, i_name);
+    }else if (i_type == "TimedLongSeq"){
+        writer = createWriter<TimedLongSeq>(this, i_name);
+    }else if (i_type == "TimedBooleanSeq"){
+        writer = createWriter<TimedBooleanSeq>(this, i_name);
+    }else if (i_type == "TimedPoint3D"){
+        writer = createWriter<TimedPoint3D>(this, i_name);
+    }else if (i_type == "TimedVector3D"){
+        writer = createWriter<TimedVector3D>(this, i_name);
+    }else if (i_type == "TimedOrientation3D"){
+        writer = createWriter<TimedOrientation3D>(this, i_name);
+    }else if (i_type == "TimedAcceleration3D"){
+        writer = createWriter<TimedAcceleration3D>(this, i_name);
+    }else if (i_type == "TimedAngularVelocity3D"){
+        writer = createWriter<TimedAngularVelocity3D>(this, i_name);
+    }else if (i_type == "TimedPose3D"){
+        writer = createWriter<TimedPose3D>(this, i_name);
+    }else{
+        std::cerr << "LogReplayer: unsupported data type(" << i_type << ")"
+                  << std::endl;
+        return NULL;
+    }
+    if (writer) m_writers.push_back(writer);
+    return writer;
+}
+
+void LogReplayer::moduleInit(RTC::Manager* manager)
+{
+    coil::Properties profile(logreplayer_spec);
+    manager->registerFactory(profile,
+                             RTC::Create<LogReplayer>,
+                             RTC::Delete<LogReplayer>);
+}
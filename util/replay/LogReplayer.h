@@ -0,0 +1,75 @@
+#ifndef __LOG_REPLAYER_H__
+#define __LOG_REPLAYER_H__
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include <rtm/Manager.h>
+#include <rtm/DataFlowComponentBase.h>
+#include <rtm/DataInPort.h>
+#include <rtm/DataOutPort.h>
+#include <rtm/idl/BasicDataTypeSkel.h>
+#include <rtm/idl/ExtendedDataTypesSkel.h>
+
+/**
+   feeds an InPort of the replayed RTC with lines of a log file written by
+   DataLogger::save(). Each line is a time stamp followed by values.
+ */
+class LogReaderBase
+{
+public:
+    LogReaderBase() : m_nextTime(-1) {}
+    virtual ~LogReaderBase() {}
+    virtual const char *name() = 0;
+    virtual RTC::PortService_ptr port() = 0;
+    bool open(const std::string& i_fname);
+    // time stamp of the next line, negative at the end of the log
+    double nextTime() const { return m_nextTime; }
+    // write the next line to the port
+    void write();
+protected:
+    virtual bool parse(std::istream& is) = 0;
+    virtual void writeData(double i_time) = 0;
+private:
+    void readLine();
+
+    std::ifstream m_ifs;
+    std::string m_line;
+    double m_nextTime;
+};
+
+/**
+   records data from an OutPort of the replayed RTC in the same format
+ */
+class LogWriterBase
+{
+public:
+    virtual ~LogWriterBase() {}
+    virtual const char *name() = 0;
+    virtual RTC::PortService_ptr port() = 0;
+    bool open(const std::string& i_fname);
+    virtual void log() = 0;
+protected:
+    std::ofstream m_ofs;
+};
+
+/**
+   \brief component which owns ports connected to the replayed RTC. It is
+   never executed, ports are accessed from the replay loop directly.
+ */
+class LogReplayer
+  : public RTC::DataFlowComponentBase
+{
+public:
+    LogReplayer(RTC::Manager* manager);
+    virtual ~LogReplayer();
+    // i_type is the data type name such as "TimedDoubleSeq"
+    LogReaderBase *addReader(const std::string& i_type, const std::string& i_name);
+    LogWriterBase *addWriter(const std::string& i_type, const std::string& i_name);
+    static void moduleInit(RTC::Manager* manager);
+private:
+    std::vector<LogReaderBase *> m_readers;
+    std::vector<LogWriterBase *> m_writers;
+};
+
+#endif
@@ -0,0 +1,210 @@
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <time.h>
+#include <rtm/Manager.h>
+#include <rtm/NVUtil.h>
+#include "hrpsys/util/OpenRTMUtil.h"
+#include "LogReplayer.h"
+
+// lines of input logs within this duration[s] are fed in the same cycle
+#define TIME_TOLERANCE 1e-4
+
+static inline long long now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec*1000000000LL + ts.tv_nsec;
+}
+
+// "IDL:RTC/TimedDoubleSeq:1.0" -> "TimedDoubleSeq"
+static std::string dataTypeName(const std::string& i_type)
+{
+    std::string type = i_type;
+    if (type.find("IDL:") == 0){
+        type = type.substr(4, type.rfind(':') - 4);
+    }
+    size_t pos = type.find_last_of("/:");
+    if (pos != std::string::npos) type = type.substr(pos+1);
+    return type;
+}
+
+void print_usage ()
+{
+    std::cerr << "Usage : hrpsys-replay --module [path] --log [basename] [option] [RTM option]" << std::endl;
+    std::cerr << " [option] should be:" << std::endl;
+    std::cerr << "  --module path : shared library of the RTC to be replayed, such as Stabilizer.so" << std::endl;
+    std::cerr << "  --factory name : factory name of the RTC (by default, basename of the module)" << std::endl;
+    std::cerr << "  --log basename : basename of logs saved by DataLogger" << std::endl;
+    std::cerr << "  --connect inport:logport : feed inport with basename.logport (by default, basename.inport is used if it exists)" << std::endl;
+    std::cerr << "  --conf name=value : set a configuration variable of the RTC" << std::endl;
+    std::cerr << "  --output basename : basename of output logs (by default, replay)" << std::endl;
+    std::cerr << "  --max-cycles N : stop after N cycles" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    std::string module, factory, logBasename, outBasename("replay");
+    std::map<std::string, std::string> connections;
+    std::vector<std::pair<std::string, std::string> > confs;
+    int maxCycles = -1;
+    int rtmargc = 0;
+    std::vector<char *> rtmargv;
+    rtmargv.push_back(argv[0]);
+    rtmargc++;
+    for (int i = 1; i < argc; i++) {
+        std::string arg(argv[i]);
+        if (arg == "--module") {
+            if (++i < argc) module = argv[i];
+        } else if (arg == "--factory") {
+            if (++i < argc) factory = argv[i];
+        } else if (arg == "--log") {
+            if (++i < argc) logBasename = argv[i];
+        } else if (arg == "--connect") {
+            if (++i < argc) {
+                std::string str(argv[i]);
+                size_t pos = str.find(':');
+                if (pos == std::string::npos) {
+                    print_usage();
+                    return 1;
+                }
+                connections[str.substr(0, pos)] = str.substr(pos+1);
+            }
+        } else if (arg == "--conf") {
+            if (++i < argc) {
+                std::string str(argv[i]);
+                size_t pos = str.find('=');
+                if (pos == std::string::npos) {
+                    print_usage();
+                    return 1;
+                }
+                confs.push_back(std::make_pair(str.substr(0, pos), str.substr(pos+1)));
+            }
+        } else if (arg == "--output") {
+            if (++i < argc) outBasename = argv[i];
+        } else if (arg == "--max-cycles") {
+            if (++i < argc) maxCycles = atoi(argv[i]);
+        } else {
+            rtmargv.push_back(argv[i]);
+            rtmargc++;
+        }
+    }
+    if (module.empty() || logBasename.empty()) {
+        print_usage();
+        return 1;
+    }
+    if (factory.empty()) {
+        factory = module.substr(module.find_last_of('/') + 1);
+        factory = factory.substr(0, factory.find('.'));
+    }
+
+    // the RTC is executed by the loop below, not by its execution context
+    char ec_opt[] = "-o", ec_type[] = "exec_cxt.periodic.type:SynchExtTriggerEC";
+    rtmargv.push_back(ec_opt);
+    rtmargv.push_back(ec_type);
+    rtmargc += 2;
+    RTC::Manager* manager = RTC::Manager::init(rtmargc, rtmargv.data());
+    LogReplayer::moduleInit(manager);
+    manager->activateManager();
+    manager->runManager(true);
+
+    manager->load(module.c_str(), (factory + "Init").c_str());
+    RTC::RTObject_impl *rtc = manager->createComponent(factory.c_str());
+    if (!rtc) {
+        std::cerr << "failed to create RTC(" << factory << ")" << std::endl;
+        return 1;
+    }
+    LogReplayer *replayer = (LogReplayer *)manager->createComponent("LogReplayer");
+
+    // connect data ports of the RTC to readers and writers
+    std::vector<LogReaderBase *> readers;
+    std::vector<LogWriterBase *> writers;
+    RTC::PortServiceList_var ports = rtc->get_ports();
+    for (unsigned int i = 0; i < ports->length(); i++) {
+        RTC::PortProfile_var prof = ports[i]->get_port_profile();
+        coil::Properties props;
+        NVUtil::copyToProperties(props, prof->properties);
+        std::string name(prof->name);
+        name = name.substr(name.find('.') + 1);
+        std::string type = dataTypeName(props["dataport.data_type"]);
+        if (props["port.port_type"] == "DataInPort") {
+            std::string logport = connections.count(name) ? connections[name] : name;
+            std::string fname = logBasename + "." + logport;
+            if (!connections.count(name) && !std::ifstream(fname.c_str()).is_open()) continue;
+            LogReaderBase *reader = replayer->addReader(type, logport);
+            if (!reader) continue;
+            if (!reader->open(fname)) {
+                std::cerr << "failed to open " << fname << std::endl;
+                return 1;
+            }
+            connectPorts(reader->port(), ports[i]);
+            readers.push_back(reader);
+            std::cout << fname << " -> " << name << std::endl;
+        } else if (props["port.port_type"] == "DataOutPort") {
+            LogWriterBase *writer = replayer->addWriter(type, name + "Log");
+            if (!writer) continue;
+            std::string fname = outBasename + "." + name;
+            if (!writer->open(fname)) {
+                std::cerr << "failed to open " << fname << std::endl;
+                return 1;
+            }
+            connectPorts(ports[i], writer->port());
+            writers.push_back(writer);
+            std::cout << name << " -> " << fname << std::endl;
+        }
+    }
+    if (readers.empty()) {
+        std::cerr << "no input log is found" << std::endl;
+        return 1;
+    }
+    RTC::RTObject_var rtcRef = RTC::RTObject::_duplicate(rtc->getObjRef());
+    for (size_t i = 0; i < confs.size(); i++) {
+        setConfiguration(rtcRef, confs[i].first, confs[i].second);
+    }
+
+    std::ofstream ofs((outBasename + ".timing").c_str());
+    ofs.setf(std::ios::fixed, std::ios::floatfield);
+    std::vector<long long> durations;
+    rtc->on_activated(0);
+    while (maxCycles < 0 || (int)durations.size() < maxCycles) {
+        // feed the earliest lines of inputs
+        double tm = -1;
+        for (size_t i = 0; i < readers.size(); i++) {
+            double next = readers[i]->nextTime();
+            if (next >= 0 && (tm < 0 || next < tm)) tm = next;
+        }
+        if (tm < 0) break;
+        for (size_t i = 0; i < readers.size(); i++) {
+            double next = readers[i]->nextTime();
+            if (next >= 0 && next < tm + TIME_TOLERANCE) readers[i]->write();
+        }
+        long long t0 = now();
+        rtc->on_execute(0);
+        long long t1 = now();
+        for (size_t i = 0; i < writers.size(); i++) {
+            writers[i]->log();
+        }
+        durations.push_back(t1 - t0);
+        ofs << std::setprecision(6) << tm << " " << (t1 - t0)/1e3 << "\n";
+    }
+    rtc->on_deactivated(0);
+
+    if (!durations.empty()) {
+        double sum = 0;
+        for (size_t i = 0; i < durations.size(); i++) sum += durations[i];
+        std::sort(durations.begin(), durations.end());
+        size_t n = durations.size();
+        std::cout << "cycles:" << n
+                  << ", onExecute[us] p50:" << durations[(n-1)*50/100]/1e3
+                  << ", p99:" << durations[(n-1)*99/100]/1e3
+                  << ", max:" << durations[n-1]/1e3
+                  << ", mean:" << sum/n/1e3 << std::endl;
+    }
+    manager->shutdown();
+    return 0;
+}
@@ -12,8 +12,7 @@
 #include "hrpsys/util/GLcamera.h"
 #include "hrpsys/util/GLlink.h"
 #include "hrpsys/util/GLbody.h"
-#include "hrpsys/util/LogManager.h"
-#include "SceneState.h"
+#include "SceneStateLog.h"
 #include "GLscene.h"
 
 using namespace OpenHRP;
@@ -30,8 +29,7 @@ void GLscene::updateScene()
 { 
     if (m_log->index()<0) return;
 
-    LogManager<SceneState> *lm 
-        = (LogManager<SceneState> *)m_log;
+    SceneLogManager *lm = (SceneLogManager *)m_log;
     SceneState &state = lm->state();
     
     for (unsigned int i=0; i<state.bodyStates.size(); i++){
@@ -58,8 +56,7 @@ void GLscene::drawAdditionalLines()
 {
     if (!m_showCollision || m_log->index()<0) return;
 
-    LogManager<SceneState> *lm 
-        = (LogManager<SceneState> *)m_log;
+    SceneLogManager *lm = (SceneLogManager *)m_log;
     SceneState &state = lm->state();
 
     glBegin(GL_LINES);
@@ -80,8 +77,7 @@ void GLscene::showStatus()
 {
     if (m_log->index()<0) return;
 
-    LogManager<SceneState> *lm 
-        = (LogManager<SceneState> *)m_log;
+    SceneLogManager *lm = (SceneLogManager *)m_log;
     SceneState &state = lm->state();
 
     if (m_showingStatus){
@@ -172,8 +168,7 @@ void GLscene::drawSensorOutput(Body *body, Sensor *sensor)
 {
     if (m_log->index()<0) return;
 
-    LogManager<SceneState> *lm 
-        = (LogManager<SceneState> *)m_log;
+    SceneLogManager *lm = (SceneLogManager *)m_log;
     SceneState &sstate = lm->state();
     if (bodyIndex(body->name())<0){
         std::cerr << "invalid bodyIndex(" << bodyIndex(body->name()) 
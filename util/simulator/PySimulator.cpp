@@ -55,6 +55,7 @@ hrp::BodyPtr createBody(const std::string& name, const ModelItem& mitem,
         return hrp::BodyPtr();
     }else{
         if (usebbox) convertToAABB(body);
+        ConvexHullCache hullCache(convexHullCacheFile(mitem.url));
         for (std::map<std::string, JointItem>::const_iterator it2=mitem.joint.begin();
              it2 != mitem.joint.end(); it2++){
             hrp::Link *link = body->link(it2->first);
@@ -63,7 +64,7 @@ hrp::BodyPtr createBody(const std::string& name, const ModelItem& mitem,
             if (it2->second.collisionShape == ""){
                 // do nothing
             }else if (it2->second.collisionShape == "convex hull"){
-                convertToConvexHull(link);
+                hullCache.convertToConvexHull(link);
             }else if (it2->second.collisionShape == "AABB"){
                 convertToAABB(link);
             }else{
@@ -321,6 +322,18 @@ double PySimulator::maxLogLength()
     return maxLogLen;
 }
 
+void PySimulator::setCompactLog(bool flag)
+{
+    boost::mutex::scoped_lock lock(log.mutex());
+    log.storage().setCompact(flag);
+}
+
+bool PySimulator::compactLog()
+{
+    boost::mutex::scoped_lock lock(log.mutex());
+    return log.storage().isCompact();
+}
+
 void PySimulator::reset()
 {
     log.clear();
@@ -381,6 +394,8 @@ BOOST_PYTHON_MODULE( hrpsysext )
                       &PySimulator::showSensors, &PySimulator::setShowSensors)
         .add_property("maxLogLength", 
                       &PySimulator::maxLogLength, &PySimulator::setMaxLogLength)
+        .add_property("compactLog", 
+                      &PySimulator::compactLog, &PySimulator::setCompactLog)
         ;
 
     class_<PyBody, boost::noncopyable>("Body", no_init)
@@ -40,8 +40,10 @@ public:
     void setWindowSize(int s);
     void setMaxLogLength(double len);
     double maxLogLength();
+    void setCompactLog(bool flag);
+    bool compactLog();
 private:  
-    LogManager<SceneState> log;
+    SceneLogManager log;
     GLscene scene;
     SDLwindow window;
     RTC::Manager* manager;
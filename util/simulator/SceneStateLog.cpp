@@ -0,0 +1,575 @@
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "SceneStateLog.h"
+
+#define DEFAULT_FRAMES_PER_CHUNK 1024
+#define MIN_COLLISION_CAPACITY   16
+
+SceneStateLog::SceneStateLog() :
+    m_compact(false), m_float(false), m_delta(false),
+    m_keyInterval(100), m_framesPerChunk(DEFAULT_FRAMES_PER_CHUNK),
+    m_maxCollisions(256), m_collisionCapacity(0), m_nvalues(0),
+    m_first(0), m_size(0), m_popped(0), m_cacheIndex(-1),
+    m_ramLimit(0), m_ramUsage(0), m_spilledBytes(0), m_spillDir("/tmp"),
+    m_fd(-1), m_fileSize(0)
+{
+}
+
+SceneStateLog::~SceneStateLog()
+{
+    releaseAll();
+    if (m_fd >= 0) close(m_fd);
+}
+
+size_t SceneStateLog::size() const
+{
+    return m_compact ? m_size : m_states.size();
+}
+
+void SceneStateLog::push_back(const SceneState& i_state)
+{
+    if (!m_compact){
+        m_states.push_back(i_state);
+        return;
+    }
+    if (m_layout.empty()){
+        std::vector<BodyLayout> layout;
+        layoutOf(i_state, layout);
+        setLayout(layout, i_state.collisions.size());
+    }else if (!fits(i_state)){
+        relayout(i_state);
+    }
+
+    if (i_state.collisions.size() > m_collisionCapacity){
+        // the record keeps the first m_maxCollisions ones only
+        m_overflow[m_popped + m_size] = i_state;
+    }
+
+    size_t g = m_first + m_size;
+    if (g/m_framesPerChunk >= m_chunks.size()) allocChunk();
+    const Chunk& chunk = m_chunks[g/m_framesPerChunk];
+    size_t slot = g%m_framesPerChunk;
+
+    flatten(i_state, &m_values[0]);
+    chunkTimes(chunk)[slot] = i_state.time;
+    double *key = NULL;
+    if (m_delta){
+        key = chunkKeys(chunk) + (slot/m_keyInterval)*m_nvalues;
+        if (slot%m_keyInterval == 0){
+            memcpy(key, &m_values[0], sizeof(double)*m_nvalues);
+        }
+    }
+    char *rec = chunkRecords(chunk);
+    if (m_float){
+        float *v = (float *)rec + slot*m_nvalues;
+        for (size_t i=0; i<m_nvalues; i++){
+            v[i] = key ? m_values[i] - key[i] : m_values[i];
+        }
+    }else{
+        double *v = (double *)rec + slot*m_nvalues;
+        for (size_t i=0; i<m_nvalues; i++){
+            v[i] = key ? m_values[i] - key[i] : m_values[i];
+        }
+    }
+    m_size++;
+}
+
+void SceneStateLog::pop_front()
+{
+    if (!m_compact){
+        m_states.pop_front();
+        return;
+    }
+    if (!m_size) return;
+    if (!m_overflow.empty() && m_overflow.begin()->first == m_popped){
+        m_overflow.erase(m_overflow.begin());
+    }
+    m_popped++;
+    m_first++;
+    m_size--;
+    if (m_first == (size_t)m_framesPerChunk){
+        freeChunk(m_chunks.front());
+        m_chunks.pop_front();
+        m_first = 0;
+    }
+    m_cacheIndex = -1;
+}
+
+void SceneStateLog::clear()
+{
+    m_states.clear();
+    releaseAll();
+    m_layout.clear();
+    m_nvalues = 0;
+    m_first = m_size = m_popped = 0;
+    m_overflow.clear();
+    m_cacheIndex = -1;
+}
+
+SceneState& SceneStateLog::operator[](size_t i)
+{
+    if (!m_compact) return m_states[i];
+    if (i != m_cacheIndex){
+        decode(i, m_cache);
+        m_cacheIndex = i;
+    }
+    return m_cache;
+}
+
+double SceneStateLog::time(size_t i) const
+{
+    if (!m_compact) return m_states[i].time;
+    size_t g = m_first + i;
+    return chunkTimes(m_chunks[g/m_framesPerChunk])[g%m_framesPerChunk];
+}
+
+void SceneStateLog::setCompact(bool flag)
+{
+    reconfigure(flag, m_float, m_delta, m_keyInterval, m_maxCollisions);
+}
+
+void SceneStateLog::useFloat(bool flag)
+{
+    reconfigure(m_compact, flag, m_delta, m_keyInterval, m_maxCollisions);
+}
+
+void SceneStateLog::useDelta(bool flag, int keyInterval)
+{
+    if (keyInterval < 1) keyInterval = 1;
+    reconfigure(m_compact, m_float, flag, keyInterval, m_maxCollisions);
+}
+
+void SceneStateLog::setMaxCollisions(size_t n)
+{
+    reconfigure(m_compact, m_float, m_delta, m_keyInterval, n);
+}
+
+void SceneStateLog::setRamLimit(size_t bytes)
+{
+    m_ramLimit = bytes;
+}
+
+void SceneStateLog::setSpillDirectory(const std::string& dir)
+{
+    m_spillDir = dir;
+}
+
+size_t SceneStateLog::ramUsage() const
+{
+    return m_ramUsage;
+}
+
+size_t SceneStateLog::spilledBytes() const
+{
+    return m_spilledBytes;
+}
+
+void SceneStateLog::layoutOf(const SceneState& i_state,
+                             std::vector<BodyLayout>& o_layout)
+{
+    o_layout.resize(i_state.bodyStates.size());
+    for (size_t i=0; i<i_state.bodyStates.size(); i++){
+        const BodyState& bs = i_state.bodyStates[i];
+        BodyLayout& bl = o_layout[i];
+        bl.nq = bs.q.size();
+        bl.nforce = bs.force.size();
+        bl.nrate = bs.rate.size();
+        bl.nacc = bs.acc.size();
+        bl.rangeCapacity.resize(bs.range.size());
+        for (size_t j=0; j<bs.range.size(); j++){
+            bl.rangeCapacity[j] = bs.range[j].size();
+        }
+    }
+}
+
+void SceneStateLog::setLayout(const std::vector<BodyLayout>& i_layout,
+                              size_t i_collisionCapacity)
+{
+    m_layout = i_layout;
+    size_t cap = MIN_COLLISION_CAPACITY;
+    while (cap < i_collisionCapacity) cap *= 2;
+    m_collisionCapacity = std::min(cap, m_maxCollisions);
+
+    m_nvalues = 1 + 7*m_collisionCapacity;
+    for (size_t i=0; i<m_layout.size(); i++){
+        const BodyLayout& bl = m_layout[i];
+        m_nvalues += 3 + 9 + bl.nq + 6*bl.nforce + 3*bl.nrate + 3*bl.nacc;
+        for (size_t j=0; j<bl.rangeCapacity.size(); j++){
+            m_nvalues += 1 + bl.rangeCapacity[j];
+        }
+    }
+    m_values.resize(m_nvalues);
+    m_decodeBuf.resize(m_nvalues);
+    if (m_delta){
+        m_framesPerChunk = m_keyInterval
+            *std::max(1, DEFAULT_FRAMES_PER_CHUNK/m_keyInterval);
+    }else{
+        m_framesPerChunk = DEFAULT_FRAMES_PER_CHUNK;
+    }
+}
+
+bool SceneStateLog::fits(const SceneState& i_state) const
+{
+    if (i_state.bodyStates.size() != m_layout.size()) return false;
+    for (size_t i=0; i<m_layout.size(); i++){
+        const BodyState& bs = i_state.bodyStates[i];
+        const BodyLayout& bl = m_layout[i];
+        if ((size_t)bs.q.size() != bl.nq || bs.force.size() != bl.nforce
+            || bs.rate.size() != bl.nrate || bs.acc.size() != bl.nacc
+            || bs.range.size() != bl.rangeCapacity.size()) return false;
+        for (size_t j=0; j<bs.range.size(); j++){
+            if (bs.range[j].size() > bl.rangeCapacity[j]) return false;
+        }
+    }
+    return i_state.collisions.size() <= m_collisionCapacity
+        || m_collisionCapacity == m_maxCollisions;
+}
+
+void SceneStateLog::relayout(const SceneState& i_state)
+{
+    std::vector<BodyLayout> layout;
+    layoutOf(i_state, layout);
+    bool compatible = layout.size() == m_layout.size();
+    for (size_t i=0; compatible && i<layout.size(); i++){
+        BodyLayout& bl = layout[i];
+        const BodyLayout& old = m_layout[i];
+        if (bl.nq != old.nq || bl.nforce != old.nforce
+            || bl.nrate != old.nrate || bl.nacc != old.nacc
+            || bl.rangeCapacity.size() != old.rangeCapacity.size()){
+            compatible = false;
+            break;
+        }
+        for (size_t j=0; j<bl.rangeCapacity.size(); j++){
+            bl.rangeCapacity[j] = std::max(bl.rangeCapacity[j],
+                                           old.rangeCapacity[j]);
+        }
+    }
+    size_t ncollision = std::max(i_state.collisions.size(),
+                                 m_collisionCapacity);
+    if (!compatible){
+        std::cerr << "SceneStateLog: structure of the scene changed, "
+                  << "previous log is discarded" << std::endl;
+        clear();
+        setLayout(layout, ncollision);
+        return;
+    }
+    SceneStateLog log;
+    log.m_compact = true;
+    log.m_float = m_float;
+    log.m_delta = m_delta;
+    log.m_keyInterval = m_keyInterval;
+    log.m_maxCollisions = m_maxCollisions;
+    log.m_ramLimit = m_ramLimit;
+    log.m_spillDir = m_spillDir;
+    log.setLayout(layout, ncollision);
+    copyTo(log);
+    swap(log);
+}
+
+void SceneStateLog::reconfigure(bool i_compact, bool i_float, bool i_delta,
+                                int i_keyInterval, size_t i_maxCollisions)
+{
+    if (i_compact == m_compact && i_float == m_float && i_delta == m_delta
+        && i_keyInterval == m_keyInterval
+        && i_maxCollisions == m_maxCollisions) return;
+    if (empty()){
+        clear();
+        m_compact = i_compact;
+        m_float = i_float;
+        m_delta = i_delta;
+        m_keyInterval = i_keyInterval;
+        m_maxCollisions = i_maxCollisions;
+        return;
+    }
+    SceneStateLog log;
+    log.m_compact = i_compact;
+    log.m_float = i_float;
+    log.m_delta = i_delta;
+    log.m_keyInterval = i_keyInterval;
+    log.m_maxCollisions = i_maxCollisions;
+    log.m_ramLimit = m_ramLimit;
+    log.m_spillDir = m_spillDir;
+    copyTo(log);
+    swap(log);
+}
+
+void SceneStateLog::copyTo(SceneStateLog& o_log)
+{
+    SceneState state;
+    for (size_t i=0; i<size(); i++){
+        if (m_compact){
+            decode(i, state);
+            o_log.push_back(state);
+        }else{
+            o_log.push_back(m_states[i]);
+        }
+    }
+}
+
+void SceneStateLog::swap(SceneStateLog& io_log)
+{
+    m_states.swap(io_log.m_states);
+    std::swap(m_compact, io_log.m_compact);
+    std::swap(m_float, io_log.m_float);
+    std::swap(m_delta, io_log.m_delta);
+    std::swap(m_keyInterval, io_log.m_keyInterval);
+    std::swap(m_framesPerChunk, io_log.m_framesPerChunk);
+    std::swap(m_maxCollisions, io_log.m_maxCollisions);
+    m_layout.swap(io_log.m_layout);
+    std::swap(m_collisionCapacity, io_log.m_collisionCapacity);
+    std::swap(m_nvalues, io_log.m_nvalues);
+    m_chunks.swap(io_log.m_chunks);
+    std::swap(m_first, io_log.m_first);
+    std::swap(m_size, io_log.m_size);
+    std::swap(m_popped, io_log.m_popped);
+    m_overflow.swap(io_log.m_overflow);
+    m_values.swap(io_log.m_values);
+    m_decodeBuf.swap(io_log.m_decodeBuf);
+    std::swap(m_ramLimit, io_log.m_ramLimit);
+    std::swap(m_ramUsage, io_log.m_ramUsage);
+    std::swap(m_spilledBytes, io_log.m_spilledBytes);
+    m_spillDir.swap(io_log.m_spillDir);
+    std::swap(m_fd, io_log.m_fd);
+    std::swap(m_fileSize, io_log.m_fileSize);
+    m_freeOffsets.swap(io_log.m_freeOffsets);
+    m_cacheIndex = io_log.m_cacheIndex = -1;
+}
+
+void SceneStateLog::flatten(const SceneState& i_state, double *o_values) const
+{
+    double *v = o_values;
+    for (size_t i=0; i<m_layout.size(); i++){
+        const BodyState& bs = i_state.bodyStates[i];
+        const BodyLayout& bl = m_layout[i];
+        for (int k=0; k<3; k++) *v++ = bs.p[k];
+        for (int k=0; k<3; k++){
+            for (int l=0; l<3; l++) *v++ = bs.R(k,l);
+        }
+        for (size_t j=0; j<bl.nq; j++) *v++ = bs.q[j];
+        for (size_t j=0; j<bl.nforce; j++){
+            for (int k=0; k<6; k++) *v++ = bs.force[j][k];
+        }
+        for (size_t j=0; j<bl.nrate; j++){
+            for (int k=0; k<3; k++) *v++ = bs.rate[j][k];
+        }
+        for (size_t j=0; j<bl.nacc; j++){
+            for (int k=0; k<3; k++) *v++ = bs.acc[j][k];
+        }
+        for (size_t j=0; j<bl.rangeCapacity.size(); j++){
+            const std::vector<double>& r = bs.range[j];
+            *v++ = r.size();
+            for (size_t k=0; k<r.size(); k++) *v++ = r[k];
+            for (size_t k=r.size(); k<bl.rangeCapacity[j]; k++) *v++ = 0;
+        }
+    }
+    size_t ncol = std::min(i_state.collisions.size(), m_collisionCapacity);
+    *v++ = ncol;
+    for (size_t i=0; i<m_collisionCapacity; i++){
+        if (i < ncol){
+            const CollisionInfo& ci = i_state.collisions[i];
+            for (int k=0; k<3; k++) *v++ = ci.position[k];
+            for (int k=0; k<3; k++) *v++ = ci.normal[k];
+            *v++ = ci.idepth;
+        }else{
+            for (int k=0; k<7; k++) *v++ = 0;
+        }
+    }
+}
+
+void SceneStateLog::unflatten(const double *i_values, SceneState& o_state) const
+{
+    const double *v = i_values;
+    o_state.bodyStates.resize(m_layout.size());
+    for (size_t i=0; i<m_layout.size(); i++){
+        BodyState& bs = o_state.bodyStates[i];
+        const BodyLayout& bl = m_layout[i];
+        for (int k=0; k<3; k++) bs.p[k] = *v++;
+        for (int k=0; k<3; k++){
+            for (int l=0; l<3; l++) bs.R(k,l) = *v++;
+        }
+        bs.q.resize(bl.nq);
+        for (size_t j=0; j<bl.nq; j++) bs.q[j] = *v++;
+        bs.force.resize(bl.nforce);
+        for (size_t j=0; j<bl.nforce; j++){
+            for (int k=0; k<6; k++) bs.force[j][k] = *v++;
+        }
+        bs.rate.resize(bl.nrate);
+        for (size_t j=0; j<bl.nrate; j++){
+            for (int k=0; k<3; k++) bs.rate[j][k] = *v++;
+        }
+        bs.acc.resize(bl.nacc);
+        for (size_t j=0; j<bl.nacc; j++){
+            for (int k=0; k<3; k++) bs.acc[j][k] = *v++;
+        }
+        bs.range.resize(bl.rangeCapacity.size());
+        for (size_t j=0; j<bl.rangeCapacity.size(); j++){
+            std::vector<double>& r = bs.range[j];
+            r.resize((int)(*v++ + 0.5));
+            for (size_t k=0; k<r.size(); k++) r[k] = v[k];
+            v += bl.rangeCapacity[j];
+        }
+    }
+    o_state.collisions.resize((int)(*v++ + 0.5));
+    for (size_t i=0; i<o_state.collisions.size(); i++){
+        CollisionInfo& ci = o_state.collisions[i];
+        for (int k=0; k<3; k++) ci.position[k] = v[k];
+        for (int k=0; k<3; k++) ci.normal[k] = v[3+k];
+        ci.idepth = v[6];
+        v += 7;
+    }
+}
+
+void SceneStateLog::decode(size_t i, SceneState& o_state) const
+{
+    if (!m_overflow.empty()){
+        std::map<size_t, SceneState>::const_iterator it
+            = m_overflow.find(m_popped + i);
+        if (it != m_overflow.end()){
+            o_state = it->second;
+            return;
+        }
+    }
+    size_t g = m_first + i;
+    const Chunk& chunk = m_chunks[g/m_framesPerChunk];
+    size_t slot = g%m_framesPerChunk;
+    const double *key = NULL;
+    if (m_delta) key = chunkKeys(chunk) + (slot/m_keyInterval)*m_nvalues;
+    double *v = &m_decodeBuf[0];
+    char *rec = chunkRecords(chunk);
+    if (m_float){
+        const float *r = (const float *)rec + slot*m_nvalues;
+        for (size_t j=0; j<m_nvalues; j++){
+            v[j] = key ? key[j] + r[j] : r[j];
+        }
+    }else{
+        const double *r = (const double *)rec + slot*m_nvalues;
+        for (size_t j=0; j<m_nvalues; j++){
+            v[j] = key ? key[j] + r[j] : r[j];
+        }
+    }
+    unflatten(v, o_state);
+    o_state.time = chunkTimes(chunk)[slot];
+}
+
+size_t SceneStateLog::chunkBytes() const
+{
+    size_t bytes = sizeof(double)*m_framesPerChunk
+        + (m_float ? sizeof(float) : sizeof(double))*m_framesPerChunk*m_nvalues;
+    if (m_delta){
+        bytes += sizeof(double)*(m_framesPerChunk/m_keyInterval)*m_nvalues;
+    }
+    // chunks are mapped from the spill file, round up to the page size
+    size_t page = sysconf(_SC_PAGESIZE);
+    return (bytes + page - 1)/page*page;
+}
+
+double *SceneStateLog::chunkTimes(const Chunk& chunk) const
+{
+    return (double *)chunk.data;
+}
+
+double *SceneStateLog::chunkKeys(const Chunk& chunk) const
+{
+    return (double *)chunk.data + m_framesPerChunk;
+}
+
+char *SceneStateLog::chunkRecords(const Chunk& chunk) const
+{
+    size_t offset = sizeof(double)*m_framesPerChunk;
+    if (m_delta){
+        offset += sizeof(double)*(m_framesPerChunk/m_keyInterval)*m_nvalues;
+    }
+    return chunk.data + offset;
+}
+
+void SceneStateLog::allocChunk()
+{
+    Chunk chunk;
+    chunk.data = NULL;
+    chunk.offset = -1;
+    size_t bytes = chunkBytes();
+    if (m_ramLimit && m_ramUsage + bytes > m_ramLimit){
+        if (m_fd < 0){
+            std::string path = m_spillDir + "/hrpsys-simulator-log-XXXXXX";
+            std::vector<char> buf(path.begin(), path.end());
+            buf.push_back('\0');
+            m_fd = mkstemp(&buf[0]);
+            if (m_fd < 0){
+                std::cerr << "SceneStateLog: failed to create a spill file in "
+                          << m_spillDir << std::endl;
+            }else{
+                // the file is removed when it is closed
+                unlink(&buf[0]);
+            }
+        }
+        if (m_fd >= 0){
+            off_t offset;
+            if (m_freeOffsets.empty()){
+                offset = m_fileSize;
+                if (ftruncate(m_fd, m_fileSize + bytes) == 0){
+                    m_fileSize += bytes;
+                }else{
+                    offset = -1;
+                }
+            }else{
+                offset = m_freeOffsets.back();
+                m_freeOffsets.pop_back();
+            }
+            if (offset >= 0){
+                void *ptr = mmap(NULL, bytes, PROT_READ|PROT_WRITE,
+                                 MAP_SHARED, m_fd, offset);
+                if (ptr != MAP_FAILED){
+                    chunk.data = (char *)ptr;
+                    chunk.offset = offset;
+                    m_spilledBytes += bytes;
+                }else{
+                    m_freeOffsets.push_back(offset);
+                }
+            }
+        }
+        if (!chunk.data){
+            std::cerr << "SceneStateLog: failed to spill log to disk, "
+                      << "allocating on heap" << std::endl;
+        }
+    }
+    if (!chunk.data){
+        chunk.data = (char *)malloc(bytes);
+        m_ramUsage += bytes;
+    }
+    m_chunks.push_back(chunk);
+}
+
+void SceneStateLog::freeChunk(Chunk& chunk)
+{
+    size_t bytes = chunkBytes();
+    if (chunk.offset < 0){
+        free(chunk.data);
+        m_ramUsage -= bytes;
+    }else{
+        munmap(chunk.data, bytes);
+        m_freeOffsets.push_back(chunk.offset);
+        m_spilledBytes -= bytes;
+    }
+    chunk.data = NULL;
+}
+
+void SceneStateLog::releaseAll()
+{
+    for (size_t i=0; i<m_chunks.size(); i++){
+        freeChunk(m_chunks[i]);
+    }
+    m_chunks.clear();
+    m_freeOffsets.clear();
+    if (m_fd >= 0){
+        if (ftruncate(m_fd, 0) != 0){
+            std::cerr << "SceneStateLog: failed to truncate the spill file"
+                      << std::endl;
+        }
+        m_fileSize = 0;
+    }
+    m_ramUsage = m_spilledBytes = 0;
+}
@@ -0,0 +1,112 @@
+#ifndef __SCENE_STATE_LOG_H__
+#define __SCENE_STATE_LOG_H__
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+#include "hrpsys/util/LogManager.h"
+#include "SceneState.h"
+
+/**
+   container of SceneState used by LogManager.
+
+   In the default mode, states are kept in a std::deque as they are. In the
+   compact mode, each state is flattened into a fixed size record and
+   records are packed into preallocated chunks. Values can be stored as
+   float32, optionally as differences from double precision key frames
+   which are recorded every keyInterval frames. Chunks which exceed the RAM
+   limit are allocated from a memory-mapped temporary file. Frames which
+   have more collisions than maxCollisions are also kept as they are.
+ */
+class SceneStateLog
+{
+public:
+    SceneStateLog();
+    ~SceneStateLog();
+    void push_back(const SceneState& i_state);
+    void pop_front();
+    void clear();
+    size_t size() const;
+    bool empty() const { return size() == 0; }
+    SceneState& operator[](size_t i);
+    double time(size_t i) const;
+
+    void setCompact(bool flag);
+    bool isCompact() const { return m_compact; }
+    void useFloat(bool flag);
+    void useDelta(bool flag, int keyInterval=100);
+    void setRamLimit(size_t bytes);
+    void setSpillDirectory(const std::string& dir);
+    void setMaxCollisions(size_t n);
+    size_t ramUsage() const;
+    size_t spilledBytes() const;
+private:
+    struct BodyLayout {
+        size_t nq, nforce, nrate, nacc;
+        std::vector<size_t> rangeCapacity;
+    };
+    struct Chunk {
+        char *data;
+        off_t offset; // offset in the spill file, -1 for chunks on heap
+    };
+    static void layoutOf(const SceneState& i_state,
+                         std::vector<BodyLayout>& o_layout);
+    void setLayout(const std::vector<BodyLayout>& i_layout,
+                   size_t i_collisionCapacity);
+    void flatten(const SceneState& i_state, double *o_values) const;
+    void unflatten(const double *i_values, SceneState& o_state) const;
+    bool fits(const SceneState& i_state) const;
+    void relayout(const SceneState& i_state);
+    void reconfigure(bool i_compact, bool i_float, bool i_delta,
+                     int i_keyInterval, size_t i_maxCollisions);
+    void copyTo(SceneStateLog& o_log);
+    void swap(SceneStateLog& io_log);
+    void decode(size_t i, SceneState& o_state) const;
+    void allocChunk();
+    void freeChunk(Chunk& chunk);
+    void releaseAll();
+    size_t chunkBytes() const;
+    double *chunkTimes(const Chunk& chunk) const;
+    double *chunkKeys(const Chunk& chunk) const;
+    char *chunkRecords(const Chunk& chunk) const;
+
+    // default mode
+    std::deque<SceneState> m_states;
+
+    // compact mode
+    bool m_compact, m_float, m_delta;
+    int m_keyInterval, m_framesPerChunk;
+    size_t m_maxCollisions;
+    std::vector<BodyLayout> m_layout;
+    size_t m_collisionCapacity;
+    size_t m_nvalues;
+    std::deque<Chunk> m_chunks;
+    size_t m_first; // index of the first frame in m_chunks.front()
+    size_t m_size;
+    size_t m_popped; // number of frames popped since clear()
+    // frames whose collisions don't fit in m_maxCollisions, keyed by
+    // m_popped + index
+    std::map<size_t, SceneState> m_overflow;
+    std::vector<double> m_values;
+    mutable SceneState m_cache;
+    mutable size_t m_cacheIndex;
+    mutable std::vector<double> m_decodeBuf;
+
+    // disk spill
+    size_t m_ramLimit, m_ramUsage, m_spilledBytes;
+    std::string m_spillDir;
+    int m_fd;
+    off_t m_fileSize;
+    std::vector<off_t> m_freeOffsets;
+};
+
+inline double logTime(SceneStateLog& i_log, size_t i)
+{
+    return i_log.time(i);
+}
+
+typedef LogManager<SceneState, SceneStateLog> SceneLogManager;
+
+#endif
@@ -1,11 +1,26 @@
+#include <fstream>
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/barrier.hpp>
+#include <hrpModel/Sensor.h>
 #include "Simulator.h"
 #include "hrpsys/util/BodyRTC.h"
 
-Simulator::Simulator(LogManager<SceneState> *i_log) 
-  : log(i_log), adjustTime(false)
+Simulator::Simulator(SceneLogManager *i_log) 
+  : log(i_log), m_realTime(0), adjustTime(false),
+    m_useBroadPhase(true), m_targetPairs(NULL), m_pairsTested(0),
+    m_totalPairsTested(0), m_numCollisionChecks(0),
+    m_numCollisionThreads(1), m_collisionThreads(NULL),
+    m_collisionBarrier(NULL), m_stopCollisionThreads(false),
+    m_rayCastAll(false)
 {
 }
 
+Simulator::~Simulator()
+{
+    setNumCollisionThreads(1);
+}
+
 void Simulator::init(Project &prj, BodyFactory &factory){
     initWorld(prj, factory, *this, pairs);
     initRTS(prj, receivers);
@@ -15,6 +30,29 @@ void Simulator::init(Project &prj, BodyFactory &factory){
     m_kinematicsOnly = prj.kinematicsOnly();
     realTime(prj.realTime());
 
+    setupCollisionPairs();
+    setupRayCastSensors(prj);
+
+    m_nextLogTime = 0;
+    appendLog();
+}
+
+void Simulator::appendLog()
+{
+    if (log && currentTime() >= m_nextLogTime){
+        state.set(*this, collisions);
+        log->add(state);
+        m_nextLogTime += m_logTimeStep;
+    }
+}
+
+void Simulator::checkCollision()
+{
+    checkCollision(collisions);
+}
+
+void Simulator::setupCollisionPairs()
+{
     collisions.length(pairs.size());
     for(size_t colIndex=0; colIndex < pairs.size(); ++colIndex){
         hrp::ColdetLinkPairPtr linkPair = pairs[colIndex];
@@ -26,23 +64,128 @@ void Simulator::init(Project &prj, BodyFactory &factory){
         pair.linkName1 = CORBA::string_dup(link0->name.c_str());
         pair.linkName2 = CORBA::string_dup(link1->name.c_str());
     }
+    m_broadPhase.setPairs(pairs);
+    m_allPairs.resize(pairs.size());
+    for (size_t i=0; i<pairs.size(); i++) m_allPairs[i] = i;
+    m_cdata.resize(pairs.size());
+}
 
-    m_nextLogTime = 0;
-    appendLog();
+static bool isRayCast(const ModelItem& i_model, const std::string& i_name,
+                      bool i_default)
+{
+    std::map<std::string, std::string>::const_iterator it
+        = i_model.sensorSimulation.find(i_name);
+    if (it == i_model.sensorSimulation.end()) return i_default;
+    return it->second == "raycast";
 }
 
-void Simulator::appendLog()
+void Simulator::setupRayCastSensors(Project &prj)
 {
-    if (log && currentTime() >= m_nextLogTime){
-        state.set(*this, collisions);
-        log->add(state);
-        m_nextLogTime += m_logTimeStep;
+    m_rayCaster.clear();
+    m_rayCastRanges.clear();
+    m_rayCastCameras.clear();
+    for (std::map<std::string, ModelItem>::iterator it=prj.models().begin();
+         it != prj.models().end(); it++){
+        const std::string name
+            = it->second.rtcName == "" ? it->first : it->second.rtcName; 
+        int index = bodyIndex(name);
+        if (index < 0) continue;
+        hrp::BodyPtr body = this->body(index);
+        for (int i=0; i<body->numSensors(hrp::Sensor::RANGE); i++){
+            hrp::RangeSensor *s = body->sensor<hrp::RangeSensor>(i);
+            if (isRayCast(it->second, s->name, m_rayCastAll)){
+                m_rayCastRanges.push_back(s);
+            }
+        }
+        for (int i=0; i<body->numSensors(hrp::Sensor::VISION); i++){
+            hrp::VisionSensor *s = body->sensor<hrp::VisionSensor>(i);
+            if (!isRayCast(it->second, s->name, m_rayCastAll)) continue;
+            if (s->imageType != hrp::VisionSensor::DEPTH){
+                std::cerr << "only depth images can be simulated by ray casting, "
+                          << s->name << " is rendered by OpenGL" << std::endl;
+                continue;
+            }
+            m_rayCastCameras.push_back(s);
+        }
     }
+    if (m_rayCastRanges.empty() && m_rayCastCameras.empty()) return;
+
+    for (unsigned int i=0; i<numBodies(); i++){
+        m_rayCaster.addBody(body(i));
+    }
+    std::cout << "number of ray cast sensors:"
+              << m_rayCastRanges.size() + m_rayCastCameras.size() << std::endl;
 }
 
-void Simulator::checkCollision()
+void Simulator::updateRayCastSensors()
 {
-    checkCollision(collisions);
+    bool updated = false;
+    for (size_t i=0; i<m_rayCastRanges.size(); i++){
+        hrp::RangeSensor *s = m_rayCastRanges[i];
+        if (s->nextUpdateTime < currentTime()){
+            if (!updated){
+                m_rayCaster.update();
+                updated = true;
+            }
+            m_rayCaster.updateRangeSensor(s);
+            s->nextUpdateTime += 1.0/s->scanRate;
+        }
+    }
+    for (size_t i=0; i<m_rayCastCameras.size(); i++){
+        hrp::VisionSensor *s = m_rayCastCameras[i];
+        if (!s->isEnabled) continue;
+        if (s->nextUpdateTime < currentTime()){
+            if (!updated){
+                m_rayCaster.update();
+                updated = true;
+            }
+            m_rayCaster.updateVisionSensor(s);
+            s->nextUpdateTime += 1.0/s->frameRate;
+        }
+    }
+}
+
+void Simulator::setNumCollisionThreads(int n)
+{
+    if (n < 1) n = 1;
+    if (m_collisionThreads){
+        m_stopCollisionThreads = true;
+        m_collisionBarrier->wait();
+        m_collisionThreads->join_all();
+        delete m_collisionThreads;
+        delete m_collisionBarrier;
+        m_collisionThreads = NULL;
+        m_collisionBarrier = NULL;
+        m_stopCollisionThreads = false;
+    }
+    m_numCollisionThreads = n;
+    if (n > 1){
+        m_collisionBarrier = new boost::barrier(n);
+        m_collisionThreads = new boost::thread_group();
+        for (int i=1; i<n; i++){
+            m_collisionThreads->create_thread(
+                boost::bind(&Simulator::collisionThreadMain, this, i));
+        }
+    }
+}
+
+void Simulator::collisionThreadMain(int id)
+{
+    while(1){
+        m_collisionBarrier->wait();
+        if (m_stopCollisionThreads) break;
+        detectCollisions(id);
+        m_collisionBarrier->wait();
+    }
+}
+
+void Simulator::detectCollisions(int id)
+{
+    const std::vector<int>& targets = *m_targetPairs;
+    for (size_t i=id; i<targets.size(); i+=m_numCollisionThreads){
+        int colIndex = targets[i];
+        m_cdata[colIndex] = &pairs[colIndex]->detectCollisions();
+    }
 }
 
 void Simulator::checkCollision(OpenHRP::CollisionSequence &collisions)
@@ -50,11 +193,32 @@ void Simulator::checkCollision(OpenHRP::CollisionSequence &collisions)
     for (unsigned int i=0; i<numBodies(); i++){
         body(i)->updateLinkColdetModelPositions();
     }
+    if (m_cdata.size() != pairs.size()) setupCollisionPairs();
+    if (m_useBroadPhase){
+        m_broadPhase.update();
+        m_targetPairs = &m_broadPhase.candidates();
+    }else{
+        m_targetPairs = &m_allPairs;
+    }
+    if (m_collisionThreads){
+        m_collisionBarrier->wait();
+        detectCollisions(0);
+        m_collisionBarrier->wait();
+    }else{
+        detectCollisions(0);
+    }
+    m_pairsTested = m_targetPairs->size();
+    m_totalPairsTested += m_pairsTested;
+    m_numCollisionChecks++;
+
     for(size_t colIndex=0; colIndex < pairs.size(); ++colIndex){
-        hrp::ColdetLinkPairPtr linkPair = pairs[colIndex];
         OpenHRP::Collision& collision = collisions[colIndex];
         OpenHRP::CollisionPointSequence* pCollisionPoints = &collision.points;
-        std::vector<hrp::collision_data>& cdata = linkPair->detectCollisions();
+        if (m_useBroadPhase && !m_broadPhase.isCandidate(colIndex)){
+            pCollisionPoints->length(0);
+            continue;
+        }
+        std::vector<hrp::collision_data>& cdata = *m_cdata[colIndex];
             
         if(cdata.empty()){
             pCollisionPoints->length(0);
@@ -151,40 +315,113 @@ bool Simulator::oneStep(){
         BodyRTC *bodyrtc = dynamic_cast<BodyRTC *>(body(i).get());
         bodyrtc->postOneStep();
     }
-    appendLog();
     tm_dynamics.end();
+
+    if (!m_rayCastRanges.empty() || !m_rayCastCameras.empty()){
+        tm_sensor.begin();
+        updateRayCastSensors();
+        tm_sensor.end();
+    }
+    appendLog();
     
     if (m_totalTime && currentTime() > m_totalTime){
         struct timeval endTime;
         gettimeofday(&endTime, NULL);
-        double realT = (endTime.tv_sec - beginTime.tv_sec)
+        m_realTime = (endTime.tv_sec - beginTime.tv_sec)
             + (endTime.tv_usec - beginTime.tv_usec)/1e6;
-        printf("total     :%8.3f[s], %8.3f[sim/real]\n",
-               realT, m_totalTime/realT);
-        printf("controller:%8.3f[s], %8.3f[ms/frame]\n",
-               tm_control.totalTime(), tm_control.averageTime()*1000);
-        printf("collision :%8.3f[s], %8.3f[ms/frame]\n",
-               tm_collision.totalTime(), tm_collision.averageTime()*1000);
-        printf("dynamics  :%8.3f[s], %8.3f[ms/frame]\n",
-               tm_dynamics.totalTime(), tm_dynamics.averageTime()*1000);
-        for (unsigned int i=0; i<numBodies(); i++){
-            hrp::BodyPtr body = this->body(i);
-            int ntri=0;
-            for (unsigned int j=0; j<body->numLinks(); j++){
-                hrp::Link *l = body->link(j);
-                if (l && l->coldetModel){
-                    ntri += l->coldetModel->getNumTriangles();
-                }
-            }
-            printf("num of triangles : %s : %d\n", body->name().c_str(), ntri);
-        }
-        fflush(stdout);
+        printStatistics();
         return false;
     }else{
         return true;
     }
 }
 
+static int numTriangles(hrp::BodyPtr body)
+{
+    int ntri=0;
+    for (unsigned int j=0; j<body->numLinks(); j++){
+        hrp::Link *l = body->link(j);
+        if (l && l->coldetModel){
+            ntri += l->coldetModel->getNumTriangles();
+        }
+    }
+    return ntri;
+}
+
+void Simulator::printStatistics()
+{
+    printf("total     :%8.3f[s], %8.3f[sim/real]\n",
+           m_realTime, m_totalTime/m_realTime);
+    printf("controller:%8.3f[s], %8.3f[ms/frame]\n",
+           tm_control.totalTime(), tm_control.averageTime()*1000);
+    printf("collision :%8.3f[s], %8.3f[ms/frame]\n",
+           tm_collision.totalTime(), tm_collision.averageTime()*1000);
+    printf("dynamics  :%8.3f[s], %8.3f[ms/frame]\n",
+           tm_dynamics.totalTime(), tm_dynamics.averageTime()*1000);
+    if (!m_rayCastRanges.empty() || !m_rayCastCameras.empty()){
+        printf("sensor    :%8.3f[s], %8.3f[ms/frame]\n",
+               tm_sensor.totalTime(), tm_sensor.averageTime()*1000);
+    }
+    printf("collision pairs : %8.1f tested/frame of %d\n",
+           m_numCollisionChecks ? (double)m_totalPairsTested/m_numCollisionChecks : 0.0,
+           (int)pairs.size());
+    for (unsigned int i=0; i<numBodies(); i++){
+        hrp::BodyPtr body = this->body(i);
+        printf("num of triangles : %s : %d\n", body->name().c_str(),
+               numTriangles(body));
+    }
+    fflush(stdout);
+}
+
+static void writeTimeMeasure(std::ostream& os, const char *name,
+                             TimeMeasure& tm)
+{
+    os << "  \"" << name << "\": {\"total\": " << tm.totalTime()
+       << ", \"average\": " << tm.averageTime() << "}," << std::endl;
+}
+
+bool Simulator::saveReport(const std::string& fname)
+{
+    std::ofstream ofs(fname.c_str());
+    if (!ofs.is_open()) return false;
+    ofs.precision(10);
+    ofs << "{" << std::endl;
+    ofs << "  \"time\": " << currentTime() << "," << std::endl;
+    ofs << "  \"timestep\": " << timeStep() << "," << std::endl;
+    ofs << "  \"real_time\": " << m_realTime << "," << std::endl;
+    writeTimeMeasure(ofs, "tm_control", tm_control);
+    writeTimeMeasure(ofs, "tm_collision", tm_collision);
+    writeTimeMeasure(ofs, "tm_dynamics", tm_dynamics);
+    writeTimeMeasure(ofs, "tm_sensor", tm_sensor);
+    ofs << "  \"collision_pairs\": " << pairs.size() << "," << std::endl;
+    ofs << "  \"collision_pairs_tested\": "
+        << (m_numCollisionChecks ? (double)m_totalPairsTested/m_numCollisionChecks : 0.0)
+        << "," << std::endl;
+    ofs << "  \"bodies\": {" << std::endl;
+    for (unsigned int i=0; i<numBodies(); i++){
+        hrp::BodyPtr body = this->body(i);
+        hrp::Link *root = body->rootLink();
+        hrp::Vector3 rpy = hrp::rpyFromRot(root->attitude());
+        ofs << "    \"" << body->name() << "\": {" << std::endl;
+        ofs << "      \"triangles\": " << numTriangles(body) << "," << std::endl;
+        ofs << "      \"p\": [" << root->p[0] << ", " << root->p[1] << ", "
+            << root->p[2] << "]," << std::endl;
+        ofs << "      \"rpy\": [" << rpy[0] << ", " << rpy[1] << ", "
+            << rpy[2] << "]," << std::endl;
+        ofs << "      \"q\": [";
+        for (unsigned int j=0; j<body->numJoints(); j++){
+            hrp::Link *l = body->joint(j);
+            if (j) ofs << ", ";
+            ofs << (l ? l->q : 0.0);
+        }
+        ofs << "]" << std::endl;
+        ofs << "    }" << (i+1 < numBodies() ? "," : "") << std::endl;
+    }
+    ofs << "  }" << std::endl;
+    ofs << "}" << std::endl;
+    return true;
+}
+
 void Simulator::clear()
 {
     RTC::Manager* manager = &RTC::Manager::instance();
@@ -197,6 +434,7 @@ void Simulator::clear()
     constraintForceSolver.clearCollisionCheckLinkPairs();
     setCurrentTime(0.0);
     pairs.clear();
+    setupCollisionPairs();
     receivers.clear();
 }
 
@@ -229,17 +467,7 @@ void Simulator::addCollisionCheckPair(BodyRTC *bodyPtr1, BodyRTC *bodyPtr2)
         }
     }
 
-    collisions.length(pairs.size());
-    for(size_t colIndex=0; colIndex < pairs.size(); ++colIndex){
-        hrp::ColdetLinkPairPtr linkPair = pairs[colIndex];
-        hrp::Link *link0 = linkPair->link(0);
-        hrp::Link *link1 = linkPair->link(1);
-        OpenHRP::LinkPair& pair = collisions[colIndex].pair;
-        pair.charName1 = CORBA::string_dup(link0->body->name().c_str());
-        pair.charName2 = CORBA::string_dup(link1->body->name().c_str());
-        pair.linkName1 = CORBA::string_dup(link0->name.c_str());
-        pair.linkName2 = CORBA::string_dup(link1->name.c_str());
-    }
+    setupCollisionPairs();
 }
 
 void Simulator::kinematicsOnly(bool flag)
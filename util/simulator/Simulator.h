@@ -4,18 +4,24 @@
 #include <hrpUtil/TimeMeasure.h>
 #include "hrpsys/util/Project.h"
 #include "hrpsys/util/ThreadedObject.h"
-#include "hrpsys/util/LogManager.h"
 #include "hrpsys/util/ProjectUtil.h"
-#include "SceneState.h"
+#include "hrpsys/util/RayCaster.h"
+#include "SceneStateLog.h"
+#include "SweepAndPrune.h"
 
 class BodyRTC;
 class SDL_Thread;
+namespace boost{
+    class barrier;
+    class thread_group;
+}
 
 class Simulator : virtual public hrp::World<hrp::ConstraintForceSolver>,
     public ThreadedObject
 {
 public:
-    Simulator(LogManager<SceneState> *i_log);
+    Simulator(SceneLogManager *i_log);
+    ~Simulator();
     void init(Project &prj, BodyFactory &factory);
     bool oneStep();
     void checkCollision(OpenHRP::CollisionSequence &collisions);
@@ -28,15 +34,46 @@ public:
     void appendLog();
     void addCollisionCheckPair(BodyRTC *b1, BodyRTC *b2);
     void kinematicsOnly(bool flag);
+    void useBroadPhase(bool flag) { m_useBroadPhase = flag; }
+    void setNumCollisionThreads(int n);
+    int numPairsTested() { return m_pairsTested; }
+    // simulate all range sensors and depth cameras by ray casting
+    void rayCastSensors(bool flag) { m_rayCastAll = flag; }
+    void setNumRayCastThreads(int n) { m_rayCaster.setNumThreads(n); }
+    const std::vector<hrp::VisionSensor *>& rayCastCameras() { return m_rayCastCameras; }
+    void printStatistics();
+    bool saveReport(const std::string& fname);
 private:
-    LogManager<SceneState> *log;
+    void setupCollisionPairs();
+    void detectCollisions(int id);
+    void collisionThreadMain(int id);
+    void setupRayCastSensors(Project &prj);
+    void updateRayCastSensors();
+    SceneLogManager *log;
     std::vector<ClockReceiver> receivers;
     std::vector<hrp::ColdetLinkPairPtr> pairs;
     OpenHRP::CollisionSequence collisions;
     SceneState state;
-    double m_totalTime, m_logTimeStep, m_nextLogTime;
-    TimeMeasure tm_dynamics, tm_control, tm_collision;
+    double m_totalTime, m_logTimeStep, m_nextLogTime, m_realTime;
+    TimeMeasure tm_dynamics, tm_control, tm_collision, tm_sensor;
     bool adjustTime, m_kinematicsOnly;
     std::deque<struct timeval> startTimes;
     struct timeval beginTime;
+    // collision detection
+    SweepAndPrune m_broadPhase;
+    bool m_useBroadPhase;
+    std::vector<int> m_allPairs;
+    const std::vector<int> *m_targetPairs;
+    std::vector<std::vector<hrp::collision_data> *> m_cdata;
+    int m_pairsTested;
+    long long m_totalPairsTested, m_numCollisionChecks;
+    int m_numCollisionThreads;
+    boost::thread_group *m_collisionThreads;
+    boost::barrier *m_collisionBarrier;
+    bool m_stopCollisionThreads;
+    // sensors simulated by ray casting
+    RayCaster m_rayCaster;
+    bool m_rayCastAll;
+    std::vector<hrp::RangeSensor *> m_rayCastRanges;
+    std::vector<hrp::VisionSensor *> m_rayCastCameras;
 };
@@ -0,0 +1,115 @@
+#include <cfloat>
+#include <cmath>
+#include <algorithm>
+#include <hrpModel/Link.h>
+#include "SweepAndPrune.h"
+
+using namespace hrp;
+
+SweepAndPrune::SweepAndPrune(double i_margin) : m_margin(i_margin)
+{
+}
+
+int SweepAndPrune::boxIndex(Link *i_link)
+{
+    for (size_t i=0; i<m_boxes.size(); i++){
+        if (m_boxes[i].link == i_link) return i;
+    }
+    Box box;
+    box.link = i_link;
+    box.bounded = false;
+    ColdetModelPtr model = i_link->coldetModel;
+    if (model && model->getNumVertices()
+        && model->getPrimitiveType() != ColdetModel::SP_PLANE){
+        std::vector<Vector3> boundingBoxData;
+        model->getBoundingBoxData(0, boundingBoxData);
+        if (boundingBoxData.size() == 2){
+            box.center = boundingBoxData[0];
+            box.halfSize = boundingBoxData[1];
+            box.bounded = true;
+        }
+    }
+    // links without bounding box are tested with every other link
+    for (int k=0; k<3; k++){
+        box.min[k] = -DBL_MAX;
+        box.max[k] = DBL_MAX;
+    }
+    m_boxes.push_back(box);
+    m_order.push_back(m_boxes.size()-1);
+    return m_boxes.size()-1;
+}
+
+void SweepAndPrune::setPairs(const std::vector<ColdetLinkPairPtr>& i_pairs)
+{
+    m_boxes.clear();
+    m_order.clear();
+    m_pairIndices.clear();
+    for (size_t i=0; i<i_pairs.size(); i++){
+        int b0 = boxIndex(i_pairs[i]->link(0));
+        int b1 = boxIndex(i_pairs[i]->link(1));
+        m_pairIndices[std::make_pair(std::min(b0,b1), std::max(b0,b1))].push_back(i);
+    }
+    m_isCandidate.resize(i_pairs.size());
+    m_candidates.reserve(i_pairs.size());
+    m_active.reserve(m_boxes.size());
+}
+
+void SweepAndPrune::updateBox(Box& box)
+{
+    if (!box.bounded) return;
+    Link *l = box.link;
+    Matrix33 R(l->attitude());
+    Vector3 c(l->p + R*box.center);
+    for (int k=0; k<3; k++){
+        double h = fabs(R(k,0))*box.halfSize[0] + fabs(R(k,1))*box.halfSize[1]
+            + fabs(R(k,2))*box.halfSize[2] + m_margin;
+        box.min[k] = c[k] - h;
+        box.max[k] = c[k] + h;
+    }
+}
+
+void SweepAndPrune::update()
+{
+    for (size_t i=0; i<m_boxes.size(); i++) updateBox(m_boxes[i]);
+
+    // insertion sort is almost linear since the order changes little
+    // between steps
+    for (size_t i=1; i<m_order.size(); i++){
+        int b = m_order[i];
+        double x = m_boxes[b].min[0];
+        int j = i - 1;
+        while (j >= 0 && m_boxes[m_order[j]].min[0] > x){
+            m_order[j+1] = m_order[j];
+            j--;
+        }
+        m_order[j+1] = b;
+    }
+
+    std::fill(m_isCandidate.begin(), m_isCandidate.end(), 0);
+    m_candidates.clear();
+    m_active.clear();
+    for (size_t i=0; i<m_order.size(); i++){
+        int b = m_order[i];
+        const Box& box = m_boxes[b];
+        size_t n=0;
+        for (size_t j=0; j<m_active.size(); j++){
+            int a = m_active[j];
+            const Box& other = m_boxes[a];
+            if (other.max[0] < box.min[0]) continue;
+            m_active[n++] = a;
+            if (other.max[1] < box.min[1] || box.max[1] < other.min[1]
+                || other.max[2] < box.min[2] || box.max[2] < other.min[2]){
+                continue;
+            }
+            std::map<std::pair<int,int>, std::vector<int> >::const_iterator it
+                = m_pairIndices.find(std::make_pair(std::min(a,b), std::max(a,b)));
+            if (it == m_pairIndices.end()) continue;
+            for (size_t k=0; k<it->second.size(); k++){
+                m_isCandidate[it->second[k]] = 1;
+                m_candidates.push_back(it->second[k]);
+            }
+        }
+        m_active.resize(n);
+        m_active.push_back(b);
+    }
+}
@@ -0,0 +1,41 @@
+#ifndef __SWEEP_AND_PRUNE_H__
+#define __SWEEP_AND_PRUNE_H__
+
+#include <map>
+#include <vector>
+#include <hrpModel/ColdetLinkPair.h>
+
+/**
+   broad phase of collision detection. Axis aligned bounding boxes of links
+   are swept along x axis and pairs whose boxes overlap are reported as
+   candidates for the narrow phase.
+ */
+class SweepAndPrune
+{
+public:
+    SweepAndPrune(double i_margin=0.005);
+    void setPairs(const std::vector<hrp::ColdetLinkPairPtr>& i_pairs);
+    // update boxes with the current link positions and find candidates
+    void update();
+    // indices of pairs whose bounding boxes overlap
+    const std::vector<int>& candidates() const { return m_candidates; }
+    bool isCandidate(int i) const { return m_isCandidate[i]; }
+private:
+    struct Box {
+        hrp::Link *link;
+        bool bounded;
+        hrp::Vector3 center, halfSize; // in the link frame
+        double min[3], max[3];         // in the world frame
+    };
+    int boxIndex(hrp::Link *i_link);
+    void updateBox(Box& box);
+
+    double m_margin;
+    std::vector<Box> m_boxes;
+    std::vector<int> m_order, m_active;
+    std::map<std::pair<int,int>, std::vector<int> > m_pairIndices;
+    std::vector<int> m_candidates;
+    std::vector<char> m_isCandidate;
+};
+
+#endif
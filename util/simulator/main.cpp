@@ -24,15 +24,16 @@ using namespace std;
 using namespace hrp;
 using namespace OpenHRP;
 
+// scene == NULL : headless mode, BodyRTC without GL resources is created
 hrp::BodyPtr createBody(const std::string& name, const ModelItem& mitem,
                         ModelLoader_ptr modelloader, GLscene *scene,
                         bool usebbox)
 {
     std::cout << "createBody(" << name << "," << mitem.url << ")" << std::endl;
     RTC::Manager& manager = RTC::Manager::instance();
-    std::string args = "GLbodyRTC?instance_name="+name;
-    GLbodyRTC *glbodyrtc = (GLbodyRTC *)manager.createComponent(args.c_str());
-    hrp::BodyPtr body = hrp::BodyPtr(glbodyrtc);
+    std::string args = (scene ? "GLbodyRTC?instance_name=" : "BodyRTC?instance_name=")+name;
+    BodyRTC *bodyrtc = (BodyRTC *)manager.createComponent(args.c_str());
+    hrp::BodyPtr body = hrp::BodyPtr(bodyrtc);
     BodyInfo_var binfo;
     try{
         OpenHRP::ModelLoader::ModelLoadOption opt;
@@ -44,11 +45,14 @@ hrp::BodyPtr createBody(const std::string& name, const ModelItem& mitem,
         std::cerr << ex.description << std::endl;
         return hrp::BodyPtr();
     }
-    if (!loadBodyFromBodyInfo(body, binfo, true, GLlinkFactory)){
+    bool loaded = scene ? loadBodyFromBodyInfo(body, binfo, true, GLlinkFactory)
+        : loadBodyFromBodyInfo(body, binfo, true);
+    if (!loaded){
         std::cerr << "failed to load model[" << mitem.url << "]" << std::endl;
-        manager.deleteComponent(glbodyrtc);
+        manager.deleteComponent(bodyrtc);
         return hrp::BodyPtr();
     }else{
+        ConvexHullCache hullCache(convexHullCacheFile(mitem.url));
         for (std::map<std::string, JointItem>::const_iterator it2=mitem.joint.begin();
              it2 != mitem.joint.end(); it2++){
             hrp::Link *link = body->link(it2->first);
@@ -57,7 +61,7 @@ hrp::BodyPtr createBody(const std::string& name, const ModelItem& mitem,
             if (it2->second.collisionShape == ""){
                 // do nothing
             }else if (it2->second.collisionShape == "convex hull"){
-                convertToConvexHull(link);
+                hullCache.convertToConvexHull(link);
             }else if (it2->second.collisionShape == "AABB"){
                 convertToAABB(link);
             }else{
@@ -65,17 +69,19 @@ hrp::BodyPtr createBody(const std::string& name, const ModelItem& mitem,
                           << it2->second.collisionShape << std::endl;
             }
         }
-        glbodyrtc->setup();
+        bodyrtc->setup();
         if (usebbox) convertToAABB(body);
         for (size_t i=0; i<mitem.inports.size(); i++){
-            glbodyrtc->createInPort(mitem.inports[i]);
+            bodyrtc->createInPort(mitem.inports[i]);
         }
         for (size_t i=0; i<mitem.outports.size(); i++){
-            glbodyrtc->createOutPort(mitem.outports[i]);
+            bodyrtc->createOutPort(mitem.outports[i]);
         }
-        loadShapeFromBodyInfo(glbodyrtc, binfo);
         body->setName(name);
-        scene->addBody(body);
+        if (scene){
+            loadShapeFromBodyInfo(dynamic_cast<GLbodyRTC *>(bodyrtc), binfo);
+            scene->addBody(body);
+        }
         return body;
     }
 }
@@ -85,6 +91,13 @@ void print_usage(char* progname)
     std::cerr << "Usage:" << progname << " [project file] [options]" << std::endl;
     std::cerr << "Options:" << std::endl;
     std::cerr << " -nodisplay         : headless mode" << std::endl;
+    std::cerr << " -batch             : fast batch mode (no viewer, no log, no naming service)" << std::endl;
+    std::cerr << " -modelloader [ior] : IOR or corbaloc URL of ModelLoader (naming service is not used)" << std::endl;
+    std::cerr << " -report [file]     : save timing statistics and final states as JSON" << std::endl;
+    std::cerr << " -collision-threads [n] : number of threads used for collision detection" << std::endl;
+    std::cerr << " -no-broad-phase    : check all collision pairs without bounding box culling" << std::endl;
+    std::cerr << " -raycast-sensors   : simulate range sensors and depth cameras by ray casting on CPU" << std::endl;
+    std::cerr << " -raycast-threads [n] : number of threads used for ray casting (0: number of CPUs)" << std::endl;
     std::cerr << " -realtime          : syncronize to real world time" << std::endl;
     std::cerr << " -usebbox           : use bounding box for collision detection" << std::endl;
     std::cerr << " -endless           : endless mode" << std::endl;
@@ -93,6 +106,11 @@ void print_usage(char* progname)
     std::cerr << " -no-default-lights : disable ambient light (simulation environment will be dark)" << std::endl;
     std::cerr << " -max-edge-length [value] : specify maximum length of polygon edge (if exceed, polygon will be divided to improve rendering quality)" << std::endl;
     std::cerr << " -max-log-length [value] : specify maximum size of the log" << std::endl;
+    std::cerr << " -compact-log       : store the log in compact flat arrays" << std::endl;
+    std::cerr << " -log-float         : store the compact log in single precision" << std::endl;
+    std::cerr << " -log-delta [frames]: store the compact log as differences from key frames recorded every [frames]" << std::endl;
+    std::cerr << " -log-ram-limit [MB]: spill the compact log exceeding the limit to a memory-mapped file" << std::endl;
+    std::cerr << " -log-spill-dir [dir] : directory where the spill file is created" << std::endl;
     std::cerr << " -exit-on-finish    : exit the program when the simulation finish" << std::endl;
     std::cerr << " -record            : record the simulation as movie" << std::endl;
     std::cerr << " -bg [r] [g] [b]    : specify background color" << std::endl;
@@ -101,7 +119,12 @@ void print_usage(char* progname)
 
 int main(int argc, char* argv[]) 
 {
-    bool display = true, usebbox=false;
+    bool display = true, usebbox=false, batch = false;
+    std::string modelLoaderIOR, reportFile;
+    int collisionThreads = 1;
+    bool broadPhase = true;
+    bool raycastSensors = false;
+    int raycastThreads = 0;
     bool showsensors = false;
     int wsize = 0;
     bool useDefaultLights = true;
@@ -111,6 +134,10 @@ int main(int argc, char* argv[])
     double maxLogLen = 60;
     bool realtime = false;
     bool endless = false;
+    bool compactLog = false, logFloat = false;
+    int logKeyInterval = 0;
+    double logRamLimit = 0;
+    std::string logSpillDir;
 
     if (argc <= 1){
         print_usage(argv[0]);
@@ -121,6 +148,21 @@ int main(int argc, char* argv[])
     for (int i=1; i<argc; i++){
         if (strcmp("-nodisplay",argv[i])==0){
             display = false;
+        }else if(strcmp("-batch", argv[i])==0){
+            batch = true;
+            display = false;
+        }else if(strcmp("-modelloader", argv[i])==0){
+            modelLoaderIOR = argv[++i];
+        }else if(strcmp("-report", argv[i])==0){
+            reportFile = argv[++i];
+        }else if(strcmp("-collision-threads", argv[i])==0){
+            collisionThreads = atoi(argv[++i]);
+        }else if(strcmp("-no-broad-phase", argv[i])==0){
+            broadPhase = false;
+        }else if(strcmp("-raycast-sensors", argv[i])==0){
+            raycastSensors = true;
+        }else if(strcmp("-raycast-threads", argv[i])==0){
+            raycastThreads = atoi(argv[++i]);
         }else if(strcmp("-realtime", argv[i])==0){
             realtime = true;
         }else if(strcmp("-usebbox", argv[i])==0){
@@ -137,6 +179,16 @@ int main(int argc, char* argv[])
             maxEdgeLen = atof(argv[++i]);
         }else if(strcmp("-max-log-length", argv[i])==0){
             maxLogLen = atof(argv[++i]);
+        }else if(strcmp("-compact-log", argv[i])==0){
+            compactLog = true;
+        }else if(strcmp("-log-float", argv[i])==0){
+            logFloat = true;
+        }else if(strcmp("-log-delta", argv[i])==0){
+            logKeyInterval = atoi(argv[++i]);
+        }else if(strcmp("-log-ram-limit", argv[i])==0){
+            logRamLimit = atof(argv[++i]);
+        }else if(strcmp("-log-spill-dir", argv[i])==0){
+            logSpillDir = argv[++i];
         }else if(strcmp("-exit-on-finish", argv[i])==0){
             exitOnFinish = true;
         }else if(strcmp("-record", argv[i])==0){
@@ -170,6 +222,13 @@ int main(int argc, char* argv[])
     std::vector<char *> rtmargv;
     for (int i=1; i<argc; i++){
         if (strcmp(argv[i], "-nodisplay") 
+            && strcmp(argv[i], "-batch")
+            && strcmp(argv[i], "-modelloader")
+            && strcmp(argv[i], "-report")
+            && strcmp(argv[i], "-collision-threads")
+            && strcmp(argv[i], "-no-broad-phase")
+            && strcmp(argv[i], "-raycast-sensors")
+            && strcmp(argv[i], "-raycast-threads")
             && strcmp(argv[i], "-realtime")
             && strcmp(argv[i], "-usebbox")
             && strcmp(argv[i], "-endless")
@@ -178,6 +237,11 @@ int main(int argc, char* argv[])
             && strcmp(argv[i], "-no-default-lights")
             && strcmp(argv[i], "-max-edge-length")
             && strcmp(argv[i], "-max-log-length")
+            && strcmp(argv[i], "-compact-log")
+            && strcmp(argv[i], "-log-float")
+            && strcmp(argv[i], "-log-delta")
+            && strcmp(argv[i], "-log-ram-limit")
+            && strcmp(argv[i], "-log-spill-dir")
             && strcmp(argv[i], "-exit-on-finish")
             && strcmp(argv[i], "-record")
             && strcmp(argv[i], "-bg")
@@ -186,33 +250,64 @@ int main(int argc, char* argv[])
             rtmargc++;
         }
     }
+    char naming_opt[] = "-o", naming_disable[] = "naming.enable:NO";
+    if (batch){
+        // components are connected in this process, see findRTC()
+        rtmargv.push_back(naming_opt);
+        rtmargv.push_back(naming_disable);
+        rtmargc += 2;
+    }
     manager = RTC::Manager::init(rtmargc, rtmargv.data());
     manager->init(rtmargc, rtmargv.data());
     GLbodyRTC::moduleInit(manager);
+    BodyRTC::moduleInit(manager);
     manager->activateManager();
     manager->runManager(true);
 
-    std::string nameServer = manager->getConfig()["corba.nameservers"];
-    int comPos = nameServer.find(",");
-    if (comPos < 0){
-        comPos = nameServer.length();
+    ModelLoader_var modelloader;
+    if (modelLoaderIOR != ""){
+        try{
+            CORBA::Object_var obj
+                = manager->getORB()->string_to_object(modelLoaderIOR.c_str());
+            modelloader = ModelLoader::_narrow(obj);
+        }catch(CORBA::SystemException& ex){
+            std::cerr << "invalid ModelLoader reference:" << modelLoaderIOR
+                      << std::endl;
+        }
+    }else{
+        std::string nameServer = manager->getConfig()["corba.nameservers"];
+        int comPos = nameServer.find(",");
+        if (comPos < 0){
+            comPos = nameServer.length();
+        }
+        nameServer = nameServer.substr(0, comPos);
+        RTC::CorbaNaming naming(manager->getORB(), nameServer.c_str());
+        modelloader = getModelLoader(CosNaming::NamingContext::_duplicate(naming.getRootContext()));
     }
-    nameServer = nameServer.substr(0, comPos);
-    RTC::CorbaNaming naming(manager->getORB(), nameServer.c_str());
-
-    ModelLoader_var modelloader = getModelLoader(CosNaming::NamingContext::_duplicate(naming.getRootContext()));
     if (CORBA::is_nil(modelloader)){
         std::cerr << "openhrp-model-loader is not running" << std::endl;
         return 1;
     }
     //==================== Viewer setup ===============
-    LogManager<SceneState> log;
+    SceneLogManager log;
+    if (compactLog){
+        SceneStateLog& storage = log.storage();
+        storage.setCompact(true);
+        storage.useFloat(logFloat);
+        if (logKeyInterval > 0) storage.useDelta(true, logKeyInterval);
+        storage.setRamLimit(logRamLimit*1024*1024);
+        if (!logSpillDir.empty()) storage.setSpillDirectory(logSpillDir);
+    }
     GLscene scene(&log);
     scene.setBackGroundColor(bgColor);
     scene.showSensors(showsensors);
     scene.maxEdgeLen(maxEdgeLen);
     scene.showCollision(prj.view().showCollision);
-    Simulator simulator(&log);
+    Simulator simulator(batch ? NULL : &log);
+    simulator.useBroadPhase(broadPhase);
+    simulator.setNumCollisionThreads(collisionThreads);
+    simulator.rayCastSensors(raycastSensors);
+    simulator.setNumRayCastThreads(raycastThreads);
 
     SDLwindow window(&scene, &log, &simulator);
     if (display){
@@ -223,8 +318,12 @@ int main(int argc, char* argv[])
     }
 
     //================= setup Simulator ======================
-    BodyFactory factory = boost::bind(createBody, _1, _2, modelloader, &scene, usebbox);
+    BodyFactory factory = boost::bind(createBody, _1, _2, modelloader,
+                                      batch ? NULL : &scene, usebbox);
     simulator.init(prj, factory);
+    for (size_t i=0; i<simulator.rayCastCameras().size(); i++){
+        scene.disableOffscreenRendering(simulator.rayCastCameras()[i]);
+    }
     if (!prj.totalTime()){
         log.enableRingBuffer(maxLogLen/prj.timeStep());
     }
@@ -247,6 +346,9 @@ int main(int argc, char* argv[])
     }else{
         while (simulator.oneStep());
     }
+    if (reportFile != "" && !simulator.saveReport(reportFile)){
+        std::cerr << "failed to save a report to " << reportFile << std::endl;
+    }
 
     manager->shutdown();
 